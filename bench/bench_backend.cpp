@@ -0,0 +1,83 @@
+#include "backend/backend.hpp"
+#include "bench/harness.hpp"
+
+#ifdef BACKEND_UINPUT_SINK
+#include "backend/uinput_backend.hpp"
+#endif
+
+namespace {
+
+using backend::Key;
+using backend::Modifier;
+
+// Only the uinput backend can be pointed at a sink (BACKEND_UINPUT_SINK);
+// elsewhere these would type into whatever window has focus.
+bool hasSink(bench::State &state, backend::InputBackend &backend) {
+#ifdef BACKEND_UINPUT_SINK
+  if (backend.isReady()) {
+    backend.setKeyDelay(0);
+    return true;
+  }
+  state.skip("cannot open " BACKEND_UINPUT_SINK);
+#else
+  (void)backend;
+  state.skip("the injection backend has no non-device sink here");
+#endif
+  return false;
+}
+
+} // namespace
+
+TYPR_BENCHMARK("backend/keyDown+keyUp") {
+  backend::InputBackend backend;
+  if (!hasSink(state, backend)) {
+    return;
+  }
+  state.setItemsPerIteration(1);
+  while (state.keepRunning()) {
+    backend.keyDown(Key::A);
+    backend.keyUp(Key::A);
+  }
+}
+
+TYPR_BENCHMARK("backend/tap") {
+  backend::InputBackend backend;
+  if (!hasSink(state, backend)) {
+    return;
+  }
+  state.setItemsPerIteration(1);
+  while (state.keepRunning()) {
+    bench::doNotOptimize(backend.tap(Key::E));
+  }
+}
+
+TYPR_BENCHMARK("backend/combo Ctrl+Shift+S") {
+  backend::InputBackend backend;
+  if (!hasSink(state, backend)) {
+    return;
+  }
+  state.setItemsPerIteration(1);
+  while (state.keepRunning()) {
+    bench::doNotOptimize(
+        backend.combo(Modifier::Ctrl | Modifier::Shift, Key::S));
+  }
+}
+
+// The same pair without the InputBackend indirection, as MacroPlayer drives
+// uinput: compare with backend/keyDown+keyUp
+TYPR_BENCHMARK("backend/keyDown+keyUp bound") {
+#ifdef BACKEND_UINPUT_SINK
+  backend::UinputBackend backend(BACKEND_UINPUT_SINK);
+  if (!backend.isReady()) {
+    state.skip("cannot open " BACKEND_UINPUT_SINK);
+    return;
+  }
+  state.setItemsPerIteration(1);
+  while (state.keepRunning()) {
+    backend.keyDown(Key::A);
+    backend.keyUp(Key::A);
+  }
+#else
+  state.skip("no concrete backend with a non-device sink here");
+#endif
+}
@@ -0,0 +1,81 @@
+#include "backend/backend.hpp"
+#include "bench/harness.hpp"
+
+#include <array>
+#include <string>
+
+namespace {
+
+using backend::Key;
+
+// A spread over the enum, so linear scans are not measured at one end only
+constexpr std::array kKeys = {Key::A,         Key::Z,         Key::Num5,
+                              Key::F12,       Key::Enter,     Key::Left,
+                              Key::Numpad7,   Key::ShiftLeft, Key::SuperRight,
+                              Key::VolumeUp,  Key::Grave,     Key::Slash};
+
+// Names as they appear in layout files: canonical, lower case and aliases
+const std::array<std::string, 8> kNames = {
+    "A", "enter", "ShiftLeft", "F12", "esc", "numpad7", "bracketleft", "Slash"};
+
+} // namespace
+
+TYPR_BENCHMARK("keys/keyToString") {
+  state.setItemsPerIteration(kKeys.size());
+  while (state.keepRunning()) {
+    for (const Key key : kKeys) {
+      bench::doNotOptimize(backend::keyToString(key));
+    }
+  }
+}
+
+TYPR_BENCHMARK("keys/keyName") {
+  state.setItemsPerIteration(kKeys.size());
+  while (state.keepRunning()) {
+    for (const Key key : kKeys) {
+      bench::doNotOptimize(backend::keyName(key));
+    }
+  }
+}
+
+TYPR_BENCHMARK("keys/stringToKey") {
+  state.setItemsPerIteration(kNames.size());
+  while (state.keepRunning()) {
+    for (const std::string &name : kNames) {
+      bench::doNotOptimize(backend::stringToKey(name));
+    }
+  }
+}
+
+TYPR_BENCHMARK("keys/stringToKey unknown") {
+  const std::string name = "NotAKeyName";
+  while (state.keepRunning()) {
+    bench::doNotOptimize(backend::stringToKey(name));
+  }
+}
+
+// What key captions pay on a layout or modifier change that misses their
+// cache: resolving every key of one keymap state
+TYPR_BENCHMARK("keymap/captions") {
+  const backend::Keymap keymap;
+  if (!keymap.isAvailable()) {
+    state.skip("no platform keymap (needs a display)");
+    return;
+  }
+  backend::Keymap::Captions captions;
+  while (state.keepRunning()) {
+    keymap.captions(0, captions);
+    bench::doNotOptimize(captions);
+  }
+}
+
+TYPR_BENCHMARK("keymap/poll") {
+  backend::Keymap keymap;
+  if (!keymap.isAvailable()) {
+    state.skip("no platform keymap (needs a display)");
+    return;
+  }
+  while (state.keepRunning()) {
+    bench::doNotOptimize(keymap.poll());
+  }
+}
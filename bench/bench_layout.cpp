@@ -0,0 +1,134 @@
+#include "backend/backend.hpp"
+#include "bench/harness.hpp"
+#include "core/geometry.hpp"
+#include "core/keyboard_controller.hpp"
+#include "core/layout.hpp"
+#include "core/layout_file.hpp"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QWidget>
+#include <array>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using backend::Key;
+
+// The shape of a full-size main block: five rows, 61 keys
+std::vector<layout::Element> buildQwerty(core::KeyboardController *controller,
+                                         QWidget *parent, bool createButtons) {
+  layout::ElementListBuilder builder(controller, parent, createButtons);
+  for (const Key key :
+       {Key::Grave, Key::Num1, Key::Num2, Key::Num3, Key::Num4, Key::Num5,
+        Key::Num6, Key::Num7, Key::Num8, Key::Num9, Key::Num0, Key::Minus,
+        Key::Equal}) {
+    builder.addKey(key);
+  }
+  builder.addKey(Key::Backspace, 2.0F);
+  builder.nextRow();
+  builder.addKey(Key::Tab, 1.5F);
+  for (const Key key : {Key::Q, Key::W, Key::E, Key::R, Key::T, Key::Y, Key::U,
+                        Key::I, Key::O, Key::P, Key::LeftBracket,
+                        Key::RightBracket}) {
+    builder.addKey(key);
+  }
+  builder.addKey(Key::Backslash, 1.5F);
+  builder.nextRow();
+  builder.addKey(Key::CapsLock, 1.75F, true);
+  for (const Key key : {Key::A, Key::S, Key::D, Key::F, Key::G, Key::H, Key::J,
+                        Key::K, Key::L, Key::Semicolon, Key::Apostrophe}) {
+    builder.addKey(key);
+  }
+  builder.addKey(Key::Enter, 2.25F);
+  builder.nextRow();
+  builder.addKey(Key::ShiftLeft, 2.25F, true);
+  for (const Key key : {Key::Z, Key::X, Key::C, Key::V, Key::B, Key::N, Key::M,
+                        Key::Comma, Key::Period, Key::Slash}) {
+    builder.addKey(key);
+  }
+  builder.addKey(Key::ShiftRight, 2.75F, true);
+  builder.nextRow();
+  builder.addKey(Key::CtrlLeft, 1.25F, true);
+  builder.addKey(Key::SuperLeft, 1.25F, true);
+  builder.addKey(Key::AltLeft, 1.25F, true);
+  builder.addKey(Key::Space, 6.25F);
+  builder.addKey(Key::AltRight, 1.25F, true);
+  builder.addKey(Key::SuperRight, 1.25F, true);
+  builder.addKey(Key::Menu, 1.25F);
+  builder.addKey(Key::CtrlRight, 1.25F, true);
+  return std::move(builder).build();
+}
+
+void benchmarkBuild(bench::State &state, bool createButtons) {
+  backend::InputBackend backend;
+  core::KeyboardController controller(&backend);
+  while (state.keepRunning()) {
+    auto parent = std::make_unique<QWidget>();
+    auto elements = buildQwerty(&controller, parent.get(), createButtons);
+    bench::doNotOptimize(elements.data());
+
+    // Tearing the keys down again is not part of the measurement
+    state.pauseTiming();
+    elements.clear();
+    parent.reset();
+    state.resumeTiming();
+  }
+}
+
+} // namespace
+
+TYPR_BENCHMARK("layout/ElementListBuilder widgets") {
+  benchmarkBuild(state, true);
+}
+
+TYPR_BENCHMARK("layout/ElementListBuilder painted") {
+  benchmarkBuild(state, false);
+}
+
+TYPR_BENCHMARK("layout/toQtLayout") {
+  backend::InputBackend backend;
+  core::KeyboardController controller(&backend);
+  QWidget parent;
+  const auto elements = buildQwerty(&controller, &parent, true);
+  while (state.keepRunning()) {
+    QVBoxLayout *qtLayout = layout::toQtLayout(elements);
+    bench::doNotOptimize(qtLayout);
+
+    state.pauseTiming();
+    delete qtLayout;
+    state.resumeTiming();
+  }
+}
+
+// Every call is a cache miss: more sizes than the geometry keeps
+TYPR_BENCHMARK("layout/Geometry solve") {
+  backend::InputBackend backend;
+  core::KeyboardController controller(&backend);
+  const auto elements = buildQwerty(&controller, nullptr, false);
+  layout::Geometry geometry(elements);
+  const std::array<QSize, 8> sizes = {
+      QSize(800, 260),  QSize(820, 270),  QSize(900, 300), QSize(1000, 330),
+      QSize(1100, 360), QSize(1200, 390), QSize(640, 210), QSize(720, 240)};
+  std::size_t next = 0;
+  while (state.keepRunning()) {
+    bench::doNotOptimize(geometry.solve(sizes[next++ % sizes.size()]).data());
+  }
+}
+
+TYPR_BENCHMARK("layout/parseLayout qwerty") {
+  QFile file(QCoreApplication::applicationDirPath() +
+             "/../layouts/qwerty.layout");
+  if (!file.open(QIODevice::ReadOnly)) {
+    state.skip("layouts/qwerty.layout not found next to the build");
+    return;
+  }
+  const std::string text = file.readAll().toStdString();
+  std::string error;
+  while (state.keepRunning()) {
+    bench::doNotOptimize(layout::parseLayout(text, error));
+  }
+}
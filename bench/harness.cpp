@@ -0,0 +1,344 @@
+#include "bench/harness.hpp"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QSysInfo>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+struct Registered {
+  std::string name;
+  Function function;
+};
+
+std::vector<Registered> &registry() {
+  static std::vector<Registered> benchmarks;
+  return benchmarks;
+}
+
+double cpuNow() {
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+struct Options {
+  std::string filter;
+  std::chrono::nanoseconds minTime{std::chrono::milliseconds(200)};
+  int repetitions{5};
+};
+
+// One timed run of a benchmark
+struct Run {
+  uint64_t iterations{0};
+  double realNs{0.0}; // per iteration
+  double cpuNs{0.0};  // per iteration
+  double itemsPerSecond{0.0};
+};
+
+struct Result {
+  std::string name;
+  std::string skipped;
+  std::vector<Run> runs;
+};
+
+Run measure(const Function &function, uint64_t iterations,
+            std::string &skipped) {
+  State state(iterations);
+  function(state);
+  skipped = state.skipped();
+
+  Run run;
+  run.iterations = std::max<uint64_t>(1, state.iterations());
+  const auto count = static_cast<double>(run.iterations);
+  run.realNs = static_cast<double>(state.elapsed().count()) / count;
+  run.cpuNs = state.cpuSeconds() * 1e9 / count;
+  if (state.itemsPerIteration() > 0 && run.realNs > 0.0) {
+    run.itemsPerSecond =
+        static_cast<double>(state.itemsPerIteration()) * 1e9 / run.realNs;
+  }
+  return run;
+}
+
+Result runBenchmark(const Registered &benchmark, const Options &options) {
+  Result result{.name = benchmark.name, .skipped = {}, .runs = {}};
+
+  // Grow the iteration count until a run is long enough to time reliably.
+  // The calibration runs double as warm-up.
+  constexpr uint64_t kMaxIterations = 1'000'000'000;
+  uint64_t iterations = 1;
+  while (true) {
+    const Run run = measure(benchmark.function, iterations, result.skipped);
+    if (!result.skipped.empty()) {
+      return result;
+    }
+    const double elapsedNs = run.realNs * static_cast<double>(iterations);
+    const auto minNs = static_cast<double>(options.minTime.count());
+    if (elapsedNs >= minNs || iterations >= kMaxIterations) {
+      break;
+    }
+    // Aim a little past the minimum, growing at most 10x per step
+    const double scale =
+        elapsedNs > 0.0 ? std::min(10.0, minNs * 1.4 / elapsedNs) : 10.0;
+    iterations = std::min(
+        kMaxIterations,
+        std::max(iterations + 1, static_cast<uint64_t>(
+                                     static_cast<double>(iterations) * scale)));
+  }
+
+  for (int repetition = 0; repetition < options.repetitions; ++repetition) {
+    result.runs.push_back(
+        measure(benchmark.function, iterations, result.skipped));
+  }
+  return result;
+}
+
+double median(std::vector<double> values) {
+  std::ranges::sort(values);
+  const std::size_t middle = values.size() / 2;
+  return values.size() % 2 == 1
+             ? values[middle]
+             : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+void printTable(const std::vector<Result> &results) {
+  std::printf("%-44s %14s %14s %14s %14s\n", "Benchmark", "Median (ns)",
+              "Min (ns)", "Iterations", "Items/s");
+  for (const Result &result : results) {
+    if (!result.skipped.empty()) {
+      std::printf("%-44s skipped: %s\n", result.name.c_str(),
+                  result.skipped.c_str());
+      continue;
+    }
+    std::vector<double> times;
+    std::vector<double> rates;
+    for (const Run &run : result.runs) {
+      times.push_back(run.realNs);
+      rates.push_back(run.itemsPerSecond);
+    }
+    const std::string rate =
+        result.runs.front().itemsPerSecond > 0.0
+            ? std::to_string(static_cast<uint64_t>(median(rates)))
+            : "-";
+    std::printf("%-44s %14.1f %14.1f %14llu %14s\n", result.name.c_str(),
+                median(times), *std::ranges::min_element(times),
+                static_cast<unsigned long long>(result.runs.front().iterations),
+                rate.c_str());
+  }
+}
+
+void writeEscaped(std::FILE *file, const std::string &text) {
+  for (const char character : text) {
+    if (character == '"' || character == '\\') {
+      std::fputc('\\', file);
+    }
+    std::fputc(character, file);
+  }
+}
+
+// Same layout as Google Benchmark's --benchmark_format=json (one entry per
+// repetition plus mean / median aggregates), so its compare.py can diff runs
+bool writeJson(const char *path, const std::vector<Result> &results,
+               const Options &options) {
+  std::FILE *file = std::fopen(path, "w");
+  if (file == nullptr) {
+    std::fprintf(stderr, "[bench] cannot write %s\n", path);
+    return false;
+  }
+
+  std::fprintf(file,
+               "{\n  \"context\": {\n"
+               "    \"date\": \"%s\",\n"
+               "    \"host_name\": \"%s\",\n"
+               "    \"executable\": \"%s\",\n"
+               "    \"num_cpus\": %u,\n"
+               "    \"library_build_type\": \"%s\"\n"
+               "  },\n  \"benchmarks\": [",
+               QDateTime::currentDateTime()
+                   .toString(Qt::ISODate)
+                   .toUtf8()
+                   .constData(),
+               QSysInfo::machineHostName().toUtf8().constData(),
+               QCoreApplication::applicationFilePath().toUtf8().constData(),
+               std::thread::hardware_concurrency(),
+#ifdef NDEBUG
+               "release"
+#else
+               "debug"
+#endif
+  );
+
+  bool first = true;
+  const auto beginEntry = [&](const std::string &name) {
+    std::fputs(first ? "\n    {\"name\": \"" : ",\n    {\"name\": \"", file);
+    writeEscaped(file, name);
+    std::fputs("\", \"run_name\": \"", file);
+    first = false;
+  };
+
+  for (const Result &result : results) {
+    if (!result.skipped.empty()) {
+      beginEntry(result.name);
+      writeEscaped(file, result.name);
+      std::fputs("\", \"run_type\": \"iteration\", \"error_occurred\": true, "
+                 "\"error_message\": \"",
+                 file);
+      writeEscaped(file, result.skipped);
+      std::fputs("\"}", file);
+      continue;
+    }
+
+    std::vector<double> real;
+    std::vector<double> cpu;
+    std::vector<double> rates;
+    for (std::size_t index = 0; index < result.runs.size(); ++index) {
+      const Run &run = result.runs[index];
+      beginEntry(result.name);
+      writeEscaped(file, result.name);
+      std::fprintf(file,
+                   "\", \"run_type\": \"iteration\", \"repetitions\": %d, "
+                   "\"repetition_index\": %zu, \"iterations\": %llu, "
+                   "\"real_time\": %.3f, \"cpu_time\": %.3f, "
+                   "\"time_unit\": \"ns\"",
+                   options.repetitions, index,
+                   static_cast<unsigned long long>(run.iterations), run.realNs,
+                   run.cpuNs);
+      if (run.itemsPerSecond > 0.0) {
+        std::fprintf(file, ", \"items_per_second\": %.1f",
+                     run.itemsPerSecond);
+      }
+      std::fputs("}", file);
+      real.push_back(run.realNs);
+      cpu.push_back(run.cpuNs);
+      rates.push_back(run.itemsPerSecond);
+    }
+
+    const auto mean = [](const std::vector<double> &values) {
+      double sum = 0.0;
+      for (const double value : values) {
+        sum += value;
+      }
+      return sum / static_cast<double>(values.size());
+    };
+    const auto aggregate = [&](const char *kind, double realNs, double cpuNs,
+                               double rate) {
+      beginEntry(result.name + "_" + kind);
+      writeEscaped(file, result.name);
+      std::fprintf(file,
+                   "\", \"run_type\": \"aggregate\", \"aggregate_name\": "
+                   "\"%s\", \"repetitions\": %d, \"iterations\": %zu, "
+                   "\"real_time\": %.3f, \"cpu_time\": %.3f, "
+                   "\"time_unit\": \"ns\"",
+                   kind, options.repetitions, result.runs.size(), realNs,
+                   cpuNs);
+      if (rate > 0.0) {
+        std::fprintf(file, ", \"items_per_second\": %.1f", rate);
+      }
+      std::fputs("}", file);
+    };
+    aggregate("mean", mean(real), mean(cpu), mean(rates));
+    aggregate("median", median(real), median(cpu), median(rates));
+  }
+  std::fputs("\n  ]\n}\n", file);
+
+  const bool ok = std::ferror(file) == 0;
+  std::fclose(file);
+  return ok;
+}
+
+} // namespace
+
+void State::pauseTiming() {
+  if (!running_) {
+    return;
+  }
+  elapsed_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - since_);
+  cpuSeconds_ += cpuNow() - cpuSince_;
+  running_ = false;
+}
+
+void State::resumeTiming() {
+  if (running_) {
+    return;
+  }
+  running_ = true;
+  cpuSince_ = cpuNow();
+  since_ = Clock::now();
+}
+
+void State::stop() { pauseTiming(); }
+
+bool registerBenchmark(const char *name, Function function) {
+  registry().push_back({.name = name, .function = std::move(function)});
+  return true;
+}
+
+} // namespace bench
+
+int main(int argc, char **argv) {
+  // Widgets are built but never shown; no display is needed
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  QApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.addHelpOption();
+  const QCommandLineOption filterOption(
+      "filter", "Only run benchmarks whose name contains this text.", "text");
+  parser.addOption(filterOption);
+  const QCommandLineOption minTimeOption(
+      "min-time", "Minimum duration of one timed run, in milliseconds.", "ms",
+      "200");
+  parser.addOption(minTimeOption);
+  const QCommandLineOption repetitionsOption(
+      "repetitions", "Timed runs per benchmark.", "count", "5");
+  parser.addOption(repetitionsOption);
+  const QCommandLineOption jsonOption(
+      "json", "Also write the results as JSON to this file.", "file");
+  parser.addOption(jsonOption);
+  const QCommandLineOption listOption("list", "List the benchmarks and exit.");
+  parser.addOption(listOption);
+  parser.process(app);
+
+  bench::Options options;
+  options.filter = parser.value(filterOption).toStdString();
+  options.minTime = std::chrono::milliseconds(
+      std::max(1, parser.value(minTimeOption).toInt()));
+  options.repetitions = std::max(1, parser.value(repetitionsOption).toInt());
+
+  // Registration order depends on link order; report in name order
+  std::ranges::stable_sort(bench::registry(), {}, &bench::Registered::name);
+
+  std::vector<bench::Result> results;
+  for (const bench::Registered &benchmark : bench::registry()) {
+    if (benchmark.name.find(options.filter) == std::string::npos) {
+      continue;
+    }
+    if (parser.isSet(listOption)) {
+      std::printf("%s\n", benchmark.name.c_str());
+      continue;
+    }
+    results.push_back(bench::runBenchmark(benchmark, options));
+  }
+  if (parser.isSet(listOption)) {
+    return 0;
+  }
+
+  bench::printTable(results);
+  if (parser.isSet(jsonOption)) {
+    const std::string path = parser.value(jsonOption).toStdString();
+    if (!bench::writeJson(path.c_str(), results, options)) {
+      return 1;
+    }
+  }
+  return 0;
+}
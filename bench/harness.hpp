@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+
+/**
+ * Minimal microbenchmark harness.
+ *
+ * A benchmark is a function that runs its body once per iteration:
+ *
+ *   TYPR_BENCHMARK("keys/stringToKey") {
+ *     while (state.keepRunning()) {
+ *       bench::doNotOptimize(backend::stringToKey("Enter"));
+ *     }
+ *   }
+ *
+ * The runner grows the iteration count until one run takes at least the
+ * minimum time, repeats that run a few times and reports the mean time per
+ * iteration of each repetition. Results are printed as a table and, with
+ * --json <file>, written in the Google Benchmark JSON format so existing
+ * comparison tools can diff two runs.
+ */
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+class State {
+public:
+  explicit State(uint64_t iterations) : remaining_(iterations) {}
+
+  State(const State &) = delete;
+  State &operator=(const State &) = delete;
+
+  // True once per iteration; starts the clock on the first call
+  bool keepRunning() {
+    if (remaining_ == 0) {
+      stop();
+      return false;
+    }
+    if (!started_) {
+      started_ = true;
+      resumeTiming();
+    }
+    --remaining_;
+    ++iterations_;
+    return true;
+  }
+
+  // Exclude per-iteration setup or teardown from the measurement
+  void pauseTiming();
+  void resumeTiming();
+
+  // Work units done per iteration (e.g. keys injected); reported as a rate
+  void setItemsPerIteration(uint64_t items) { itemsPerIteration_ = items; }
+
+  // Give up on this benchmark (e.g. no display for the keymap); the reason
+  // is reported instead of a time
+  void skip(std::string reason) {
+    skipped_ = std::move(reason);
+    remaining_ = 0;
+  }
+
+  [[nodiscard]] uint64_t iterations() const { return iterations_; }
+  [[nodiscard]] uint64_t itemsPerIteration() const {
+    return itemsPerIteration_;
+  }
+  [[nodiscard]] std::chrono::nanoseconds elapsed() const { return elapsed_; }
+  [[nodiscard]] double cpuSeconds() const { return cpuSeconds_; }
+  [[nodiscard]] const std::string &skipped() const { return skipped_; }
+
+private:
+  void stop();
+
+  uint64_t remaining_;
+  uint64_t iterations_{0};
+  uint64_t itemsPerIteration_{0};
+  bool started_{false};
+  bool running_{false};
+  Clock::time_point since_;
+  double cpuSince_{0.0};
+  std::chrono::nanoseconds elapsed_{0};
+  double cpuSeconds_{0.0};
+  std::string skipped_;
+};
+
+using Function = std::function<void(State &)>;
+
+// Called by TYPR_BENCHMARK at static initialisation
+bool registerBenchmark(const char *name, Function function);
+
+// Keep the compiler from discarding a computed value
+template <typename T> inline void doNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  const volatile auto *sink = &value;
+  (void)sink;
+#endif
+}
+
+} // namespace bench
+
+#define TYPR_BENCH_CONCAT_INNER(a, b) a##b
+#define TYPR_BENCH_CONCAT(a, b) TYPR_BENCH_CONCAT_INNER(a, b)
+
+#define TYPR_BENCHMARK(name)                                                   \
+  static void TYPR_BENCH_CONCAT(typrBenchmark, __LINE__)(bench::State &);      \
+  static const bool TYPR_BENCH_CONCAT(typrBenchmarkRegistered, __LINE__) =     \
+      bench::registerBenchmark(name,                                           \
+                               TYPR_BENCH_CONCAT(typrBenchmark, __LINE__));    \
+  static void TYPR_BENCH_CONCAT(typrBenchmark, __LINE__)(                      \
+      [[maybe_unused]] bench::State & state)
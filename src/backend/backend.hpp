@@ -1,9 +1,11 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 
 namespace backend {
 
@@ -189,6 +191,8 @@ enum class BackendType : uint8_t {
   LinuxUInput, // Direct uinput (works everywhere on Linux)
 };
 
+class Driver;
+
 class InputBackend {
 public:
   InputBackend();
@@ -243,6 +247,12 @@ public:
   // Set delay between key events in tap/combo (microseconds)
   void setKeyDelay(uint32_t delayUs);
 
+#if defined(__linux__)
+  // The driver the registry opened for this backend (driver.hpp), null if
+  // none; see bound()
+  [[nodiscard]] Driver *driver();
+#endif
+
 private:
   struct Impl;
   std::unique_ptr<Impl> m_impl;
@@ -280,8 +290,54 @@ private:
   std::unique_ptr<Impl> m_impl;
 };
 
+// Keymap: what each key types in the active keyboard layout, so captions can
+// follow the user's layout (AZERTY, Dvorak, ...) and shift level instead of
+// the US names of the Key enum.
+class Keymap {
+public:
+  // Layout (group) and the modifiers that select a shift level, packed.
+  // Opaque; only compared and used as a cache key.
+  using State = uint32_t;
+  // UTF-8 text per Key (indexed by the enum value); empty where the key types
+  // nothing printable
+  using Captions = std::array<std::string, 256>;
+
+  Keymap();
+  ~Keymap();
+
+  Keymap(const Keymap &) = delete;
+  Keymap &operator=(const Keymap &) = delete;
+  Keymap(Keymap &&) noexcept;
+  Keymap &operator=(Keymap &&) noexcept;
+
+  // False where the platform keymap cannot be read (captions stay Key names)
+  [[nodiscard]] bool isAvailable() const;
+
+  // Descriptor that becomes readable when the layout, the keymap or the
+  // modifier state changed (then call poll()); -1 if there is none.
+  [[nodiscard]] int notifierFd() const;
+
+  // Process pending change notifications and return the current state
+  State poll();
+
+  // Bumped whenever the keymap itself is replaced; captions resolved for an
+  // older generation are stale.
+  [[nodiscard]] uint32_t generation() const;
+
+  // Resolve what every key types in `state`
+  void captions(State state, Captions &out) const;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> m_impl;
+};
+
 // Utility functions
 std::string keyToString(Key key);
+// Same as keyToString() but returns a view into static storage (no allocation)
+std::string_view keyName(Key key);
 Key stringToKey(const std::string &str);
+// Shift, Ctrl, Alt, Super and the lock keys
+bool isModifierKey(Key key);
 
 } // namespace backend
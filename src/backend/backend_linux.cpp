@@ -0,0 +1,174 @@
+#if defined(__linux__)
+
+#include "backend.hpp"
+#include "backend_registry.hpp"
+#include "driver.hpp"
+
+namespace backend {
+
+/**
+ * InputBackend on Linux: forwards to the Driver BackendRegistry chose for
+ * the session (uinput, XTest or the Wayland virtual keyboard).
+ */
+
+namespace {
+
+// Null when moved from, or when the chosen backend is not built in
+Driver *driverOf(const auto &impl) {
+  return impl ? impl->driver.get() : nullptr;
+}
+
+} // namespace
+
+struct InputBackend::Impl {
+  std::unique_ptr<Driver> driver;
+};
+
+BackendRegistry &BackendRegistry::instance() {
+  static BackendRegistry registry(
+      {
+          {BackendType::LinuxUInput, uinputAvailable, makeUinputDriver},
+#ifdef BACKEND_HAVE_X11
+          {BackendType::LinuxX11, xtestAvailable, makeXTestDriver},
+#endif
+#ifdef BACKEND_HAVE_WAYLAND
+          {BackendType::LinuxWayland, waylandAvailable, makeWaylandDriver},
+#endif
+      },
+      defaultCacheFile());
+  return registry;
+}
+
+InputBackend::InputBackend() : m_impl(std::make_unique<Impl>()) {
+  m_impl->driver = BackendRegistry::instance().open();
+}
+InputBackend::~InputBackend() = default;
+InputBackend::InputBackend(InputBackend &&) noexcept = default;
+InputBackend &InputBackend::operator=(InputBackend &&) noexcept = default;
+
+BackendType InputBackend::type() const {
+  const Driver *driver = driverOf(m_impl);
+  return driver != nullptr ? driver->type() : BackendType::Unknown;
+}
+
+Capabilities InputBackend::capabilities() const {
+  const Driver *driver = driverOf(m_impl);
+  return driver != nullptr ? driver->capabilities() : Capabilities{};
+}
+
+bool InputBackend::isReady() const {
+  const Driver *driver = driverOf(m_impl);
+  return driver != nullptr && driver->isReady();
+}
+
+bool InputBackend::requestPermissions() {
+  Driver *driver = driverOf(m_impl);
+  return driver != nullptr && driver->requestPermissions();
+}
+
+bool InputBackend::keyDown(Key key) {
+  Driver *driver = driverOf(m_impl);
+  return driver != nullptr && driver->keyDown(key);
+}
+
+bool InputBackend::keyUp(Key key) {
+  Driver *driver = driverOf(m_impl);
+  return driver != nullptr && driver->keyUp(key);
+}
+
+bool InputBackend::tap(Key key) {
+  Driver *driver = driverOf(m_impl);
+  return driver != nullptr && driver->tap(key);
+}
+
+Modifier InputBackend::activeModifiers() const {
+  const Driver *driver = driverOf(m_impl);
+  return driver != nullptr ? driver->activeModifiers() : Modifier::None;
+}
+
+bool InputBackend::holdModifier(Modifier mod) {
+  Driver *driver = driverOf(m_impl);
+  return driver != nullptr && driver->holdModifier(mod);
+}
+
+bool InputBackend::releaseModifier(Modifier mod) {
+  Driver *driver = driverOf(m_impl);
+  return driver != nullptr && driver->releaseModifier(mod);
+}
+
+bool InputBackend::releaseAllModifiers() {
+  Driver *driver = driverOf(m_impl);
+  return driver != nullptr && driver->releaseAllModifiers();
+}
+
+bool InputBackend::combo(Modifier mods, Key key) {
+  Driver *driver = driverOf(m_impl);
+  return driver != nullptr && driver->combo(mods, key);
+}
+
+bool InputBackend::typeText(const std::u32string &text) {
+  Driver *driver = driverOf(m_impl);
+  return driver != nullptr && driver->typeText(text);
+}
+
+bool InputBackend::typeText(const std::string &utf8Text) {
+  // Convert UTF-8 to UTF-32
+  std::u32string utf32;
+  size_t i = 0;
+  while (i < utf8Text.size()) {
+    char32_t cp = 0;
+    unsigned char c = utf8Text[i];
+
+    if ((c & 0x80) == 0) {
+      cp = c;
+      i += 1;
+    } else if ((c & 0xE0) == 0xC0) {
+      cp = (c & 0x1F) << 6;
+      if (i + 1 < utf8Text.size())
+        cp |= (utf8Text[i + 1] & 0x3F);
+      i += 2;
+    } else if ((c & 0xF0) == 0xE0) {
+      cp = (c & 0x0F) << 12;
+      if (i + 1 < utf8Text.size())
+        cp |= (utf8Text[i + 1] & 0x3F) << 6;
+      if (i + 2 < utf8Text.size())
+        cp |= (utf8Text[i + 2] & 0x3F);
+      i += 3;
+    } else if ((c & 0xF8) == 0xF0) {
+      cp = (c & 0x07) << 18;
+      if (i + 1 < utf8Text.size())
+        cp |= (utf8Text[i + 1] & 0x3F) << 12;
+      if (i + 2 < utf8Text.size())
+        cp |= (utf8Text[i + 2] & 0x3F) << 6;
+      if (i + 3 < utf8Text.size())
+        cp |= (utf8Text[i + 3] & 0x3F);
+      i += 4;
+    } else {
+      i += 1;
+      continue;
+    }
+
+    utf32.push_back(cp);
+  }
+  return typeText(utf32);
+}
+
+bool InputBackend::typeCharacter(char32_t codepoint) {
+  return typeText(std::u32string(1, codepoint));
+}
+
+void InputBackend::flush() {
+  if (Driver *driver = driverOf(m_impl))
+    driver->flush();
+}
+
+void InputBackend::setKeyDelay(uint32_t delayUs) {
+  if (Driver *driver = driverOf(m_impl))
+    driver->setKeyDelay(delayUs);
+}
+
+Driver *InputBackend::driver() { return driverOf(m_impl); }
+
+} // namespace backend
+
+#endif // __linux__
@@ -1,6 +1,7 @@
 #ifdef __APPLE__
 
 #include "backend.hpp"
+#include "core/trace.hpp"
 
 #include <ApplicationServices/ApplicationServices.h>
 #include <Carbon/Carbon.h>
@@ -367,6 +368,7 @@ bool InputBackend::requestPermissions() {
 }
 
 bool InputBackend::keyDown(Key key) {
+  TYPR_TRACE_SPAN("backend", "InputBackend::keyDown");
   // Update modifier state if pressing a modifier
   switch (key) {
   case Key::ShiftLeft:
@@ -392,6 +394,7 @@ bool InputBackend::keyDown(Key key) {
 }
 
 bool InputBackend::keyUp(Key key) {
+  TYPR_TRACE_SPAN("backend", "InputBackend::keyUp");
   bool result = m_impl->sendKey(key, false);
   // Update modifier state if releasing a modifier
   switch (key) {
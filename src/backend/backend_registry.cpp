@@ -0,0 +1,369 @@
+#include "backend_registry.hpp"
+
+#include "core/log.hpp"
+#include "core/trace.hpp"
+#include "driver.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace backend {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A tap the listener has not seen by then is counted as missed
+constexpr auto kEchoTimeout = std::chrono::milliseconds(200);
+// Between taps, so one's release is not mistaken for the next one's press
+constexpr auto kTapGap = std::chrono::milliseconds(5);
+// For the listener's thread to be listening before the first tap
+constexpr auto kListenerWarmUp = std::chrono::milliseconds(50);
+
+// Literals, so the log can keep the pointer
+const char *nameOf(BackendType type) {
+  switch (type) {
+  case BackendType::LinuxUInput:
+    return "uinput";
+  case BackendType::LinuxX11:
+    return "x11";
+  case BackendType::LinuxWayland:
+    return "wayland";
+  default:
+    break;
+  }
+  return "unknown";
+}
+
+const char *nameOf(SessionType session) {
+  switch (session) {
+  case SessionType::X11:
+    return "x11";
+  case SessionType::Wayland:
+    return "wayland";
+  case SessionType::Console:
+    break;
+  }
+  return "console";
+}
+
+bool isSet(const char *variable) {
+  const char *value = std::getenv(variable);
+  return value != nullptr && *value != '\0';
+}
+
+} // namespace
+
+SessionType currentSessionType() {
+  if (const char *type = std::getenv("XDG_SESSION_TYPE"); type != nullptr) {
+    const std::string_view value(type);
+    if (value == "wayland") {
+      return SessionType::Wayland;
+    }
+    if (value == "x11") {
+      return SessionType::X11;
+    }
+  }
+  // Started outside a login session manager (e.g. from a nested compositor)
+  if (isSet("WAYLAND_DISPLAY")) {
+    return SessionType::Wayland;
+  }
+  return isSet("DISPLAY") ? SessionType::X11 : SessionType::Console;
+}
+
+std::string_view sessionName(SessionType session) { return nameOf(session); }
+
+std::string_view backendName(BackendType type) { return nameOf(type); }
+
+std::optional<BackendType> backendFromName(std::string_view name) {
+  for (const BackendType type :
+       {BackendType::LinuxUInput, BackendType::LinuxX11,
+        BackendType::LinuxWayland}) {
+    if (name == nameOf(type)) {
+      return type;
+    }
+  }
+  return std::nullopt;
+}
+
+std::chrono::microseconds measureTapLatency(Driver &driver, std::size_t taps) {
+  TYPR_TRACE_SPAN("backend", "measureTapLatency");
+  std::mutex mutex;
+  std::condition_variable seen;
+  bool echoed = false;
+  Clock::time_point echoedAt;
+
+  OutputListener listener;
+  const bool listening = listener.startListening(
+      [&](char32_t, Key key, Modifier, bool pressed) {
+        if (!pressed || (key != Key::ShiftLeft && key != Key::ShiftRight)) {
+          return;
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          echoed = true;
+          echoedAt = Clock::now();
+        }
+        seen.notify_all();
+      });
+  if (!listening) {
+    return std::chrono::microseconds(0);
+  }
+  std::this_thread::sleep_for(kListenerWarmUp);
+
+  std::vector<std::chrono::microseconds> samples;
+  samples.reserve(taps);
+  for (std::size_t tap = 0; tap < taps; ++tap) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      echoed = false;
+    }
+    const Clock::time_point sentAt = Clock::now();
+    driver.tap(Key::ShiftLeft);
+    driver.flush();
+    std::unique_lock<std::mutex> lock(mutex);
+    if (seen.wait_for(lock, kEchoTimeout, [&]() { return echoed; })) {
+      samples.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+          echoedAt - sentAt));
+    }
+    lock.unlock();
+    std::this_thread::sleep_for(kTapGap);
+  }
+  listener.stopListening();
+
+  if (samples.empty() || samples.size() * 2 < taps) {
+    return std::chrono::microseconds(0);
+  }
+  const auto middle = samples.begin() + static_cast<std::ptrdiff_t>(
+                                            samples.size() / 2);
+  std::nth_element(samples.begin(), middle, samples.end());
+  return *middle;
+}
+
+BackendRegistry::BackendRegistry(std::vector<Entry> entries,
+                                 std::string cacheFile, Measure measure)
+    : entries_(std::move(entries)), cacheFile_(std::move(cacheFile)),
+      measure_(measure ? std::move(measure) : Measure(measureTapLatency)) {}
+
+BackendRegistry::~BackendRegistry() = default;
+
+std::string BackendRegistry::defaultCacheFile() {
+  std::filesystem::path base;
+  if (const char *cache = std::getenv("XDG_CACHE_HOME");
+      cache != nullptr && *cache == '/') {
+    base = cache;
+  } else if (const char *home = std::getenv("HOME");
+             home != nullptr && *home != '\0') {
+    base = std::filesystem::path(home) / ".cache";
+  } else {
+    return {};
+  }
+  return (base / "typr-osk" / "backend").string();
+}
+
+std::vector<BackendType>
+BackendRegistry::candidates(SessionType session) const {
+  std::vector<BackendType> preferred;
+  switch (session) {
+  case SessionType::Wayland:
+    preferred = {BackendType::LinuxWayland, BackendType::LinuxUInput};
+    break;
+  case SessionType::X11:
+    preferred = {BackendType::LinuxX11, BackendType::LinuxUInput};
+    break;
+  case SessionType::Console:
+    preferred = {BackendType::LinuxUInput};
+    break;
+  }
+  std::erase_if(preferred,
+                [this](BackendType type) { return find(type) == nullptr; });
+  return preferred;
+}
+
+BackendRegistry::Selection BackendRegistry::select(SessionType session,
+                                                   const Options &options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return selectLocked(session, options);
+}
+
+BackendRegistry::Selection
+BackendRegistry::selectLocked(SessionType session, const Options &options) {
+  TYPR_TRACE_SPAN("backend", "BackendRegistry::select");
+  Selection selection;
+  opened_.reset();
+
+  if (!options.ignoreCache) {
+    if (const auto type = cached(session); type && find(*type) != nullptr) {
+      std::unique_ptr<Driver> driver = find(*type)->create();
+      if (driver != nullptr && driver->isReady()) {
+        TYPR_LOG_INFO("backend", "{} backend for the {} session (cached)",
+                      nameOf(*type), nameOf(session));
+        chosen_ = *type;
+        opened_ = std::move(driver);
+        selection.type = *type;
+        selection.cached = true;
+        return selection;
+      }
+      TYPR_LOG_INFO("backend", "cached {} backend does not open, probing",
+                    nameOf(*type));
+    }
+  }
+
+  // Without a benchmark the first ready one wins, and the rest are not
+  // opened at all (a uinput device is not created for nothing)
+  std::vector<std::unique_ptr<Driver>> drivers;
+  for (const BackendType type : candidates(session)) {
+    const Entry &entry = *find(type);
+    BackendProbe probe;
+    probe.type = type;
+    probe.available = !entry.available || entry.available();
+    std::unique_ptr<Driver> driver;
+    if (probe.available) {
+      driver = entry.create();
+      probe.ready = driver != nullptr && driver->isReady();
+    }
+    if (probe.ready && options.benchmark) {
+      probe.tapLatency = measure_(*driver, options.benchmarkTaps);
+    }
+    TYPR_LOG_INFO("backend", "probed {}: available {}, ready {}, {} us",
+                  nameOf(type), probe.available, probe.ready,
+                  probe.tapLatency.count());
+    selection.probes.push_back(probe);
+    drivers.push_back(probe.ready ? std::move(driver) : nullptr);
+    if (probe.ready && !options.benchmark) {
+      break;
+    }
+  }
+
+  // The first ready one, unless one after it measured faster
+  const auto measured = [](const BackendProbe &probe) {
+    return probe.tapLatency.count() > 0;
+  };
+  std::optional<std::size_t> best;
+  for (std::size_t index = 0; index < selection.probes.size(); ++index) {
+    const BackendProbe &probe = selection.probes[index];
+    if (!probe.ready) {
+      continue;
+    }
+    const BackendProbe *current = best ? &selection.probes[*best] : nullptr;
+    if (current == nullptr ||
+        (measured(probe) &&
+         (!measured(*current) || probe.tapLatency < current->tapLatency))) {
+      best = index;
+    }
+  }
+
+  if (best) {
+    selection.type = selection.probes[*best].type;
+    opened_ = std::move(drivers[*best]);
+    remember(session, selection.type);
+  } else if (!selection.probes.empty()) {
+    // Nothing works: the last resort, so the caller can report what it needs
+    // (uinput: device permissions)
+    selection.type = selection.probes.back().type;
+    TYPR_LOG_WARN("backend", "no backend works in the {} session",
+                  nameOf(session));
+  }
+  chosen_ = selection.type;
+  TYPR_LOG_INFO("backend", "{} backend for the {} session",
+                nameOf(selection.type), nameOf(session));
+  return selection;
+}
+
+void BackendRegistry::pin(BackendType type) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  chosen_ = type;
+  if (opened_ != nullptr && opened_->type() != type) {
+    opened_.reset();
+  }
+}
+
+std::unique_ptr<Driver> BackendRegistry::open() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (chosen_ == BackendType::Unknown) {
+    if (const char *name = std::getenv("TYPR_OSK_BACKEND"); name != nullptr) {
+      if (const auto type = backendFromName(name)) {
+        chosen_ = *type;
+      } else {
+        TYPR_LOG_WARN("backend", "TYPR_OSK_BACKEND names no backend");
+      }
+    }
+  }
+  if (chosen_ == BackendType::Unknown) {
+    selectLocked(currentSessionType(), Options{});
+  }
+  if (opened_ != nullptr && opened_->type() == chosen_) {
+    return std::move(opened_);
+  }
+  const Entry *entry = find(chosen_);
+  return entry != nullptr ? entry->create() : nullptr;
+}
+
+const BackendRegistry::Entry *BackendRegistry::find(BackendType type) const {
+  const auto entry =
+      std::ranges::find_if(entries_, [type](const Entry &candidate) {
+        return candidate.type == type;
+      });
+  return entry != entries_.end() ? &*entry : nullptr;
+}
+
+// One "session=backend" line per session type
+std::optional<BackendType>
+BackendRegistry::cached(SessionType session) const {
+  if (cacheFile_.empty()) {
+    return std::nullopt;
+  }
+  std::ifstream in(cacheFile_);
+  const std::string prefix = std::string(nameOf(session)) + "=";
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.starts_with(prefix)) {
+      return backendFromName(std::string_view(line).substr(prefix.size()));
+    }
+  }
+  return std::nullopt;
+}
+
+void BackendRegistry::remember(SessionType session, BackendType type) const {
+  if (cacheFile_.empty()) {
+    return;
+  }
+  const std::string prefix = std::string(nameOf(session)) + "=";
+  std::vector<std::string> lines;
+  {
+    std::ifstream in(cacheFile_);
+    std::string line;
+    while (std::getline(in, line)) {
+      if (!line.empty() && !line.starts_with(prefix)) {
+        lines.push_back(line);
+      }
+    }
+  }
+  lines.push_back(prefix + nameOf(type));
+
+  // Written aside and renamed over, so a reader never sees half of it
+  const std::filesystem::path path(cacheFile_);
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+  const std::filesystem::path temporary = path.string() + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::trunc);
+    for (const std::string &line : lines) {
+      out << line << '\n';
+    }
+    if (!out) {
+      TYPR_LOG_WARN("backend", "cannot write the backend cache");
+      return;
+    }
+  }
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    TYPR_LOG_WARN("backend", "cannot write the backend cache");
+  }
+}
+
+} // namespace backend
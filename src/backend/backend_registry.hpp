@@ -0,0 +1,142 @@
+#pragma once
+
+#include "backend.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace backend {
+
+class Driver;
+
+// What kind of session the keyboard runs in, which decides the backends
+// worth trying
+enum class SessionType : uint8_t {
+  Console, // neither X11 nor Wayland
+  X11,
+  Wayland,
+};
+
+// From XDG_SESSION_TYPE, else from WAYLAND_DISPLAY / DISPLAY
+[[nodiscard]] SessionType currentSessionType();
+[[nodiscard]] std::string_view sessionName(SessionType session);
+
+// "uinput", "x11", "wayland": as in the cache file, TYPR_OSK_BACKEND and
+// --backend
+[[nodiscard]] std::string_view backendName(BackendType type);
+[[nodiscard]] std::optional<BackendType> backendFromName(std::string_view name);
+
+struct BackendProbe {
+  BackendType type{BackendType::Unknown};
+  bool available{false}; // the session and permissions allow it
+  bool ready{false};     // and it opened
+  // Median from a tap to the listener seeing it; zero if not measured
+  std::chrono::microseconds tapLatency{0};
+};
+
+/**
+ * @brief Median latency of `taps` taps of Shift through `driver`, as seen by
+ * an OutputListener; zero if the listener cannot start or misses most of
+ * them (e.g. it does not see what the driver injects).
+ *
+ * The taps reach the focused application, which is why this only runs when
+ * asked for.
+ */
+[[nodiscard]] std::chrono::microseconds measureTapLatency(Driver &driver,
+                                                          std::size_t taps);
+
+/**
+ * @brief Picks the injection backend on Linux, where one binary carries
+ * several.
+ *
+ * The candidates depend on the session: the Wayland virtual keyboard on
+ * Wayland, XTest on X11 (it would only reach Xwayland clients on Wayland),
+ * and uinput everywhere as the fallback that needs device permissions. Each
+ * is checked for availability without opening anything, then opened; the
+ * first that is ready wins, or, with a benchmark, the one with the lowest
+ * tap latency through the listener.
+ *
+ * The winner is remembered per session type in a small cache file, so later
+ * startups open it directly. A cached backend that no longer opens is probed
+ * again. TYPR_OSK_BACKEND=<name> or pin() skip all of it.
+ */
+class BackendRegistry {
+public:
+  struct Entry {
+    BackendType type{BackendType::Unknown};
+    std::function<bool()> available;
+    std::function<std::unique_ptr<Driver>()> create;
+  };
+
+  struct Options {
+    // Probe even if the cache knows the answer
+    bool ignoreCache{false};
+    // Rank the ready backends by tap latency (types Shift into the focused
+    // application)
+    bool benchmark{false};
+    std::size_t benchmarkTaps{20};
+  };
+
+  struct Selection {
+    BackendType type{BackendType::Unknown};
+    bool cached{false}; // taken from the cache, nothing probed
+    std::vector<BackendProbe> probes;
+  };
+
+  // measureTapLatency() unless replaced
+  using Measure =
+      std::function<std::chrono::microseconds(Driver &, std::size_t taps)>;
+
+  // `entries` in no particular order; an empty `cacheFile` keeps nothing
+  BackendRegistry(std::vector<Entry> entries, std::string cacheFile,
+                  Measure measure = {});
+  ~BackendRegistry();
+
+  BackendRegistry(const BackendRegistry &) = delete;
+  BackendRegistry &operator=(const BackendRegistry &) = delete;
+  BackendRegistry(BackendRegistry &&) = delete;
+  BackendRegistry &operator=(BackendRegistry &&) = delete;
+
+  // The drivers built into this binary, used by InputBackend()
+  static BackendRegistry &instance();
+  // $XDG_CACHE_HOME/typr-osk/backend, or ~/.cache/typr-osk/backend
+  [[nodiscard]] static std::string defaultCacheFile();
+
+  // Backends built in that are worth trying in `session`, best first
+  [[nodiscard]] std::vector<BackendType>
+  candidates(SessionType session) const;
+
+  // Choose the backend for `session`; InputBackend() opens it from then on
+  Selection select(SessionType session, const Options &options);
+  // Use `type` from now on, without probing or caching
+  void pin(BackendType type);
+
+  // A driver of the chosen backend, choosing it first (TYPR_OSK_BACKEND, the
+  // cache, probing) if nothing has been. Null if the chosen type is not
+  // built in.
+  [[nodiscard]] std::unique_ptr<Driver> open();
+
+private:
+  Selection selectLocked(SessionType session, const Options &options);
+  [[nodiscard]] const Entry *find(BackendType type) const;
+  [[nodiscard]] std::optional<BackendType> cached(SessionType session) const;
+  void remember(SessionType session, BackendType type) const;
+
+  std::vector<Entry> entries_;
+  std::string cacheFile_;
+  Measure measure_;
+
+  std::mutex mutex_;
+  BackendType chosen_{BackendType::Unknown};
+  // Opened while probing, handed to the first open()
+  std::unique_ptr<Driver> opened_;
+};
+
+} // namespace backend
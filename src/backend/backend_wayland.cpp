@@ -0,0 +1,800 @@
+#if defined(__linux__) && defined(BACKEND_HAVE_WAYLAND)
+
+#include "backend.hpp"
+#include "core/log.hpp"
+#include "core/trace.hpp"
+#include "driver.hpp"
+#include "evdev_keys.hpp"
+#include "spare_keys.hpp"
+
+#include "virtual-keyboard-unstable-v1-client-protocol.h"
+
+#include <wayland-client.h>
+#include <xkbcommon/xkbcommon.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace backend {
+
+/**
+ * Driver for Wayland sessions, on zwp_virtual_keyboard_v1 (wlroots
+ * compositors such as sway, and others that implement it).
+ *
+ * The compositor gets a keyboard of its own from us, so nothing needs
+ * /dev/uinput. A virtual keyboard brings its own keymap: we start from the
+ * seat's (so a Key is the same physical position, evdev code, as on the
+ * user's keyboard) and upload it once, as a sealed memfd the compositor maps
+ * read-only. Modifier state is not derived by the compositor; it is tracked
+ * here with xkbcommon and sent whenever a key changes it.
+ *
+ * Requests are only queued in libwayland's output buffer: every public call
+ * is one sequence that ends with a single wl_display_flush(), so a tap, a
+ * combo or a whole text is one write to the compositor socket. Key delays
+ * are carried by the event timestamps rather than slept on.
+ *
+ * Text is typed with the keys of the active layout (with Shift for the second
+ * level). Other characters are bound to spare keycodes (see SpareKeys) by
+ * uploading the keymap again with the bindings added, one upload per round;
+ * a client receives the new keymap before the keys that follow it, so
+ * nothing has to wait.
+ */
+
+namespace {
+
+// Spare keycodes to bind characters outside the layout to. Keycodes above
+// 255 are left alone: X clients under Xwayland cannot see them.
+constexpr std::size_t kMaxSpares = 16;
+constexpr xkb_keycode_t kMaxSpareKeycode = 255;
+
+// Requests queued before the buffer is flushed within a sequence. One is 20
+// to 24 bytes; libwayland's buffer holds 4 KiB.
+constexpr std::size_t kMaxQueued = 128;
+
+// How long a flush waits for room on a full socket
+constexpr int kFlushTimeoutMs = 1000;
+
+xkb_keysym_t keysymFor(char32_t codepoint) {
+  switch (codepoint) {
+  case U'\n':
+  case U'\r':
+    return XKB_KEY_Return;
+  case U'\t':
+    return XKB_KEY_Tab;
+  case U'\b':
+    return XKB_KEY_BackSpace;
+  default:
+    return xkb_utf32_to_keysym(codepoint);
+  }
+}
+
+// Timestamps of our requests, in milliseconds on one clock
+uint32_t timestamp() {
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+class WaylandDriver final : public Driver {
+public:
+  WaylandDriver();
+  ~WaylandDriver() override;
+
+  [[nodiscard]] BackendType type() const override;
+  [[nodiscard]] Capabilities capabilities() const override;
+  [[nodiscard]] bool isReady() const override;
+  bool requestPermissions() override;
+  bool keyDown(Key key) override;
+  bool keyUp(Key key) override;
+  bool tap(Key key) override;
+  [[nodiscard]] Modifier activeModifiers() const override;
+  bool holdModifier(Modifier mod) override;
+  bool releaseModifier(Modifier mod) override;
+  bool releaseAllModifiers() override;
+  bool combo(Modifier mods, Key key) override;
+  bool typeText(const std::u32string &text) override;
+  void flush() override;
+  void setKeyDelay(uint32_t delayUs) override;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace
+
+struct WaylandDriver::Impl {
+  // A key of the layout that types a keysym
+  struct Stroke {
+    xkb_keycode_t keycode{0};
+    bool shift{false};
+  };
+
+  wl_display *display{nullptr};
+  wl_registry *registry{nullptr};
+  wl_seat *seat{nullptr};
+  uint32_t seatVersion{0};
+  uint32_t seatCapabilities{0};
+  zwp_virtual_keyboard_manager_v1 *manager{nullptr};
+  zwp_virtual_keyboard_v1 *keyboard{nullptr};
+  std::string seatKeymap;
+  bool broken{false}; // the connection failed, nothing goes out anymore
+  std::size_t queued{0};
+
+  xkb_context *context{nullptr};
+  xkb_keymap *keymap{nullptr}; // without our bindings
+  xkb_state *state{nullptr};
+  std::string keymapText; // of `keymap`
+
+  Modifier currentMods{Modifier::None};
+  uint32_t keyDelayUs{1000};
+  std::array<uint32_t, 256> codes{}; // evdev code by Key, 0 = none
+  uint32_t shiftCode{0};
+  std::unordered_map<xkb_keysym_t, Stroke> strokes;
+  xkb_layout_index_t strokesLayout{XKB_LAYOUT_INVALID};
+
+  SpareKeys spares;
+  std::vector<std::string> spareNames; // key names, by spare
+
+  Impl() {
+    display = wl_display_connect(nullptr);
+    if (display == nullptr) {
+      TYPR_LOG_WARN("backend::InputBackend",
+                    "Wayland: no compositor to connect to");
+      return;
+    }
+    static const wl_registry_listener registryListener = {
+        .global = &Impl::onGlobal,
+        .global_remove = &Impl::onGlobalRemove,
+    };
+    registry = wl_display_get_registry(display);
+    wl_registry_add_listener(registry, &registryListener, this);
+    wl_display_roundtrip(display); // globals
+    if (seat == nullptr || manager == nullptr) {
+      TYPR_LOG_WARN("backend::InputBackend",
+                    "Wayland: the compositor has no virtual keyboards");
+      disconnect();
+      return;
+    }
+    wl_display_roundtrip(display); // seat capabilities
+    readSeatKeymap();
+
+    if (!loadKeymap()) {
+      disconnect();
+      return;
+    }
+    for (const auto &[key, code] : kEvdevKeys) {
+      codes[static_cast<std::size_t>(key)] = static_cast<uint32_t>(code);
+    }
+    shiftCode = codes[static_cast<std::size_t>(Key::ShiftLeft)];
+    findSpares();
+    loadStrokes();
+
+    keyboard =
+        zwp_virtual_keyboard_manager_v1_create_virtual_keyboard(manager, seat);
+    uploadKeymap(keymapText);
+    // Untrusted clients are refused with a protocol error
+    if (wl_display_roundtrip(display) < 0) {
+      TYPR_LOG_WARN("backend::InputBackend",
+                    "Wayland: virtual keyboard refused ({})",
+                    wl_display_get_error(display));
+      disconnect();
+    }
+  }
+
+  ~Impl() { disconnect(); }
+
+  Impl(const Impl &) = delete;
+  Impl &operator=(const Impl &) = delete;
+  Impl(Impl &&) = delete;
+  Impl &operator=(Impl &&) = delete;
+
+  void disconnect() {
+    if (keyboard != nullptr) {
+      // Our keymap, bindings included, goes with it
+      zwp_virtual_keyboard_v1_destroy(keyboard);
+      keyboard = nullptr;
+    }
+    if (manager != nullptr) {
+      zwp_virtual_keyboard_manager_v1_destroy(manager);
+      manager = nullptr;
+    }
+    if (seat != nullptr) {
+      if (seatVersion >= WL_SEAT_RELEASE_SINCE_VERSION) {
+        wl_seat_release(seat);
+      } else {
+        wl_seat_destroy(seat);
+      }
+      seat = nullptr;
+    }
+    if (registry != nullptr) {
+      wl_registry_destroy(registry);
+      registry = nullptr;
+    }
+    if (display != nullptr) {
+      wl_display_flush(display);
+      wl_display_disconnect(display);
+      display = nullptr;
+    }
+    xkb_state_unref(state);
+    state = nullptr;
+    xkb_keymap_unref(keymap);
+    keymap = nullptr;
+    xkb_context_unref(context);
+    context = nullptr;
+  }
+
+  static void onGlobal(void *data, wl_registry *registry, uint32_t name,
+                       const char *interface, uint32_t version) {
+    auto *self = static_cast<Impl *>(data);
+    const std::string_view id(interface);
+    if (id == wl_seat_interface.name && self->seat == nullptr) {
+      static const wl_seat_listener seatListener = {
+          .capabilities = &Impl::onSeatCapabilities,
+          .name = &Impl::onSeatName,
+      };
+      self->seatVersion = std::min(version, 5U);
+      self->seat = static_cast<wl_seat *>(wl_registry_bind(
+          registry, name, &wl_seat_interface, self->seatVersion));
+      wl_seat_add_listener(self->seat, &seatListener, self);
+    } else if (id == zwp_virtual_keyboard_manager_v1_interface.name) {
+      self->manager = static_cast<zwp_virtual_keyboard_manager_v1 *>(
+          wl_registry_bind(registry, name,
+                           &zwp_virtual_keyboard_manager_v1_interface, 1));
+    }
+  }
+
+  static void onGlobalRemove(void *, wl_registry *, uint32_t) {}
+
+  static void onSeatCapabilities(void *data, wl_seat *, uint32_t caps) {
+    static_cast<Impl *>(data)->seatCapabilities = caps;
+  }
+
+  static void onSeatName(void *, wl_seat *, const char *) {}
+
+  // The keymap of the seat's keyboard, so keys keep their meaning when the
+  // compositor switches between it and ours
+  void readSeatKeymap() {
+    if ((seatCapabilities & WL_SEAT_CAPABILITY_KEYBOARD) == 0) {
+      return;
+    }
+    static const wl_keyboard_listener keyboardListener = {
+        .keymap = &Impl::onSeatKeymap,
+        .enter = [](void *, wl_keyboard *, uint32_t, wl_surface *,
+                    wl_array *) {},
+        .leave = [](void *, wl_keyboard *, uint32_t, wl_surface *) {},
+        .key = [](void *, wl_keyboard *, uint32_t, uint32_t, uint32_t,
+                  uint32_t) {},
+        .modifiers = [](void *, wl_keyboard *, uint32_t, uint32_t, uint32_t,
+                        uint32_t, uint32_t) {},
+        .repeat_info = [](void *, wl_keyboard *, int32_t, int32_t) {},
+    };
+    wl_keyboard *seatKeyboard = wl_seat_get_keyboard(seat);
+    wl_keyboard_add_listener(seatKeyboard, &keyboardListener, this);
+    wl_display_roundtrip(display);
+    if (seatVersion >= WL_KEYBOARD_RELEASE_SINCE_VERSION) {
+      wl_keyboard_release(seatKeyboard);
+    } else {
+      wl_keyboard_destroy(seatKeyboard);
+    }
+  }
+
+  static void onSeatKeymap(void *data, wl_keyboard *, uint32_t format,
+                           int32_t fd, uint32_t size) {
+    auto *self = static_cast<Impl *>(data);
+    if (format == WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1 && size > 0) {
+      void *text = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (text != MAP_FAILED) {
+        // NUL-terminated, as the protocol asks
+        self->seatKeymap.assign(static_cast<const char *>(text), size - 1);
+        munmap(text, size);
+      }
+    }
+    close(fd);
+  }
+
+  bool loadKeymap() {
+    context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+    if (context == nullptr) {
+      return false;
+    }
+    if (!seatKeymap.empty()) {
+      keymap = xkb_keymap_new_from_string(context, seatKeymap.c_str(),
+                                          XKB_KEYMAP_FORMAT_TEXT_V1,
+                                          XKB_KEYMAP_COMPILE_NO_FLAGS);
+    }
+    if (keymap == nullptr) {
+      // No keyboard on the seat: the XKB_DEFAULT_* layout
+      keymap = xkb_keymap_new_from_names(context, nullptr,
+                                         XKB_KEYMAP_COMPILE_NO_FLAGS);
+    }
+    if (keymap == nullptr) {
+      TYPR_LOG_WARN("backend::InputBackend", "Wayland: no keymap");
+      return false;
+    }
+    char *text = xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
+    keymapText = text;
+    free(text);
+    state = xkb_state_new(keymap);
+    return state != nullptr;
+  }
+
+  // Hand `text` to the compositor in a sealed memfd: it cannot change under
+  // the compositor once it is mapped, so it is safe to map shared
+  bool uploadKeymap(const std::string &text) {
+    TYPR_TRACE_SPAN("backend", "Wayland uploadKeymap");
+    const int fd =
+        memfd_create("typr-osk-keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+      TYPR_LOG_WARN("backend::InputBackend", "Wayland: memfd_create() ({})",
+                    errno);
+      return false;
+    }
+    const std::size_t size = text.size() + 1; // with the NUL
+    std::size_t written = 0;
+    while (written < size) {
+      const ssize_t n = write(fd, text.c_str() + written, size - written);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        TYPR_LOG_WARN("backend::InputBackend", "Wayland: keymap write ({})",
+                      errno);
+        close(fd);
+        return false;
+      }
+      written += static_cast<std::size_t>(n);
+    }
+    fcntl(fd, F_ADD_SEALS,
+          F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    // libwayland sends a duplicate of the descriptor
+    zwp_virtual_keyboard_v1_keymap(keyboard, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1,
+                                   fd, static_cast<uint32_t>(size));
+    close(fd);
+    // A new keymap starts from a clean state in the compositor
+    sendModifiers();
+    return true;
+  }
+
+  void findSpares() {
+    // From the top: the low keycodes are the ones keyboards actually have
+    const xkb_keycode_t top =
+        std::min(xkb_keymap_max_keycode(keymap), kMaxSpareKeycode);
+    for (xkb_keycode_t keycode = top;
+         keycode > static_cast<xkb_keycode_t>(kEvdevToXKeycode) &&
+         keycode >= xkb_keymap_min_keycode(keymap) &&
+         spares.size() < kMaxSpares;
+         --keycode) {
+      const char *name = xkb_keymap_key_get_name(keymap, keycode);
+      if (name != nullptr &&
+          xkb_keymap_num_layouts_for_key(keymap, keycode) == 0) {
+        spares.add(keycode);
+        spareNames.emplace_back(name);
+      }
+    }
+    if (spares.empty()) {
+      TYPR_LOG_WARN("backend::InputBackend",
+                    "Wayland: no free keycode, only the layout's characters "
+                    "can be typed");
+    }
+  }
+
+  // Which key (and level) of the active layout types each keysym
+  void loadStrokes() {
+    TYPR_TRACE_SPAN("backend", "Wayland loadStrokes");
+    strokes.clear();
+    strokesLayout =
+        xkb_state_serialize_layout(state, XKB_STATE_LAYOUT_EFFECTIVE);
+    for (const xkb_level_index_t level : {1U, 0U}) {
+      for (xkb_keycode_t keycode = xkb_keymap_min_keycode(keymap);
+           keycode <= xkb_keymap_max_keycode(keymap); ++keycode) {
+        const xkb_layout_index_t layouts =
+            xkb_keymap_num_layouts_for_key(keymap, keycode);
+        if (layouts == 0 ||
+            keycode < static_cast<xkb_keycode_t>(kEvdevToXKeycode)) {
+          continue;
+        }
+        const xkb_layout_index_t layout =
+            strokesLayout < layouts ? strokesLayout : 0;
+        const xkb_keysym_t *syms = nullptr;
+        if (xkb_keymap_key_get_syms_by_level(keymap, keycode, layout, level,
+                                             &syms) == 1) {
+          // Unshifted strokes run last and win
+          strokes[syms[0]] = {.keycode = keycode, .shift = level == 1};
+        }
+      }
+    }
+  }
+
+  // The keymap with the characters bound to spare keycodes, in one upload
+  bool bindSpares(const std::vector<SpareKeys::Binding> &binds) {
+    TYPR_TRACE_SPAN("backend", "Wayland bindSpares");
+    std::string text = withBindings();
+    xkb_keymap *check =
+        text.empty() ? nullptr
+                     : xkb_keymap_new_from_string(context, text.c_str(),
+                                                  XKB_KEYMAP_FORMAT_TEXT_V1,
+                                                  XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (check == nullptr) {
+      TYPR_LOG_WARN("backend::InputBackend",
+                    "Wayland: {} characters could not be bound", binds.size());
+      return false;
+    }
+    xkb_keymap_unref(check);
+    return uploadKeymap(text);
+  }
+
+  // The keymap text with a symbols entry per bound spare; empty if the text
+  // does not end the way xkbcommon writes it
+  [[nodiscard]] std::string withBindings() const {
+    std::string keys;
+    for (std::size_t index = 0; index < spares.size(); ++index) {
+      if (spares.sym(index) == SpareKeys::kNoSymbol) {
+        continue;
+      }
+      std::array<char, 64> name{};
+      xkb_keysym_get_name(spares.sym(index), name.data(), name.size());
+      // Bound on both levels, so a held Shift does not matter
+      keys += "\tkey <" + spareNames[index] + "> { [ " + name.data() + ", " +
+              name.data() + " ] };\n";
+    }
+    // The symbols section is the last one before the end of the keymap
+    const std::size_t keymapEnd = keymapText.rfind("};");
+    if (keymapEnd == std::string::npos || keymapEnd == 0) {
+      return {};
+    }
+    const std::size_t symbolsEnd = keymapText.rfind("};", keymapEnd - 1);
+    if (symbolsEnd == std::string::npos) {
+      return {};
+    }
+    std::string text = keymapText;
+    text.insert(symbolsEnd, keys);
+    return text;
+  }
+
+  void sendModifiers() {
+    zwp_virtual_keyboard_v1_modifiers(
+        keyboard, xkb_state_serialize_mods(state, XKB_STATE_MODS_DEPRESSED),
+        xkb_state_serialize_mods(state, XKB_STATE_MODS_LATCHED),
+        xkb_state_serialize_mods(state, XKB_STATE_MODS_LOCKED),
+        xkb_state_serialize_layout(state, XKB_STATE_LAYOUT_EFFECTIVE));
+    queue();
+  }
+
+  void send(uint32_t code, bool down, uint32_t time) {
+    zwp_virtual_keyboard_v1_key(keyboard, time, code,
+                                down ? WL_KEYBOARD_KEY_STATE_PRESSED
+                                     : WL_KEYBOARD_KEY_STATE_RELEASED);
+    queue();
+    // Spare keycodes have no actions, so the state needs no bindings
+    if (xkb_state_update_key(state, code + kEvdevToXKeycode,
+                             down ? XKB_KEY_DOWN : XKB_KEY_UP) != 0) {
+      sendModifiers();
+    }
+  }
+
+  bool sendKey(Key key, bool down) {
+    TYPR_TRACE_SPAN("backend", "Wayland key event");
+    const uint32_t code = codes[static_cast<std::size_t>(key)];
+    if (keyboard == nullptr || broken || code == 0) {
+      return false;
+    }
+    send(code, down, timestamp());
+    return true;
+  }
+
+  // Long sequences go out in parts before the output buffer fills up
+  void queue() {
+    if (++queued >= kMaxQueued) {
+      flush();
+    }
+  }
+
+  bool flush() {
+    if (display == nullptr || broken) {
+      return false;
+    }
+    queued = 0;
+    while (wl_display_flush(display) < 0) {
+      if (errno != EAGAIN) {
+        // Also what a protocol error looks like from here
+        TYPR_LOG_WARN("backend::InputBackend",
+                      "Wayland: connection lost ({})", errno);
+        broken = true;
+        return false;
+      }
+      pollfd writable{};
+      writable.fd = wl_display_get_fd(display);
+      writable.events = POLLOUT;
+      if (poll(&writable, 1, kFlushTimeoutMs) <= 0) {
+        TYPR_LOG_WARN("backend::InputBackend",
+                      "Wayland: the compositor stopped reading");
+        broken = true;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void typeStroke(xkb_keycode_t keycode, bool shift, uint32_t time) {
+    // The level the character is on, whatever Shift the user holds
+    const bool shiftHeld = hasModifier(currentMods, Modifier::Shift);
+    const bool toggleShift = shift != shiftHeld;
+    const uint32_t code = keycode - kEvdevToXKeycode;
+    if (toggleShift) {
+      send(shiftCode, shift, time);
+    }
+    send(code, true, time);
+    send(code, false, time);
+    if (toggleShift) {
+      send(shiftCode, shiftHeld, time);
+    }
+  }
+
+  bool typeText(const std::u32string &text) {
+    if (xkb_state_serialize_layout(state, XKB_STATE_LAYOUT_EFFECTIVE) !=
+        strokesLayout) {
+      loadStrokes();
+    }
+
+    // The steps SpareKeys leaves to the backend
+    struct Steps {
+      Impl &impl;
+
+      static SpareKeys::Keysym keysym(char32_t codepoint) {
+        return keysymFor(codepoint);
+      }
+      [[nodiscard]] bool hasStroke(SpareKeys::Keysym sym) const {
+        return impl.strokes.contains(sym);
+      }
+      bool typeStroke(SpareKeys::Keysym sym) {
+        const auto stroke = impl.strokes.find(sym);
+        if (stroke == impl.strokes.end()) {
+          return false;
+        }
+        impl.typeStroke(stroke->second.keycode, stroke->second.shift,
+                        timestamp());
+        return true;
+      }
+      bool bind(const std::vector<SpareKeys::Binding> &binds) {
+        return impl.bindSpares(binds);
+      }
+      void typeSpare(uint32_t keycode) {
+        const uint32_t code = keycode - kEvdevToXKeycode;
+        const uint32_t time = timestamp();
+        impl.send(code, true, time);
+        impl.send(code, false, time);
+      }
+    };
+    Steps steps{*this};
+    return spares.typeText(text, steps);
+  }
+
+  [[nodiscard]] uint32_t delayMs() const { return (keyDelayUs + 999) / 1000; }
+};
+
+WaylandDriver::WaylandDriver() : m_impl(std::make_unique<Impl>()) {}
+WaylandDriver::~WaylandDriver() = default;
+
+BackendType WaylandDriver::type() const { return BackendType::LinuxWayland; }
+
+Capabilities WaylandDriver::capabilities() const {
+  const bool ready = isReady();
+  return {
+      .canInjectKeys = ready,
+      .canInjectText = ready,
+      .canSimulateHID = false, // the compositor's keyboard, not the kernel's
+      .supportsKeyRepeat = true, // clients repeat held keys themselves
+      .needsAccessibilityPerm = false,
+      .needsInputMonitoringPerm = false,
+      .needsUinputAccess = false,
+  };
+}
+
+bool WaylandDriver::isReady() const {
+  return m_impl && m_impl->keyboard != nullptr && !m_impl->broken;
+}
+
+bool WaylandDriver::requestPermissions() {
+  // Up to the compositor, which has already answered when we connected
+  return isReady();
+}
+
+bool WaylandDriver::keyDown(Key key) {
+  TYPR_TRACE_SPAN("backend", "InputBackend::keyDown");
+  if (!m_impl)
+    return false;
+
+  switch (key) {
+  case Key::ShiftLeft:
+  case Key::ShiftRight:
+    m_impl->currentMods = m_impl->currentMods | Modifier::Shift;
+    break;
+  case Key::CtrlLeft:
+  case Key::CtrlRight:
+    m_impl->currentMods = m_impl->currentMods | Modifier::Ctrl;
+    break;
+  case Key::AltLeft:
+  case Key::AltRight:
+    m_impl->currentMods = m_impl->currentMods | Modifier::Alt;
+    break;
+  case Key::SuperLeft:
+  case Key::SuperRight:
+    m_impl->currentMods = m_impl->currentMods | Modifier::Super;
+    break;
+  default:
+    break;
+  }
+  const bool result = m_impl->sendKey(key, true);
+  flush();
+  return result;
+}
+
+bool WaylandDriver::keyUp(Key key) {
+  TYPR_TRACE_SPAN("backend", "InputBackend::keyUp");
+  if (!m_impl)
+    return false;
+
+  const bool result = m_impl->sendKey(key, false);
+  flush();
+  switch (key) {
+  case Key::ShiftLeft:
+  case Key::ShiftRight:
+    m_impl->currentMods =
+        static_cast<Modifier>(static_cast<uint8_t>(m_impl->currentMods) &
+                              ~static_cast<uint8_t>(Modifier::Shift));
+    break;
+  case Key::CtrlLeft:
+  case Key::CtrlRight:
+    m_impl->currentMods =
+        static_cast<Modifier>(static_cast<uint8_t>(m_impl->currentMods) &
+                              ~static_cast<uint8_t>(Modifier::Ctrl));
+    break;
+  case Key::AltLeft:
+  case Key::AltRight:
+    m_impl->currentMods =
+        static_cast<Modifier>(static_cast<uint8_t>(m_impl->currentMods) &
+                              ~static_cast<uint8_t>(Modifier::Alt));
+    break;
+  case Key::SuperLeft:
+  case Key::SuperRight:
+    m_impl->currentMods =
+        static_cast<Modifier>(static_cast<uint8_t>(m_impl->currentMods) &
+                              ~static_cast<uint8_t>(Modifier::Super));
+    break;
+  default:
+    break;
+  }
+  return result;
+}
+
+bool WaylandDriver::tap(Key key) {
+  TYPR_TRACE_SPAN("backend", "InputBackend::tap");
+  const uint32_t code =
+      m_impl ? m_impl->codes[static_cast<std::size_t>(key)] : 0;
+  if (code == 0 || !isReady())
+    return false;
+  // One write: the key delay is the gap between the two timestamps
+  const uint32_t time = timestamp();
+  m_impl->send(code, true, time);
+  m_impl->send(code, false, time + m_impl->delayMs());
+  flush();
+  return true;
+}
+
+Modifier WaylandDriver::activeModifiers() const {
+  return m_impl ? m_impl->currentMods : Modifier::None;
+}
+
+bool WaylandDriver::holdModifier(Modifier mod) {
+  bool ok = true;
+  if (hasModifier(mod, Modifier::Shift))
+    ok &= keyDown(Key::ShiftLeft);
+  if (hasModifier(mod, Modifier::Ctrl))
+    ok &= keyDown(Key::CtrlLeft);
+  if (hasModifier(mod, Modifier::Alt))
+    ok &= keyDown(Key::AltLeft);
+  if (hasModifier(mod, Modifier::Super))
+    ok &= keyDown(Key::SuperLeft);
+  return ok;
+}
+
+bool WaylandDriver::releaseModifier(Modifier mod) {
+  bool ok = true;
+  if (hasModifier(mod, Modifier::Shift))
+    ok &= keyUp(Key::ShiftLeft);
+  if (hasModifier(mod, Modifier::Ctrl))
+    ok &= keyUp(Key::CtrlLeft);
+  if (hasModifier(mod, Modifier::Alt))
+    ok &= keyUp(Key::AltLeft);
+  if (hasModifier(mod, Modifier::Super))
+    ok &= keyUp(Key::SuperLeft);
+  return ok;
+}
+
+bool WaylandDriver::releaseAllModifiers() {
+  return releaseModifier(Modifier::Shift | Modifier::Ctrl | Modifier::Alt |
+                         Modifier::Super);
+}
+
+bool WaylandDriver::combo(Modifier mods, Key key) {
+  // One sequence: the modifiers go down, the key is tapped and the modifiers
+  // come up in a single flush
+  const uint32_t code =
+      m_impl ? m_impl->codes[static_cast<std::size_t>(key)] : 0;
+  if (code == 0 || !isReady())
+    return false;
+  const std::pair<Modifier, Key> modifierKeys[] = {
+      {Modifier::Shift, Key::ShiftLeft},
+      {Modifier::Ctrl, Key::CtrlLeft},
+      {Modifier::Alt, Key::AltLeft},
+      {Modifier::Super, Key::SuperLeft},
+  };
+  uint32_t time = timestamp();
+  for (const auto &[modifier, modifierKey] : modifierKeys) {
+    if (hasModifier(mods, modifier)) {
+      m_impl->send(m_impl->codes[static_cast<std::size_t>(modifierKey)], true,
+                   time);
+    }
+  }
+  time += m_impl->delayMs();
+  m_impl->send(code, true, time);
+  time += m_impl->delayMs();
+  m_impl->send(code, false, time);
+  for (const auto &[modifier, modifierKey] : modifierKeys) {
+    if (hasModifier(mods, modifier)) {
+      m_impl->send(m_impl->codes[static_cast<std::size_t>(modifierKey)], false,
+                   time);
+    }
+  }
+  flush();
+  return true;
+}
+
+bool WaylandDriver::typeText(const std::u32string &text) {
+  TYPR_TRACE_SPAN("backend", "InputBackend::typeText");
+  if (!isReady())
+    return false;
+  const bool ok = m_impl->typeText(text);
+  flush();
+  return ok && isReady();
+}
+
+void WaylandDriver::flush() {
+  if (m_impl)
+    m_impl->flush();
+}
+
+void WaylandDriver::setKeyDelay(uint32_t delayUs) {
+  if (m_impl)
+    m_impl->keyDelayUs = delayUs;
+}
+
+std::unique_ptr<Driver> makeWaylandDriver() {
+  return std::make_unique<WaylandDriver>();
+}
+
+bool waylandAvailable() {
+  // WAYLAND_DISPLAY defaults to wayland-0, but without it set this is not a
+  // Wayland session
+  const char *display = std::getenv("WAYLAND_DISPLAY");
+  return (display != nullptr && *display != '\0') ||
+         std::getenv("WAYLAND_SOCKET") != nullptr;
+}
+
+} // namespace backend
+
+#endif // __linux__ && BACKEND_HAVE_WAYLAND
@@ -1,6 +1,7 @@
 #ifdef _WIN32
 
 #include "backend.hpp"
+#include "core/trace.hpp"
 #include <Windows.h>
 #include <chrono>
 #include <thread>
@@ -282,6 +283,7 @@ bool InputBackend::isReady() const { return m_impl->ready; }
 bool InputBackend::requestPermissions() { return true; }
 
 bool InputBackend::keyDown(Key key) {
+  TYPR_TRACE_SPAN("backend", "InputBackend::keyDown");
   // Update modifier state when a modifier key is pressed
   switch (key) {
   case Key::ShiftLeft:
@@ -307,6 +309,7 @@ bool InputBackend::keyDown(Key key) {
 }
 
 bool InputBackend::keyUp(Key key) {
+  TYPR_TRACE_SPAN("backend", "InputBackend::keyUp");
   bool result = m_impl->sendKey(key, false);
   // Update modifier state when a modifier key is released
   switch (key) {
@@ -0,0 +1,605 @@
+#if defined(__linux__) && defined(BACKEND_HAVE_X11)
+
+#include "backend.hpp"
+#include "core/log.hpp"
+#include "core/trace.hpp"
+#include "driver.hpp"
+#include "evdev_keys.hpp"
+#include "spare_keys.hpp"
+
+#include <X11/XKBlib.h>
+#include <X11/Xlib.h>
+#include <X11/extensions/XTest.h>
+#include <X11/keysym.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace backend {
+
+/**
+ * Driver for X11 sessions, on the XTest extension.
+ *
+ * Keys are sent as fake events of the X server's XTest device, so nothing
+ * needs /dev/uinput and there is no device to create. Like uinput, a Key is a
+ * physical position (evdev code + 8), which is what the key captions show.
+ *
+ * Events are only queued in Xlib's output buffer: every public call is one
+ * sequence that ends with a single XFlush(), so a tap, a combo or a whole
+ * text is one write to the server. Delays between the events of a sequence
+ * are left to the server (the delay argument of XTestFakeKeyEvent) rather
+ * than slept on here.
+ *
+ * Text is typed with the keys of the active layout where it has them (with
+ * Shift for the second level). Other characters are bound to spare keycodes
+ * (see SpareKeys) with XChangeKeyboardMapping.
+ */
+
+namespace {
+
+// Spare keycodes to bind characters outside the layout to
+constexpr std::size_t kMaxSpares = 16;
+
+// Clients reread the keyboard mapping when told it changed; before a spare
+// keycode is bound to another character they get this long to have read the
+// key presses of the previous one.
+constexpr auto kRemapSettle = std::chrono::milliseconds(5);
+
+// Keysym of a character: Latin-1 keysyms are the codepoints, everything else
+// is the codepoint + 0x01000000
+KeySym keysymFor(char32_t codepoint) {
+  switch (codepoint) {
+  case U'\n':
+  case U'\r':
+    return XK_Return;
+  case U'\t':
+    return XK_Tab;
+  case U'\b':
+    return XK_BackSpace;
+  default:
+    break;
+  }
+  if ((codepoint >= 0x20 && codepoint <= 0x7e) ||
+      (codepoint >= 0xa0 && codepoint <= 0xff)) {
+    return codepoint;
+  }
+  if (codepoint < 0xa0 || codepoint > 0x10ffff) {
+    return NoSymbol;
+  }
+  return 0x01000000 | codepoint;
+}
+
+class XTestDriver final : public Driver {
+public:
+  XTestDriver();
+  ~XTestDriver() override;
+
+  [[nodiscard]] BackendType type() const override;
+  [[nodiscard]] Capabilities capabilities() const override;
+  [[nodiscard]] bool isReady() const override;
+  bool requestPermissions() override;
+  bool keyDown(Key key) override;
+  bool keyUp(Key key) override;
+  bool tap(Key key) override;
+  [[nodiscard]] Modifier activeModifiers() const override;
+  bool holdModifier(Modifier mod) override;
+  bool releaseModifier(Modifier mod) override;
+  bool releaseAllModifiers() override;
+  bool combo(Modifier mods, Key key) override;
+  bool typeText(const std::u32string &text) override;
+  void flush() override;
+  void setKeyDelay(uint32_t delayUs) override;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace
+
+struct XTestDriver::Impl {
+  // A key of the layout that types a keysym
+  struct Stroke {
+    KeyCode keycode{0};
+    bool shift{false};
+  };
+
+  Display *dpy{nullptr};
+  Modifier currentMods{}; // X11 defines None
+  uint32_t keyDelayUs{1000};
+  std::array<KeyCode, 256> keycodes{}; // by Key, 0 = none
+  KeyCode shiftKeycode{0};
+  std::unordered_map<KeySym, Stroke> strokes;
+  unsigned strokesGroup{0}; // the group `strokes` were read for
+  int xkbEventBase{0};
+  SpareKeys spares;
+  // Keycode ranges (first, count) remapped by bindSpares() whose MapNotify
+  // has not been read yet
+  std::vector<std::pair<int, int>> remaps;
+
+  Impl() {
+    int major = XkbMajorVersion;
+    int minor = XkbMinorVersion;
+    int errorBase = 0;
+    int reason = 0;
+    dpy = XkbOpenDisplay(nullptr, &xkbEventBase, &errorBase, &major, &minor,
+                         &reason);
+    if (dpy == nullptr) {
+      TYPR_LOG_WARN("backend::InputBackend",
+                    "X11: XkbOpenDisplay() failed ({})", reason);
+      return;
+    }
+    int eventBase = 0;
+    int xtestError = 0;
+    if (!XTestQueryExtension(dpy, &eventBase, &xtestError, &major, &minor)) {
+      TYPR_LOG_WARN("backend::InputBackend", "X11: no XTest extension");
+      XCloseDisplay(dpy);
+      dpy = nullptr;
+      return;
+    }
+    // Fake events must not be held up by another client's grab
+    XTestGrabControl(dpy, True);
+
+    for (const auto &[key, code] : kEvdevKeys) {
+      keycodes[static_cast<std::size_t>(key)] =
+          static_cast<KeyCode>(code + kEvdevToXKeycode);
+    }
+    shiftKeycode = keycodes[static_cast<std::size_t>(Key::ShiftLeft)];
+
+    findSpares();
+    XkbSelectEvents(dpy, XkbUseCoreKbd,
+                    XkbNewKeyboardNotifyMask | XkbMapNotifyMask,
+                    XkbNewKeyboardNotifyMask | XkbMapNotifyMask);
+    // A group switch (e.g. us,ru with a toggle key) changes the keys of
+    // every character without touching the map
+    XkbSelectEventDetails(dpy, XkbUseCoreKbd, XkbStateNotify,
+                          XkbGroupStateMask, XkbGroupStateMask);
+    loadStrokes();
+  }
+
+  ~Impl() {
+    if (dpy != nullptr) {
+      unbindSpares();
+      XCloseDisplay(dpy);
+    }
+  }
+
+  Impl(const Impl &) = delete;
+  Impl &operator=(const Impl &) = delete;
+  Impl(Impl &&) = delete;
+  Impl &operator=(Impl &&) = delete;
+
+  void findSpares() {
+    int minKeycode = 0;
+    int maxKeycode = 0;
+    XDisplayKeycodes(dpy, &minKeycode, &maxKeycode);
+    int perKeycode = 0;
+    KeySym *syms = XGetKeyboardMapping(dpy, static_cast<KeyCode>(minKeycode),
+                                       maxKeycode - minKeycode + 1,
+                                       &perKeycode);
+    if (syms == nullptr) {
+      return;
+    }
+    // From the top: the low keycodes are the ones keyboards actually have
+    for (int keycode = maxKeycode;
+         keycode >= minKeycode && spares.size() < kMaxSpares; --keycode) {
+      const KeySym *row = syms + ((keycode - minKeycode) * perKeycode);
+      bool empty = true;
+      for (int level = 0; level < perKeycode; ++level) {
+        empty = empty && row[level] == NoSymbol;
+      }
+      if (empty) {
+        spares.add(static_cast<uint32_t>(keycode));
+      }
+    }
+    XFree(syms);
+    if (spares.empty()) {
+      TYPR_LOG_WARN("backend::InputBackend",
+                    "X11: no free keycode, only the layout's characters can "
+                    "be typed");
+    }
+  }
+
+  // Which key (and level) of the active group types each keysym
+  void loadStrokes() {
+    TYPR_TRACE_SPAN("backend", "X11 loadStrokes");
+    strokes.clear();
+    XkbDescPtr xkb = XkbGetMap(dpy, XkbAllClientInfoMask, XkbUseCoreKbd);
+    if (xkb == nullptr) {
+      return;
+    }
+    XkbStateRec state;
+    strokesGroup =
+        XkbGetState(dpy, XkbUseCoreKbd, &state) == Success ? state.group : 0;
+    for (const bool shift : {true, false}) {
+      const unsigned coreState =
+          XkbBuildCoreState(shift ? ShiftMask : 0, strokesGroup);
+      for (int keycode = xkb->min_key_code; keycode <= xkb->max_key_code;
+           ++keycode) {
+        if (spares.isSpare(static_cast<uint32_t>(keycode))) {
+          continue;
+        }
+        unsigned consumed = 0;
+        KeySym sym = NoSymbol;
+        if (XkbTranslateKeyCode(xkb, static_cast<KeyCode>(keycode), coreState,
+                                &consumed, &sym) &&
+            sym != NoSymbol) {
+          // Unshifted strokes run last and win
+          strokes[sym] = {.keycode = static_cast<KeyCode>(keycode),
+                          .shift = shift};
+        }
+      }
+    }
+    XkbFreeKeyboard(xkb, 0, True);
+  }
+
+  // Reload the strokes if the layout or its active group changed (not
+  // counting our own bindings of spare keycodes)
+  void refreshLayout() {
+    bool reload = false;
+    while (XPending(dpy) > 0) {
+      XEvent event;
+      XNextEvent(dpy, &event);
+      if (event.type != xkbEventBase) {
+        continue;
+      }
+      const auto *xkbEvent = reinterpret_cast<const XkbEvent *>(&event);
+      if (xkbEvent->any.xkb_type == XkbNewKeyboardNotify) {
+        reload = true;
+      } else if (xkbEvent->any.xkb_type == XkbMapNotify) {
+        const XkbMapNotifyEvent &map = xkbEvent->map;
+        const auto own = std::ranges::find(
+            remaps, std::pair<int, int>{map.first_key_sym, map.num_key_syms});
+        if (own != remaps.end()) {
+          remaps.erase(own);
+        } else {
+          reload = true;
+        }
+      } else if (xkbEvent->any.xkb_type == XkbStateNotify) {
+        reload = reload ||
+                 static_cast<unsigned>(xkbEvent->state.group) != strokesGroup;
+      }
+    }
+    if (reload) {
+      loadStrokes();
+    }
+  }
+
+  // Bind characters to spare keycodes in one round of mapping changes
+  bool bindSpares(const std::vector<SpareKeys::Binding> &binds) {
+    TYPR_TRACE_SPAN("backend", "X11 bindSpares");
+    const bool rebinding =
+        std::ranges::any_of(binds, [](const SpareKeys::Binding &binding) {
+          return binding.previous != SpareKeys::kNoSymbol;
+        });
+    if (rebinding) {
+      // Let earlier presses of the keys being rebound be read first
+      XSync(dpy, False);
+      std::this_thread::sleep_for(kRemapSettle);
+    }
+    // One change over the keycodes from the lowest spare of the round to the
+    // highest. Keycodes in between that are not spares keep their symbols,
+    // read back from the server.
+    int first = 0;
+    int last = 0;
+    for (const SpareKeys::Binding &binding : binds) {
+      const int keycode = static_cast<int>(spares.keycode(binding.spare));
+      first = first == 0 ? keycode : std::min(first, keycode);
+      last = std::max(last, keycode);
+    }
+    const int count = last - first + 1;
+    int perKeycode = 2;
+    std::vector<KeySym> syms(static_cast<std::size_t>(count) * 2, NoSymbol);
+    bool onlySpares = true;
+    for (int keycode = first; keycode <= last; ++keycode) {
+      onlySpares = onlySpares && spares.isSpare(static_cast<uint32_t>(keycode));
+    }
+    if (!onlySpares) {
+      int currentPerKeycode = 0;
+      KeySym *current = XGetKeyboardMapping(dpy, static_cast<KeyCode>(first),
+                                            count, &currentPerKeycode);
+      if (current == nullptr) {
+        return false;
+      }
+      perKeycode = std::max(currentPerKeycode, 2);
+      syms.assign(static_cast<std::size_t>(count * perKeycode), NoSymbol);
+      for (int row = 0; row < count; ++row) {
+        std::copy_n(current + (row * currentPerKeycode), currentPerKeycode,
+                    syms.begin() + (row * perKeycode));
+      }
+      XFree(current);
+    }
+    // Every spare in the range, changed or not, is written with what it is
+    // bound to now, on both levels so a held Shift does not matter
+    for (std::size_t spare = 0; spare < spares.size(); ++spare) {
+      const int keycode = static_cast<int>(spares.keycode(spare));
+      if (keycode < first || keycode > last) {
+        continue;
+      }
+      const auto row = syms.begin() + ((keycode - first) * perKeycode);
+      std::fill_n(row, perKeycode, NoSymbol);
+      row[0] = row[1] = spares.sym(spare);
+    }
+    XChangeKeyboardMapping(dpy, first, perKeycode, syms.data(), count);
+    remaps.emplace_back(first, count);
+    return true;
+  }
+
+  void unbindSpares() {
+    const std::vector<SpareKeys::Binding> binds = spares.unbindAll();
+    if (!binds.empty()) {
+      bindSpares(binds);
+      XFlush(dpy);
+    }
+  }
+
+  void fake(KeyCode keycode, bool down, unsigned long delayMs = 0) {
+    XTestFakeKeyEvent(dpy, keycode, down ? True : False, delayMs);
+  }
+
+  bool sendKey(Key key, bool down) {
+    TYPR_TRACE_SPAN("backend", "XTest event");
+    const KeyCode keycode = keycodes[static_cast<std::size_t>(key)];
+    if (dpy == nullptr || keycode == 0) {
+      return false;
+    }
+    fake(keycode, down);
+    return true;
+  }
+
+  void typeStroke(const Stroke &stroke) {
+    // The level the character is on, whatever Shift the user holds
+    const bool shiftHeld = hasModifier(currentMods, Modifier::Shift);
+    const bool toggleShift = stroke.shift != shiftHeld;
+    if (toggleShift) {
+      fake(shiftKeycode, stroke.shift);
+    }
+    fake(stroke.keycode, true);
+    fake(stroke.keycode, false);
+    if (toggleShift) {
+      fake(shiftKeycode, shiftHeld);
+    }
+  }
+
+  bool typeText(const std::u32string &text) {
+    // The steps SpareKeys leaves to the backend
+    struct Steps {
+      Impl &impl;
+
+      static SpareKeys::Keysym keysym(char32_t codepoint) {
+        return static_cast<SpareKeys::Keysym>(keysymFor(codepoint));
+      }
+      [[nodiscard]] bool hasStroke(SpareKeys::Keysym sym) const {
+        return impl.strokes.contains(sym);
+      }
+      bool typeStroke(SpareKeys::Keysym sym) {
+        const auto stroke = impl.strokes.find(sym);
+        if (stroke == impl.strokes.end()) {
+          return false;
+        }
+        impl.typeStroke(stroke->second);
+        return true;
+      }
+      bool bind(const std::vector<SpareKeys::Binding> &binds) {
+        return impl.bindSpares(binds);
+      }
+      void typeSpare(uint32_t keycode) {
+        impl.fake(static_cast<KeyCode>(keycode), true);
+        impl.fake(static_cast<KeyCode>(keycode), false);
+      }
+    };
+    Steps steps{*this};
+    return spares.typeText(text, steps);
+  }
+
+  unsigned long delayMs() const { return (keyDelayUs + 999) / 1000; }
+};
+
+XTestDriver::XTestDriver() : m_impl(std::make_unique<Impl>()) {}
+XTestDriver::~XTestDriver() = default;
+
+BackendType XTestDriver::type() const { return BackendType::LinuxX11; }
+
+Capabilities XTestDriver::capabilities() const {
+  const bool ready = isReady();
+  return {
+      .canInjectKeys = ready,
+      .canInjectText = ready,
+      .canSimulateHID = false, // events of the server's XTest device
+      .supportsKeyRepeat = true,
+      .needsAccessibilityPerm = false,
+      .needsInputMonitoringPerm = false,
+      .needsUinputAccess = false,
+  };
+}
+
+bool XTestDriver::isReady() const {
+  return m_impl && m_impl->dpy != nullptr;
+}
+
+bool XTestDriver::requestPermissions() {
+  // Any client of the X server may use XTest
+  return isReady();
+}
+
+bool XTestDriver::keyDown(Key key) {
+  TYPR_TRACE_SPAN("backend", "InputBackend::keyDown");
+  if (!m_impl)
+    return false;
+
+  switch (key) {
+  case Key::ShiftLeft:
+  case Key::ShiftRight:
+    m_impl->currentMods = m_impl->currentMods | Modifier::Shift;
+    break;
+  case Key::CtrlLeft:
+  case Key::CtrlRight:
+    m_impl->currentMods = m_impl->currentMods | Modifier::Ctrl;
+    break;
+  case Key::AltLeft:
+  case Key::AltRight:
+    m_impl->currentMods = m_impl->currentMods | Modifier::Alt;
+    break;
+  case Key::SuperLeft:
+  case Key::SuperRight:
+    m_impl->currentMods = m_impl->currentMods | Modifier::Super;
+    break;
+  default:
+    break;
+  }
+  const bool result = m_impl->sendKey(key, true);
+  flush();
+  return result;
+}
+
+bool XTestDriver::keyUp(Key key) {
+  TYPR_TRACE_SPAN("backend", "InputBackend::keyUp");
+  if (!m_impl)
+    return false;
+
+  const bool result = m_impl->sendKey(key, false);
+  flush();
+  switch (key) {
+  case Key::ShiftLeft:
+  case Key::ShiftRight:
+    m_impl->currentMods =
+        static_cast<Modifier>(static_cast<uint8_t>(m_impl->currentMods) &
+                              ~static_cast<uint8_t>(Modifier::Shift));
+    break;
+  case Key::CtrlLeft:
+  case Key::CtrlRight:
+    m_impl->currentMods =
+        static_cast<Modifier>(static_cast<uint8_t>(m_impl->currentMods) &
+                              ~static_cast<uint8_t>(Modifier::Ctrl));
+    break;
+  case Key::AltLeft:
+  case Key::AltRight:
+    m_impl->currentMods =
+        static_cast<Modifier>(static_cast<uint8_t>(m_impl->currentMods) &
+                              ~static_cast<uint8_t>(Modifier::Alt));
+    break;
+  case Key::SuperLeft:
+  case Key::SuperRight:
+    m_impl->currentMods =
+        static_cast<Modifier>(static_cast<uint8_t>(m_impl->currentMods) &
+                              ~static_cast<uint8_t>(Modifier::Super));
+    break;
+  default:
+    break;
+  }
+  return result;
+}
+
+bool XTestDriver::tap(Key key) {
+  TYPR_TRACE_SPAN("backend", "InputBackend::tap");
+  if (!m_impl || !m_impl->sendKey(key, true))
+    return false;
+  // The server holds the key down for the key delay
+  m_impl->fake(m_impl->keycodes[static_cast<std::size_t>(key)], false,
+               m_impl->delayMs());
+  flush();
+  return true;
+}
+
+Modifier XTestDriver::activeModifiers() const {
+  return m_impl ? m_impl->currentMods : Modifier{};
+}
+
+bool XTestDriver::holdModifier(Modifier mod) {
+  bool ok = true;
+  if (hasModifier(mod, Modifier::Shift))
+    ok &= keyDown(Key::ShiftLeft);
+  if (hasModifier(mod, Modifier::Ctrl))
+    ok &= keyDown(Key::CtrlLeft);
+  if (hasModifier(mod, Modifier::Alt))
+    ok &= keyDown(Key::AltLeft);
+  if (hasModifier(mod, Modifier::Super))
+    ok &= keyDown(Key::SuperLeft);
+  return ok;
+}
+
+bool XTestDriver::releaseModifier(Modifier mod) {
+  bool ok = true;
+  if (hasModifier(mod, Modifier::Shift))
+    ok &= keyUp(Key::ShiftLeft);
+  if (hasModifier(mod, Modifier::Ctrl))
+    ok &= keyUp(Key::CtrlLeft);
+  if (hasModifier(mod, Modifier::Alt))
+    ok &= keyUp(Key::AltLeft);
+  if (hasModifier(mod, Modifier::Super))
+    ok &= keyUp(Key::SuperLeft);
+  return ok;
+}
+
+bool XTestDriver::releaseAllModifiers() {
+  return releaseModifier(Modifier::Shift | Modifier::Ctrl | Modifier::Alt |
+                         Modifier::Super);
+}
+
+bool XTestDriver::combo(Modifier mods, Key key) {
+  // One sequence: the modifiers go down, the key is tapped and the modifiers
+  // come up in a single flush
+  const KeyCode keycode =
+      m_impl ? m_impl->keycodes[static_cast<std::size_t>(key)] : 0;
+  if (keycode == 0 || !isReady())
+    return false;
+  const std::pair<Modifier, Key> modifierKeys[] = {
+      {Modifier::Shift, Key::ShiftLeft},
+      {Modifier::Ctrl, Key::CtrlLeft},
+      {Modifier::Alt, Key::AltLeft},
+      {Modifier::Super, Key::SuperLeft},
+  };
+  for (const auto &[modifier, modifierKey] : modifierKeys) {
+    if (hasModifier(mods, modifier)) {
+      m_impl->sendKey(modifierKey, true);
+    }
+  }
+  m_impl->fake(keycode, true, m_impl->delayMs());
+  m_impl->fake(keycode, false, m_impl->delayMs());
+  for (const auto &[modifier, modifierKey] : modifierKeys) {
+    if (hasModifier(mods, modifier)) {
+      m_impl->sendKey(modifierKey, false);
+    }
+  }
+  flush();
+  return true;
+}
+
+bool XTestDriver::typeText(const std::u32string &text) {
+  TYPR_TRACE_SPAN("backend", "InputBackend::typeText");
+  if (!isReady())
+    return false;
+  m_impl->refreshLayout();
+  const bool ok = m_impl->typeText(text);
+  flush();
+  return ok;
+}
+
+void XTestDriver::flush() {
+  if (isReady())
+    XFlush(m_impl->dpy);
+}
+
+void XTestDriver::setKeyDelay(uint32_t delayUs) {
+  if (m_impl)
+    m_impl->keyDelayUs = delayUs;
+}
+
+std::unique_ptr<Driver> makeXTestDriver() {
+  return std::make_unique<XTestDriver>();
+}
+
+bool xtestAvailable() {
+  const char *display = std::getenv("DISPLAY");
+  return display != nullptr && *display != '\0';
+}
+
+} // namespace backend
+
+#endif // __linux__ && BACKEND_HAVE_X11
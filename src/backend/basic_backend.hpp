@@ -0,0 +1,178 @@
+#pragma once
+
+#include "backend.hpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace backend {
+
+// The modifier a key holds, None for the other keys
+[[nodiscard]] constexpr Modifier modifierOf(Key key) {
+  switch (key) {
+  case Key::ShiftLeft:
+  case Key::ShiftRight:
+    return Modifier::Shift;
+  case Key::CtrlLeft:
+  case Key::CtrlRight:
+    return Modifier::Ctrl;
+  case Key::AltLeft:
+  case Key::AltRight:
+    return Modifier::Alt;
+  case Key::SuperLeft:
+  case Key::SuperRight:
+    return Modifier::Super;
+  default:
+    return Modifier::None;
+  }
+}
+
+// Timing policy: sleeps between the presses of a tap or combo
+class SleepTiming {
+public:
+  void setDelay(uint32_t delayUs) { delayUs_ = delayUs; }
+
+  void pause() const {
+    if (delayUs_ > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(delayUs_));
+    }
+  }
+
+private:
+  uint32_t delayUs_{1000};
+};
+
+/**
+ * @brief The InputBackend key operations over compile-time policies, for
+ * code that knows its backend and wants the calls inlined into its loop.
+ *
+ * `Policy` provides:
+ * - `Sink`, built from the constructor arguments: `isOpen()`,
+ *   `key(int code, bool down)` for one reported key event, `sync()`
+ * - `Keymap`: `static int code(Key)`, negative for keys it cannot send
+ * - `Timing`: `setDelay(uint32_t us)`, `pause()` between the presses of a
+ *   tap or combo
+ * - `kType`, and `kCapabilities` (`canInjectKeys` follows the sink)
+ *
+ * There is no text injection; typeText() fails. InputBackend stays the
+ * type-erased entry point: on Linux the registry hands out these wrapped in
+ * a DriverAdapter, and bound() (driver.hpp) gets the concrete one back.
+ */
+template <typename Policy> class BasicInputBackend {
+public:
+  using Sink = typename Policy::Sink;
+  using Keymap = typename Policy::Keymap;
+  using Timing = typename Policy::Timing;
+
+  template <typename... Args>
+  explicit BasicInputBackend(Args &&...args)
+      : sink_(std::forward<Args>(args)...) {}
+
+  [[nodiscard]] static constexpr BackendType type() { return Policy::kType; }
+
+  [[nodiscard]] Capabilities capabilities() const {
+    Capabilities capabilities = Policy::kCapabilities;
+    capabilities.canInjectKeys = isReady();
+    return capabilities;
+  }
+
+  [[nodiscard]] bool isReady() const { return sink_.isOpen(); }
+
+  bool keyDown(Key key) {
+    mods_ = mods_ | modifierOf(key);
+    return send(key, true);
+  }
+
+  bool keyUp(Key key) {
+    const bool sent = send(key, false);
+    mods_ = static_cast<Modifier>(static_cast<uint8_t>(mods_) &
+                                  ~static_cast<uint8_t>(modifierOf(key)));
+    return sent;
+  }
+
+  bool tap(Key key) {
+    if (!keyDown(key)) {
+      return false;
+    }
+    timing_.pause();
+    return keyUp(key);
+  }
+
+  [[nodiscard]] Modifier activeModifiers() const { return mods_; }
+
+  bool holdModifier(Modifier mod) {
+    bool ok = true;
+    if (hasModifier(mod, Modifier::Shift)) {
+      ok &= keyDown(Key::ShiftLeft);
+    }
+    if (hasModifier(mod, Modifier::Ctrl)) {
+      ok &= keyDown(Key::CtrlLeft);
+    }
+    if (hasModifier(mod, Modifier::Alt)) {
+      ok &= keyDown(Key::AltLeft);
+    }
+    if (hasModifier(mod, Modifier::Super)) {
+      ok &= keyDown(Key::SuperLeft);
+    }
+    return ok;
+  }
+
+  bool releaseModifier(Modifier mod) {
+    bool ok = true;
+    if (hasModifier(mod, Modifier::Shift)) {
+      ok &= keyUp(Key::ShiftLeft);
+    }
+    if (hasModifier(mod, Modifier::Ctrl)) {
+      ok &= keyUp(Key::CtrlLeft);
+    }
+    if (hasModifier(mod, Modifier::Alt)) {
+      ok &= keyUp(Key::AltLeft);
+    }
+    if (hasModifier(mod, Modifier::Super)) {
+      ok &= keyUp(Key::SuperLeft);
+    }
+    return ok;
+  }
+
+  bool releaseAllModifiers() {
+    return releaseModifier(Modifier::Shift | Modifier::Ctrl | Modifier::Alt |
+                           Modifier::Super);
+  }
+
+  bool combo(Modifier mods, Key key) {
+    if (!holdModifier(mods)) {
+      return false;
+    }
+    timing_.pause();
+    const bool ok = tap(key);
+    timing_.pause();
+    releaseModifier(mods);
+    return ok;
+  }
+
+  bool typeText(const std::u32string & /*text*/) { return false; }
+
+  void flush() { sink_.sync(); }
+
+  void setKeyDelay(uint32_t delayUs) { timing_.setDelay(delayUs); }
+
+  [[nodiscard]] Sink &sink() { return sink_; }
+
+private:
+  bool send(Key key, bool down) {
+    const int code = Keymap::code(key);
+    if (code < 0 || !sink_.isOpen()) {
+      return false;
+    }
+    sink_.key(code, down);
+    return true;
+  }
+
+  Sink sink_;
+  [[no_unique_address]] Timing timing_;
+  Modifier mods_{Modifier::None};
+};
+
+} // namespace backend
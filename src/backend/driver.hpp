@@ -0,0 +1,133 @@
+#pragma once
+
+#include "backend.hpp"
+#include "core/trace.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace backend {
+
+/**
+ * One way of injecting keys, behind InputBackend on Linux.
+ *
+ * A Linux build carries every backend the system had headers for (uinput,
+ * XTest, Wayland virtual keyboard); BackendRegistry picks one at runtime and
+ * InputBackend forwards to it. Same contract as the InputBackend methods of
+ * the same names. UTF-8 conversion is done by InputBackend.
+ */
+class Driver {
+public:
+  Driver() = default;
+  virtual ~Driver() = default;
+
+  Driver(const Driver &) = delete;
+  Driver &operator=(const Driver &) = delete;
+  Driver(Driver &&) = delete;
+  Driver &operator=(Driver &&) = delete;
+
+  [[nodiscard]] virtual BackendType type() const = 0;
+  [[nodiscard]] virtual Capabilities capabilities() const = 0;
+  [[nodiscard]] virtual bool isReady() const = 0;
+  virtual bool requestPermissions() = 0;
+
+  virtual bool keyDown(Key key) = 0;
+  virtual bool keyUp(Key key) = 0;
+  virtual bool tap(Key key) = 0;
+
+  [[nodiscard]] virtual Modifier activeModifiers() const = 0;
+  virtual bool holdModifier(Modifier mod) = 0;
+  virtual bool releaseModifier(Modifier mod) = 0;
+  virtual bool releaseAllModifiers() = 0;
+  virtual bool combo(Modifier mods, Key key) = 0;
+
+  virtual bool typeText(const std::u32string &text) = 0;
+
+  virtual void flush() = 0;
+  virtual void setKeyDelay(uint32_t delayUs) = 0;
+};
+
+/**
+ * A BasicInputBackend (or anything with the same members) as a Driver, so
+ * the registry can hand it out like the others while bound() gives callers
+ * that know the type the concrete backend, calls inlined.
+ */
+template <typename Backend> class DriverAdapter final : public Driver {
+public:
+  template <typename... Args>
+  explicit DriverAdapter(Args &&...args)
+      : backend_(std::forward<Args>(args)...) {}
+
+  [[nodiscard]] Backend &backend() { return backend_; }
+
+  [[nodiscard]] BackendType type() const override { return backend_.type(); }
+  [[nodiscard]] Capabilities capabilities() const override {
+    return backend_.capabilities();
+  }
+  [[nodiscard]] bool isReady() const override { return backend_.isReady(); }
+  // Nothing a running process can ask for
+  bool requestPermissions() override { return backend_.isReady(); }
+
+  bool keyDown(Key key) override {
+    TYPR_TRACE_SPAN("backend", "InputBackend::keyDown");
+    return backend_.keyDown(key);
+  }
+  bool keyUp(Key key) override {
+    TYPR_TRACE_SPAN("backend", "InputBackend::keyUp");
+    return backend_.keyUp(key);
+  }
+  bool tap(Key key) override { return backend_.tap(key); }
+
+  [[nodiscard]] Modifier activeModifiers() const override {
+    return backend_.activeModifiers();
+  }
+  bool holdModifier(Modifier mod) override {
+    return backend_.holdModifier(mod);
+  }
+  bool releaseModifier(Modifier mod) override {
+    return backend_.releaseModifier(mod);
+  }
+  bool releaseAllModifiers() override {
+    return backend_.releaseAllModifiers();
+  }
+  bool combo(Modifier mods, Key key) override {
+    return backend_.combo(mods, key);
+  }
+
+  bool typeText(const std::u32string &text) override {
+    return backend_.typeText(text);
+  }
+
+  void flush() override { backend_.flush(); }
+  void setKeyDelay(uint32_t delayUs) override {
+    backend_.setKeyDelay(delayUs);
+  }
+
+private:
+  Backend backend_;
+};
+
+// The Backend behind `input` when the registry picked that one, for loops
+// worth compiling against it; null for any other driver (and in tests, whose
+// InputBackend has none). Stays owned by `input`.
+template <typename Backend> Backend *bound(InputBackend &input) {
+  auto *adapter = dynamic_cast<DriverAdapter<Backend> *>(input.driver());
+  return adapter != nullptr ? &adapter->backend() : nullptr;
+}
+
+// The drivers, each defined by its backend_*.cpp. The *Available() checks
+// are cheap and open nothing: whether the session and permissions allow the
+// driver at all.
+std::unique_ptr<Driver> makeUinputDriver();
+bool uinputAvailable();
+#ifdef BACKEND_HAVE_X11
+std::unique_ptr<Driver> makeXTestDriver();
+bool xtestAvailable();
+#endif
+#ifdef BACKEND_HAVE_WAYLAND
+std::unique_ptr<Driver> makeWaylandDriver();
+bool waylandAvailable();
+#endif
+
+} // namespace backend
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "backend.hpp"
+
+#include <array>
+#include <cstdint>
+#include <linux/input-event-codes.h>
+
+namespace backend {
+
+// Key -> Linux input event code (KEY_*), i.e. a physical key position. The X
+// server numbers the same keys with the event code + kEvdevToXKeycode.
+struct EvdevKey {
+  Key key;
+  int code;
+};
+
+inline constexpr int kEvdevToXKeycode = 8;
+
+inline constexpr EvdevKey kEvdevKeys[] = {
+    // Letters
+    {Key::A, KEY_A},
+    {Key::B, KEY_B},
+    {Key::C, KEY_C},
+    {Key::D, KEY_D},
+    {Key::E, KEY_E},
+    {Key::F, KEY_F},
+    {Key::G, KEY_G},
+    {Key::H, KEY_H},
+    {Key::I, KEY_I},
+    {Key::J, KEY_J},
+    {Key::K, KEY_K},
+    {Key::L, KEY_L},
+    {Key::M, KEY_M},
+    {Key::N, KEY_N},
+    {Key::O, KEY_O},
+    {Key::P, KEY_P},
+    {Key::Q, KEY_Q},
+    {Key::R, KEY_R},
+    {Key::S, KEY_S},
+    {Key::T, KEY_T},
+    {Key::U, KEY_U},
+    {Key::V, KEY_V},
+    {Key::W, KEY_W},
+    {Key::X, KEY_X},
+    {Key::Y, KEY_Y},
+    {Key::Z, KEY_Z},
+
+    // Numbers (top row)
+    {Key::Num0, KEY_0},
+    {Key::Num1, KEY_1},
+    {Key::Num2, KEY_2},
+    {Key::Num3, KEY_3},
+    {Key::Num4, KEY_4},
+    {Key::Num5, KEY_5},
+    {Key::Num6, KEY_6},
+    {Key::Num7, KEY_7},
+    {Key::Num8, KEY_8},
+    {Key::Num9, KEY_9},
+
+    // Function keys
+    {Key::F1, KEY_F1},
+    {Key::F2, KEY_F2},
+    {Key::F3, KEY_F3},
+    {Key::F4, KEY_F4},
+    {Key::F5, KEY_F5},
+    {Key::F6, KEY_F6},
+    {Key::F7, KEY_F7},
+    {Key::F8, KEY_F8},
+    {Key::F9, KEY_F9},
+    {Key::F10, KEY_F10},
+    {Key::F11, KEY_F11},
+    {Key::F12, KEY_F12},
+    {Key::F13, KEY_F13},
+    {Key::F14, KEY_F14},
+    {Key::F15, KEY_F15},
+    {Key::F16, KEY_F16},
+    {Key::F17, KEY_F17},
+    {Key::F18, KEY_F18},
+    {Key::F19, KEY_F19},
+    {Key::F20, KEY_F20},
+
+    // Control
+    {Key::Enter, KEY_ENTER},
+    {Key::Escape, KEY_ESC},
+    {Key::Backspace, KEY_BACKSPACE},
+    {Key::Tab, KEY_TAB},
+    {Key::Space, KEY_SPACE},
+
+    // Navigation
+    {Key::Left, KEY_LEFT},
+    {Key::Right, KEY_RIGHT},
+    {Key::Up, KEY_UP},
+    {Key::Down, KEY_DOWN},
+    {Key::Home, KEY_HOME},
+    {Key::End, KEY_END},
+    {Key::PageUp, KEY_PAGEUP},
+    {Key::PageDown, KEY_PAGEDOWN},
+    {Key::Delete, KEY_DELETE},
+    {Key::Insert, KEY_INSERT},
+
+    // Numpad
+    {Key::Numpad0, KEY_KP0},
+    {Key::Numpad1, KEY_KP1},
+    {Key::Numpad2, KEY_KP2},
+    {Key::Numpad3, KEY_KP3},
+    {Key::Numpad4, KEY_KP4},
+    {Key::Numpad5, KEY_KP5},
+    {Key::Numpad6, KEY_KP6},
+    {Key::Numpad7, KEY_KP7},
+    {Key::Numpad8, KEY_KP8},
+    {Key::Numpad9, KEY_KP9},
+    {Key::NumpadDivide, KEY_KPSLASH},
+    {Key::NumpadMultiply, KEY_KPASTERISK},
+    {Key::NumpadMinus, KEY_KPMINUS},
+    {Key::NumpadPlus, KEY_KPPLUS},
+    {Key::NumpadEnter, KEY_KPENTER},
+    {Key::NumpadDecimal, KEY_KPDOT},
+
+    // Modifiers
+    {Key::ShiftLeft, KEY_LEFTSHIFT},
+    {Key::ShiftRight, KEY_RIGHTSHIFT},
+    {Key::CtrlLeft, KEY_LEFTCTRL},
+    {Key::CtrlRight, KEY_RIGHTCTRL},
+    {Key::AltLeft, KEY_LEFTALT},
+    {Key::AltRight, KEY_RIGHTALT},
+    {Key::SuperLeft, KEY_LEFTMETA},
+    {Key::SuperRight, KEY_RIGHTMETA},
+    {Key::CapsLock, KEY_CAPSLOCK},
+    {Key::NumLock, KEY_NUMLOCK},
+
+    // Misc
+    {Key::Menu, KEY_MENU},
+    {Key::Mute, KEY_MUTE},
+    {Key::VolumeDown, KEY_VOLUMEDOWN},
+    {Key::VolumeUp, KEY_VOLUMEUP},
+    {Key::MediaPlayPause, KEY_PLAYPAUSE},
+    {Key::MediaStop, KEY_STOPCD},
+    {Key::MediaNext, KEY_NEXTSONG},
+    {Key::MediaPrevious, KEY_PREVIOUSSONG},
+
+    // Punctuation / layout-dependent
+    {Key::Grave, KEY_GRAVE},
+    {Key::Minus, KEY_MINUS},
+    {Key::Equal, KEY_EQUAL},
+    {Key::LeftBracket, KEY_LEFTBRACE},
+    {Key::RightBracket, KEY_RIGHTBRACE},
+    {Key::Backslash, KEY_BACKSLASH},
+    {Key::Semicolon, KEY_SEMICOLON},
+    {Key::Apostrophe, KEY_APOSTROPHE},
+    {Key::Comma, KEY_COMMA},
+    {Key::Period, KEY_DOT},
+    {Key::Slash, KEY_SLASH},
+};
+
+// Keymap policy of BasicInputBackend: kEvdevKeys as a table indexed by Key,
+// so a lookup is one load
+struct EvdevKeymap {
+  static constexpr std::array<int16_t, 256> kCodes = []() {
+    std::array<int16_t, 256> codes{};
+    codes.fill(-1);
+    for (const auto &[key, code] : kEvdevKeys) {
+      codes[static_cast<uint8_t>(key)] = static_cast<int16_t>(code);
+    }
+    return codes;
+  }();
+
+  [[nodiscard]] static constexpr int code(Key key) {
+    return kCodes[static_cast<uint8_t>(key)];
+  }
+};
+
+} // namespace backend
@@ -166,13 +166,15 @@ const std::vector<std::pair<Key, std::string>> &keyStringPairs() {
 
 } // namespace
 
-std::string keyToString(Key key) {
+std::string keyToString(Key key) { return std::string(keyName(key)); }
+
+std::string_view keyName(Key key) {
   for (const auto &pair : keyStringPairs()) {
     if (pair.first == key) {
       return pair.second;
     }
   }
-  return {"Unknown"};
+  return "Unknown";
 }
 
 Key stringToKey(const std::string &input) {
@@ -222,6 +224,9 @@ Key stringToKey(const std::string &input) {
     rev.emplace("slash", Key::Slash);
     rev.emplace("bracketleft", Key::LeftBracket);
     rev.emplace("bracketright", Key::RightBracket);
+    rev.emplace("leftbracket", Key::LeftBracket);
+    rev.emplace("rightbracket", Key::RightBracket);
+    rev.emplace("equal", Key::Equal);
 
     // Numeric keypad aliases (numpadX is already present via canonical mapping,
     // but also allow \"kpX\" prefixes that some users might use).
@@ -245,4 +250,22 @@ Key stringToKey(const std::string &input) {
   return Key::Unknown;
 }
 
+bool isModifierKey(Key key) {
+  switch (key) {
+  case Key::ShiftLeft:
+  case Key::ShiftRight:
+  case Key::CtrlLeft:
+  case Key::CtrlRight:
+  case Key::AltLeft:
+  case Key::AltRight:
+  case Key::SuperLeft:
+  case Key::SuperRight:
+  case Key::CapsLock:
+  case Key::NumLock:
+    return true;
+  default:
+    return false;
+  }
+}
+
 } // namespace backend
@@ -0,0 +1,33 @@
+#if !defined(__linux__)
+
+#include "backend.hpp"
+
+namespace backend {
+
+// Keymap without a platform implementation: no captions are resolved and the
+// keys keep the names of the Key enum.
+
+struct Keymap::Impl {};
+
+Keymap::Keymap() : m_impl(std::make_unique<Impl>()) {}
+Keymap::~Keymap() = default;
+Keymap::Keymap(Keymap &&) noexcept = default;
+Keymap &Keymap::operator=(Keymap &&) noexcept = default;
+
+bool Keymap::isAvailable() const { return false; }
+
+int Keymap::notifierFd() const { return -1; }
+
+Keymap::State Keymap::poll() { return 0; }
+
+uint32_t Keymap::generation() const { return 0; }
+
+void Keymap::captions(State /*state*/, Captions &out) const {
+  for (auto &caption : out) {
+    caption.clear();
+  }
+}
+
+} // namespace backend
+
+#endif // !__linux__
@@ -0,0 +1,254 @@
+#if defined(__linux__)
+
+#include "backend.hpp"
+#include "core/log.hpp"
+
+#include <X11/XKBlib.h>
+#include <X11/Xlib.h>
+#include <linux/input-event-codes.h>
+
+#include <utility>
+
+namespace backend {
+
+/**
+ * Keymap implementation for X11 using XKB.
+ *
+ * Captions are resolved per physical key (evdev code + 8 is the X keycode),
+ * which is also what the uinput backend injects, so a caption is what the key
+ * will actually type. Layout, keymap and modifier changes arrive as XKB events
+ * on a dedicated display connection.
+ */
+
+namespace {
+
+// Keys whose caption comes from the keymap; everything else keeps its name
+constexpr std::pair<Key, int> kPrintableKeys[] = {
+    {Key::A, KEY_A},
+    {Key::B, KEY_B},
+    {Key::C, KEY_C},
+    {Key::D, KEY_D},
+    {Key::E, KEY_E},
+    {Key::F, KEY_F},
+    {Key::G, KEY_G},
+    {Key::H, KEY_H},
+    {Key::I, KEY_I},
+    {Key::J, KEY_J},
+    {Key::K, KEY_K},
+    {Key::L, KEY_L},
+    {Key::M, KEY_M},
+    {Key::N, KEY_N},
+    {Key::O, KEY_O},
+    {Key::P, KEY_P},
+    {Key::Q, KEY_Q},
+    {Key::R, KEY_R},
+    {Key::S, KEY_S},
+    {Key::T, KEY_T},
+    {Key::U, KEY_U},
+    {Key::V, KEY_V},
+    {Key::W, KEY_W},
+    {Key::X, KEY_X},
+    {Key::Y, KEY_Y},
+    {Key::Z, KEY_Z},
+    {Key::Num0, KEY_0},
+    {Key::Num1, KEY_1},
+    {Key::Num2, KEY_2},
+    {Key::Num3, KEY_3},
+    {Key::Num4, KEY_4},
+    {Key::Num5, KEY_5},
+    {Key::Num6, KEY_6},
+    {Key::Num7, KEY_7},
+    {Key::Num8, KEY_8},
+    {Key::Num9, KEY_9},
+    {Key::Grave, KEY_GRAVE},
+    {Key::Minus, KEY_MINUS},
+    {Key::Equal, KEY_EQUAL},
+    {Key::LeftBracket, KEY_LEFTBRACE},
+    {Key::RightBracket, KEY_RIGHTBRACE},
+    {Key::Backslash, KEY_BACKSLASH},
+    {Key::Semicolon, KEY_SEMICOLON},
+    {Key::Apostrophe, KEY_APOSTROPHE},
+    {Key::Comma, KEY_COMMA},
+    {Key::Period, KEY_DOT},
+    {Key::Slash, KEY_SLASH},
+};
+
+constexpr int kEvdevToXKeycode = 8;
+
+// Modifiers that pick a shift level: Shift, Lock and Mod5 (AltGr, i.e.
+// ISO_Level3_Shift, in the usual XKB configurations)
+constexpr unsigned kLevelMods = ShiftMask | LockMask | Mod5Mask;
+
+Keymap::State packState(unsigned group, unsigned mods) {
+  return static_cast<Keymap::State>((group << 8U) | (mods & kLevelMods));
+}
+
+} // namespace
+
+struct Keymap::Impl {
+  Impl() {
+    int major = XkbMajorVersion;
+    int minor = XkbMinorVersion;
+    int errorBase = 0;
+    int reason = 0;
+    dpy = XkbOpenDisplay(nullptr, &xkbEventBase, &errorBase, &major, &minor,
+                         &reason);
+    if (dpy == nullptr) {
+      TYPR_LOG_WARN("backend::Keymap", "X11: XkbOpenDisplay() failed ({})",
+                    reason);
+      return;
+    }
+
+    XkbSelectEvents(dpy, XkbUseCoreKbd,
+                    XkbNewKeyboardNotifyMask | XkbMapNotifyMask,
+                    XkbNewKeyboardNotifyMask | XkbMapNotifyMask);
+    // Only group and modifier changes; pointer buttons etc. are not wanted
+    XkbSelectEventDetails(dpy, XkbUseCoreKbd, XkbStateNotify,
+                          XkbGroupStateMask | XkbModifierStateMask,
+                          XkbGroupStateMask | XkbModifierStateMask);
+    loadMap();
+
+    XkbStateRec current;
+    if (XkbGetState(dpy, XkbUseCoreKbd, &current) == Success) {
+      state = packState(current.group, current.mods);
+    }
+    XFlush(dpy);
+  }
+
+  ~Impl() {
+    if (xkb != nullptr) {
+      XkbFreeKeyboard(xkb, 0, True);
+    }
+    if (dpy != nullptr) {
+      XCloseDisplay(dpy);
+    }
+  }
+
+  Impl(const Impl &) = delete;
+  Impl &operator=(const Impl &) = delete;
+  Impl(Impl &&) = delete;
+  Impl &operator=(Impl &&) = delete;
+
+  void loadMap() {
+    if (xkb != nullptr) {
+      XkbFreeKeyboard(xkb, 0, True);
+    }
+    xkb = XkbGetMap(dpy, XkbAllClientInfoMask, XkbUseCoreKbd);
+    ++generation;
+  }
+
+  State poll() {
+    if (dpy == nullptr) {
+      return state;
+    }
+    // Reading the map is a round trip that can queue more events, so drain
+    // again after it; the descriptor only signals data not yet queued.
+    bool reload = false;
+    for (;;) {
+      drain(reload);
+      if (!reload) {
+        return state;
+      }
+      loadMap();
+      reload = false;
+    }
+  }
+
+  void drain(bool &reload) {
+    while (XPending(dpy) > 0) {
+      XEvent event;
+      XNextEvent(dpy, &event);
+      if (event.type != xkbEventBase) {
+        continue;
+      }
+      const auto *xkbEvent = reinterpret_cast<const XkbEvent *>(&event);
+      switch (xkbEvent->any.xkb_type) {
+      case XkbStateNotify:
+        state = packState(static_cast<unsigned>(xkbEvent->state.group),
+                          xkbEvent->state.mods);
+        break;
+      case XkbNewKeyboardNotify:
+      case XkbMapNotify:
+        // A layout switch can send several of these; read the map once
+        reload = true;
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  void captions(State forState, Captions &out) const {
+    for (auto &caption : out) {
+      caption.clear();
+    }
+    if (xkb == nullptr) {
+      return;
+    }
+
+    const unsigned group = forState >> 8U;
+    const unsigned mods = forState & kLevelMods;
+    const unsigned coreState = XkbBuildCoreState(mods, group);
+    for (const auto &[key, code] : kPrintableKeys) {
+      unsigned consumed = 0;
+      KeySym sym = NoSymbol;
+      const auto keycode = static_cast<KeyCode>(code + kEvdevToXKeycode);
+      if (!XkbTranslateKeyCode(xkb, keycode, coreState, &consumed, &sym) ||
+          sym == NoSymbol) {
+        continue;
+      }
+      // Converts through the locale, so non-Latin keysyms work too. Lock is
+      // applied here when the key type did not use it (e.g. Caps on digits).
+      char buffer[16];
+      int extra = 0;
+      const int length = XkbTranslateKeySym(dpy, &sym, mods & ~consumed, buffer,
+                                            sizeof(buffer), &extra);
+      // Dead keys and control characters get no caption from the keymap
+      if (length <= 0 || static_cast<unsigned char>(buffer[0]) < 0x20 ||
+          buffer[0] == 0x7f) {
+        continue;
+      }
+      out[static_cast<std::size_t>(key)].assign(
+          buffer, static_cast<std::size_t>(length));
+    }
+  }
+
+  Display *dpy{nullptr};
+  XkbDescPtr xkb{nullptr};
+  int xkbEventBase{0};
+  State state{0};
+  uint32_t generation{0};
+};
+
+Keymap::Keymap() : m_impl(std::make_unique<Impl>()) {}
+Keymap::~Keymap() = default;
+Keymap::Keymap(Keymap &&) noexcept = default;
+Keymap &Keymap::operator=(Keymap &&) noexcept = default;
+
+bool Keymap::isAvailable() const {
+  return m_impl && m_impl->dpy != nullptr && m_impl->xkb != nullptr;
+}
+
+int Keymap::notifierFd() const {
+  return m_impl && m_impl->dpy != nullptr ? ConnectionNumber(m_impl->dpy) : -1;
+}
+
+Keymap::State Keymap::poll() { return m_impl ? m_impl->poll() : 0; }
+
+uint32_t Keymap::generation() const {
+  return m_impl ? m_impl->generation : 0;
+}
+
+void Keymap::captions(State state, Captions &out) const {
+  if (m_impl) {
+    m_impl->captions(state, out);
+  } else {
+    for (auto &caption : out) {
+      caption.clear();
+    }
+  }
+}
+
+} // namespace backend
+
+#endif // __linux__
@@ -1,6 +1,8 @@
 #ifdef __APPLE__
 
 #include "backend.hpp"
+#include "core/log.hpp"
+#include "core/trace.hpp"
 
 #import <Foundation/Foundation.h>
 #include <ApplicationServices/ApplicationServices.h>
@@ -39,20 +41,6 @@ Modifier flagsToModifier(CGEventFlags flags) {
   return mods;
 }
 
-static bool output_debug_enabled() {
-  static int d = -1;
-  if (d != -1)
-    return d != 0;
-  const char *env = getenv("TYPR_OSK_DEBUG_BACKEND");
-  if (!env) {
-    // Default to enabled for the time being while testing
-    d = 1;
-  } else {
-    d = (env[0] != '0');
-  }
-  return d != 0;
-}
-
 } // namespace
 
 struct OutputListener::Impl {
@@ -119,6 +107,7 @@ struct OutputListener::Impl {
 private:
   // Thread main installs an event tap and runs a CFRunLoop to receive events.
   void threadMain() {
+    core::trace::setThreadName("output listener");
     // Create an event mask for key down + key up
     CGEventMask mask = CGEventMaskBit(kCGEventKeyDown) | CGEventMaskBit(kCGEventKeyUp);
 
@@ -130,9 +119,9 @@ private:
       // Failed to create event tap -> nothing we can do here
       running.store(false);
       ready.store(false);
-      if (output_debug_enabled()) {
-        fprintf(stderr, "[typr-backend] OutputListener (macOS): failed to create CGEventTap. Input Monitoring permission may be missing.\n");
-      }
+      TYPR_LOG_WARN("backend::OutputListener",
+                    "macOS: failed to create CGEventTap. Input Monitoring "
+                    "permission may be missing.");
       return;
     }
 
@@ -142,11 +131,10 @@ private:
     // Enable the tap
     CGEventTapEnable(eventTap, true);
 
-    // Signal successful initialization and optionally log
+    // Signal successful initialization
     ready.store(true);
-    if (output_debug_enabled()) {
-      fprintf(stderr, "[typr-backend] OutputListener (macOS): event tap created and enabled\n");
-    }
+    TYPR_LOG_INFO("backend::OutputListener",
+                  "macOS: event tap created and enabled");
 
     // Store the run loop so `stop` can stop it from another thread
     runLoop = CFRunLoopGetCurrent();
@@ -169,6 +157,7 @@ private:
 
   // Event tap callback (invoked on the run loop thread)
   static CGEventRef eventTapCallback(CGEventTapProxy proxy, CGEventType type, CGEventRef event, void *userInfo) {
+    TYPR_TRACE_SPAN("listener", "event tap");
     Impl *self = reinterpret_cast<Impl *>(userInfo);
     if (!self)
       return event;
@@ -231,13 +220,10 @@ private:
       cbCopy(static_cast<char32_t>(codepoint), mapped, mods, pressed);
     }
 
-    if (output_debug_enabled()) {
-      std::string kname = "Unknown";
-      auto kIt = self->cgKeyToKey.find(keyCode);
-      if (kIt != self->cgKeyToKey.end()) kname = keyToString(kIt->second);
-      fprintf(stderr, "[typr-backend] OutputListener (macOS) %s: keycode=%u key=%s cp=%u mods=%u\n",
-              pressed ? "press" : "release", (unsigned)keyCode, kname.c_str(), (unsigned)codepoint, (unsigned)mods);
-    }
+    // Recorded into the log ring; only formatted when dumped or echoed
+    TYPR_LOG_DEBUG("backend::OutputListener",
+                   "macOS pressed={} keycode={} key={} cp={} mods={}", pressed,
+                   (unsigned)keyCode, mapped, (uint32_t)codepoint, mods);
 
     // Let the event pass through unchanged
     return event;
@@ -18,6 +18,8 @@
 #ifdef _WIN32
 
 #include "backend.hpp"
+#include "core/log.hpp"
+#include "core/trace.hpp"
 
 #include <Windows.h>
 #include <atomic>
@@ -61,23 +63,6 @@ bool isExtendedKeyForVK(WORD vk) {
   }
 }
 
-// Debugging helper for OutputListener. Controlled by env var
-// TYPR_OSK_DEBUG_BACKEND (set to '0' to disable). Defaults to enabled for
-// testing as requested.
-static bool output_debug_enabled() {
-  static int d = -1;
-  if (d != -1)
-    return d != 0;
-  const char *env = getenv("TYPR_OSK_DEBUG_BACKEND");
-  if (!env) {
-    // Default to enabled for the time being while testing
-    d = 1;
-  } else {
-    d = (env[0] != '0');
-  }
-  return d != 0;
-}
-
 } // namespace
 
 // PImpl for OutputListener
@@ -288,6 +273,7 @@ private:
   // Entry point for hook events
   static LRESULT CALLBACK lowLevelKeyboardProc(int nCode, WPARAM wParam,
                                                LPARAM lParam) {
+    TYPR_TRACE_SPAN("listener", "keyboard hook");
     if (nCode < 0)
       return CallNextHookEx(nullptr, nCode, wParam, lParam);
     auto *kbd = reinterpret_cast<KBDLLHOOKSTRUCT *>(lParam);
@@ -359,17 +345,11 @@ private:
     Modifier mods = deriveModifiers();
     invokeCallback(codepoint, mappedKey, mods, pressed);
 
-    // Debug logging (enabled by default for testing; disable by setting
-    // TYPR_OSK_DEBUG_BACKEND=0 in the environment)
-    if (output_debug_enabled()) {
-      std::string keyName = keyToString(mappedKey);
-      fprintf(stderr,
-              "[typr-backend] OutputListener (Windows) %s: vk=%u key=%s cp=%u "
-              "mods=%u\n",
-              pressed ? "press" : "release", static_cast<unsigned>(vk),
-              keyName.c_str(), static_cast<unsigned>(codepoint),
-              static_cast<unsigned>(mods));
-    }
+    // Recorded into the log ring; only formatted when dumped or echoed
+    TYPR_LOG_DEBUG("backend::OutputListener",
+                   "Windows pressed={} vk={} key={} cp={} mods={}", pressed,
+                   static_cast<unsigned>(vk), mappedKey,
+                   static_cast<uint32_t>(codepoint), mods);
   }
 
   // Determine modifiers using GetKeyState
@@ -402,6 +382,7 @@ private:
 
   // Thread main: install hook and run message loop until WM_QUIT posted.
   void threadMain() {
+    core::trace::setThreadName("output listener");
     // Save thread id so stop() can post WM_QUIT
     threadId.store(GetCurrentThreadId());
     // Register instance for the hookproc
@@ -415,19 +396,15 @@ private:
       threadId.store(0);
       running.store(false);
       ready.store(false);
-      if (output_debug_enabled()) {
-        fprintf(stderr, "[typr-backend] OutputListener (Windows): "
-                        "SetWindowsHookEx failed\n");
-      }
+      TYPR_LOG_WARN("backend::OutputListener",
+                    "Windows: SetWindowsHookEx failed");
       return;
     }
 
     // Hook installed successfully
     ready.store(true);
-    if (output_debug_enabled()) {
-      fprintf(stderr, "[typr-backend] OutputListener (Windows): low-level "
-                      "keyboard hook installed\n");
-    }
+    TYPR_LOG_INFO("backend::OutputListener",
+                  "Windows: low-level keyboard hook installed");
 
     // Standard message loop (blocks on GetMessage; WM_QUIT ends it).
     MSG msg;
@@ -1,16 +1,18 @@
 #if defined(__linux__)
 
 #include "backend.hpp"
+#include "core/log.hpp"
+#include "core/trace.hpp"
 
 #include <X11/XKBlib.h>
 #include <X11/Xlib.h>
 #include <X11/extensions/XInput2.h>
 #include <X11/keysym.h>
 
+#include <algorithm>
 #include <atomic>
+#include <cctype>
 #include <chrono>
-#include <cstdio>
-#include <cstdlib>
 #include <cstring>
 #include <mutex>
 #include <thread>
@@ -19,22 +21,6 @@
 
 namespace backend {
 
-namespace {
-static bool output_debug_enabled() {
-  static int d = -1;
-  if (d != -1)
-    return d != 0;
-  const char *env = getenv("TYPR_OSK_DEBUG_BACKEND");
-  if (!env) {
-    // Default to enabled for the time being while testing
-    d = 1;
-  } else {
-    d = (env[0] != '0');
-  }
-  return d != 0;
-}
-} // namespace
-
 /**
  * OutputListener implementation for X11 using XInput2 raw events.
  *
@@ -101,14 +87,12 @@ struct OutputListener::Impl {
 private:
   // Main thread: open display, register XI2 raw key events and process them.
   void threadMain() {
+    core::trace::setThreadName("output listener");
     dpy = XOpenDisplay(nullptr);
     if (!dpy) {
       running.store(false);
       ready.store(false);
-      if (output_debug_enabled()) {
-        fprintf(stderr,
-                "[typr-backend] OutputListener (X11): XOpenDisplay() failed\n");
-      }
+      TYPR_LOG_WARN("backend::OutputListener", "X11: XOpenDisplay() failed");
       return;
     }
 
@@ -121,10 +105,8 @@ private:
       dpy = nullptr;
       running.store(false);
       ready.store(false);
-      if (output_debug_enabled()) {
-        fprintf(stderr, "[typr-backend] OutputListener (X11): XInput extension "
-                        "not available\n");
-      }
+      TYPR_LOG_WARN("backend::OutputListener",
+                    "X11: XInput extension not available");
       return;
     }
 
@@ -136,10 +118,8 @@ private:
       dpy = nullptr;
       running.store(false);
       ready.store(false);
-      if (output_debug_enabled()) {
-        fprintf(stderr, "[typr-backend] OutputListener (X11): XI2 not "
-                        "available (XIQueryVersion failed)\n");
-      }
+      TYPR_LOG_WARN("backend::OutputListener",
+                    "X11: XI2 not available (XIQueryVersion failed)");
       return;
     }
 
@@ -161,12 +141,10 @@ private:
     XISelectEvents(dpy, root, &evmask, 1);
     XFlush(dpy);
 
-    // Event selection succeeded; mark as ready and optionally log
+    // Event selection succeeded; mark as ready
     ready.store(true);
-    if (output_debug_enabled()) {
-      fprintf(stderr, "[typr-backend] OutputListener (X11): registered for "
-                      "XI_RawKey events\n");
-    }
+    TYPR_LOG_INFO("backend::OutputListener",
+                  "X11: registered for XI_RawKey events");
 
     // Polling event loop (keeps it simple and avoid blocking shutdown issues)
     while (running.load()) {
@@ -209,6 +187,7 @@ private:
 
   // Handle a Raw event (XI_RawKeyPress / XI_RawKeyRelease)
   void handleRawKeyEvent(XIEvent *xiev) {
+    TYPR_TRACE_SPAN("listener", "X11 raw key event");
     // XI_RawEvent is the actual underlying structure for raw key events.
     if (!xiev)
       return;
@@ -293,20 +272,14 @@ private:
       cbCopy = callback;
     }
     if (cbCopy) {
-      cbCopy(codepoint, mapped, mods, pressed);
+      cbCopy(codepoint, mappedKey, mods, pressed);
     }
 
-    // Debug logging (enabled by default for testing; disable with
-    // TYPR_OSK_DEBUG_BACKEND=0)
-    if (output_debug_enabled()) {
-      std::string keyName = keyToString(mapped);
-      fprintf(stderr,
-              "[typr-backend] OutputListener (X11) %s: keycode=%d key=%s "
-              "keysym=%lu cp=%u mods=%u\n",
-              pressed ? "press" : "release", keycode, keyName.c_str(),
-              static_cast<unsigned long>(ks), static_cast<unsigned>(codepoint),
-              static_cast<unsigned>(mods));
-    }
+    // Recorded into the log ring; only formatted when dumped or echoed
+    TYPR_LOG_DEBUG("backend::OutputListener",
+                   "X11 pressed={} keycode={} key={} keysym={} cp={} mods={}",
+                   pressed, keycode, mappedKey, static_cast<unsigned long>(ks),
+                   static_cast<uint32_t>(codepoint), mods);
   }
 
   // Build a reverse mapping from keycode -> Key by scanning available keycodes
@@ -0,0 +1,70 @@
+#include "backend/spare_keys.hpp"
+
+#include <algorithm>
+
+namespace backend {
+
+void SpareKeys::add(uint32_t keycode) {
+  spares_.push_back({.keycode = keycode});
+}
+
+bool SpareKeys::isSpare(uint32_t keycode) const {
+  return std::ranges::any_of(spares_, [keycode](const Spare &spare) {
+    return spare.keycode == keycode;
+  });
+}
+
+bool SpareKeys::use(Keysym sym, uint64_t roundStart) {
+  std::size_t index = 0;
+  if (const auto found = bound_.find(sym); found != bound_.end()) {
+    index = found->second;
+  } else {
+    index = spareToBind(roundStart);
+    if (index == spares_.size()) {
+      return false;
+    }
+    Spare &spare = spares_[index];
+    if (spare.sym != kNoSymbol) {
+      bound_.erase(spare.sym);
+    }
+    bound_[sym] = index;
+    binds_.push_back({.spare = index, .sym = sym, .previous = spare.sym});
+    spare.sym = sym;
+  }
+  spares_[index].lastUsed = ++useClock_;
+  return true;
+}
+
+std::size_t SpareKeys::spareToBind(uint64_t roundStart) const {
+  std::size_t best = spares_.size();
+  for (std::size_t index = 0; index < spares_.size(); ++index) {
+    if (spares_[index].lastUsed <= roundStart &&
+        (best == spares_.size() ||
+         spares_[index].lastUsed < spares_[best].lastUsed)) {
+      best = index;
+    }
+  }
+  return best;
+}
+
+void SpareKeys::dropBinds() {
+  for (const Binding &binding : binds_) {
+    bound_.erase(binding.sym);
+    spares_[binding.spare].sym = kNoSymbol;
+  }
+  binds_.clear();
+}
+
+std::vector<SpareKeys::Binding> SpareKeys::unbindAll() {
+  std::vector<Binding> binds;
+  for (std::size_t index = 0; index < spares_.size(); ++index) {
+    if (spares_[index].sym != kNoSymbol) {
+      binds.push_back({.spare = index, .previous = spares_[index].sym});
+      spares_[index].sym = kNoSymbol;
+    }
+  }
+  bound_.clear();
+  return binds;
+}
+
+} // namespace backend
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace backend {
+
+/**
+ * @brief Spare keycodes (ones the layout leaves empty) that the text
+ * backends bind characters outside the layout to.
+ *
+ * Bindings are kept and reused least recently used first, so a character that
+ * comes back costs a plain key tap. typeText() types a text in rounds: each
+ * binds every new character it can with one batch of mapping changes, then
+ * types its share of the text.
+ *
+ * Keysyms are X11 / xkbcommon keysyms, which share their values; 0 is
+ * NoSymbol in both.
+ */
+class SpareKeys {
+public:
+  using Keysym = uint32_t;
+
+  static constexpr Keysym kNoSymbol = 0;
+
+  // A spare (by index) to bind to `sym`, kNoSymbol to unbind it
+  struct Binding {
+    std::size_t spare{0};
+    Keysym sym{kNoSymbol};
+    Keysym previous{kNoSymbol}; // what it was bound to before
+  };
+
+  void add(uint32_t keycode);
+
+  [[nodiscard]] std::size_t size() const { return spares_.size(); }
+  [[nodiscard]] bool empty() const { return spares_.empty(); }
+  [[nodiscard]] uint32_t keycode(std::size_t spare) const {
+    return spares_[spare].keycode;
+  }
+  [[nodiscard]] Keysym sym(std::size_t spare) const {
+    return spares_[spare].sym;
+  }
+  [[nodiscard]] bool isSpare(uint32_t keycode) const;
+
+  /**
+   * @brief Type `text`. `Steps` provides:
+   * - `Keysym keysym(char32_t)`, kNoSymbol for characters without one
+   * - `bool hasStroke(Keysym)`: whether a key of the layout types it
+   * - `bool typeStroke(Keysym)`: type it with that key, false if there is
+   *   none
+   * - `bool bind(const std::vector<Binding> &)`: one batch of mapping changes,
+   *   with sym() already answering the new bindings; on false they are
+   *   dropped and their characters are not typed
+   * - `void typeSpare(uint32_t keycode)`: tap a bound spare
+   *
+   * @return False if a character could not be typed (no keysym, or no spare
+   * keycodes at all).
+   */
+  template <typename Steps>
+  bool typeText(const std::u32string &text, Steps &steps) {
+    bool ok = true;
+    std::size_t start = 0;
+    while (start < text.size()) {
+      const std::size_t end = planRound(text, start, steps);
+      if (!binds_.empty() && !steps.bind(binds_)) {
+        dropBinds();
+      }
+      for (std::size_t index = start; index < end; ++index) {
+        const Keysym sym = steps.keysym(text[index]);
+        if (steps.typeStroke(sym)) {
+          continue;
+        }
+        if (const auto spare = bound_.find(sym); spare != bound_.end()) {
+          steps.typeSpare(spares_[spare->second].keycode);
+        } else {
+          ok = false;
+        }
+      }
+      start = end;
+    }
+    return ok;
+  }
+
+  // Unbind every bound spare; the bindings to apply are returned
+  [[nodiscard]] std::vector<Binding> unbindAll();
+
+private:
+  struct Spare {
+    uint32_t keycode{0};
+    Keysym sym{kNoSymbol};
+    uint64_t lastUsed{0};
+  };
+
+  // Take characters from `start` until one needs a spare while every spare
+  // is taken by this round already; binds_ gets the new bindings. Returns
+  // where the round ends.
+  template <typename Steps>
+  std::size_t planRound(const std::u32string &text, std::size_t start,
+                        Steps &steps) {
+    const uint64_t roundStart = useClock_;
+    binds_.clear();
+    std::size_t end = start;
+    for (; end < text.size(); ++end) {
+      const Keysym sym = steps.keysym(text[end]);
+      if (sym == kNoSymbol || spares_.empty() || steps.hasStroke(sym)) {
+        continue;
+      }
+      if (!use(sym, roundStart)) {
+        break;
+      }
+    }
+    return end;
+  }
+
+  // Mark the spare bound to `sym` used, binding one if it has none. False if
+  // every spare is already used by the round that started at `roundStart`.
+  bool use(Keysym sym, uint64_t roundStart);
+  // Spare to bind a new character to: the least recently used one that this
+  // round has not used yet; size() if there is none
+  [[nodiscard]] std::size_t spareToBind(uint64_t roundStart) const;
+  void dropBinds();
+
+  std::vector<Spare> spares_;
+  std::unordered_map<Keysym, std::size_t> bound_; // into spares_
+  std::vector<Binding> binds_;                     // of the current round
+  uint64_t useClock_{0};
+};
+
+} // namespace backend
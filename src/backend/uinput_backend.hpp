@@ -0,0 +1,117 @@
+#pragma once
+
+#include "basic_backend.hpp"
+#include "evdev_keys.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <thread>
+#include <unistd.h>
+
+namespace backend {
+
+// Sink policy: input events into a virtual keyboard device on /dev/uinput,
+// or, given a path, into a plain file (benchmarks: /dev/null)
+class UinputSink {
+public:
+  UinputSink() {
+    fd_ = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+    if (fd_ < 0) {
+      return;
+    }
+    device_ = true;
+
+    // Enable key events
+    ioctl(fd_, UI_SET_EVBIT, EV_KEY);
+
+#ifdef KEY_MAX
+    // Enable all key codes we might use (if available)
+    for (int i = 0; i < KEY_MAX; ++i) {
+      ioctl(fd_, UI_SET_KEYBIT, i);
+    }
+#endif
+
+    // Create virtual device
+    struct uinput_setup usetup{};
+    std::memset(&usetup, 0, sizeof(usetup));
+    usetup.id.bustype = BUS_USB;
+    usetup.id.vendor = 0x1234;
+    usetup.id.product = 0x5678;
+    std::strncpy(usetup.name, "Virtual Keyboard", UINPUT_MAX_NAME_SIZE - 1);
+
+    ioctl(fd_, UI_DEV_SETUP, &usetup);
+    ioctl(fd_, UI_DEV_CREATE);
+
+    // Give udev time to create the device node
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  explicit UinputSink(const char *path) : fd_(open(path, O_WRONLY)) {}
+
+  ~UinputSink() {
+    if (fd_ < 0) {
+      return;
+    }
+    if (device_) {
+      ioctl(fd_, UI_DEV_DESTROY);
+    }
+    close(fd_);
+  }
+
+  UinputSink(const UinputSink &) = delete;
+  UinputSink &operator=(const UinputSink &) = delete;
+
+  [[nodiscard]] bool isOpen() const { return fd_ >= 0; }
+
+  // The key event and its report in one write
+  void key(int code, bool down) {
+    input_event events[2]{};
+    events[0].type = EV_KEY;
+    events[0].code = static_cast<unsigned short>(code);
+    events[0].value = down ? 1 : 0;
+    events[1].type = EV_SYN;
+    events[1].code = SYN_REPORT;
+    (void)write(fd_, events, sizeof(events));
+  }
+
+  void sync() {
+    if (fd_ < 0) {
+      return;
+    }
+    input_event event{};
+    event.type = EV_SYN;
+    event.code = SYN_REPORT;
+    (void)write(fd_, &event, sizeof(event));
+  }
+
+private:
+  int fd_{-1};
+  bool device_{false};
+};
+
+struct UinputPolicy {
+  using Sink = UinputSink;
+  using Keymap = EvdevKeymap;
+  using Timing = SleepTiming;
+
+  static constexpr BackendType kType = BackendType::LinuxUInput;
+  static constexpr Capabilities kCapabilities{
+      .canInjectKeys = true,
+      .canInjectText = false, // uinput is physical keys only
+      .canSimulateHID = true, // This is true HID simulation
+      .supportsKeyRepeat = true,
+      .needsAccessibilityPerm = false,
+      .needsInputMonitoringPerm = false,
+      .needsUinputAccess = true,
+  };
+};
+
+// Key events of a virtual input device: any session, HID level, needs write
+// access to /dev/uinput
+using UinputBackend = BasicInputBackend<UinputPolicy>;
+
+} // namespace backend
@@ -0,0 +1,298 @@
+#include "bulk_typer.hpp"
+
+#include "backend/backend.hpp"
+#include "core/log.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace core {
+
+namespace {
+
+// Characters that may be on their way back through the listener at once
+constexpr std::size_t kInFlight = 64;
+// With nothing coming back for this long, the rest in flight is given up on
+constexpr auto kStallTimeout = std::chrono::milliseconds(1000);
+// Rate without a listener to pace by
+constexpr double kOpenLoopRate = 100.0;
+
+std::chrono::nanoseconds intervalAt(double rate) {
+  return std::chrono::nanoseconds(static_cast<int64_t>(1e9 / rate));
+}
+
+} // namespace
+
+InjectionRate::InjectionRate() : InjectionRate(Config{}) {}
+
+InjectionRate::InjectionRate(const Config &config)
+    : config_(config),
+      rate_(std::clamp(config.initial, config.minimum, config.maximum)) {}
+
+void InjectionRate::onEcho(uint64_t sequence, std::chrono::microseconds latency,
+                           uint64_t sent) {
+  if (latency > config_.lagLimit) {
+    if (sequence >= recovered_) {
+      slowDown(sent);
+    }
+    return;
+  }
+  if (++inTime_ >= config_.window) {
+    inTime_ = 0;
+    rate_ = std::min(rate_ + config_.increase, config_.maximum);
+  }
+}
+
+void InjectionRate::onStall(uint64_t sent) { slowDown(sent); }
+
+std::chrono::nanoseconds InjectionRate::interval() const {
+  return intervalAt(rate_);
+}
+
+void InjectionRate::slowDown(uint64_t sent) {
+  rate_ = std::max(rate_ * config_.decrease, config_.minimum);
+  inTime_ = 0;
+  recovered_ = sent;
+  ++slowdowns_;
+}
+
+struct BulkTyper::Impl {
+  using Clock = std::chrono::steady_clock;
+
+  struct Job {
+    std::u32string text;
+    Finished finished;
+  };
+
+  explicit Impl(const InjectionRate::Config &rateConfig)
+      : config(rateConfig), worker(&Impl::threadMain, this) {}
+
+  ~Impl() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      ++generation;
+    }
+    wake.notify_all();
+    echo.notify_all();
+    worker.join();
+  }
+
+  bool type(std::u32string text, Finished finished) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (busy || pending) {
+        TYPR_LOG_WARN("bulk", "still typing, text of {} characters dropped",
+                      text.size());
+        return false;
+      }
+      pending = Job{.text = std::move(text), .finished = std::move(finished)};
+    }
+    wake.notify_all();
+    return true;
+  }
+
+  void cancel() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++generation;
+      pending.reset();
+    }
+    wake.notify_all();
+    echo.notify_all();
+  }
+
+  void waitUntilIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return !pending && !busy; });
+  }
+
+private:
+  void threadMain() {
+    trace::setThreadName("bulk typing");
+    backend = std::make_unique<backend::InputBackend>();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      wake.wait(lock, [this]() { return stopping || pending.has_value(); });
+      if (stopping) {
+        break;
+      }
+      Job job = std::move(*pending);
+      pending.reset();
+      busy = true;
+      const uint64_t started = generation;
+      lock.unlock();
+
+      const BulkTypingReport report = run(job.text, started);
+      if (job.finished) {
+        job.finished(report);
+      }
+
+      lock.lock();
+      busy = false;
+      idle.notify_all();
+    }
+    lock.unlock();
+    backend.reset();
+  }
+
+  BulkTypingReport run(const std::u32string &text, uint64_t started) {
+    TYPR_TRACE_SPAN("bulk", "BulkTyper::run");
+    BulkTypingReport report;
+    if (!backend->isReady() || !backend->capabilities().canInjectText) {
+      TYPR_LOG_WARN("bulk", "backend cannot inject text, {} characters lost",
+                    text.size());
+      return report;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      rate = InjectionRate(config);
+      sent = 0;
+      echoed = 0;
+      confirmed = 0;
+    }
+    report.verified = listener.startListening(
+        [this](char32_t, backend::Key key, backend::Modifier, bool pressed) {
+          onEcho(key, pressed);
+        });
+
+    const Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start;
+    for (const char32_t codepoint : text) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!waitForRoom(lock, started)) {
+          report.cancelled = true;
+          break;
+        }
+        // A late wake-up is made up by the next character, a stall is not
+        const auto interval =
+            report.verified ? rate.interval() : intervalAt(kOpenLoopRate);
+        deadline = std::max(deadline + interval, Clock::now() - interval);
+        if (wake.wait_until(lock, deadline,
+                            [&]() { return generation != started; })) {
+          report.cancelled = true;
+          break;
+        }
+        // Counted before it is injected: the echo may beat typeCharacter()
+        sentAt[sent % kInFlight] = Clock::now();
+        ++sent;
+      }
+      backend->typeCharacter(codepoint);
+      backend->flush();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (report.verified) {
+      // Give the last characters the chance to come back
+      echo.wait_for(lock, kStallTimeout, [&]() {
+        return echoed == sent || generation != started;
+      });
+    }
+    report.typed = static_cast<std::size_t>(sent);
+    report.confirmed = static_cast<std::size_t>(confirmed);
+    report.seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    report.charactersPerSecond =
+        report.seconds > 0.0 ? static_cast<double>(sent) / report.seconds
+                             : 0.0;
+    report.finalRate = report.verified ? rate.rate() : kOpenLoopRate;
+    report.slowdowns = rate.slowdowns();
+    lock.unlock();
+    listener.stopListening();
+
+    TYPR_LOG_INFO("bulk", "{} characters in {} s, {} per second, {} slowdowns",
+                  report.typed, report.seconds, report.charactersPerSecond,
+                  report.slowdowns);
+    return report;
+  }
+
+  // Wait while the ring of characters in flight is full. Returns false if
+  // typing was cancelled.
+  bool waitForRoom(std::unique_lock<std::mutex> &lock, uint64_t started) {
+    while (sent - echoed >= kInFlight) {
+      const bool moved = echo.wait_for(lock, kStallTimeout, [&]() {
+        return sent - echoed < kInFlight || generation != started;
+      });
+      if (generation != started) {
+        return false;
+      }
+      if (!moved) {
+        TYPR_LOG_WARN("bulk", "{} characters not seen by the listener",
+                      sent - echoed);
+        rate.onStall(sent);
+        echoed = sent;
+      }
+    }
+    return true;
+  }
+
+  // Listener thread
+  void onEcho(backend::Key key, bool pressed) {
+    if (!pressed || backend::isModifierKey(key)) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (echoed == sent) {
+        return; // not one of ours
+      }
+      const auto latency =
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              Clock::now() - sentAt[echoed % kInFlight]);
+      rate.onEcho(echoed, latency, sent);
+      ++echoed;
+      ++confirmed;
+    }
+    echo.notify_all();
+  }
+
+  const InjectionRate::Config config;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable echo;
+  std::condition_variable idle;
+  std::optional<Job> pending;
+  bool busy{false};
+  bool stopping{false};
+  // Bumped by cancel() and on destruction; a text stops once it changed
+  uint64_t generation{0};
+
+  // Shared with the listener thread, under `mutex`
+  InjectionRate rate;
+  uint64_t sent{0};
+  uint64_t echoed{0}; // or given up on
+  uint64_t confirmed{0};
+  std::array<Clock::time_point, kInFlight> sentAt{};
+
+  // Typing thread only
+  std::unique_ptr<backend::InputBackend> backend;
+  backend::OutputListener listener;
+
+  std::thread worker;
+};
+
+BulkTyper::BulkTyper() : BulkTyper(InjectionRate::Config{}) {}
+
+BulkTyper::BulkTyper(const InjectionRate::Config &config)
+    : m_impl(std::make_unique<Impl>(config)) {}
+
+BulkTyper::~BulkTyper() = default;
+
+bool BulkTyper::type(std::u32string text, Finished finished) {
+  return m_impl->type(std::move(text), std::move(finished));
+}
+
+void BulkTyper::cancel() { m_impl->cancel(); }
+
+void BulkTyper::waitUntilIdle() { m_impl->waitUntilIdle(); }
+
+} // namespace core
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace core {
+
+/**
+ * @brief Additive-increase / multiplicative-decrease control of an injection
+ * rate, in characters per second.
+ *
+ * The rate grows by a fixed step every time a window of characters has come
+ * back through the listener in time, and is cut by a factor as soon as one
+ * comes back late. A cut is taken once per episode: characters that were
+ * already injected at the old rate are expected to be late as well and do not
+ * cut it again.
+ */
+class InjectionRate {
+public:
+  struct Config {
+    double initial{1000.0}; // characters per second
+    double minimum{20.0};
+    double maximum{4000.0};
+    double increase{50.0}; // per window of characters seen in time
+    double decrease{0.5};  // factor applied when one is late
+    uint32_t window{32};
+    std::chrono::microseconds lagLimit{30000};
+  };
+
+  InjectionRate();
+  explicit InjectionRate(const Config &config);
+
+  /**
+   * @brief The character injected as number `sequence` (counting from 0)
+   * came back after `latency`; `sent` characters have been injected so far.
+   */
+  void onEcho(uint64_t sequence, std::chrono::microseconds latency,
+              uint64_t sent);
+  // Nothing came back for too long
+  void onStall(uint64_t sent);
+
+  [[nodiscard]] double rate() const { return rate_; }
+  [[nodiscard]] std::chrono::nanoseconds interval() const;
+  [[nodiscard]] uint32_t slowdowns() const { return slowdowns_; }
+
+private:
+  void slowDown(uint64_t sent);
+
+  Config config_;
+  double rate_;
+  uint32_t inTime_{0};
+  // Characters injected before the last cut do not cut again
+  uint64_t recovered_{0};
+  uint32_t slowdowns_{0};
+};
+
+struct BulkTypingReport {
+  std::size_t typed{0};     // characters injected
+  std::size_t confirmed{0}; // of those, seen by the listener
+  double seconds{0.0};
+  double charactersPerSecond{0.0};
+  double finalRate{0.0}; // where the controller ended up
+  uint32_t slowdowns{0};
+  bool verified{false}; // paced by the listener rather than a fixed rate
+  bool cancelled{false};
+};
+
+/**
+ * @brief Types long texts as fast as the system keeps up with.
+ *
+ * Every character is injected on a thread of its own and watched for as it
+ * comes back through an OutputListener. The delay between characters is set
+ * by an InjectionRate: it starts short, shrinks while characters come back
+ * promptly and doubles when the input pipeline falls behind, instead of
+ * using one fixed key delay that is either too slow or overruns slow
+ * applications. At most a ring of characters is in flight; when none of them
+ * comes back for a while, typing slows down and carries on.
+ *
+ * Without a listener (or on Wayland) the text goes out at a fixed,
+ * conservative rate. Keys typed by the user during a bulk text count as
+ * echoes and may hide some lag.
+ */
+class BulkTyper {
+public:
+  // Called on the typing thread when a text is done
+  using Finished = std::function<void(const BulkTypingReport &)>;
+
+  BulkTyper();
+  explicit BulkTyper(const InjectionRate::Config &config);
+  ~BulkTyper();
+
+  BulkTyper(const BulkTyper &) = delete;
+  BulkTyper &operator=(const BulkTyper &) = delete;
+  BulkTyper(BulkTyper &&) = delete;
+  BulkTyper &operator=(BulkTyper &&) = delete;
+
+  // Start typing `text`. Returns false if another text is still going out.
+  bool type(std::u32string text, Finished finished = {});
+  // Stop the text being typed
+  void cancel();
+  // Block until the current text is done
+  void waitUntilIdle();
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace core
@@ -0,0 +1,111 @@
+#include "control_protocol.hpp"
+
+#include <array>
+
+namespace core {
+
+namespace {
+
+void putU32(uint8_t *out, uint32_t value) {
+  out[0] = static_cast<uint8_t>(value);
+  out[1] = static_cast<uint8_t>(value >> 8);
+  out[2] = static_cast<uint8_t>(value >> 16);
+  out[3] = static_cast<uint8_t>(value >> 24);
+}
+
+// keyName() is a linear scan; a batch may carry thousands of keys
+bool isKnownKey(uint8_t value) {
+  static const std::array<bool, 256> known = []() {
+    std::array<bool, 256> table{};
+    for (std::size_t i = 1; i < table.size(); ++i) {
+      table[i] = backend::keyName(static_cast<backend::Key>(i)) != "Unknown";
+    }
+    return table;
+  }();
+  return known[value];
+}
+
+} // namespace
+
+bool parseControlBatch(std::span<const uint8_t> payload, ControlBatch &batch) {
+  batch.commands.clear();
+  batch.text.clear();
+
+  std::size_t pos = 0;
+  const auto remaining = [&]() { return payload.size() - pos; };
+  while (pos < payload.size()) {
+    ControlCommand command;
+    command.op = static_cast<ControlOp>(payload[pos++]);
+    switch (command.op) {
+    case ControlOp::Show:
+    case ControlOp::Hide:
+    case ControlOp::Toggle:
+      break;
+    case ControlOp::Layer:
+      if (remaining() < 1) {
+        return false;
+      }
+      command.layer = payload[pos++];
+      break;
+    case ControlOp::KeyDown:
+    case ControlOp::KeyUp:
+    case ControlOp::Tap:
+      if (remaining() < 1 || !isKnownKey(payload[pos])) {
+        return false;
+      }
+      command.key = static_cast<backend::Key>(payload[pos++]);
+      break;
+    case ControlOp::Combo:
+      if (remaining() < 2 || !isKnownKey(payload[pos + 1])) {
+        return false;
+      }
+      command.mods = static_cast<backend::Modifier>(payload[pos]);
+      command.key = static_cast<backend::Key>(payload[pos + 1]);
+      pos += 2;
+      break;
+    case ControlOp::DumpLog:
+      if (remaining() < 2) {
+        return false;
+      }
+      command.seconds =
+          static_cast<uint16_t>(payload[pos] | (payload[pos + 1] << 8));
+      pos += 2;
+      break;
+    case ControlOp::Text:
+    case ControlOp::BulkText: {
+      const std::size_t width = command.op == ControlOp::Text ? 2 : 4;
+      if (remaining() < width) {
+        return false;
+      }
+      std::size_t length = 0;
+      for (std::size_t byte = 0; byte < width; ++byte) {
+        length |= static_cast<std::size_t>(payload[pos + byte]) << (8 * byte);
+      }
+      pos += width;
+      if (remaining() < length) {
+        return false;
+      }
+      command.textOffset = static_cast<uint32_t>(batch.text.size());
+      command.textLength = static_cast<uint32_t>(length);
+      batch.text.append(reinterpret_cast<const char *>(&payload[pos]), length);
+      pos += length;
+      break;
+    }
+    default:
+      return false;
+    }
+    batch.commands.push_back(command);
+  }
+  return true;
+}
+
+std::array<uint8_t, kControlReplySize> encodeControlReply(ControlStatus status,
+                                                          uint32_t succeeded) {
+  std::array<uint8_t, kControlReplySize> reply{};
+  putU32(reply.data(), kControlReplySize - 4);
+  reply[4] = static_cast<uint8_t>(status);
+  putU32(reply.data() + 5, succeeded);
+  return reply;
+}
+
+} // namespace core
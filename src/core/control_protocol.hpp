@@ -0,0 +1,107 @@
+#pragma once
+
+#include "backend/backend.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace core {
+
+/**
+ * Wire format of the control socket.
+ *
+ * Every message, in both directions, is a little-endian u32 payload length
+ * followed by the payload. A request payload is a batch: any number of
+ * commands back to back, each an opcode byte followed by its operands.
+ *
+ *   0x01 show
+ *   0x02 hide
+ *   0x03 toggle
+ *   0x04 layer   u8 layer        latch a layer (0 = base layer)
+ *   0x10 down    u8 key          backend::Key value
+ *   0x11 up      u8 key
+ *   0x12 tap     u8 key
+ *   0x13 combo   u8 mods, u8 key backend::Modifier bits
+ *   0x20 text    u16 length, UTF-8 bytes
+ *                typed, or pasted when long (see TextInserter)
+ *   0x21 bulk    u32 length, UTF-8 bytes
+ *                type in the background, as fast as the system keeps up
+ *                (see BulkTyper); succeeds once queued
+ *   0x30 log     u16 seconds     dump the last seconds of the log ring
+ *                (0 = all of it) to TYPR_OSK_LOG_FILE, else stderr
+ *
+ * A batch is executed in order in one go on the GUI thread. Every request
+ * gets one reply, in request order: u8 status (ControlStatus) and u32 number
+ * of commands that succeeded. A malformed batch is rejected whole and
+ * nothing in it runs.
+ *
+ * Example: tap Shift+H, then type "ello" = 0a 00 00 00 | 13 01 08 | 20 04 00
+ * 'e' 'l' 'l' 'o'.
+ */
+
+enum class ControlOp : uint8_t {
+  Show = 0x01,
+  Hide = 0x02,
+  Toggle = 0x03,
+  Layer = 0x04,
+  KeyDown = 0x10,
+  KeyUp = 0x11,
+  Tap = 0x12,
+  Combo = 0x13,
+  Text = 0x20,
+  BulkText = 0x21,
+  DumpLog = 0x30,
+};
+
+enum class ControlStatus : uint8_t {
+  Ok = 0,
+  Malformed = 1,  // nothing was executed
+  SomeFailed = 2, // e.g. the backend cannot inject text
+};
+
+// Largest accepted request payload; bigger requests close the connection
+static constexpr std::size_t kMaxControlPayload = 1U << 20;
+static constexpr std::size_t kControlReplySize = 4 + 1 + 4;
+
+struct ControlCommand {
+  ControlOp op{ControlOp::Show};
+  backend::Key key{backend::Key::Unknown};
+  backend::Modifier mods{backend::Modifier::None};
+  uint8_t layer{0};
+  uint16_t seconds{0}; // DumpLog
+  // Text commands: a range of ControlBatch::text
+  uint32_t textOffset{0};
+  uint32_t textLength{0};
+};
+
+/**
+ * @brief A parsed request. The text of all text commands shares one buffer,
+ * so a batch costs two allocations however many commands it carries.
+ */
+struct ControlBatch {
+  std::vector<ControlCommand> commands;
+  std::string text;
+
+  [[nodiscard]] std::string_view textOf(const ControlCommand &command) const {
+    return std::string_view(text).substr(command.textOffset,
+                                         command.textLength);
+  }
+};
+
+/**
+ * @brief Parse one request payload (without its length prefix).
+ * @return false if the payload is malformed (unknown opcode, truncated
+ * operands, key out of range); `batch` is then unspecified.
+ */
+bool parseControlBatch(std::span<const uint8_t> payload, ControlBatch &batch);
+
+// Encode a reply message, length prefix included
+std::array<uint8_t, kControlReplySize> encodeControlReply(ControlStatus status,
+                                                          uint32_t succeeded);
+
+} // namespace core
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "core/control_protocol.hpp"
+
+#include <QObject>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace core {
+
+/**
+ * @brief Lets other local programs drive the keyboard (switch devices,
+ * scripts, assistive tools) through a Unix-domain socket.
+ *
+ * Requests use the batched binary protocol of control_protocol.hpp. All
+ * connections are served by one I/O thread (epoll on Linux) that reads and
+ * parses requests, so the GUI thread only sees whole batches: each one is
+ * posted to it as a single queued call and run by the handler, and its reply
+ * goes back through the I/O thread. Clients may pipeline requests without
+ * waiting for replies; a client with too many batches in flight is not read
+ * from until the GUI thread catches up.
+ *
+ * Only Linux has an implementation for now; elsewhere listen() fails.
+ */
+class ControlServer : public QObject {
+public:
+  // Runs a parsed batch on the GUI thread; returns how many of its commands
+  // succeeded
+  using Handler = std::function<uint32_t(const ControlBatch &batch)>;
+
+  explicit ControlServer(Handler handler, QObject *parent = nullptr);
+  ~ControlServer() override;
+
+  ControlServer(const ControlServer &) = delete;
+  ControlServer &operator=(const ControlServer &) = delete;
+  ControlServer(ControlServer &&) = delete;
+  ControlServer &operator=(ControlServer &&) = delete;
+
+  /**
+   * @brief Create the socket at `path` and start serving.
+   *
+   * A stale socket left by a crashed instance is replaced; a live one (another
+   * instance is running) makes this fail. The socket is only accessible to
+   * the current user and is removed again on destruction.
+   */
+  bool listen(const std::string &path);
+  [[nodiscard]] bool isListening() const;
+
+  // $XDG_RUNTIME_DIR/typr-osk.sock, or empty if there is no runtime directory
+  [[nodiscard]] static std::string defaultPath();
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace core
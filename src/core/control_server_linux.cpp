@@ -0,0 +1,464 @@
+#if defined(__linux__)
+
+#include "control_server.hpp"
+
+#include "core/log.hpp"
+#include "core/trace.hpp"
+
+#include <QDebug>
+#include <QMetaObject>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace core {
+
+namespace {
+
+// epoll user data of the two non-client descriptors; clients count up from
+// kFirstClientId so a reply never reaches a later client reusing the fd
+constexpr uint64_t kListenId = 0;
+constexpr uint64_t kWakeId = 1;
+constexpr uint64_t kFirstClientId = 2;
+
+// Batches posted to the GUI thread but not answered yet, per client
+constexpr int kMaxInFlight = 64;
+constexpr std::size_t kReadChunk = 64 * 1024;
+
+using Reply = std::array<uint8_t, kControlReplySize>;
+
+uint32_t readU32(const uint8_t *in) {
+  return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+         (static_cast<uint32_t>(in[2]) << 16) |
+         (static_cast<uint32_t>(in[3]) << 24);
+}
+
+} // namespace
+
+struct ControlServer::Impl {
+  struct Client {
+    int fd{-1};
+    std::vector<uint8_t> in;
+    std::vector<uint8_t> out;
+    std::size_t outPos{0};
+    int inFlight{0};
+    bool eof{false};
+    bool hangup{false};
+    uint32_t interest{0};
+  };
+
+  Impl(ControlServer *owner, Handler handler)
+      : owner(owner), handler(std::move(handler)) {}
+
+  ~Impl() { stop(); }
+
+  bool start(const std::string &socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+      TYPR_LOG_WARN("control", "socket path is empty or too long");
+      return false;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+      return fail(socketPath, "socket()");
+    }
+    const auto *addr = reinterpret_cast<const sockaddr *>(&address);
+    if (bind(listenFd, addr, sizeof(address)) != 0) {
+      if (errno != EADDRINUSE) {
+        return fail(socketPath, "bind()");
+      }
+      // Left behind by a crashed instance unless somebody still answers
+      const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      const bool live =
+          probe >= 0 && connect(probe, addr, sizeof(address)) == 0;
+      if (probe >= 0) {
+        close(probe);
+      }
+      if (live) {
+        qWarning() << "[control] Another instance is serving"
+                   << socketPath.c_str();
+        closeAll();
+        return false;
+      }
+      // Only ever remove a socket: the path may name anything
+      struct stat status{};
+      if (lstat(socketPath.c_str(), &status) != 0 ||
+          !S_ISSOCK(status.st_mode)) {
+        qWarning() << "[control]" << socketPath.c_str()
+                   << "exists and is not a socket, not replacing it";
+        closeAll();
+        return false;
+      }
+      unlink(socketPath.c_str());
+      if (bind(listenFd, addr, sizeof(address)) != 0) {
+        return fail(socketPath, "bind()");
+      }
+    }
+    path = socketPath;
+    // Anything that can connect can type; the runtime directory is private
+    // already, this covers other locations
+    chmod(path.c_str(), S_IRUSR | S_IWUSR);
+    if (::listen(listenFd, SOMAXCONN) != 0) {
+      return fail(socketPath, "listen()");
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0 || !watch(listenFd, kListenId, EPOLLIN) ||
+        !watch(wakeFd, kWakeId, EPOLLIN)) {
+      return fail(socketPath, "epoll");
+    }
+
+    worker = std::thread(&Impl::threadMain, this);
+    qDebug() << "[control] Listening on" << path.c_str();
+    return true;
+  }
+
+  void stop() {
+    if (worker.joinable()) {
+      stopping.store(true);
+      wake();
+      worker.join();
+    }
+    closeAll();
+  }
+
+  [[nodiscard]] bool isRunning() const { return worker.joinable(); }
+
+  // GUI thread: run a batch (or refuse a malformed one) and queue its reply
+  void execute(uint64_t client, const ControlBatch &batch, bool valid) {
+    ControlStatus status = ControlStatus::Malformed;
+    uint32_t succeeded = 0;
+    if (valid) {
+      TYPR_TRACE_SPAN("control", "ControlServer::execute");
+      succeeded = handler ? handler(batch) : 0;
+      status = succeeded == batch.commands.size() ? ControlStatus::Ok
+                                                  : ControlStatus::SomeFailed;
+    }
+    {
+      std::lock_guard<std::mutex> lock(repliesMutex);
+      replies.emplace_back(client, encodeControlReply(status, succeeded));
+    }
+    wake();
+  }
+
+private:
+  bool fail(const std::string &socketPath, const char *what) {
+    qWarning() << "[control]" << what << "failed for" << socketPath.c_str()
+               << std::strerror(errno);
+    closeAll();
+    return false;
+  }
+
+  void closeAll() {
+    for (auto &[id, client] : clients) {
+      close(client.fd);
+    }
+    clients.clear();
+    for (int *fd : {&listenFd, &epollFd, &wakeFd}) {
+      if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+      }
+    }
+    if (!path.empty()) {
+      unlink(path.c_str());
+      path.clear();
+    }
+  }
+
+  bool watch(int fd, uint64_t id, uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = id;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+  }
+
+  void wake() {
+    const uint64_t one = 1;
+    [[maybe_unused]] const auto written = write(wakeFd, &one, sizeof(one));
+  }
+
+  void threadMain() {
+    trace::setThreadName("control");
+    std::array<epoll_event, 32> events{};
+    while (!stopping.load()) {
+      const int count =
+          epoll_wait(epollFd, events.data(), static_cast<int>(events.size()),
+                     -1);
+      if (count < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        TYPR_LOG_WARN("control", "epoll_wait failed, errno {}", errno);
+        return;
+      }
+      for (int index = 0; index < count; ++index) {
+        const uint64_t id = events[index].data.u64;
+        if (id == kListenId) {
+          acceptClients();
+        } else if (id == kWakeId) {
+          uint64_t value = 0;
+          [[maybe_unused]] const auto got = read(wakeFd, &value, sizeof(value));
+          deliverReplies();
+        } else {
+          serve(id, events[index].events);
+        }
+      }
+    }
+  }
+
+  void acceptClients() {
+    for (;;) {
+      const int fd = accept4(listenFd, nullptr, nullptr,
+                             SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0) {
+        return;
+      }
+      const uint64_t id = nextClientId++;
+      Client &client = clients[id];
+      client.fd = fd;
+      client.interest = EPOLLIN;
+      if (!watch(fd, id, EPOLLIN)) {
+        drop(id);
+        continue;
+      }
+      TYPR_LOG_DEBUG("control", "client {} connected", id);
+    }
+  }
+
+  void serve(uint64_t id, uint32_t events) {
+    auto found = clients.find(id);
+    if (found == clients.end()) {
+      return;
+    }
+    Client &client = found->second;
+    if ((events & EPOLLERR) != 0 ||
+        ((events & EPOLLOUT) != 0 && !flush(client)) ||
+        ((events & (EPOLLIN | EPOLLHUP)) != 0 && !receive(id, client))) {
+      drop(id);
+      return;
+    }
+    if ((events & EPOLLHUP) != 0) {
+      // Closed on the other end. Requests it sent still run, but nobody reads
+      // replies; stop polling (a hangup is reported on every wait) and read
+      // the rest as batches complete.
+      client.hangup = true;
+      client.out.clear();
+      client.outPos = 0;
+      epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+    }
+    settle(id, client);
+  }
+
+  // Read what is available and post every complete request
+  bool receive(uint64_t id, Client &client) {
+    while (!client.eof && client.inFlight < kMaxInFlight) {
+      const ssize_t got = read(client.fd, readBuffer.data(), readBuffer.size());
+      if (got == 0) {
+        // Half-closed: still answer what was sent
+        client.eof = true;
+      } else if (got < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          break;
+        }
+        if (errno != EINTR) {
+          return false;
+        }
+      } else {
+        client.in.insert(client.in.end(), readBuffer.begin(),
+                         readBuffer.begin() + got);
+        if (!dispatch(id, client)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool dispatch(uint64_t id, Client &client) {
+    std::size_t pos = 0;
+    while (client.in.size() - pos >= 4) {
+      const uint32_t length = readU32(client.in.data() + pos);
+      if (length > kMaxControlPayload) {
+        TYPR_LOG_WARN("control", "client {} sent {} bytes, dropping it", id,
+                      length);
+        return false;
+      }
+      if (client.in.size() - pos - 4 < length) {
+        break;
+      }
+      ControlBatch batch;
+      const bool valid = parseControlBatch(
+          std::span<const uint8_t>(client.in.data() + pos + 4, length), batch);
+      pos += 4 + length;
+      ++client.inFlight;
+      // Even malformed batches take the trip so replies stay in order
+      QMetaObject::invokeMethod(
+          owner,
+          [this, id, valid, batch = std::move(batch)]() {
+            execute(id, batch, valid);
+          },
+          Qt::QueuedConnection);
+    }
+    client.in.erase(client.in.begin(),
+                    client.in.begin() + static_cast<std::ptrdiff_t>(pos));
+    return true;
+  }
+
+  void deliverReplies() {
+    {
+      std::lock_guard<std::mutex> lock(repliesMutex);
+      std::swap(replies, delivering);
+    }
+    for (const auto &[id, reply] : delivering) {
+      auto found = clients.find(id);
+      if (found == clients.end()) {
+        continue; // disconnected before its batch ran
+      }
+      Client &client = found->second;
+      --client.inFlight;
+      if (!client.hangup) {
+        client.out.insert(client.out.end(), reply.begin(), reply.end());
+      }
+    }
+    for (const auto &[id, reply] : delivering) {
+      auto found = clients.find(id);
+      if (found == clients.end()) {
+        continue;
+      }
+      Client &client = found->second;
+      // Reading may have been paused on kMaxInFlight, with complete requests
+      // already buffered
+      if (!flush(client) || !dispatch(id, client) ||
+          (client.hangup && !receive(id, client))) {
+        drop(id);
+        continue;
+      }
+      settle(id, client);
+    }
+    delivering.clear();
+  }
+
+  bool flush(Client &client) {
+    while (client.outPos < client.out.size()) {
+      const ssize_t sent =
+          send(client.fd, client.out.data() + client.outPos,
+               client.out.size() - client.outPos, MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+      }
+      client.outPos += static_cast<std::size_t>(sent);
+    }
+    client.out.clear();
+    client.outPos = 0;
+    return true;
+  }
+
+  // Update what the client is polled for, or close it once it is done
+  void settle(uint64_t id, Client &client) {
+    const bool pendingOut = client.outPos < client.out.size();
+    if (client.eof && client.inFlight == 0 && !pendingOut) {
+      drop(id);
+      return;
+    }
+    if (client.hangup) {
+      return;
+    }
+    uint32_t interest = 0;
+    if (!client.eof && client.inFlight < kMaxInFlight) {
+      interest |= EPOLLIN;
+    }
+    if (pendingOut) {
+      interest |= EPOLLOUT;
+    }
+    if (interest != client.interest) {
+      client.interest = interest;
+      epoll_event event{};
+      event.events = interest;
+      event.data.u64 = id;
+      epoll_ctl(epollFd, EPOLL_CTL_MOD, client.fd, &event);
+    }
+  }
+
+  void drop(uint64_t id) {
+    auto found = clients.find(id);
+    if (found == clients.end()) {
+      return;
+    }
+    if (!found->second.hangup) {
+      epoll_ctl(epollFd, EPOLL_CTL_DEL, found->second.fd, nullptr);
+    }
+    close(found->second.fd);
+    clients.erase(found);
+    TYPR_LOG_DEBUG("control", "client {} disconnected", id);
+  }
+
+  ControlServer *owner;
+  Handler handler;
+  std::string path;
+  int listenFd{-1};
+  int epollFd{-1};
+  int wakeFd{-1};
+  std::thread worker;
+  std::atomic_bool stopping{false};
+
+  // I/O thread only
+  std::unordered_map<uint64_t, Client> clients;
+  uint64_t nextClientId{kFirstClientId};
+  std::vector<std::pair<uint64_t, Reply>> delivering;
+  std::array<uint8_t, kReadChunk> readBuffer{};
+
+  std::mutex repliesMutex;
+  std::vector<std::pair<uint64_t, Reply>> replies;
+};
+
+ControlServer::ControlServer(Handler handler, QObject *parent)
+    : QObject(parent),
+      m_impl(std::make_unique<Impl>(this, std::move(handler))) {}
+
+// Batches still queued for the GUI thread are discarded with this QObject
+ControlServer::~ControlServer() = default;
+
+bool ControlServer::listen(const std::string &path) {
+  if (m_impl->isRunning()) {
+    return false;
+  }
+  return m_impl->start(path);
+}
+
+bool ControlServer::isListening() const { return m_impl->isRunning(); }
+
+std::string ControlServer::defaultPath() {
+  const char *runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+  if (runtimeDir == nullptr || *runtimeDir == '\0') {
+    return {};
+  }
+  return std::string(runtimeDir) + "/typr-osk.sock";
+}
+
+} // namespace core
+
+#endif // __linux__
@@ -0,0 +1,34 @@
+#if !defined(__linux__)
+
+#include "control_server.hpp"
+
+#include "core/log.hpp"
+
+namespace core {
+
+// Control server without a platform implementation: listen() always fails and
+// the keyboard can only be driven through its windows.
+
+struct ControlServer::Impl {
+  Handler handler;
+};
+
+ControlServer::ControlServer(Handler handler, QObject *parent)
+    : QObject(parent), m_impl(std::make_unique<Impl>()) {
+  m_impl->handler = std::move(handler);
+}
+
+ControlServer::~ControlServer() = default;
+
+bool ControlServer::listen(const std::string & /*path*/) {
+  TYPR_LOG_WARN("control", "no control socket on this platform");
+  return false;
+}
+
+bool ControlServer::isListening() const { return false; }
+
+std::string ControlServer::defaultPath() { return {}; }
+
+} // namespace core
+
+#endif // !__linux__
@@ -0,0 +1,153 @@
+#include "geometry.hpp"
+
+#include "core/layout.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+
+namespace layout {
+
+Geometry::Geometry(const std::vector<Element> &elements, int layer,
+                   Metrics metrics)
+    : metrics_(metrics) {
+  order_.reserve(elements.size());
+  for (std::size_t index = 0; index < elements.size(); ++index) {
+    if (elements[index].layer() == layer) {
+      order_.push_back(index);
+    }
+  }
+
+  // Builders emit elements row by row already; only sort when they are not.
+  const auto before = [&elements](std::size_t lhs, std::size_t rhs) {
+    const Element &left = elements[lhs];
+    const Element &right = elements[rhs];
+    return left.row() != right.row() ? left.row() < right.row()
+                                     : left.column() < right.column();
+  };
+  if (!std::ranges::is_sorted(order_, before)) {
+    std::ranges::stable_sort(order_, before);
+  }
+
+  widthUnits_.reserve(order_.size());
+  float widestRow = 0.0F;
+  for (std::size_t first = 0; first < order_.size();) {
+    const int row = elements[order_[first]].row();
+    Row span{.first = first, .last = first, .heightUnits = 0.0F,
+             .widthUnits = 0.0F};
+    for (; span.last < order_.size() &&
+           elements[order_[span.last]].row() == row;
+         ++span.last) {
+      const Element &element = elements[order_[span.last]];
+      widthUnits_.push_back(element.widthAsUnit());
+      span.widthUnits += element.widthAsUnit();
+      span.heightUnits = std::max(span.heightUnits, element.heightAsUnit());
+    }
+    if (span.heightUnits <= 0.0F) {
+      span.heightUnits = 1.0F;
+    }
+
+    const auto gaps = static_cast<float>(span.last - span.first - 1);
+    widestRow = std::max(widestRow, (span.widthUnits * metrics_.baseUnit) +
+                                        (gaps * metrics_.spacing));
+    totalHeightUnits_ += span.heightUnits;
+    rows_.push_back(span);
+    first = span.last;
+  }
+
+  const int rowGaps =
+      rows_.empty() ? 0 : static_cast<int>(rows_.size() - 1) * metrics_.spacing;
+  minimumSize_ =
+      QSize(static_cast<int>(widestRow) + (2 * metrics_.margin),
+            static_cast<int>(totalHeightUnits_ * metrics_.baseUnit) + rowGaps +
+                (2 * metrics_.margin));
+}
+
+const std::vector<QRect> &Geometry::solve(QSize size) {
+  ++useCounter_;
+
+  // The cache is tiny, so a linear scan (and LRU eviction) is cheapest
+  std::size_t victim = 0;
+  for (std::size_t index = 0; index < cache_.size(); ++index) {
+    CacheEntry &entry = cache_[index];
+    if (entry.lastUse != 0 && entry.size == size) {
+      entry.lastUse = useCounter_;
+      current_ = index;
+      return entry.rects;
+    }
+    if (entry.lastUse < cache_[victim].lastUse) {
+      victim = index;
+    }
+  }
+
+  TYPR_TRACE_SPAN("layout", "Geometry::solve (miss)");
+  CacheEntry &entry = cache_[victim];
+  entry.size = size;
+  entry.lastUse = useCounter_;
+  solveInto(size, entry.rects);
+  current_ = victim;
+  return entry.rects;
+}
+
+void Geometry::solveInto(QSize size, std::vector<QRect> &rects) const {
+  rects.resize(order_.size());
+  if (rows_.empty()) {
+    return;
+  }
+
+  const QRect area = QRect(QPoint(0, 0), size)
+                         .adjusted(metrics_.margin, metrics_.margin,
+                                   -metrics_.margin, -metrics_.margin);
+  const float freeHeight = static_cast<float>(
+      area.height() - (metrics_.spacing * static_cast<int>(rows_.size() - 1)));
+  const auto spacing = static_cast<float>(metrics_.spacing);
+
+  float y = static_cast<float>(area.top());
+  for (const Row &row : rows_) {
+    const float rowHeight = freeHeight * row.heightUnits / totalHeightUnits_;
+    const float freeWidth =
+        static_cast<float>(area.width()) -
+        (spacing * static_cast<float>(row.last - row.first - 1));
+    const float pixelsPerUnit =
+        row.widthUnits > 0.0F ? freeWidth / row.widthUnits : 0.0F;
+
+    const int top = qRound(y);
+    const int bottom = qRound(y + rowHeight) - 1;
+    float x = static_cast<float>(area.left());
+    for (std::size_t index = row.first; index < row.last; ++index) {
+      const float width = widthUnits_[index] * pixelsPerUnit;
+      // Round both edges so neighbouring keys never overlap or leave gaps
+      rects[index] =
+          QRect(QPoint(qRound(x), top), QPoint(qRound(x + width) - 1, bottom));
+      x += width + spacing;
+    }
+    y += rowHeight + spacing;
+  }
+}
+
+std::size_t Geometry::hitTest(QPoint point) const {
+  if (current_ >= cache_.size() || rows_.empty()) {
+    return kNoKey;
+  }
+  const std::vector<QRect> &rects = cache_[current_].rects;
+
+  // Rows and the keys inside a row are sorted, so both lookups are binary
+  // searches on the far edge.
+  const auto row = std::ranges::lower_bound(
+      rows_, point.y(), {},
+      [&rects](const Row &span) { return rects[span.first].bottom(); });
+  if (row == rows_.end()) {
+    return kNoKey;
+  }
+
+  const auto first = rects.begin() + static_cast<std::ptrdiff_t>(row->first);
+  const auto last = rects.begin() + static_cast<std::ptrdiff_t>(row->last);
+  const auto key = std::lower_bound(
+      first, last, point.x(),
+      [](const QRect &rect, int x) { return rect.right() < x; });
+  if (key == last || !key->contains(point)) {
+    return kNoKey;
+  }
+  return static_cast<std::size_t>(key - rects.begin());
+}
+
+} // namespace layout
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace layout {
+
+class Element;
+
+/**
+ * @brief Spacing and minimum key size shared by every renderer.
+ */
+struct Metrics {
+  int margin{4};    ///< Outer margin around the keyboard, in pixels
+  int spacing{4};   ///< Gap between keys and between rows, in pixels
+  int baseUnit{40}; ///< Minimum size of a 1.0 x 1.0 key, in pixels
+};
+
+/**
+ * @brief Turns an Element list into key rectangles.
+ *
+ * The element list is ordered by row and column once, when the Geometry is
+ * built. After that, solving a window size is a single O(n) pass that writes a
+ * flat array of rectangles: rows share the height in proportion to their
+ * tallest key, and the keys of a row share its width in proportion to their
+ * width units. The last few sizes are cached, so resizing back and forth (or
+ * rotating) is a lookup.
+ */
+class Geometry {
+public:
+  struct Row {
+    std::size_t first;  ///< First key of the row, as a position in order()
+    std::size_t last;   ///< One past the last key of the row
+    float heightUnits;  ///< Height of the tallest key
+    float widthUnits;   ///< Sum of the key widths
+  };
+
+  static constexpr std::size_t kNoKey = static_cast<std::size_t>(-1);
+
+  Geometry() = default;
+  // Lays out the elements of one layer
+  explicit Geometry(const std::vector<Element> &elements, int layer = 0,
+                    Metrics metrics = {});
+
+  // Element indices in row-major order. Rectangles and rows are indexed by
+  // position in this order.
+  [[nodiscard]] const std::vector<std::size_t> &order() const { return order_; }
+  [[nodiscard]] const std::vector<Row> &rows() const { return rows_; }
+  [[nodiscard]] const Metrics &metrics() const { return metrics_; }
+
+  // Smallest size at which every key gets at least its baseUnit size
+  [[nodiscard]] QSize minimumSize() const { return minimumSize_; }
+
+  /**
+   * @brief Key rectangles for a keyboard of the given size, in order().
+   * The returned reference stays valid until the next call to solve().
+   */
+  const std::vector<QRect> &solve(QSize size);
+
+  // Position in order() of the key under a point, for the size last passed to
+  // solve(); kNoKey when the point is in a gap or outside the keyboard.
+  [[nodiscard]] std::size_t hitTest(QPoint point) const;
+
+private:
+  struct CacheEntry {
+    QSize size;
+    std::vector<QRect> rects;
+    uint64_t lastUse{0};
+  };
+
+  static constexpr std::size_t kCacheSize = 4;
+
+  void solveInto(QSize size, std::vector<QRect> &rects) const;
+
+  Metrics metrics_;
+  std::vector<std::size_t> order_;
+  std::vector<float> widthUnits_; // per position in order()
+  std::vector<Row> rows_;
+  float totalHeightUnits_{0.0F};
+  QSize minimumSize_;
+
+  std::array<CacheEntry, kCacheSize> cache_;
+  std::size_t current_{kCacheSize}; // entry returned by the last solve()
+  uint64_t useCounter_{0};
+};
+
+} // namespace layout
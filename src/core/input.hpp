@@ -1,35 +1,30 @@
 #pragma once
 
-#include "../backend/backend.hpp"
-#include "../ui/widgets.hpp"
-
-#include <QAction>
-#include <QDebug>
-#include <QObject>
-#include <QString>
-#include <QTimer>
-#include <functional>
-
-#define DEFAULT_HOLD_THRESHOLD 300
-#define DEFAULT_REPEAT_INTERVAL 80
+#include "backend/backend.hpp"
+#include "core/keyboard_controller.hpp"
+#include "ui/widgets.hpp"
 
-class QAction;
+#include <functional>
 
 namespace core {
 
 /**
  * @brief Input class that connects a Key to a RightClickableToolButton
- * and performs the actual key injection when the button is clicked
+ * and performs the actual key injection when the button is clicked.
+ *
+ * Input is a lightweight handle onto a KeyboardController slot: the
+ * controller owns the press / hold / toggle state and the timers, Input only
+ * remembers which slot it registered and releases it when destroyed.
  */
 class Input {
 public:
   // Callback types for key events
-  using KeyCallback = std::function<void(backend::Key)>;
+  using KeyCallback = KeyboardController::KeyCallback;
 
-  // Constructor that takes the key, button, and a reference to the input
-  // backend
+  // Constructor that takes the key, button, and the controller that drives
+  // every key of the keyboard
   Input(backend::Key key, ui::Widget::RightClickableToolButton *button,
-        backend::InputBackend *backend);
+        KeyboardController *controller);
 
   // Disable copy
   Input(const Input &) = delete;
@@ -44,6 +39,7 @@ public:
   // Getters
   [[nodiscard]] backend::Key key() const;
   [[nodiscard]] ui::Widget::RightClickableToolButton *button() const;
+  [[nodiscard]] KeyboardController::Slot slot() const { return slot_; }
   [[nodiscard]] bool isToggleMode() const;
   [[nodiscard]] bool isToggled() const;
 
@@ -56,6 +52,9 @@ public:
   // Set callback for key release events
   void setOnKeyReleased(KeyCallback callback);
 
+  // Caption shown on the key (defaults to the key's name)
+  void setLabel(const QString &label);
+
   // Simulate key down (visual feedback only)
   void keyDown();
 
@@ -87,70 +86,23 @@ public:
   void setHoldThresholdMs(int thresholdInMs);
   [[nodiscard]] int holdThresholdMs() const;
 
-private:
   /**
-   * @brief Internal handler for button trigger events (clicks)
-   *
-   * Note: by default Input uses native hold semantics (keyDown on press /
-   * keyUp on release). The class listens for press/release to support
-   * native-hold behaviour (so the OS can manage repeat). The
-   * QAction::triggered signal is only connected for toggle-mode or for
-   * explicit programmatic triggers (e.g., shortcuts) and is not used for
-   * normal mouse click handling to avoid duplicate event handling.
+   * @brief Configure software repeat for this key (initial delay, period and
+   * acceleration). Only used on backends without native key repeat.
    */
-  void onTriggered();
-
-  // Internal handlers for press / release lifecycle
-  void onPressed();
-  void onReleased();
-  void onToggled(bool checked); // QAction toggled handler (toggle-mode keys)
-
-  // Called when the hold threshold has been reached (start repeating)
-  void onHoldTimeout();
-
-  // (manual auto-repeat removed; hold threshold now controls when keyDown is
-  // sent)
-
-  // Helper to disconnect and stop timers/connections. Used during move and
-  // destruction.
-  void tearDownConnections();
-
-  backend::Key key_;
-  ui::Widget::RightClickableToolButton *button_;
-  backend::InputBackend *backend_;
-  QAction *action_;
-
-  bool isToggleMode_{false};
-  bool isToggled_{false};
-  KeyCallback onKeyPressed_;
-  KeyCallback onKeyReleased_;
-
-  // Hold threshold configuration and transient state
-  // Default is 300 ms before sending keyDown; short presses are taps.
-  int holdThresholdMs_{
-      DEFAULT_HOLD_THRESHOLD}; // milliseconds; threshold before sending keyDown
-                               // (default: 300 ms)
-
-  // Transient state
-  bool isPressed_{false}; // true while mouse button is down
-  bool isHeld_{
-      false}; // true when holdThreshold has elapsed and keyDown has been sent
-
-  // Timer used to detect the hold threshold; parented to button_
-  QTimer *holdTimer_{nullptr};
-
-  // Fallback repeat timer: used only if the backend does not provide native
-  // autorepeat when a physical-like keyDown is injected. This is private and
-  // controlled internally; default repeat interval is 80 ms.
-  QTimer *repeatTimer_{nullptr};
-  QMetaObject::Connection repeatTimerConnection_;
-  int repeatIntervalMs_{DEFAULT_REPEAT_INTERVAL};
-
-  // Stored connections so move / reattachment can disconnect/reconnect safely
-  QMetaObject::Connection pressedConnection_;
-  QMetaObject::Connection releasedConnection_;
-  QMetaObject::Connection actionToggledConnection_;
-  QMetaObject::Connection holdTimerConnection_;
+  void setRepeatConfig(const RepeatConfig &config);
+  [[nodiscard]] const RepeatConfig &repeatConfig() const;
+
+  /**
+   * @brief Choose when the key reaches the target: on release / after the
+   * hold threshold (Deferred, the default) or on press (Immediate).
+   */
+  void setPressMode(PressMode mode);
+  [[nodiscard]] PressMode pressMode() const;
+
+private:
+  KeyboardController *controller_;
+  KeyboardController::Slot slot_{KeyboardController::kInvalidSlot};
 };
 
 } // namespace core
@@ -0,0 +1,82 @@
+#include "key_captions.hpp"
+
+#include "core/log.hpp"
+
+#include <QSocketNotifier>
+#include <vector>
+
+namespace core {
+
+KeyCaptions::KeyCaptions(KeyboardController *controller, QObject *parent)
+    : QObject(parent), controller_(controller) {
+  if (!keymap_.isAvailable()) {
+    TYPR_LOG_INFO("core::KeyCaptions",
+                  "no keymap on this platform, keeping key names");
+    return;
+  }
+
+  if (const int fd = keymap_.notifierFd(); fd >= 0) {
+    notifier_ = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier_, &QSocketNotifier::activated, this,
+            [this]() { update(false); });
+  }
+  update(true);
+}
+
+void KeyCaptions::refresh() {
+  if (keymap_.isAvailable()) {
+    update(true);
+  }
+}
+
+void KeyCaptions::update(bool force) {
+  const backend::Keymap::State state = keymap_.poll();
+  if (keymap_.generation() != generation_) {
+    // New keymap (layout added, setxkbmap, ...): every cached set is stale
+    generation_ = keymap_.generation();
+    cache_.clear();
+    force = true;
+  }
+  if (!force && state == state_) {
+    return;
+  }
+  state_ = state;
+
+  const Captions &captions = captionsFor(state);
+  std::vector<KeyboardController::LabelChange> changes;
+  for (KeyboardController::Slot slot = 0; slot < controller_->size();
+       ++slot) {
+    const backend::Key key = controller_->key(slot);
+    if (key == backend::Key::Unknown) {
+      continue;
+    }
+    const QString &caption = captions[static_cast<std::size_t>(key)];
+    if (caption != controller_->label(slot)) {
+      changes.emplace_back(slot, caption);
+    }
+  }
+  controller_->setLabels(changes);
+
+  TYPR_LOG_DEBUG("core::KeyCaptions", "state {} relabelled {} keys", state,
+                 changes.size());
+}
+
+const KeyCaptions::Captions &
+KeyCaptions::captionsFor(backend::Keymap::State state) {
+  auto [entry, inserted] = cache_.try_emplace(state);
+  if (!inserted) {
+    return entry->second;
+  }
+
+  backend::Keymap::Captions resolved;
+  keymap_.captions(state, resolved);
+  for (std::size_t index = 0; index < resolved.size(); ++index) {
+    const auto key = static_cast<backend::Key>(index);
+    entry->second[index] = resolved[index].empty()
+                               ? QString::fromUtf8(backend::keyName(key))
+                               : QString::fromStdString(resolved[index]);
+  }
+  return entry->second;
+}
+
+} // namespace core
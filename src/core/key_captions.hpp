@@ -0,0 +1,51 @@
+#pragma once
+
+#include "backend/backend.hpp"
+#include "core/keyboard_controller.hpp"
+
+#include <QObject>
+#include <QString>
+#include <array>
+#include <unordered_map>
+
+class QSocketNotifier;
+
+namespace core {
+
+/**
+ * @brief Keeps key captions in step with the active keyboard layout and
+ * modifier state.
+ *
+ * Captions come from backend::Keymap, so an AZERTY user sees AZERTY letters
+ * and they follow Shift, Caps Lock and AltGr. Each (layout, modifier state)
+ * is resolved once and cached; a later change back to it only compares
+ * cached strings. Only the keys whose caption differs are relabelled, in one
+ * KeyboardController::setLabels() batch.
+ *
+ * Keys the keymap has no caption for (and Key::Unknown keys, e.g. layer keys)
+ * keep their names.
+ */
+class KeyCaptions : public QObject {
+public:
+  explicit KeyCaptions(KeyboardController *controller,
+                       QObject *parent = nullptr);
+
+  // Apply the current captions again, e.g. after a layout reload reset the
+  // labels of reconfigured or added keys
+  void refresh();
+
+private:
+  using Captions = std::array<QString, 256>; // indexed by backend::Key
+
+  void update(bool force);
+  const Captions &captionsFor(backend::Keymap::State state);
+
+  KeyboardController *controller_;
+  backend::Keymap keymap_;
+  QSocketNotifier *notifier_{nullptr};
+  std::unordered_map<backend::Keymap::State, Captions> cache_;
+  backend::Keymap::State state_{0};
+  uint32_t generation_{0};
+};
+
+} // namespace core
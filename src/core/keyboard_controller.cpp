@@ -0,0 +1,518 @@
+#include "keyboard_controller.hpp"
+
+#include "core/log.hpp"
+#include "core/trace.hpp"
+
+#include <QString>
+#include <algorithm>
+
+namespace core {
+
+KeyboardController::KeyboardController(backend::InputBackend *backend)
+    : backend_(backend),
+      nativeRepeat_(backend != nullptr &&
+                    backend->capabilities().supportsKeyRepeat),
+      softwareRepeat_(backend != nullptr && !nativeRepeat_),
+      epoch_(Clock::now()) {
+  wheelTimer_.setTimerType(Qt::PreciseTimer);
+  wheelTimer_.setInterval(kWheelTickMs);
+  QObject::connect(&wheelTimer_, &QTimer::timeout, &wheelTimer_,
+                   [this]() { onWheelTick(); });
+}
+
+KeyboardController::~KeyboardController() {
+  wheelTimer_.stop();
+  // Buttons may already be gone at this point (they belong to the window), so
+  // only make sure no key is left held on the target side.
+  for (Slot slot = 0; slot < keys_.size(); ++slot) {
+    if (has(slot, Used) && (has(slot, Held) || has(slot, Toggled))) {
+      pressUp(slot);
+    }
+  }
+}
+
+KeyboardController::Slot
+KeyboardController::addKey(backend::Key key,
+                           ui::Widget::RightClickableToolButton *button) {
+  Slot slot = kInvalidSlot;
+  if (!freeSlots_.empty()) {
+    slot = freeSlots_.back();
+    freeSlots_.pop_back();
+  } else {
+    slot = keys_.size();
+    keys_.emplace_back();
+    buttons_.emplace_back();
+    labels_.emplace_back();
+    flags_.emplace_back();
+    holdThresholdMs_.emplace_back();
+    repeatConfigs_.emplace_back();
+    repeatPeriodMs_.emplace_back();
+    deadlines_.emplace_back();
+    wheelBuckets_.emplace_back();
+    onKeyPressed_.emplace_back();
+    onKeyReleased_.emplace_back();
+  }
+
+  keys_[slot] = key;
+  buttons_[slot] = button;
+  labels_[slot] = QString::fromUtf8(backend::keyName(key));
+  flags_[slot] = Used;
+  holdThresholdMs_[slot] = DEFAULT_HOLD_THRESHOLD;
+  repeatConfigs_[slot] = RepeatConfig{};
+  deadlines_[slot] = {};
+  onKeyPressed_[slot] = nullptr;
+  onKeyReleased_[slot] = nullptr;
+
+  if (button != nullptr) {
+    // The button is used as the connection context so the connections die
+    // with it; removeKey() drops them explicitly when the key goes away first.
+    QObject::connect(button, &QToolButton::pressed, button, [this, slot]() {
+      if (has(slot, Used) && !has(slot, Pressed)) {
+        set(slot, ButtonPress, true);
+        press(slot);
+      }
+    });
+    QObject::connect(button, &QToolButton::released, button,
+                     [this, slot]() { release(slot); });
+
+    button->setText(labels_[slot]);
+    button->setToolButtonStyle(Qt::ToolButtonTextOnly);
+  }
+
+  return slot;
+}
+
+void KeyboardController::removeKey(Slot slot) {
+  if (slot >= keys_.size() || !has(slot, Used)) {
+    return;
+  }
+
+  disarm(slot);
+
+  // Never leave a key stuck down on the target side
+  if (has(slot, Held) || has(slot, Toggled)) {
+    pressUp(slot);
+  }
+
+  if (auto *button = buttons_[slot]; button != nullptr) {
+    QObject::disconnect(button, nullptr, button, nullptr);
+  }
+
+  buttons_[slot] = nullptr;
+  flags_[slot] = 0;
+  onKeyPressed_[slot] = nullptr;
+  onKeyReleased_[slot] = nullptr;
+  freeSlots_.push_back(slot);
+}
+
+void KeyboardController::setToggleMode(Slot slot, bool toggle) {
+  if (!toggle && has(slot, Toggled)) {
+    // A latched key that stops being a toggle must not stay down
+    set(slot, Toggled, false);
+    pressUp(slot);
+  }
+  set(slot, Toggle, toggle);
+  if (auto *button = buttons_[slot]; button != nullptr) {
+    // Let QAbstractButton flip its checked state on click so toggle keys keep
+    // their highlight; release() re-syncs it with the logical state.
+    button->setCheckable(toggle);
+    button->setChecked(has(slot, Toggled));
+  }
+  notifyStateChanged(slot);
+}
+
+void KeyboardController::setHoldThresholdMs(Slot slot, int thresholdInMs) {
+  holdThresholdMs_[slot] = thresholdInMs;
+}
+
+void KeyboardController::setRepeatConfig(Slot slot,
+                                         const RepeatConfig &config) {
+  repeatConfigs_[slot] = config;
+}
+
+void KeyboardController::setPressMode(Slot slot, PressMode mode) {
+  set(slot, Immediate, mode == PressMode::Immediate);
+}
+
+void KeyboardController::setOnKeyPressed(Slot slot, KeyCallback callback) {
+  onKeyPressed_[slot] = std::move(callback);
+}
+
+void KeyboardController::setOnKeyReleased(Slot slot, KeyCallback callback) {
+  onKeyReleased_[slot] = std::move(callback);
+}
+
+void KeyboardController::setLabel(Slot slot, const QString &label) {
+  if (labels_[slot] == label) {
+    return;
+  }
+  labels_[slot] = label;
+  if (auto *button = buttons_[slot]; button != nullptr) {
+    button->setText(label);
+  }
+  notifyStateChanged(slot);
+}
+
+void KeyboardController::setLabels(const std::vector<LabelChange> &labels) {
+  // Buttons would each schedule their own repaint and size update; hold the
+  // window's updates so the whole batch lands in one paint.
+  QWidget *window = nullptr;
+  for (const auto &[slot, label] : labels) {
+    if (auto *button = buttons_[slot]; button != nullptr) {
+      window = button->window();
+      break;
+    }
+  }
+  const bool suspend = window != nullptr && window->updatesEnabled();
+  if (suspend) {
+    window->setUpdatesEnabled(false);
+  }
+  for (const auto &[slot, label] : labels) {
+    setLabel(slot, label);
+  }
+  if (suspend) {
+    window->setUpdatesEnabled(true);
+  }
+}
+
+bool KeyboardController::isToggleMode(Slot slot) const {
+  return has(slot, Toggle);
+}
+
+bool KeyboardController::isToggled(Slot slot) const {
+  return has(slot, Toggled);
+}
+
+bool KeyboardController::isPressed(Slot slot) const {
+  return has(slot, Pressed);
+}
+
+void KeyboardController::press(Slot slot) {
+  TYPR_TRACE_SPAN("core", "KeyboardController::press");
+  if (!has(slot, Used) || has(slot, Pressed)) {
+    return;
+  }
+
+  set(slot, Pressed, true);
+  set(slot, Held, false);
+  set(slot, Early, false);
+  setVisualDown(slot, true);
+
+  // Toggle keys act on release. Normal keys wait for the hold threshold
+  // before sending keyDown; a zero threshold means keyDown on press.
+  if (has(slot, Toggle)) {
+    return;
+  }
+
+  const auto now = currentTime();
+  if (has(slot, Immediate)) {
+    pressImmediate(slot, now);
+  } else if (holdThresholdMs_[slot] > 0) {
+    arm(slot, now + std::chrono::milliseconds(holdThresholdMs_[slot]));
+  } else {
+    onDeadline(slot, now);
+  }
+}
+
+void KeyboardController::release(Slot slot) {
+  TYPR_TRACE_SPAN("core", "KeyboardController::release");
+  if (!has(slot, Used) || !has(slot, Pressed)) {
+    return;
+  }
+
+  disarm(slot);
+
+  const bool wasHeld = has(slot, Held);
+  const bool wasEarly = has(slot, Early);
+  set(slot, Pressed, false);
+  set(slot, ButtonPress, false);
+  set(slot, Held, false);
+  set(slot, Early, false);
+  setVisualDown(slot, false);
+
+  const backend::Key key = keys_[slot];
+
+  if (has(slot, Toggle)) {
+    const bool toggled = !has(slot, Toggled);
+    set(slot, Toggled, toggled);
+    if (toggled) {
+      pressDown(slot);
+      if (onKeyPressed_[slot]) {
+        onKeyPressed_[slot](key);
+      }
+    } else {
+      pressUp(slot);
+      if (onKeyReleased_[slot]) {
+        onKeyReleased_[slot](key);
+      }
+    }
+    if (auto *button = buttons_[slot]; button != nullptr) {
+      button->setChecked(toggled);
+    }
+    notifyStateChanged(slot);
+    return;
+  }
+
+  if (wasHeld) {
+    // keyDown was sent when the threshold passed; now release it.
+    pressUp(slot);
+    if (onKeyReleased_[slot]) {
+      onKeyReleased_[slot](key);
+    }
+  } else if (wasEarly) {
+    // Immediate key released before the threshold: its tap already went out.
+    if (onKeyReleased_[slot]) {
+      onKeyReleased_[slot](key);
+    }
+  } else {
+    // Short press -> tap
+    tap(slot);
+    if (onKeyPressed_[slot]) {
+      onKeyPressed_[slot](key);
+    }
+    if (onKeyReleased_[slot]) {
+      onKeyReleased_[slot](key);
+    }
+  }
+}
+
+void KeyboardController::releaseButtonPress(Slot slot) {
+  if (slot < keys_.size() && has(slot, ButtonPress)) {
+    release(slot);
+  }
+}
+
+bool KeyboardController::tap(Slot slot) {
+  TYPR_TRACE_SPAN("core", "KeyboardController::tap");
+  if (keys_[slot] == backend::Key::Unknown) {
+    return true; // callback-only key
+  }
+  if (backend_ == nullptr || !backend_->isReady()) {
+    TYPR_LOG_WARN("core::Input", "backend not ready for key {}", keys_[slot]);
+    return false;
+  }
+
+  TYPR_LOG_DEBUG("core::Input", "tap {}", keys_[slot]);
+  if (!backend_->tap(keys_[slot])) {
+    return false;
+  }
+  notifyInjected(slot, true);
+  notifyInjected(slot, false);
+  return true;
+}
+
+bool KeyboardController::pressDown(Slot slot) {
+  TYPR_TRACE_SPAN("core", "KeyboardController::pressDown");
+  if (keys_[slot] == backend::Key::Unknown) {
+    return true; // callback-only key
+  }
+  if (backend_ == nullptr || !backend_->isReady()) {
+    return false;
+  }
+
+  TYPR_LOG_DEBUG("core::Input", "key down {}", keys_[slot]);
+  if (!backend_->keyDown(keys_[slot])) {
+    return false;
+  }
+  notifyInjected(slot, true);
+  return true;
+}
+
+bool KeyboardController::pressUp(Slot slot) {
+  TYPR_TRACE_SPAN("core", "KeyboardController::pressUp");
+  if (keys_[slot] == backend::Key::Unknown) {
+    return true; // callback-only key
+  }
+  if (backend_ == nullptr || !backend_->isReady()) {
+    return false;
+  }
+
+  TYPR_LOG_DEBUG("core::Input", "key up {}", keys_[slot]);
+  if (!backend_->keyUp(keys_[slot])) {
+    return false;
+  }
+  notifyInjected(slot, false);
+  return true;
+}
+
+void KeyboardController::setClock(NowFunction now) {
+  wheelTimer_.stop();
+  now_ = std::move(now);
+  epoch_ = currentTime();
+  lastTick_ = 0;
+}
+
+void KeyboardController::setVisualDown(Slot slot, bool down) {
+  if (has(slot, VisualDown) == down) {
+    return;
+  }
+  set(slot, VisualDown, down);
+  if (auto *button = buttons_[slot]; button != nullptr) {
+    button->setDown(down);
+  }
+  notifyStateChanged(slot);
+}
+
+int64_t KeyboardController::tickOf(Clock::time_point time) const {
+  const auto elapsed =
+      std::chrono::duration_cast<std::chrono::milliseconds>(time - epoch_);
+  // Round up so a deadline never fires early
+  return (elapsed.count() + kWheelTickMs - 1) / kWheelTickMs;
+}
+
+void KeyboardController::arm(Slot slot, Clock::time_point deadline) {
+  disarm(slot);
+
+  if (pendingDeadlines_ == 0) {
+    // The wheel was idle: count from the current tick, which has not been
+    // visited yet
+    lastTick_ = tickOf(currentTime()) - 1;
+  }
+
+  const int64_t tick = std::max(tickOf(deadline), lastTick_ + 1);
+  const std::size_t bucket = static_cast<std::size_t>(tick) & (kWheelSize - 1);
+  deadlines_[slot] = deadline;
+  wheelBuckets_[slot] = bucket;
+  wheel_[bucket].push_back(slot);
+
+  if (pendingDeadlines_++ == 0 && !now_) {
+    wheelTimer_.start();
+  }
+}
+
+void KeyboardController::disarm(Slot slot) {
+  if (deadlines_[slot] == Clock::time_point{}) {
+    return;
+  }
+
+  // Buckets only ever hold a handful of slots, so a linear erase is cheaper
+  // than keeping cancelled entries around until the wheel comes back to them.
+  auto &bucket = wheel_[wheelBuckets_[slot]];
+  if (auto it = std::ranges::find(bucket, slot); it != bucket.end()) {
+    *it = bucket.back();
+    bucket.pop_back();
+  }
+  deadlines_[slot] = {};
+  if (--pendingDeadlines_ == 0) {
+    wheelTimer_.stop();
+  }
+}
+
+void KeyboardController::onWheelTick() {
+  TYPR_TRACE_SPAN("core", "KeyboardController::onWheelTick");
+  const auto now = currentTime();
+  const int64_t nowTick = tickOf(now);
+
+  // Visit every bucket between the last processed tick and now. If the event
+  // loop stalled for more than a full revolution each bucket is visited once.
+  const int64_t first =
+      std::max(lastTick_ + 1, nowTick - static_cast<int64_t>(kWheelSize) + 1);
+  // The timer does not tick in phase with the wheel, so the current bucket
+  // can still hold deadlines due later in this tick period. Visit it again
+  // next time instead of only a revolution later.
+  lastTick_ = nowTick - 1;
+
+  for (int64_t tick = first; tick <= nowTick; ++tick) {
+    auto &bucket = wheel_[static_cast<std::size_t>(tick) & (kWheelSize - 1)];
+    for (std::size_t i = 0; i < bucket.size();) {
+      const Slot slot = bucket[i];
+      if (deadlines_[slot] > now) {
+        // Deadline is one or more revolutions away
+        ++i;
+        continue;
+      }
+
+      // disarm() removes the entry from this bucket; handlers may re-arm.
+      const Clock::time_point deadline = deadlines_[slot];
+      disarm(slot);
+      onDeadline(slot, deadline);
+    }
+  }
+}
+
+void KeyboardController::onDeadline(Slot slot, Clock::time_point deadline) {
+  if (!has(slot, Pressed) || has(slot, Toggle)) {
+    return;
+  }
+
+  if (has(slot, Held)) {
+    onRepeat(slot, deadline);
+    return;
+  }
+
+  // Hold threshold elapsed: send a single keyDown for non-toggle keys. For an
+  // immediate key this turns the tap sent on press into a hold.
+  if (!pressDown(slot)) {
+    return;
+  }
+  set(slot, Held, true);
+  if (!has(slot, Early) && onKeyPressed_[slot]) {
+    onKeyPressed_[slot](keys_[slot]);
+  }
+
+  scheduleRepeat(slot, deadline);
+}
+
+void KeyboardController::pressImmediate(Slot slot, Clock::time_point now) {
+  if (!pressDown(slot)) {
+    return;
+  }
+  if (onKeyPressed_[slot]) {
+    onKeyPressed_[slot](keys_[slot]);
+  }
+
+  const auto threshold = std::chrono::milliseconds(holdThresholdMs_[slot]);
+  if (nativeRepeat_ && holdThresholdMs_[slot] > 0) {
+    // Keeping the key down would let the OS start repeating on its own
+    // schedule, so release it now and press it again if the user is still
+    // holding when the threshold passes.
+    pressUp(slot);
+    set(slot, Early, true);
+    arm(slot, now + threshold);
+    return;
+  }
+
+  // No OS repeat to fight: keep the key down until release and start the
+  // software repeat (if any) once the threshold has passed.
+  set(slot, Held, true);
+  scheduleRepeat(slot, now + threshold);
+}
+
+void KeyboardController::scheduleRepeat(Slot slot, Clock::time_point from) {
+  const RepeatConfig &config = repeatConfigs_[slot];
+  if (!softwareRepeat_ || !config.enabled) {
+    return;
+  }
+  repeatPeriodMs_[slot] = static_cast<float>(config.intervalMs);
+  arm(slot, from + std::chrono::milliseconds(config.initialDelayMs));
+}
+
+void KeyboardController::onRepeat(Slot slot, Clock::time_point deadline) {
+  // A repeat is another keyDown while the key is held, which is how a
+  // physical keyboard's typematic repeat reaches applications.
+  if (backend_ != nullptr && backend_->isReady()) {
+    TYPR_LOG_TRACE("core::Input", "repeat {}", keys_[slot]);
+    backend_->keyDown(keys_[slot]);
+    if (onKeyPressed_[slot]) {
+      onKeyPressed_[slot](keys_[slot]);
+    }
+  }
+
+  const RepeatConfig &config = repeatConfigs_[slot];
+  float &period = repeatPeriodMs_[slot];
+
+  // Schedule from the previous deadline rather than from now so late ticks do
+  // not accumulate into drift. Periods that were missed entirely (the GUI
+  // thread stalled) are skipped instead of replayed as a burst.
+  const auto now = currentTime();
+  auto next = deadline;
+  do {
+    next += std::chrono::microseconds(static_cast<int64_t>(period * 1000.0F));
+    period = std::max({1.0F, static_cast<float>(config.minIntervalMs),
+                       period * config.acceleration});
+  } while (next <= now);
+
+  arm(slot, next);
+}
+
+} // namespace core
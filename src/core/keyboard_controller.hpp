@@ -0,0 +1,268 @@
+#pragma once
+
+#include "backend/backend.hpp"
+#include "ui/widgets.hpp"
+
+#include <QString>
+#include <QTimer>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#define DEFAULT_HOLD_THRESHOLD 300
+#define DEFAULT_REPEAT_DELAY 250
+#define DEFAULT_REPEAT_INTERVAL 80
+
+namespace core {
+
+/**
+ * @brief Software key-repeat settings for one key.
+ *
+ * Only used when the backend does not generate repeats itself
+ * (Capabilities::supportsKeyRepeat == false). Once the key is held, the first
+ * repeat fires after initialDelayMs; every following period is the previous
+ * one multiplied by acceleration, clamped to minIntervalMs. An acceleration of
+ * 1.0 gives a constant rate.
+ */
+struct RepeatConfig {
+  bool enabled{true};
+  int initialDelayMs{DEFAULT_REPEAT_DELAY};
+  int intervalMs{DEFAULT_REPEAT_INTERVAL};
+  int minIntervalMs{DEFAULT_REPEAT_INTERVAL};
+  float acceleration{1.0F};
+};
+
+/**
+ * @brief When a key reaches the target application.
+ *
+ * Deferred: nothing is injected until release (tap) or until the hold
+ * threshold passes (keyDown, then keyUp on release). Short taps therefore
+ * arrive when the finger lifts.
+ *
+ * Immediate: keyDown is injected on press and keyUp on release, so a tap
+ * arrives as soon as the key is touched. If the OS generates its own repeat,
+ * the key is released right away and pressed again once the hold threshold
+ * passes (a retroactive hold), which keeps OS repeat from starting early.
+ */
+enum class PressMode : uint8_t { Deferred, Immediate };
+
+/**
+ * @brief Owns the press / hold / toggle state of every key on the keyboard.
+ *
+ * Keys are registered once and addressed by a slot index. All per-key state
+ * lives in flat arrays indexed by that slot, and every pending deadline (hold
+ * threshold, software repeat) is kept in a single coarse timer wheel driven by
+ * one QTimer.
+ * This replaces the per-key QAction / QTimer pairs the keyboard used to
+ * allocate, so an 80-key layout costs one QObject instead of a few hundred and
+ * a press only pushes an entry into a wheel bucket.
+ */
+class KeyboardController {
+public:
+  using Slot = std::size_t;
+  using KeyCallback = std::function<void(backend::Key)>;
+  using StateCallback = std::function<void(Slot)>;
+  using Clock = std::chrono::steady_clock;
+  using InjectedCallback =
+      std::function<void(backend::Key, bool down, Clock::time_point)>;
+  using NowFunction = std::function<Clock::time_point()>;
+
+  static constexpr Slot kInvalidSlot = static_cast<Slot>(-1);
+
+  // Granularity of the timer wheel. Deadlines are rounded up to the next tick,
+  // which is well below what a user can perceive on a hold threshold.
+  static constexpr int kWheelTickMs = 5;
+
+  explicit KeyboardController(backend::InputBackend *backend);
+
+  KeyboardController(const KeyboardController &) = delete;
+  KeyboardController &operator=(const KeyboardController &) = delete;
+  KeyboardController(KeyboardController &&) = delete;
+  KeyboardController &operator=(KeyboardController &&) = delete;
+
+  ~KeyboardController();
+
+  /**
+   * @brief Register a key and return its slot. The button (if any) gets its
+   * caption and press / release wiring; it may be null for keys that are not
+   * backed by a widget.
+   *
+   * Keys registered as backend::Key::Unknown are never injected; they only
+   * run their callbacks (e.g. layer keys).
+   */
+  Slot addKey(backend::Key key, ui::Widget::RightClickableToolButton *button);
+
+  // Release a slot. Any pending deadline is dropped and a held key is released
+  // so nothing stays stuck down on the target side.
+  void removeKey(Slot slot);
+
+  [[nodiscard]] backend::InputBackend *backend() const { return backend_; }
+  [[nodiscard]] std::size_t size() const { return keys_.size(); }
+
+  // --- Per-slot configuration ---
+  void setToggleMode(Slot slot, bool toggle);
+  void setHoldThresholdMs(Slot slot, int thresholdInMs);
+  void setRepeatConfig(Slot slot, const RepeatConfig &config);
+  void setPressMode(Slot slot, PressMode mode);
+  void setOnKeyPressed(Slot slot, KeyCallback callback);
+  void setOnKeyReleased(Slot slot, KeyCallback callback);
+
+  // Caption shown on the key (defaults to the key's name)
+  void setLabel(Slot slot, const QString &label);
+
+  // Apply many captions at once (e.g. after a modifier or layout change).
+  // Keys whose caption is unchanged are not touched, and repaints of the rest
+  // coalesce into one frame.
+  using LabelChange = std::pair<Slot, QString>;
+  void setLabels(const std::vector<LabelChange> &labels);
+
+  // Called whenever a key's visual state (down / toggled) changes. Renderers
+  // that do not use one button per key repaint just that key from here.
+  void setOnStateChanged(StateCallback callback) {
+    onStateChanged_ = std::move(callback);
+  }
+
+  // Called for every key down and up the controller injects (a tap is both),
+  // with the clock's time. Software repeats are not reported.
+  void setOnInjected(InjectedCallback callback) {
+    onInjected_ = std::move(callback);
+  }
+
+  // --- Per-slot state ---
+  [[nodiscard]] backend::Key key(Slot slot) const { return keys_[slot]; }
+  [[nodiscard]] ui::Widget::RightClickableToolButton *button(Slot slot) const {
+    return buttons_[slot];
+  }
+  [[nodiscard]] const QString &label(Slot slot) const { return labels_[slot]; }
+  [[nodiscard]] bool isToggleMode(Slot slot) const;
+  [[nodiscard]] bool isToggled(Slot slot) const;
+  [[nodiscard]] bool isPressed(Slot slot) const;
+  // Drawn as pushed: pressed (or forced down by setVisualDown)
+  [[nodiscard]] bool isDown(Slot slot) const { return has(slot, VisualDown); }
+  [[nodiscard]] int holdThresholdMs(Slot slot) const {
+    return holdThresholdMs_[slot];
+  }
+  [[nodiscard]] const RepeatConfig &repeatConfig(Slot slot) const {
+    return repeatConfigs_[slot];
+  }
+  [[nodiscard]] PressMode pressMode(Slot slot) const {
+    return has(slot, Immediate) ? PressMode::Immediate : PressMode::Deferred;
+  }
+
+  // Software repeat is enabled automatically when the backend does not
+  // repeat held keys itself; this overrides the detection.
+  void setSoftwareRepeat(bool enabled) { softwareRepeat_ = enabled; }
+  [[nodiscard]] bool softwareRepeat() const { return softwareRepeat_; }
+
+  // --- Press lifecycle (driven by the button signals) ---
+  void press(Slot slot);
+  void release(Slot slot);
+  // Release the key if its button pressed it. A button hidden while the mouse
+  // holds it (e.g. its layer page is switched away) never emits released(),
+  // so whatever hides it calls this instead. Presses routed by slot, such as
+  // touches, are left alone.
+  void releaseButtonPress(Slot slot);
+
+  // --- Direct injection helpers ---
+  bool tap(Slot slot);
+  bool pressDown(Slot slot);
+  bool pressUp(Slot slot);
+
+  // Visual feedback only
+  void setVisualDown(Slot slot, bool down);
+
+  // --- Virtual time (tests) ---
+  /**
+   * @brief Read time from `now` instead of the steady clock. The wheel timer
+   * is then never started: whoever drives the clock calls runDueDeadlines()
+   * after moving it, once per kWheelTickMs to match the real timer. Only call
+   * while no deadline is pending; an empty function restores the real clock.
+   */
+  void setClock(NowFunction now);
+
+  // Fire every deadline that is due at the clock's current time (what one
+  // wheel timer tick does)
+  void runDueDeadlines() { onWheelTick(); }
+  [[nodiscard]] bool hasPendingDeadlines() const {
+    return pendingDeadlines_ > 0;
+  }
+
+private:
+  enum Flag : uint16_t {
+    Used = 0x01,
+    Toggle = 0x02,
+    Toggled = 0x04,
+    Pressed = 0x08,
+    Held = 0x10,      // keyDown has been injected and the key is down
+    Immediate = 0x20, // PressMode::Immediate
+    Early = 0x40,     // an immediate press already delivered its tap
+    VisualDown = 0x80,
+    ButtonPress = 0x100, // pressed through its button's pressed() signal
+  };
+
+  static constexpr std::size_t kWheelSize = 256; // must be a power of two
+
+  [[nodiscard]] bool has(Slot slot, uint16_t flag) const {
+    return (flags_[slot] & flag) != 0;
+  }
+  void set(Slot slot, uint16_t flag, bool enabled) {
+    flags_[slot] = enabled ? static_cast<uint16_t>(flags_[slot] | flag)
+                           : static_cast<uint16_t>(flags_[slot] & ~flag);
+  }
+
+  [[nodiscard]] Clock::time_point currentTime() const {
+    return now_ ? now_() : Clock::now();
+  }
+  [[nodiscard]] int64_t tickOf(Clock::time_point time) const;
+  void arm(Slot slot, Clock::time_point deadline);
+  void disarm(Slot slot);
+  void pressImmediate(Slot slot, Clock::time_point now);
+  void scheduleRepeat(Slot slot, Clock::time_point from);
+  void onWheelTick();
+  void onDeadline(Slot slot, Clock::time_point deadline);
+  void onRepeat(Slot slot, Clock::time_point deadline);
+  void notifyStateChanged(Slot slot) const {
+    if (onStateChanged_) {
+      onStateChanged_(slot);
+    }
+  }
+  void notifyInjected(Slot slot, bool down) const {
+    if (onInjected_) {
+      onInjected_(keys_[slot], down, currentTime());
+    }
+  }
+
+  backend::InputBackend *backend_;
+  bool nativeRepeat_{false};
+  bool softwareRepeat_{false};
+
+  // Flat per-slot state
+  std::vector<backend::Key> keys_;
+  std::vector<ui::Widget::RightClickableToolButton *> buttons_;
+  std::vector<QString> labels_;
+  std::vector<uint16_t> flags_;
+  std::vector<int> holdThresholdMs_;
+  std::vector<RepeatConfig> repeatConfigs_;
+  std::vector<float> repeatPeriodMs_; // period until the next repeat
+  std::vector<Clock::time_point> deadlines_; // default value = none pending
+  std::vector<std::size_t> wheelBuckets_;     // bucket holding the deadline
+  std::vector<KeyCallback> onKeyPressed_;
+  std::vector<KeyCallback> onKeyReleased_;
+  std::vector<Slot> freeSlots_;
+  StateCallback onStateChanged_;
+  InjectedCallback onInjected_;
+
+  // Timer wheel
+  std::array<std::vector<Slot>, kWheelSize> wheel_;
+  std::size_t pendingDeadlines_{0};
+  int64_t lastTick_{0};
+  Clock::time_point epoch_;
+  NowFunction now_; // empty = Clock::now()
+  QTimer wheelTimer_;
+};
+
+} // namespace core
@@ -0,0 +1,104 @@
+#include "layer_switcher.hpp"
+
+#include "core/log.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace layout {
+
+LayerSwitcher::LayerSwitcher(ShowCallback showLayer)
+    : showLayer_(std::move(showLayer)) {}
+
+void LayerSwitcher::bind(const LayoutSpec &layout,
+                         std::vector<Element> &elements) {
+  using KeyCallback = core::Input::KeyCallback;
+
+  // Elements are built in spec order (see buildElements / applyDiff)
+  const std::size_t count = std::min(elements.size(), layout.keys.size());
+  for (std::size_t index = 0; index < count; ++index) {
+    core::Input *input = elements[index].input();
+    const KeySpec &spec = layout.keys[index];
+    if (spec.layerAction == LayerAction::None) {
+      input->setOnKeyPressed(nullptr);
+      // Toggled modifiers latch on their own and do not end a layer
+      input->setOnKeyReleased(
+          spec.toggle ? KeyCallback(nullptr)
+                      : KeyCallback([this](backend::Key) { onKeyUsed(); }));
+      continue;
+    }
+    input->setOnKeyPressed([this, spec](backend::Key) {
+      onLayerPressed(spec);
+    });
+    input->setOnKeyReleased([this, spec](backend::Key) {
+      onLayerReleased(spec);
+    });
+  }
+
+  layerCount_ = std::max<int>(1, static_cast<int>(layout.layers.size()));
+  if (locked_ >= layerCount_) {
+    locked_ = 0;
+  }
+  momentary_ = -1;
+  oneShot_ = false;
+  update();
+}
+
+bool LayerSwitcher::lock(int layer) {
+  if (layer < 0 || layer >= layerCount_) {
+    return false;
+  }
+  locked_ = layer;
+  momentary_ = -1;
+  oneShot_ = false;
+  update();
+  return true;
+}
+
+void LayerSwitcher::onLayerPressed(const KeySpec &spec) {
+  if (spec.layerAction != LayerAction::Momentary) {
+    return;
+  }
+  momentary_ = spec.layerTarget;
+  used_ = false;
+  oneShot_ = false;
+  update();
+}
+
+void LayerSwitcher::onLayerReleased(const KeySpec &spec) {
+  if (spec.layerAction == LayerAction::Lock) {
+    locked_ = locked_ == spec.layerTarget ? 0 : spec.layerTarget;
+    momentary_ = -1;
+    oneShot_ = false;
+  } else if (momentary_ == spec.layerTarget) {
+    if (used_) {
+      momentary_ = -1;
+    } else {
+      oneShot_ = true;
+    }
+  }
+  update();
+}
+
+void LayerSwitcher::onKeyUsed() {
+  used_ = true;
+  if (oneShot_) {
+    oneShot_ = false;
+    momentary_ = -1;
+    update();
+  }
+}
+
+void LayerSwitcher::update() {
+  const int layer = momentary_ >= 0 ? momentary_ : locked_;
+  if (layer == current_) {
+    return;
+  }
+  current_ = layer;
+  TYPR_LOG_DEBUG("layout", "layer {}", current_);
+  if (showLayer_) {
+    showLayer_(current_);
+  }
+}
+
+} // namespace layout
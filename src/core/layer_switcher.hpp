@@ -0,0 +1,57 @@
+#pragma once
+
+#include "core/layout.hpp"
+#include "core/layout_file.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace layout {
+
+/**
+ * @brief Decides which layer of a layout is shown.
+ *
+ * Every layer is built up front (widgets or painted caches), so a switch is
+ * only a call to the show callback, which flips what is already there.
+ *
+ * A momentary layer key shows its layer while held. If no other key was used
+ * while it was down (a tap, or any click with a mouse, which cannot hold it
+ * and press something else), the layer stays for one more key. A lock key
+ * toggles its layer on and off.
+ */
+class LayerSwitcher {
+public:
+  using ShowCallback = std::function<void(int layer)>;
+
+  explicit LayerSwitcher(ShowCallback showLayer);
+
+  /**
+   * @brief Hook the key callbacks of `elements` (built from `layout`).
+   *
+   * Call again after the elements were rebuilt or reloaded. The shown layer
+   * is kept if the layout still has it.
+   */
+  void bind(const LayoutSpec &layout, std::vector<Element> &elements);
+
+  // Lock `layer` as its lock key would (0 returns to the base layer).
+  // Returns false if the layout has no such layer.
+  bool lock(int layer);
+
+  [[nodiscard]] int current() const { return current_; }
+
+private:
+  void onLayerPressed(const KeySpec &spec);
+  void onLayerReleased(const KeySpec &spec);
+  void onKeyUsed();
+  void update();
+
+  ShowCallback showLayer_;
+  int layerCount_{1};
+  int current_{0};
+  int locked_{0};
+  int momentary_{-1}; // -1 while no momentary layer is active
+  bool used_{false};
+  bool oneShot_{false};
+};
+
+} // namespace layout
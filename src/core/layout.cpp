@@ -1,6 +1,7 @@
 #include "layout.hpp"
-#include <algorithm>
-#include <map>
+
+#include "core/geometry.hpp"
+#include "core/trace.hpp"
 
 #define DEFAULT_SIZE_STRETCH_MULTIPLIER 100
 
@@ -8,9 +9,12 @@ namespace layout {
 
 Element ElementBuilder::addKey(backend::Key key, int row, int column,
                                float widthAsUnit, float heightAsUnit,
-                               bool toggle, int holdThresholdMs) {
-  auto *btn = new ui::Widget::RightClickableToolButton(parent_);
-  auto input = std::make_unique<core::Input>(key, btn, backend_);
+                               bool toggle, int holdThresholdMs,
+                               const core::RepeatConfig &repeat,
+                               core::PressMode pressMode) {
+  auto *btn = createButtons_ ? new ui::Widget::RightClickableToolButton(parent_)
+                            : nullptr;
+  auto input = std::make_unique<core::Input>(key, btn, controller_);
   if (toggle) {
     input->setToggleMode(true);
   }
@@ -19,6 +23,8 @@ Element ElementBuilder::addKey(backend::Key key, int row, int column,
   // are treated as taps; holding beyond the threshold sends a single keyDown
   // when the threshold elapses and a keyUp on release.
   input->setHoldThresholdMs(holdThresholdMs);
+  input->setRepeatConfig(repeat);
+  input->setPressMode(pressMode);
 
   return Element(
       std::move(input),
@@ -26,60 +32,45 @@ Element ElementBuilder::addKey(backend::Key key, int row, int column,
       Element::Position{.row = row, .column = column});
 }
 
-QVBoxLayout *toQtLayout(const std::vector<Element> &elements) {
+QVBoxLayout *toQtLayout(const std::vector<Element> &elements, int layer) {
+  TYPR_TRACE_SPAN("layout", "toQtLayout");
+  const Geometry geometry(elements, layer);
+  const Metrics &metrics = geometry.metrics();
+
   auto mainLayout = std::make_unique<QVBoxLayout>();
-  mainLayout->setContentsMargins(4, 4, 4, 4);
-  mainLayout->setSpacing(4);
-
-  // Group element pointers by row index to avoid moving/copying Elements
-  // which might own unique_ptrs.
-  std::map<int, std::vector<const Element *>> rows;
-  for (const auto &element : elements) {
-    rows[element.row()].push_back(&element);
-  }
+  mainLayout->setContentsMargins(metrics.margin, metrics.margin,
+                                 metrics.margin, metrics.margin);
+  mainLayout->setSpacing(metrics.spacing);
 
-  // Iterate through sorted rows
-  for (auto &[rowIdx, rowElements] : rows) {
+  // The geometry already grouped the elements into rows in column order
+  for (const auto &row : geometry.rows()) {
     auto rowLayout = std::make_unique<QHBoxLayout>();
-    rowLayout->setSpacing(4);
-
-    // Sort element pointers within the row by their column index
-    std::ranges::sort(rowElements, [](const Element *lhs, const Element *rhs) {
-      return lhs->column() < rhs->column();
-    });
-
-    float maxRowHeightUnit = 0.0F;
-    for (const auto *element : rowElements) {
-      maxRowHeightUnit = std::max(maxRowHeightUnit, element->heightAsUnit());
-    }
-    if (maxRowHeightUnit <= 0.0F) {
-      maxRowHeightUnit = 1.0F;
-    }
+    rowLayout->setSpacing(metrics.spacing);
 
-    for (const auto *element : rowElements) {
-      auto *btn = element->input()->button();
+    for (std::size_t index = row.first; index < row.last; ++index) {
+      const Element &element = elements[geometry.order()[index]];
+      auto *btn = element.input()->button();
       if (btn != nullptr) {
         // Use stretch factors for proportional resizing.
         // We multiply by 100 to handle fractional units (e.g., 1.25, 1.5) as
         // integers.
-        int hStretch = static_cast<int>(element->widthAsUnit() * DEFAULT_SIZE_STRETCH_MULTIPLIER);
+        int hStretch = static_cast<int>(element.widthAsUnit() * DEFAULT_SIZE_STRETCH_MULTIPLIER);
 
         // Set policy to Expanding in both directions
         btn->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 
         // Set a minimum size based on units to prevent keys from collapsing
         // entirely
-        constexpr int baseUnit = 40;
         btn->setMinimumSize(
-            static_cast<int>(element->widthAsUnit() * baseUnit),
-            static_cast<int>(element->heightAsUnit() * baseUnit));
+            static_cast<int>(element.widthAsUnit() * metrics.baseUnit),
+            static_cast<int>(element.heightAsUnit() * metrics.baseUnit));
 
         rowLayout->addWidget(btn, hStretch);
       }
     }
 
     // Apply vertical stretch to the row layout
-    int vStretch = static_cast<int>(maxRowHeightUnit * DEFAULT_SIZE_STRETCH_MULTIPLIER);
+    int vStretch = static_cast<int>(row.heightUnits * DEFAULT_SIZE_STRETCH_MULTIPLIER);
     mainLayout->addLayout(rowLayout.release(), vStretch);
   }
 
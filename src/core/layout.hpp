@@ -7,6 +7,7 @@
 
 #include "../backend/backend.hpp"
 #include "core/input.hpp"
+#include "core/keyboard_controller.hpp"
 
 namespace layout {
 
@@ -25,6 +26,7 @@ public:
   struct Position {
     int row = 0;    ///< Logical row in the keyboard grid
     int column = 0; ///< Logical column in the keyboard grid
+    int layer = 0;  ///< Layer the key belongs to (0 = base layer)
   };
 
   /**
@@ -48,6 +50,11 @@ public:
   [[nodiscard]] float heightAsUnit() const { return size_.heightAsUnit; }
   [[nodiscard]] int row() const { return pos_.row; }
   [[nodiscard]] int column() const { return pos_.column; }
+  [[nodiscard]] int layer() const { return pos_.layer; }
+
+  // Used when a layout is reloaded in place
+  void setSize(Size size) { size_ = size; }
+  void setPosition(Position pos) { pos_ = pos; }
 
 private:
   std::unique_ptr<core::Input> input_;
@@ -62,9 +69,14 @@ private:
  */
 class ElementBuilder {
 public:
-  explicit ElementBuilder(backend::InputBackend *backend,
-                          QWidget *parent = nullptr)
-      : backend_(backend), parent_(parent) {}
+  /**
+   * @param createButtons When false no RightClickableToolButton is created;
+   * the keys are drawn and hit-tested by a single ui::KeyboardView instead.
+   */
+  explicit ElementBuilder(core::KeyboardController *controller,
+                          QWidget *parent = nullptr, bool createButtons = true)
+      : controller_(controller), parent_(parent),
+        createButtons_(createButtons) {}
 
   /**
    * @brief Creates a Layout::Element.
@@ -76,16 +88,23 @@ public:
    * @param toggle Whether the key is in toggle mode.
    * @param holdThresholdMs How many milliseconds the user must hold the
    * button before it is considered held and a keyDown is sent (default: 300).
+   * @param repeat Software repeat settings, used when the backend has no
+   * native key repeat.
+   * @param pressMode Immediate injects keyDown on press for the lowest tap
+   * latency; Deferred (default) waits for release or the hold threshold.
    * @return A constructed Layout::Element.
    */
-  [[nodiscard]] Element addKey(backend::Key key, int row, int column,
-                               float widthAsUnit = 1.0F,
-                               float heightAsUnit = 1.0F, bool toggle = false,
-                               int holdThresholdMs = DEFAULT_HOLD_THRESHOLD);
+  [[nodiscard]] Element
+  addKey(backend::Key key, int row, int column, float widthAsUnit = 1.0F,
+         float heightAsUnit = 1.0F, bool toggle = false,
+         int holdThresholdMs = DEFAULT_HOLD_THRESHOLD,
+         const core::RepeatConfig &repeat = {},
+         core::PressMode pressMode = core::PressMode::Deferred);
 
 private:
-  backend::InputBackend *backend_;
+  core::KeyboardController *controller_;
   QWidget *parent_;
+  bool createButtons_;
 };
 
 /**
@@ -93,9 +112,10 @@ private:
  */
 class ElementListBuilder {
 public:
-  explicit ElementListBuilder(backend::InputBackend *backend,
-                              QWidget *parent = nullptr)
-      : builder_(backend, parent) {}
+  explicit ElementListBuilder(core::KeyboardController *controller,
+                              QWidget *parent = nullptr,
+                              bool createButtons = true)
+      : builder_(controller, parent, createButtons) {}
 
   /**
    * @brief Adds a key to the current row and advances the column.
@@ -106,22 +126,28 @@ public:
    *
    * @param holdThresholdMs How many milliseconds the user must hold the
    * button before the key is considered held (default: 300).
+   * @param repeat Software repeat settings (see core::RepeatConfig).
+   * @param pressMode When the key is injected (see core::PressMode).
    */
   void addKey(backend::Key key, float widthAsUnit = 1.0F,
               float heightAsUnit = 1.0F, bool toggle = false,
-              int holdThresholdMs = DEFAULT_HOLD_THRESHOLD) {
+              int holdThresholdMs = DEFAULT_HOLD_THRESHOLD,
+              const core::RepeatConfig &repeat = {},
+              core::PressMode pressMode = core::PressMode::Deferred) {
     elements_.push_back(builder_.addKey(key, currentRow_, currentCol_++,
                                         widthAsUnit, heightAsUnit, toggle,
-                                        holdThresholdMs));
+                                        holdThresholdMs, repeat, pressMode));
   }
 
   // Convenience overload: allow passing 'toggle' as the third parameter
   // (e.g., addKey(key, width, true) to make the key toggle on click).
   void addKey(backend::Key key, float widthAsUnit, bool toggle,
-              int holdThresholdMs = DEFAULT_HOLD_THRESHOLD) {
+              int holdThresholdMs = DEFAULT_HOLD_THRESHOLD,
+              const core::RepeatConfig &repeat = {},
+              core::PressMode pressMode = core::PressMode::Deferred) {
     elements_.push_back(builder_.addKey(key, currentRow_, currentCol_++,
                                         widthAsUnit, 1.0F, toggle,
-                                        holdThresholdMs));
+                                        holdThresholdMs, repeat, pressMode));
   }
 
   /**
@@ -151,9 +177,10 @@ private:
  * rows within a main vertical layout.
  *
  * @param elements The elements to organize.
+ * @param layer Only the elements of this layer are laid out.
  * @return A pointer to a new QVBoxLayout. The caller or a parent widget takes
  * ownership of the layout.
  */
-QVBoxLayout *toQtLayout(const std::vector<Element> &elements);
+QVBoxLayout *toQtLayout(const std::vector<Element> &elements, int layer = 0);
 
 } // namespace layout
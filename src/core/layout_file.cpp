@@ -0,0 +1,720 @@
+#include "layout_file.hpp"
+
+#include "core/log.hpp"
+#include "core/trace.hpp"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <type_traits>
+
+namespace layout {
+
+namespace {
+
+// --- Binary cache format ---------------------------------------------------
+//
+// Header, then `count` fixed-size key records, then the layer names as
+// `namesSize` bytes of NUL-terminated strings, then `macroCount` compiled
+// macros in `macrosSize` bytes (see writeMacros). The cache only ever lives
+// on the machine that wrote it, so native endianness and float layout are
+// fine.
+
+constexpr char kCacheMagic[8] = {'T', 'Y', 'P', 'R', 'L', 'Y', 'T', '\0'};
+constexpr uint32_t kCacheVersion = 4;
+
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  int64_t sourceSize;
+  int64_t sourceMtimeMs;
+  uint32_t layerCount;
+  uint32_t namesSize;
+  uint32_t macroCount;
+  uint32_t macrosSize;
+};
+
+enum CachedFlag : uint8_t {
+  CachedToggle = 0x01,
+  CachedImmediate = 0x02,
+  CachedRepeat = 0x04,
+  CachedRecord = 0x08,
+};
+
+struct CachedKey {
+  uint8_t key;
+  uint8_t flags;
+  uint8_t layerAction;
+  uint8_t reserved;
+  int32_t row;
+  int32_t column;
+  float widthAsUnit;
+  float heightAsUnit;
+  int32_t holdThresholdMs;
+  int32_t repeatDelayMs;
+  int32_t repeatIntervalMs;
+  int32_t repeatMinIntervalMs;
+  float repeatAcceleration;
+  int32_t layer;
+  int32_t layerTarget;
+  int32_t macro;
+};
+
+static_assert(std::is_trivially_copyable_v<CacheHeader>);
+static_assert(std::is_trivially_copyable_v<CachedKey>);
+static_assert(sizeof(CacheHeader) == 48);
+static_assert(sizeof(CachedKey) == 52);
+
+CachedKey toCached(const KeySpec &spec) {
+  uint8_t flags = 0;
+  flags |= spec.toggle ? CachedToggle : 0;
+  flags |= spec.pressMode == core::PressMode::Immediate ? CachedImmediate : 0;
+  flags |= spec.repeat.enabled ? CachedRepeat : 0;
+  flags |= spec.recordMacro ? CachedRecord : 0;
+  return CachedKey{
+      .key = static_cast<uint8_t>(spec.key),
+      .flags = flags,
+      .layerAction = static_cast<uint8_t>(spec.layerAction),
+      .reserved = 0,
+      .row = spec.row,
+      .column = spec.column,
+      .widthAsUnit = spec.widthAsUnit,
+      .heightAsUnit = spec.heightAsUnit,
+      .holdThresholdMs = spec.holdThresholdMs,
+      .repeatDelayMs = spec.repeat.initialDelayMs,
+      .repeatIntervalMs = spec.repeat.intervalMs,
+      .repeatMinIntervalMs = spec.repeat.minIntervalMs,
+      .repeatAcceleration = spec.repeat.acceleration,
+      .layer = spec.layer,
+      .layerTarget = spec.layerTarget,
+      .macro = spec.macro,
+  };
+}
+
+KeySpec fromCached(const CachedKey &cached) {
+  return KeySpec{
+      .key = static_cast<backend::Key>(cached.key),
+      .row = cached.row,
+      .column = cached.column,
+      .widthAsUnit = cached.widthAsUnit,
+      .heightAsUnit = cached.heightAsUnit,
+      .toggle = (cached.flags & CachedToggle) != 0,
+      .holdThresholdMs = cached.holdThresholdMs,
+      .repeat =
+          core::RepeatConfig{
+              .enabled = (cached.flags & CachedRepeat) != 0,
+              .initialDelayMs = cached.repeatDelayMs,
+              .intervalMs = cached.repeatIntervalMs,
+              .minIntervalMs = cached.repeatMinIntervalMs,
+              .acceleration = cached.repeatAcceleration,
+          },
+      .pressMode = (cached.flags & CachedImmediate) != 0
+                       ? core::PressMode::Immediate
+                       : core::PressMode::Deferred,
+      .layer = cached.layer,
+      .layerAction = static_cast<LayerAction>(cached.layerAction),
+      .layerTarget = cached.layerTarget,
+      .macro = cached.macro,
+      .recordMacro = (cached.flags & CachedRecord) != 0,
+  };
+}
+
+// Macros follow each other as: u32 name size, name, u32 code size, code,
+// u32 text count, then per text a u32 length and its UTF-32 code units.
+void appendU32(QByteArray &bytes, uint32_t value) {
+  bytes.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+QByteArray writeMacros(const std::vector<core::Macro> &macros) {
+  QByteArray bytes;
+  for (const auto &macro : macros) {
+    appendU32(bytes, static_cast<uint32_t>(macro.name.size()));
+    bytes.append(macro.name.data(), static_cast<qsizetype>(macro.name.size()));
+    appendU32(bytes, static_cast<uint32_t>(macro.code.size()));
+    bytes.append(reinterpret_cast<const char *>(macro.code.data()),
+                 static_cast<qsizetype>(macro.code.size()));
+    appendU32(bytes, static_cast<uint32_t>(macro.texts.size()));
+    for (const auto &text : macro.texts) {
+      appendU32(bytes, static_cast<uint32_t>(text.size()));
+      bytes.append(reinterpret_cast<const char *>(text.data()),
+                   static_cast<qsizetype>(text.size() * sizeof(char32_t)));
+    }
+  }
+  return bytes;
+}
+
+bool readMacros(std::string_view bytes, uint32_t count,
+                std::vector<core::Macro> &macros) {
+  const auto take = [&bytes](std::size_t size, std::string_view &out) {
+    if (bytes.size() < size) {
+      return false;
+    }
+    out = bytes.substr(0, size);
+    bytes.remove_prefix(size);
+    return true;
+  };
+  const auto takeU32 = [&take](uint32_t &value) {
+    std::string_view raw;
+    if (!take(sizeof(value), raw)) {
+      return false;
+    }
+    std::memcpy(&value, raw.data(), sizeof(value));
+    return true;
+  };
+
+  // Each macro takes at least its three sizes
+  if (count > bytes.size() / (3 * sizeof(uint32_t))) {
+    return false;
+  }
+  macros.reserve(count);
+  for (uint32_t index = 0; index < count; ++index) {
+    core::Macro &macro = macros.emplace_back();
+    uint32_t size = 0;
+    std::string_view raw;
+    if (!takeU32(size) || !take(size, raw)) {
+      return false;
+    }
+    macro.name = raw;
+    if (!takeU32(size) || !take(size, raw)) {
+      return false;
+    }
+    macro.code.assign(raw.begin(), raw.end());
+    uint32_t texts = 0;
+    if (!takeU32(texts)) {
+      return false;
+    }
+    for (uint32_t text = 0; text < texts; ++text) {
+      if (!takeU32(size) || !take(size * sizeof(char32_t), raw)) {
+        return false;
+      }
+      std::u32string &out = macro.texts.emplace_back(size, U'\0');
+      std::memcpy(out.data(), raw.data(), raw.size());
+    }
+    if (!core::isValidMacro(macro)) {
+      return false;
+    }
+  }
+  return bytes.empty();
+}
+
+// Whether a cached key only refers to what the cache holds: a key value, a
+// layer action, and layer and macro indices in range. Anything else is a
+// cache from another build or a damaged one.
+bool isConsistent(const CachedKey &cached, uint32_t layerCount,
+                  uint32_t macroCount) {
+  const auto key = static_cast<backend::Key>(cached.key);
+  const bool knownKey =
+      key == backend::Key::Unknown || backend::keyName(key) != "Unknown";
+  const auto layers = static_cast<int64_t>(layerCount);
+  return knownKey &&
+         cached.layerAction <= static_cast<uint8_t>(LayerAction::Lock) &&
+         cached.layer >= 0 && cached.layer < layers &&
+         cached.layerTarget >= 0 && cached.layerTarget < layers &&
+         cached.macro >= -1 &&
+         cached.macro < static_cast<int64_t>(macroCount);
+}
+
+QString cachePathFor(const QFileInfo &source) {
+  const QByteArray digest =
+      QCryptographicHash::hash(source.absoluteFilePath().toUtf8(),
+                               QCryptographicHash::Sha1)
+          .toHex();
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+         "/layouts/" + QString::fromLatin1(digest) + ".bin";
+}
+
+std::optional<LayoutSpec> readCache(const QString &cachePath,
+                                    const QFileInfo &source) {
+  QFile file(cachePath);
+  if (!file.open(QIODevice::ReadOnly) ||
+      file.size() < static_cast<qint64>(sizeof(CacheHeader))) {
+    return std::nullopt;
+  }
+
+  const uchar *data = file.map(0, file.size());
+  if (data == nullptr) {
+    return std::nullopt;
+  }
+
+  CacheHeader header{};
+  std::memcpy(&header, data, sizeof(header));
+  const std::size_t keysSize =
+      static_cast<std::size_t>(header.count) * sizeof(CachedKey);
+  const auto expectedSize =
+      static_cast<qint64>(sizeof(CacheHeader) + keysSize + header.namesSize +
+                          header.macrosSize);
+  if (std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 ||
+      header.version != kCacheVersion || file.size() != expectedSize ||
+      header.sourceSize != source.size() ||
+      header.sourceMtimeMs != source.lastModified().toMSecsSinceEpoch()) {
+    return std::nullopt;
+  }
+
+  LayoutSpec layout;
+  layout.keys.reserve(header.count);
+  const uchar *cursor = data + sizeof(CacheHeader);
+  for (uint32_t index = 0; index < header.count; ++index) {
+    CachedKey cached{};
+    std::memcpy(&cached, cursor, sizeof(cached));
+    // The counts themselves are checked against what is decoded below
+    if (!isConsistent(cached, header.layerCount, header.macroCount)) {
+      return std::nullopt;
+    }
+    layout.keys.push_back(fromCached(cached));
+    cursor += sizeof(CachedKey);
+  }
+
+  const auto *names = reinterpret_cast<const char *>(cursor);
+  std::string_view remaining(names, header.namesSize);
+  while (!remaining.empty()) {
+    const std::size_t end = remaining.find('\0');
+    if (end == std::string_view::npos) {
+      return std::nullopt;
+    }
+    layout.layers.emplace_back(remaining.substr(0, end));
+    remaining.remove_prefix(end + 1);
+  }
+  if (layout.layers.size() != header.layerCount) {
+    return std::nullopt;
+  }
+
+  const std::string_view macros(names + header.namesSize, header.macrosSize);
+  if (!readMacros(macros, header.macroCount, layout.macros)) {
+    return std::nullopt;
+  }
+  return layout;
+}
+
+void writeCache(const QString &cachePath, const QFileInfo &source,
+                const LayoutSpec &layout) {
+  QDir().mkpath(QFileInfo(cachePath).absolutePath());
+
+  CacheHeader header{};
+  std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+  header.version = kCacheVersion;
+  header.count = static_cast<uint32_t>(layout.keys.size());
+  header.sourceSize = source.size();
+  header.sourceMtimeMs = source.lastModified().toMSecsSinceEpoch();
+  header.layerCount = static_cast<uint32_t>(layout.layers.size());
+
+  QByteArray names;
+  for (const auto &name : layout.layers) {
+    names.append(name.data(), static_cast<qsizetype>(name.size()));
+    names.append('\0');
+  }
+  header.namesSize = static_cast<uint32_t>(names.size());
+  const QByteArray macros = writeMacros(layout.macros);
+  header.macroCount = static_cast<uint32_t>(layout.macros.size());
+  header.macrosSize = static_cast<uint32_t>(macros.size());
+
+  QByteArray bytes;
+  bytes.reserve(static_cast<qsizetype>(
+      sizeof(CacheHeader) + (layout.keys.size() * sizeof(CachedKey)) +
+      static_cast<std::size_t>(names.size() + macros.size())));
+  bytes.append(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (const auto &spec : layout.keys) {
+    const CachedKey cached = toCached(spec);
+    bytes.append(reinterpret_cast<const char *>(&cached), sizeof(cached));
+  }
+  bytes.append(names);
+  bytes.append(macros);
+
+  // QSaveFile renames into place, so a concurrent launch never maps a
+  // half-written cache.
+  QSaveFile file(cachePath);
+  if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size() ||
+      !file.commit()) {
+    qWarning() << "[layout] Could not write layout cache" << cachePath;
+  }
+}
+
+// --- Text parser ------------------------------------------------------------
+
+bool isSpace(char character) {
+  return character == ' ' || character == '\t' || character == '\r';
+}
+
+template <typename T> bool parseNumber(std::string_view text, T &out) {
+  const auto *end = text.data() + text.size();
+  auto [ptr, ec] = std::from_chars(text.data(), end, out);
+  return ec == std::errc() && ptr == end;
+}
+
+bool parseRepeat(std::string_view value, core::RepeatConfig &repeat) {
+  if (value == "off") {
+    repeat.enabled = false;
+    return true;
+  }
+  repeat.enabled = true;
+
+  int field = 0;
+  while (!value.empty()) {
+    const std::size_t slash = value.find('/');
+    const std::string_view part = value.substr(0, slash);
+    bool parsed = false;
+    switch (field++) {
+    case 0:
+      parsed = parseNumber(part, repeat.initialDelayMs);
+      break;
+    case 1:
+      parsed = parseNumber(part, repeat.intervalMs);
+      repeat.minIntervalMs = repeat.intervalMs;
+      break;
+    case 2:
+      parsed = parseNumber(part, repeat.minIntervalMs);
+      break;
+    case 3:
+      parsed = parseNumber(part, repeat.acceleration);
+      break;
+    default:
+      break;
+    }
+    if (!parsed) {
+      return false;
+    }
+    value = slash == std::string_view::npos ? std::string_view()
+                                            : value.substr(slash + 1);
+  }
+  return true;
+}
+
+// Parse one "Name:attr:attr" (or "@layer:attr", "*macro:attr") token. Layer
+// and macro keys get the name of the layer or macro they refer to in
+// `target`. Returns an error message, or an empty string on success.
+std::string parseKey(std::string_view token, KeySpec &spec,
+                     std::string &target) {
+  std::size_t colon = token.find(':');
+  const std::string name(token.substr(0, colon));
+  const bool layerKey = name.size() > 1 && name.front() == '@';
+  const bool macroKey = name.size() > 1 && name.front() == '*';
+  if (layerKey || macroKey) {
+    // Layer and macro keys inject nothing themselves, and act on press and
+    // release directly.
+    target = name.substr(1);
+    spec.key = backend::Key::Unknown;
+    spec.layerAction = layerKey ? LayerAction::Momentary : LayerAction::None;
+    spec.holdThresholdMs = 0;
+    spec.repeat.enabled = false;
+  } else {
+    spec.key = backend::stringToKey(name);
+    if (spec.key == backend::Key::Unknown) {
+      return "unknown key '" + name + "'";
+    }
+  }
+
+  while (colon != std::string_view::npos) {
+    token = token.substr(colon + 1);
+    colon = token.find(':');
+    const std::string_view attribute = token.substr(0, colon);
+    const std::size_t equals = attribute.find('=');
+    const std::string_view attrName = attribute.substr(0, equals);
+    const std::string_view value = equals == std::string_view::npos
+                                       ? std::string_view()
+                                       : attribute.substr(equals + 1);
+
+    bool parsed = false;
+    if (attrName == "w") {
+      parsed = parseNumber(value, spec.widthAsUnit) && spec.widthAsUnit > 0.0F;
+    } else if (attrName == "h") {
+      parsed =
+          parseNumber(value, spec.heightAsUnit) && spec.heightAsUnit > 0.0F;
+    } else if (macroKey) {
+      if (attrName == "record") {
+        spec.recordMacro = true;
+        parsed = value.empty();
+      }
+    } else if (layerKey) {
+      if (attrName == "lock") {
+        spec.layerAction = LayerAction::Lock;
+        parsed = value.empty();
+      }
+    } else if (attrName == "toggle") {
+      spec.toggle = true;
+      parsed = value.empty();
+    } else if (attrName == "hold") {
+      parsed = parseNumber(value, spec.holdThresholdMs) &&
+               spec.holdThresholdMs >= 0;
+    } else if (attrName == "mode") {
+      parsed = value == "immediate" || value == "deferred";
+      spec.pressMode = value == "immediate" ? core::PressMode::Immediate
+                                            : core::PressMode::Deferred;
+    } else if (attrName == "repeat") {
+      parsed = parseRepeat(value, spec.repeat);
+    }
+    if (!parsed) {
+      return "bad attribute '" + std::string(attribute) + "' on key '" + name +
+             "'";
+    }
+  }
+  return {};
+}
+
+std::string_view trimmed(std::string_view text) {
+  while (!text.empty() && isSpace(text.front())) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && isSpace(text.back())) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+} // namespace
+
+bool KeySpec::operator==(const KeySpec &other) const {
+  return key == other.key && row == other.row && column == other.column &&
+         widthAsUnit == other.widthAsUnit &&
+         heightAsUnit == other.heightAsUnit && toggle == other.toggle &&
+         holdThresholdMs == other.holdThresholdMs &&
+         repeat.enabled == other.repeat.enabled &&
+         repeat.initialDelayMs == other.repeat.initialDelayMs &&
+         repeat.intervalMs == other.repeat.intervalMs &&
+         repeat.minIntervalMs == other.repeat.minIntervalMs &&
+         repeat.acceleration == other.repeat.acceleration &&
+         pressMode == other.pressMode && layer == other.layer &&
+         layerAction == other.layerAction &&
+         layerTarget == other.layerTarget && macro == other.macro &&
+         recordMacro == other.recordMacro;
+}
+
+std::optional<LayoutSpec> parseLayout(std::string_view text,
+                                      std::string &error) {
+  TYPR_TRACE_SPAN("layout", "parseLayout");
+  struct PendingTarget {
+    std::size_t key;
+    std::string name; // of a layer, or of a macro for macro keys
+    int line;
+  };
+
+  LayoutSpec layout;
+  layout.layers.emplace_back("base");
+  std::vector<PendingTarget> pendingTargets;
+  std::vector<PendingTarget> pendingMacros;
+  int lineNumber = 0;
+  int row = 0;
+
+  while (!text.empty()) {
+    const std::size_t newline = text.find('\n');
+    std::string_view line = text.substr(0, newline);
+    text = newline == std::string_view::npos ? std::string_view()
+                                             : text.substr(newline + 1);
+    ++lineNumber;
+
+    // "macro name steps..." defines a macro. Its text may contain '#', so the
+    // steps strip their own comments.
+    if (std::string_view definition = trimmed(line);
+        definition.starts_with("macro") && definition.size() > 5 &&
+        isSpace(definition[5])) {
+      definition = trimmed(definition.substr(5));
+      std::size_t nameEnd = 0;
+      while (nameEnd < definition.size() && !isSpace(definition[nameEnd])) {
+        ++nameEnd;
+      }
+      std::string name(definition.substr(0, nameEnd));
+      if (name.find(':') != std::string::npos) {
+        error = "line " + std::to_string(lineNumber) + ": bad macro name '" +
+                name + "'";
+        return std::nullopt;
+      }
+      if (std::ranges::find(layout.macros, name, &core::Macro::name) !=
+          layout.macros.end()) {
+        error = "line " + std::to_string(lineNumber) + ": duplicate macro '" +
+                name + "'";
+        return std::nullopt;
+      }
+      std::string message;
+      auto macro = core::compileMacro(std::move(name),
+                                      definition.substr(nameEnd), message);
+      if (!macro) {
+        error = "line " + std::to_string(lineNumber) + ": " + message;
+        return std::nullopt;
+      }
+      layout.macros.push_back(std::move(*macro));
+      continue;
+    }
+
+    if (const std::size_t comment = line.find('#');
+        comment != std::string_view::npos) {
+      line = line.substr(0, comment);
+    }
+
+    // "[name]" starts a new layer
+    if (const std::string_view header = trimmed(line);
+        header.size() > 2 && header.front() == '[' && header.back() == ']') {
+      std::string name(header.substr(1, header.size() - 2));
+      if (std::ranges::find(layout.layers, name) != layout.layers.end()) {
+        error = "line " + std::to_string(lineNumber) + ": duplicate layer '" +
+                name + "'";
+        return std::nullopt;
+      }
+      layout.layers.push_back(std::move(name));
+      row = 0;
+      continue;
+    }
+
+    int column = 0;
+    while (!line.empty()) {
+      std::size_t start = 0;
+      while (start < line.size() && isSpace(line[start])) {
+        ++start;
+      }
+      std::size_t end = start;
+      while (end < line.size() && !isSpace(line[end])) {
+        ++end;
+      }
+      const std::string_view token = line.substr(start, end - start);
+      line = line.substr(end);
+      if (token.empty()) {
+        continue;
+      }
+
+      KeySpec spec;
+      spec.row = row;
+      spec.column = column++;
+      spec.layer = static_cast<int>(layout.layers.size() - 1);
+      std::string target;
+      if (std::string message = parseKey(token, spec, target);
+          !message.empty()) {
+        error = "line " + std::to_string(lineNumber) + ": " + message;
+        return std::nullopt;
+      }
+      // Layers and macros may be referenced before they are defined
+      if (spec.layerAction != LayerAction::None) {
+        pendingTargets.push_back(PendingTarget{.key = layout.keys.size(),
+                                               .name = std::move(target),
+                                               .line = lineNumber});
+      } else if (!target.empty()) {
+        pendingMacros.push_back(PendingTarget{.key = layout.keys.size(),
+                                              .name = std::move(target),
+                                              .line = lineNumber});
+      }
+      layout.keys.push_back(spec);
+    }
+
+    // Blank and comment-only lines do not start a row
+    if (column > 0) {
+      ++row;
+    }
+  }
+
+  for (const auto &pending : pendingTargets) {
+    const auto found = std::ranges::find(layout.layers, pending.name);
+    if (found == layout.layers.end()) {
+      error = "line " + std::to_string(pending.line) + ": unknown layer '" +
+              pending.name + "'";
+      return std::nullopt;
+    }
+    layout.keys[pending.key].layerTarget =
+        static_cast<int>(found - layout.layers.begin());
+  }
+  for (const auto &pending : pendingMacros) {
+    const auto found =
+        std::ranges::find(layout.macros, pending.name, &core::Macro::name);
+    if (found == layout.macros.end()) {
+      error = "line " + std::to_string(pending.line) + ": unknown macro '" +
+              pending.name + "'";
+      return std::nullopt;
+    }
+    layout.keys[pending.key].macro =
+        static_cast<int>(found - layout.macros.begin());
+  }
+
+  if (layout.keys.empty()) {
+    error = "layout has no keys";
+    return std::nullopt;
+  }
+  return layout;
+}
+
+std::optional<LayoutSpec> loadLayoutFile(const QString &path) {
+  TYPR_TRACE_SPAN("layout", "loadLayoutFile");
+  const QFileInfo source(path);
+  if (!source.exists()) {
+    qWarning() << "[layout] Layout file not found:" << path;
+    return std::nullopt;
+  }
+
+  const QString cachePath = cachePathFor(source);
+  if (auto cached = readCache(cachePath, source)) {
+    TYPR_LOG_DEBUG("layout", "loaded {} keys on {} layers from layout cache",
+                   cached->keys.size(), cached->layers.size());
+    return cached;
+  }
+
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    qWarning() << "[layout] Cannot read layout file:" << path;
+    return std::nullopt;
+  }
+  const QByteArray text = file.readAll();
+
+  std::string error;
+  auto layout = parseLayout(
+      std::string_view(text.constData(), static_cast<std::size_t>(text.size())),
+      error);
+  if (!layout) {
+    qWarning() << "[layout]" << path << QString::fromStdString(error);
+    return std::nullopt;
+  }
+
+  TYPR_LOG_DEBUG("layout", "parsed {} keys, refreshing layout cache",
+                 layout->keys.size());
+  writeCache(cachePath, source, *layout);
+  return layout;
+}
+
+Element buildElement(ElementBuilder &builder, const KeySpec &spec,
+                     const LayoutSpec &layout) {
+  Element element = builder.addKey(
+      spec.key, spec.row, spec.column, spec.widthAsUnit, spec.heightAsUnit,
+      spec.toggle, spec.holdThresholdMs, spec.repeat, spec.pressMode);
+  configureElement(element, spec, layout);
+  return element;
+}
+
+void configureElement(Element &element, const KeySpec &spec,
+                      const LayoutSpec &layout) {
+  core::Input *input = element.input();
+  input->setToggleMode(spec.toggle);
+  input->setHoldThresholdMs(spec.holdThresholdMs);
+  input->setRepeatConfig(spec.repeat);
+  input->setPressMode(spec.pressMode);
+  if (spec.layerAction != LayerAction::None) {
+    input->setLabel(QString::fromStdString(
+        layout.layers[static_cast<std::size_t>(spec.layerTarget)]));
+  } else if (spec.macro >= 0) {
+    const QString name = QString::fromStdString(
+        layout.macros[static_cast<std::size_t>(spec.macro)].name);
+    input->setLabel(spec.recordMacro ? "Rec " + name : name);
+  } else {
+    input->setLabel(QString::fromUtf8(backend::keyName(spec.key)));
+  }
+
+  element.setSize(Element::Size{.widthAsUnit = spec.widthAsUnit,
+                                .heightAsUnit = spec.heightAsUnit});
+  element.setPosition(Element::Position{
+      .row = spec.row, .column = spec.column, .layer = spec.layer});
+}
+
+std::vector<Element> buildElements(const LayoutSpec &layout,
+                                   core::KeyboardController *controller,
+                                   QWidget *parent, bool createButtons) {
+  TYPR_TRACE_SPAN("layout", "buildElements");
+  ElementBuilder builder(controller, parent, createButtons);
+  std::vector<Element> elements;
+  elements.reserve(layout.keys.size());
+  for (const auto &spec : layout.keys) {
+    elements.push_back(buildElement(builder, spec, layout));
+  }
+  return elements;
+}
+
+} // namespace layout
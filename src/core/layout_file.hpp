@@ -0,0 +1,128 @@
+#pragma once
+
+#include "backend/backend.hpp"
+#include "core/keyboard_controller.hpp"
+#include "core/layout.hpp"
+#include "core/macro.hpp"
+
+#include <QString>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class QWidget;
+
+namespace layout {
+
+/**
+ * @brief What a layer key does when pressed.
+ *
+ * Momentary: the target layer is shown while the key is held. Released on its
+ * own (a tap, or the only way with a mouse), it stays for the next key only.
+ * Lock: each tap switches to the target layer or back to the base layer.
+ */
+enum class LayerAction : uint8_t { None, Momentary, Lock };
+
+/**
+ * @brief One key of a declarative layout: everything ElementBuilder::addKey()
+ * takes, as plain data.
+ */
+struct KeySpec {
+  backend::Key key{backend::Key::Unknown};
+  int row{0};
+  int column{0};
+  float widthAsUnit{1.0F};
+  float heightAsUnit{1.0F};
+  bool toggle{false};
+  int holdThresholdMs{DEFAULT_HOLD_THRESHOLD};
+  core::RepeatConfig repeat{};
+  core::PressMode pressMode{core::PressMode::Deferred};
+  int layer{0}; ///< Layer the key is on
+  LayerAction layerAction{LayerAction::None};
+  int layerTarget{0};      ///< Layer a layer key switches to
+  int macro{-1};           ///< Macro a macro key plays (index into macros)
+  bool recordMacro{false}; ///< The macro key records `macro` instead
+
+  bool operator==(const KeySpec &other) const;
+};
+
+/**
+ * @brief A parsed layout: its layers (index 0 is the base layer), the keys
+ * of every layer in row-major order and its compiled macros.
+ */
+struct LayoutSpec {
+  std::vector<std::string> layers;
+  std::vector<KeySpec> keys;
+  std::vector<core::Macro> macros;
+
+  bool operator==(const LayoutSpec &other) const = default;
+};
+
+/**
+ * @brief Parse the text layout format.
+ *
+ * Every non-empty line is a row of whitespace-separated keys; '#' starts a
+ * comment. A key is its name (as accepted by backend::stringToKey) followed by
+ * optional ':'-separated attributes:
+ *
+ *   w=1.5              width in units (default 1)
+ *   h=1                height in units (default 1)
+ *   toggle             toggle key (stays down until pressed again)
+ *   hold=300           hold threshold in milliseconds
+ *   mode=immediate     press mode: immediate or deferred (default)
+ *   repeat=off         no software repeat
+ *   repeat=200/60/16/0.9
+ *                      software repeat: delay / interval / min interval /
+ *                      acceleration (trailing fields may be omitted)
+ *
+ * e.g. "Tab:w=1.5 Q W E" or "ShiftLeft:w=2.5:toggle".
+ *
+ * A "[name]" line starts a new layer; keys before the first one are on the
+ * base layer. "@name" is a key that switches to layer `name` while held
+ * (LayerAction::Momentary), "@name:lock" one that latches it
+ * (LayerAction::Lock); both take the w / h attributes.
+ *
+ * A "macro name steps..." line defines a macro (steps as in
+ * core::compileMacro) and "*name" is a key that plays it, also with w / h.
+ * "*name:record" records it instead: tapped once it starts recording the keys
+ * pressed, tapped again it replaces the macro with the recording (see
+ * core::MacroRecorder). Macros are compiled here, so a broken one fails the
+ * whole layout.
+ *
+ * @return The layout, or nullopt with a message naming the offending line in
+ * `error`.
+ */
+std::optional<LayoutSpec> parseLayout(std::string_view text,
+                                      std::string &error);
+
+/**
+ * @brief Load a layout file.
+ *
+ * The parsed layout is stored in a binary cache (under the user cache
+ * directory) keyed by the file's path and validated against its size and
+ * modification time. When the cache is valid it is memory-mapped and read
+ * directly, so the text is only parsed again after the file changes.
+ */
+std::optional<LayoutSpec> loadLayoutFile(const QString &path);
+
+/**
+ * @brief Build one Element from its spec, registering the key with the
+ * controller.
+ */
+Element buildElement(ElementBuilder &builder, const KeySpec &spec,
+                     const LayoutSpec &layout);
+
+// Apply a spec to an existing Element (used when a layout is reloaded)
+void configureElement(Element &element, const KeySpec &spec,
+                      const LayoutSpec &layout);
+
+/**
+ * @brief Build the Elements of every layer of a layout.
+ */
+std::vector<Element> buildElements(const LayoutSpec &layout,
+                                   core::KeyboardController *controller,
+                                   QWidget *parent = nullptr,
+                                   bool createButtons = true);
+
+} // namespace layout
@@ -0,0 +1,145 @@
+#include "layout_reloader.hpp"
+
+#include "core/log.hpp"
+#include "core/trace.hpp"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <array>
+#include <optional>
+
+namespace layout {
+
+namespace {
+
+// Editors often write a file in several steps (truncate, write, rename), so
+// changes are coalesced before the file is read.
+constexpr int kDebounceMs = 100;
+
+} // namespace
+
+LayoutReloader::LayoutReloader(QString path, LayoutSpec layout,
+                               std::vector<Element> *elements,
+                               core::KeyboardController *controller,
+                               QWidget *parent, bool createButtons,
+                               ChangedCallback onChanged)
+    : QObject(parent), path_(std::move(path)), layout_(std::move(layout)),
+      elements_(elements), builder_(controller, parent, createButtons),
+      onChanged_(std::move(onChanged)) {
+  debounce_.setSingleShot(true);
+  debounce_.setInterval(kDebounceMs);
+  connect(&debounce_, &QTimer::timeout, this, [this]() { reload(); });
+  connect(&watcher_, &QFileSystemWatcher::fileChanged, this,
+          [this]() { debounce_.start(); });
+  // Saving through a rename replaces the inode; the directory watch catches
+  // the new file appearing.
+  connect(&watcher_, &QFileSystemWatcher::directoryChanged, this,
+          [this]() { debounce_.start(); });
+  watch();
+}
+
+void LayoutReloader::watch() {
+  // A replaced file drops out of the watch list, so re-add it every time
+  if (!watcher_.files().contains(path_) && QFileInfo::exists(path_)) {
+    watcher_.addPath(path_);
+  }
+  const QString directory = QFileInfo(path_).absolutePath();
+  if (!watcher_.directories().contains(directory)) {
+    watcher_.addPath(directory);
+  }
+}
+
+void LayoutReloader::reload() {
+  TYPR_TRACE_SPAN("layout", "LayoutReloader::reload");
+  watch();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  auto layout = loadLayoutFile(path_);
+  if (!layout) {
+    // Keep the current keyboard while the file is broken mid-edit
+    return;
+  }
+  if (*layout == layout_) {
+    return;
+  }
+
+  const DiffStats stats = applyDiff(layout_, *layout, *elements_, builder_);
+  layout_ = std::move(*layout);
+  if (onChanged_) {
+    onChanged_(layout_);
+  }
+
+  TYPR_LOG_INFO("layout",
+                "reloaded in {} us: {} kept, {} reconfigured, {} added, {} "
+                "removed",
+                timer.nsecsElapsed() / 1000, stats.kept, stats.reconfigured,
+                stats.added, stats.removed);
+  qDebug() << "[layout] Reloaded" << path_;
+}
+
+LayoutReloader::DiffStats
+LayoutReloader::applyDiff(const LayoutSpec &oldLayout,
+                          const LayoutSpec &newLayout,
+                          std::vector<Element> &elements,
+                          ElementBuilder &builder) {
+  DiffStats stats;
+
+  // Old element indices per key, in layout order. Key is a uint8_t enum, so a
+  // flat table beats hashing.
+  std::array<std::vector<std::size_t>, 256> oldByKey;
+  const std::vector<KeySpec> &oldSpecs = oldLayout.keys;
+  for (std::size_t index = 0; index < oldSpecs.size(); ++index) {
+    oldByKey[static_cast<std::size_t>(oldSpecs[index].key)].push_back(index);
+  }
+  std::array<std::size_t, 256> used{};
+
+  std::vector<std::optional<Element>> oldElements;
+  oldElements.reserve(elements.size());
+  for (auto &element : elements) {
+    oldElements.emplace_back(std::move(element));
+  }
+  elements.clear();
+  elements.reserve(newLayout.keys.size());
+
+  for (const auto &spec : newLayout.keys) {
+    const auto keyIndex = static_cast<std::size_t>(spec.key);
+    const auto &candidates = oldByKey[keyIndex];
+    if (used[keyIndex] < candidates.size()) {
+      const std::size_t oldIndex = candidates[used[keyIndex]++];
+      Element element = std::move(*oldElements[oldIndex]);
+      oldElements[oldIndex].reset();
+      if (oldSpecs[oldIndex] == spec &&
+          oldLayout.layers == newLayout.layers &&
+          oldLayout.macros == newLayout.macros) {
+        ++stats.kept;
+      } else {
+        configureElement(element, spec, newLayout);
+        ++stats.reconfigured;
+      }
+      elements.push_back(std::move(element));
+      continue;
+    }
+
+    elements.push_back(buildElement(builder, spec, newLayout));
+    ++stats.added;
+  }
+
+  // Whatever was not matched is gone from the layout
+  for (auto &element : oldElements) {
+    if (!element) {
+      continue;
+    }
+    if (auto *button = element->input()->button(); button != nullptr) {
+      button->deleteLater();
+    }
+    element.reset(); // releases the controller slot
+    ++stats.removed;
+  }
+
+  return stats;
+}
+
+} // namespace layout
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "core/keyboard_controller.hpp"
+#include "core/layout.hpp"
+#include "core/layout_file.hpp"
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <functional>
+#include <vector>
+
+class QWidget;
+
+namespace layout {
+
+/**
+ * @brief Watches a layout file and applies edits to the live keyboard.
+ *
+ * The file is watched through QFileSystemWatcher (inotify on Linux). When it
+ * changes, the new key list is diffed against the current one and only the
+ * keys that changed are touched: unchanged keys are kept as they are,
+ * reconfigured keys get new settings on their existing Input, and only added
+ * or removed keys create or destroy anything. Kept keys keep their controller
+ * slot, so a key that is held or latched stays that way across the reload.
+ */
+class LayoutReloader : public QObject {
+public:
+  // Called after the element list changed so the renderer can lay it out
+  // again (widgets are not recreated)
+  using ChangedCallback = std::function<void(const LayoutSpec &)>;
+
+  struct DiffStats {
+    int kept{0};
+    int reconfigured{0};
+    int added{0};
+    int removed{0};
+  };
+
+  LayoutReloader(QString path, LayoutSpec layout,
+                 std::vector<Element> *elements,
+                 core::KeyboardController *controller, QWidget *parent,
+                 bool createButtons, ChangedCallback onChanged);
+
+  // Re-read the file now and apply the differences
+  void reload();
+
+  /**
+   * @brief Turn `elements` (built from `oldLayout`) into `newLayout`, reusing
+   * every element whose key is still present.
+   *
+   * Keys are matched by identity and occurrence (the second Space in the old
+   * layout matches the second Space in the new one).
+   */
+  static DiffStats applyDiff(const LayoutSpec &oldLayout,
+                             const LayoutSpec &newLayout,
+                             std::vector<Element> &elements,
+                             ElementBuilder &builder);
+
+private:
+  void watch();
+
+  QString path_;
+  LayoutSpec layout_;
+  std::vector<Element> *elements_;
+  ElementBuilder builder_;
+  ChangedCallback onChanged_;
+  QFileSystemWatcher watcher_;
+  QTimer debounce_;
+};
+
+} // namespace layout
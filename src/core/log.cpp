@@ -0,0 +1,319 @@
+#include "log.hpp"
+
+#include <algorithm>
+#include <array>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace core::log {
+
+namespace detail {
+
+Ring g_ring;
+
+std::atomic<bool> g_echo{[]() {
+  const char *env = std::getenv("TYPR_OSK_DEBUG_BACKEND");
+  return env != nullptr && env[0] != '\0' && env[0] != '0';
+}()};
+
+} // namespace detail
+
+namespace {
+
+void writeAll(int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+#ifdef _WIN32
+    const int written = _write(fd, data, static_cast<unsigned>(size));
+#else
+    const ssize_t written = ::write(fd, data, size);
+#endif
+    if (written <= 0) {
+      return;
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+}
+
+// Fixed-capacity line buffer. Formatting never allocates so dump() can run
+// from a crash handler.
+class Line {
+public:
+  void append(std::string_view text) {
+    const std::size_t count = std::min(text.size(), buffer_.size() - size_);
+    std::memcpy(buffer_.data() + size_, text.data(), count);
+    size_ += count;
+  }
+
+  void append(char character) { append(std::string_view(&character, 1)); }
+
+  void appendUnsigned(uint64_t value, int minDigits = 1) {
+    std::array<char, 24> digits{};
+    int count = 0;
+    do {
+      digits[count++] = static_cast<char>('0' + (value % 10));
+      value /= 10;
+    } while (value != 0 || count < minDigits);
+    while (count > 0) {
+      append(digits[--count]);
+    }
+  }
+
+  void appendSigned(int64_t value) {
+    if (value < 0) {
+      append('-');
+      appendUnsigned(static_cast<uint64_t>(-(value + 1)) + 1);
+    } else {
+      appendUnsigned(static_cast<uint64_t>(value));
+    }
+  }
+
+  // Fixed-point with three decimals; enough for latencies and ratios.
+  void appendFixed(double value) {
+    if (value < 0) {
+      append('-');
+      value = -value;
+    }
+    const auto scaled = static_cast<uint64_t>((value * 1000.0) + 0.5);
+    appendUnsigned(scaled / 1000);
+    append('.');
+    appendUnsigned(scaled % 1000, 3);
+  }
+
+  void flush(int fd) {
+    writeAll(fd, buffer_.data(), size_);
+    size_ = 0;
+  }
+
+private:
+  std::array<char, 512> buffer_{};
+  std::size_t size_{0};
+};
+
+const char *levelName(Level level) {
+  switch (level) {
+  case Level::Trace:
+    return "TRACE";
+  case Level::Debug:
+    return "DEBUG";
+  case Level::Info:
+    return "INFO";
+  case Level::Warn:
+    return "WARN";
+  case Level::Error:
+    return "ERROR";
+  }
+  return "?";
+}
+
+void appendArg(Line &line, ArgKind kind, uint64_t value) {
+  switch (kind) {
+  case ArgKind::None:
+    break;
+  case ArgKind::Int:
+    line.appendSigned(static_cast<int64_t>(value));
+    break;
+  case ArgKind::UInt:
+    line.appendUnsigned(value);
+    break;
+  case ArgKind::Bool:
+    line.append(value != 0 ? "true" : "false");
+    break;
+  case ArgKind::Double:
+    line.appendFixed(std::bit_cast<double>(value));
+    break;
+  case ArgKind::CStr: {
+    const auto *text = reinterpret_cast<const char *>(value);
+    line.append(text != nullptr ? std::string_view(text) : "(null)");
+    break;
+  }
+  case ArgKind::Key:
+    line.append(backend::keyName(static_cast<backend::Key>(value)));
+    break;
+  }
+}
+
+// Format one record. `relativeTo` is the timestamp the printed time is
+// relative to (the dump time, or the record itself for live echo).
+void formatRecord(Line &line, const Record &record, int64_t timeNs,
+                  int64_t relativeTo) {
+  const Site *site = record.site;
+
+  line.append('[');
+  if (relativeTo != timeNs) {
+    line.appendFixed(static_cast<double>(timeNs - relativeTo) / 1.0e6);
+    line.append("ms] ");
+  } else {
+    line.appendFixed(static_cast<double>(timeNs) / 1.0e9);
+    line.append("s] ");
+  }
+  line.append(levelName(site->level));
+  line.append(" [");
+  line.append(site->component);
+  line.append("] ");
+
+  std::size_t argIndex = 0;
+  for (const char *cursor = site->format; *cursor != '\0'; ++cursor) {
+    if (cursor[0] == '{' && cursor[1] == '}') {
+      if (argIndex < kMaxArgs) {
+        appendArg(line, record.kinds[argIndex], record.values[argIndex]);
+        ++argIndex;
+      }
+      ++cursor;
+      continue;
+    }
+    line.append(*cursor);
+  }
+  line.append('\n');
+}
+
+// Copy a record out of the ring, rejecting it if a writer touched it
+// meanwhile. Returns false for torn, empty or recycled records.
+bool snapshot(const Record &source, uint64_t expectedSequence, Record &out) {
+  const uint64_t before = source.sequence.load(std::memory_order_acquire);
+  if (before != expectedSequence) {
+    return false;
+  }
+  out.timeNs = source.timeNs;
+  out.site = source.site;
+  std::memcpy(out.kinds, source.kinds, sizeof(out.kinds));
+  std::memcpy(out.values, source.values, sizeof(out.values));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return source.sequence.load(std::memory_order_relaxed) == before &&
+         out.site != nullptr;
+}
+
+// TYPR_OSK_LOG_SECONDS, read when the handlers are installed: the fatal
+// signal handler cannot call getenv()
+int64_t g_dumpWindowMs = 0;
+
+#ifndef _WIN32
+int g_dumpPipe[2] = {-1, -1};
+
+void onDumpSignal(int /*signal*/) {
+  const char byte = 1;
+  [[maybe_unused]] const ssize_t ignored = ::write(g_dumpPipe[1], &byte, 1);
+}
+#endif
+
+void onFatalSignal(int signal) {
+  const char banner[] = "[typr] fatal signal, dumping log ring:\n";
+  writeAll(2, banner, sizeof(banner) - 1);
+  dump(2, g_dumpWindowMs);
+  std::signal(signal, SIG_DFL);
+  std::raise(signal);
+}
+
+} // namespace
+
+namespace detail {
+
+void echo(const Record &record) {
+  Line line;
+  formatRecord(line, record, record.timeNs, record.timeNs);
+  line.flush(2);
+}
+
+} // namespace detail
+
+void dump(int fd, int64_t maxAgeMs) {
+  const auto &ring = detail::g_ring;
+  const uint64_t head = ring.head.load(std::memory_order_acquire);
+  const uint64_t first =
+      head > detail::kRingSize ? head - detail::kRingSize : 0;
+  const int64_t now = detail::nowNs();
+  const int64_t oldest =
+      maxAgeMs > 0 ? now - (maxAgeMs * 1000 * 1000) : INT64_MIN;
+
+  Line line;
+  uint64_t skipped = 0;
+  for (uint64_t index = first; index < head; ++index) {
+    Record copy;
+    const Record &source = ring.records[index & (detail::kRingSize - 1)];
+    if (!snapshot(source, 2 * (index + 1), copy)) {
+      ++skipped;
+      continue;
+    }
+    if (copy.timeNs < oldest) {
+      continue;
+    }
+    formatRecord(line, copy, copy.timeNs, now);
+    line.flush(fd);
+  }
+
+  line.append("[typr] log dump: ");
+  line.appendUnsigned(head - first);
+  line.append(" records, ");
+  line.appendUnsigned(skipped);
+  line.append(" overwritten while dumping\n");
+  line.flush(fd);
+}
+
+void dumpToOutput(int64_t maxAgeMs) {
+#ifndef _WIN32
+  const char *path = std::getenv("TYPR_OSK_LOG_FILE");
+  if (path != nullptr && path[0] != '\0') {
+    const int fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd >= 0) {
+      dump(fd, maxAgeMs);
+      ::close(fd);
+      return;
+    }
+  }
+#endif
+  dump(2, maxAgeMs);
+}
+
+void setEcho(bool enabled) {
+  detail::g_echo.store(enabled, std::memory_order_relaxed);
+}
+
+void installDumpHandlers() {
+  static std::atomic<bool> installed{false};
+  if (installed.exchange(true)) {
+    return;
+  }
+
+  if (const char *seconds = std::getenv("TYPR_OSK_LOG_SECONDS");
+      seconds != nullptr) {
+    g_dumpWindowMs = std::max<int64_t>(0, std::atoll(seconds)) * 1000;
+  }
+
+  for (int signal : {SIGSEGV, SIGABRT, SIGFPE, SIGILL}) {
+    std::signal(signal, onFatalSignal);
+  }
+
+#ifndef _WIN32
+  std::signal(SIGBUS, onFatalSignal);
+
+  // SIGUSR1 only pokes a pipe; the dump itself runs on a helper thread so it
+  // never races the code that was interrupted.
+  if (::pipe(g_dumpPipe) != 0) {
+    return;
+  }
+  std::thread([]() {
+    char byte = 0;
+    while (::read(g_dumpPipe[0], &byte, 1) == 1) {
+      dumpToOutput(g_dumpWindowMs);
+    }
+  }).detach();
+
+  struct sigaction action{};
+  action.sa_handler = onDumpSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGUSR1, &action, nullptr);
+#endif
+}
+
+} // namespace core::log
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "backend/backend.hpp"
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * Structured, deferred-formatting logger.
+ *
+ * A log statement records a pointer to its static call site (level, component
+ * and format string) plus up to kMaxArgs raw argument values into a fixed-size
+ * in-memory ring buffer. Nothing is formatted on the hot path: text is only
+ * produced when the ring is dumped (SIGUSR1, a crash, or an explicit dump()
+ * call), or when live echo to stderr is enabled with TYPR_OSK_DEBUG_BACKEND.
+ *
+ * Statements below TYPR_LOG_MIN_LEVEL are removed at compile time.
+ *
+ * Format strings use `{}` placeholders. Supported arguments are integers,
+ * bools, enums (backend::Key is printed by name), floating point values and
+ * `const char *` pointing at string literals - the pointer is stored, not the
+ * characters, so never pass a temporary buffer.
+ */
+
+#ifndef TYPR_LOG_MIN_LEVEL
+#define TYPR_LOG_MIN_LEVEL 1 // Debug and above are recorded
+#endif
+
+namespace core::log {
+
+enum class Level : uint8_t { Trace = 0, Debug, Info, Warn, Error };
+
+struct Site {
+  Level level;
+  const char *component;
+  const char *format;
+};
+
+enum class ArgKind : uint8_t { None, Int, UInt, Bool, Double, CStr, Key };
+
+static constexpr std::size_t kMaxArgs = 6;
+
+struct Record {
+  // Seqlock: odd while the record is being written, 2 * (index + 1) once
+  // complete. Readers discard records whose sequence changes under them.
+  std::atomic<uint64_t> sequence{0};
+  int64_t timeNs{0};
+  const Site *site{nullptr};
+  ArgKind kinds[kMaxArgs]{};
+  uint64_t values[kMaxArgs]{};
+};
+
+namespace detail {
+
+static constexpr std::size_t kRingSize = 4096; // records, power of two
+
+struct Ring {
+  std::atomic<uint64_t> head{0};
+  Record records[kRingSize];
+};
+
+extern Ring g_ring;
+extern std::atomic<bool> g_echo;
+
+void echo(const Record &record);
+
+inline int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+template <typename T>
+inline void encode(Record &record, std::size_t index, T value) {
+  using U = std::remove_cvref_t<T>;
+  if constexpr (std::is_same_v<U, backend::Key>) {
+    record.kinds[index] = ArgKind::Key;
+    record.values[index] = static_cast<uint64_t>(value);
+  } else if constexpr (std::is_same_v<U, bool>) {
+    record.kinds[index] = ArgKind::Bool;
+    record.values[index] = value ? 1 : 0;
+  } else if constexpr (std::is_enum_v<U>) {
+    encode(record, index, static_cast<std::underlying_type_t<U>>(value));
+  } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+    record.kinds[index] = ArgKind::Int;
+    record.values[index] = static_cast<uint64_t>(static_cast<int64_t>(value));
+  } else if constexpr (std::is_integral_v<U>) {
+    record.kinds[index] = ArgKind::UInt;
+    record.values[index] = static_cast<uint64_t>(value);
+  } else if constexpr (std::is_floating_point_v<U>) {
+    record.kinds[index] = ArgKind::Double;
+    record.values[index] = std::bit_cast<uint64_t>(static_cast<double>(value));
+  } else {
+    static_assert(std::is_convertible_v<U, const char *>,
+                  "unsupported log argument type");
+    record.kinds[index] = ArgKind::CStr;
+    record.values[index] =
+        reinterpret_cast<uintptr_t>(static_cast<const char *>(value));
+  }
+}
+
+} // namespace detail
+
+template <typename... Args> inline void write(const Site *site, Args... args) {
+  static_assert(sizeof...(Args) <= kMaxArgs, "too many log arguments");
+
+  auto &ring = detail::g_ring;
+  const uint64_t index = ring.head.fetch_add(1, std::memory_order_relaxed);
+  Record &record = ring.records[index & (detail::kRingSize - 1)];
+
+  record.sequence.store((2 * index) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  record.timeNs = detail::nowNs();
+  record.site = site;
+  std::size_t argIndex = 0;
+  (detail::encode(record, argIndex++, args), ...);
+  for (; argIndex < kMaxArgs; ++argIndex) {
+    record.kinds[argIndex] = ArgKind::None;
+  }
+
+  record.sequence.store(2 * (index + 1), std::memory_order_release);
+
+  if (detail::g_echo.load(std::memory_order_relaxed)) {
+    detail::echo(record);
+  }
+}
+
+/**
+ * @brief Format the records of the last @p maxAgeMs milliseconds (all records
+ * when zero) to a file descriptor, oldest first. Does not allocate.
+ */
+void dump(int fd, int64_t maxAgeMs = 0);
+
+// dump() appended to the file named by TYPR_OSK_LOG_FILE, else to stderr
+void dumpToOutput(int64_t maxAgeMs);
+
+// Enable or disable live echo of every record to stderr (formatting cost is
+// then paid per record). Initialised from TYPR_OSK_DEBUG_BACKEND.
+void setEcho(bool enabled);
+
+/**
+ * @brief Install the dump triggers: SIGUSR1 dumps the ring to stderr (or to
+ * the file named by TYPR_OSK_LOG_FILE), and fatal signals dump it before the
+ * process dies. Both keep to the last TYPR_OSK_LOG_SECONDS seconds when that
+ * is set. Safe to call more than once.
+ */
+void installDumpHandlers();
+
+} // namespace core::log
+
+#define TYPR_LOG(level, component, format, ...)                                \
+  do {                                                                         \
+    if constexpr (static_cast<int>(level) >= TYPR_LOG_MIN_LEVEL) {             \
+      static constexpr ::core::log::Site typrLogSite{level, component,         \
+                                                     format};                  \
+      ::core::log::write(&typrLogSite __VA_OPT__(, ) __VA_ARGS__);             \
+    }                                                                          \
+  } while (false)
+
+#define TYPR_LOG_TRACE(component, format, ...)                                 \
+  TYPR_LOG(::core::log::Level::Trace, component,                               \
+           format __VA_OPT__(, ) __VA_ARGS__)
+#define TYPR_LOG_DEBUG(component, format, ...)                                 \
+  TYPR_LOG(::core::log::Level::Debug, component,                               \
+           format __VA_OPT__(, ) __VA_ARGS__)
+#define TYPR_LOG_INFO(component, format, ...)                                  \
+  TYPR_LOG(::core::log::Level::Info, component,                                \
+           format __VA_OPT__(, ) __VA_ARGS__)
+#define TYPR_LOG_WARN(component, format, ...)                                  \
+  TYPR_LOG(::core::log::Level::Warn, component,                                \
+           format __VA_OPT__(, ) __VA_ARGS__)
+#define TYPR_LOG_ERROR(component, format, ...)                                 \
+  TYPR_LOG(::core::log::Level::Error, component,                               \
+           format __VA_OPT__(, ) __VA_ARGS__)
@@ -0,0 +1,445 @@
+#include "macro.hpp"
+
+#include "core/log.hpp"
+#include "core/trace.hpp"
+
+#if defined(__linux__)
+#include "backend/driver.hpp"
+#include "backend/uinput_backend.hpp"
+#endif
+
+#include <QString>
+#include <array>
+#include <bitset>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace core {
+
+namespace {
+
+constexpr std::size_t kQueueSize = 16;
+
+bool isSpace(char character) {
+  return character == ' ' || character == '\t' || character == '\r' ||
+         character == '\n';
+}
+
+uint16_t readU16(const uint8_t *in) {
+  return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+void emit(std::vector<uint8_t> &code, MacroOp op, backend::Key key) {
+  code.push_back(static_cast<uint8_t>(op));
+  code.push_back(static_cast<uint8_t>(key));
+}
+
+void emit(std::vector<uint8_t> &code, MacroOp op, uint16_t operand) {
+  code.push_back(static_cast<uint8_t>(op));
+  code.push_back(static_cast<uint8_t>(operand));
+  code.push_back(static_cast<uint8_t>(operand >> 8));
+}
+
+// Read a quoted string starting after its opening quote. Returns false if it
+// is not closed.
+bool readQuoted(std::string_view &steps, std::string &out) {
+  while (!steps.empty()) {
+    const char character = steps.front();
+    steps.remove_prefix(1);
+    if (character == '"') {
+      return true;
+    }
+    if (character == '\\' && !steps.empty()) {
+      out.push_back(steps.front());
+      steps.remove_prefix(1);
+      continue;
+    }
+    out.push_back(character);
+  }
+  return false;
+}
+
+} // namespace
+
+std::optional<Macro> compileMacro(std::string name, std::string_view steps,
+                                  std::string &error) {
+  Macro macro;
+  macro.name = std::move(name);
+  std::bitset<256> held;
+
+  for (;;) {
+    while (!steps.empty() && isSpace(steps.front())) {
+      steps.remove_prefix(1);
+    }
+    if (steps.empty() || steps.front() == '#') {
+      break;
+    }
+
+    if (steps.front() == '"') {
+      steps.remove_prefix(1);
+      std::string text;
+      if (!readQuoted(steps, text)) {
+        error = "unterminated text in macro '" + macro.name + "'";
+        return std::nullopt;
+      }
+      if (text.empty()) {
+        continue;
+      }
+      if (macro.texts.size() > std::numeric_limits<uint16_t>::max()) {
+        error = "too many texts in macro '" + macro.name + "'";
+        return std::nullopt;
+      }
+      emit(macro.code, MacroOp::Text,
+           static_cast<uint16_t>(macro.texts.size()));
+      macro.texts.push_back(QString::fromUtf8(text.data(),
+                                              static_cast<qsizetype>(
+                                                  text.size()))
+                                .toStdU32String());
+      continue;
+    }
+
+    std::size_t end = 0;
+    while (end < steps.size() && !isSpace(steps[end])) {
+      ++end;
+    }
+    const std::string_view step = steps.substr(0, end);
+    steps.remove_prefix(end);
+
+    if (step.size() > 2 && step.ends_with("ms") && step.front() >= '0' &&
+        step.front() <= '9') {
+      const std::string_view digits = step.substr(0, step.size() - 2);
+      uint32_t ms = 0;
+      const auto [ptr, ec] =
+          std::from_chars(digits.data(), digits.data() + digits.size(), ms);
+      if (ec != std::errc() || ptr != digits.data() + digits.size()) {
+        error = "bad delay '" + std::string(step) + "' in macro '" +
+                macro.name + "'";
+        return std::nullopt;
+      }
+      while (ms > 0) {
+        const uint32_t part =
+            std::min<uint32_t>(ms, std::numeric_limits<uint16_t>::max());
+        emit(macro.code, MacroOp::Delay, static_cast<uint16_t>(part));
+        ms -= part;
+      }
+      continue;
+    }
+
+    const char prefix = step.front();
+    const bool down = prefix == '+';
+    const bool up = prefix == '-' && step.size() > 1;
+    const std::string keyName(down || up ? step.substr(1) : step);
+    const backend::Key key = backend::stringToKey(keyName);
+    if (key == backend::Key::Unknown) {
+      error = "unknown key '" + keyName + "' in macro '" + macro.name + "'";
+      return std::nullopt;
+    }
+    const auto index = static_cast<std::size_t>(key);
+    // Only a release may (and must) find its key held
+    if (held[index] != up) {
+      error = "key '" + keyName + "' " +
+              (up ? "released without being pressed" : "is already held") +
+              " in macro '" + macro.name + "'";
+      return std::nullopt;
+    }
+    if (!up) {
+      emit(macro.code, MacroOp::Down, key);
+    }
+    if (!down) {
+      emit(macro.code, MacroOp::Up, key);
+    }
+    held[index] = down;
+  }
+
+  if (held.any()) {
+    error = "macro '" + macro.name + "' ends with keys still held";
+    return std::nullopt;
+  }
+  if (macro.code.empty()) {
+    error = "macro '" + macro.name + "' has no steps";
+    return std::nullopt;
+  }
+  return macro;
+}
+
+bool isValidMacro(const Macro &macro) {
+  std::bitset<256> held;
+  const std::vector<uint8_t> &code = macro.code;
+  std::size_t pc = 0;
+  while (pc < code.size()) {
+    const std::size_t operands = code.size() - pc - 1;
+    switch (static_cast<MacroOp>(code[pc])) {
+    case MacroOp::Down:
+    case MacroOp::Up: {
+      const bool up = code[pc] == static_cast<uint8_t>(MacroOp::Up);
+      if (operands < 1) {
+        return false;
+      }
+      const uint8_t key = code[pc + 1];
+      if (backend::keyName(static_cast<backend::Key>(key)) == "Unknown" ||
+          held[key] != up) {
+        return false;
+      }
+      held[key] = !up;
+      pc += 2;
+      break;
+    }
+    case MacroOp::Delay:
+      if (operands < 2) {
+        return false;
+      }
+      pc += 3;
+      break;
+    case MacroOp::Text:
+      if (operands < 2 || readU16(&code[pc + 1]) >= macro.texts.size()) {
+        return false;
+      }
+      pc += 3;
+      break;
+    default:
+      return false;
+    }
+  }
+  return !code.empty() && held.none();
+}
+
+void MacroRecorder::start() {
+  recording_ = true;
+  code_.clear();
+  held_.reset();
+}
+
+void MacroRecorder::record(backend::Key key, bool down,
+                           Clock::time_point time) {
+  const auto index = static_cast<std::size_t>(key);
+  // A release needs its press in the recording, and a press must not repeat
+  if (!recording_ || held_[index] == down) {
+    return;
+  }
+  if (!code_.empty()) {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  time - last_)
+                  .count();
+    while (ms > 0) {
+      const auto part =
+          std::min<int64_t>(ms, std::numeric_limits<uint16_t>::max());
+      emit(code_, MacroOp::Delay, static_cast<uint16_t>(part));
+      ms -= part;
+    }
+  }
+  emit(code_, down ? MacroOp::Down : MacroOp::Up, key);
+  held_[index] = down;
+  last_ = time;
+}
+
+std::optional<Macro> MacroRecorder::finish(std::string name) {
+  recording_ = false;
+  for (std::size_t index = 0; index < held_.size(); ++index) {
+    if (held_[index]) {
+      emit(code_, MacroOp::Up, static_cast<backend::Key>(index));
+    }
+  }
+  held_.reset();
+  if (code_.empty()) {
+    return std::nullopt;
+  }
+  return Macro{.name = std::move(name), .code = std::move(code_), .texts = {}};
+}
+
+struct MacroPlayer::Impl {
+  using Clock = std::chrono::steady_clock;
+
+  Impl() : worker(&Impl::threadMain, this) {}
+
+  ~Impl() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      ++generation;
+    }
+    wake.notify_all();
+    worker.join();
+  }
+
+  bool play(std::shared_ptr<const Macro> macro) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (count == kQueueSize) {
+        TYPR_LOG_WARN("macro", "queue full, macro dropped");
+        return false;
+      }
+      queue[(head + count) % kQueueSize] = std::move(macro);
+      ++count;
+    }
+    wake.notify_all();
+    return true;
+  }
+
+  void cancel() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++generation;
+      for (; count > 0; --count, head = (head + 1) % kQueueSize) {
+        queue[head].reset();
+      }
+    }
+    wake.notify_all();
+    idle.notify_all();
+  }
+
+  void waitUntilIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return count == 0 && !busy; });
+  }
+
+  backend::Capabilities capabilities() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return opened; });
+    return openedCapabilities;
+  }
+
+private:
+  void threadMain() {
+    trace::setThreadName("macros");
+    backend = std::make_unique<backend::InputBackend>();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    opened = true;
+    openedCapabilities = backend->capabilities();
+    idle.notify_all();
+    for (;;) {
+      wake.wait(lock, [this]() { return stopping || count > 0; });
+      if (stopping) {
+        break;
+      }
+      std::shared_ptr<const Macro> macro = std::move(queue[head]);
+      head = (head + 1) % kQueueSize;
+      --count;
+      busy = true;
+      const uint64_t started = generation;
+      lock.unlock();
+
+      run(*macro, started);
+      macro.reset();
+
+      lock.lock();
+      busy = false;
+      if (count == 0) {
+        idle.notify_all();
+      }
+    }
+    lock.unlock();
+    backend.reset();
+  }
+
+  void run(const Macro &macro, uint64_t started) {
+    TYPR_TRACE_SPAN("macro", "MacroPlayer::run");
+    if (!backend->isReady()) {
+      TYPR_LOG_WARN("macro", "backend not ready, macro skipped");
+      return;
+    }
+#if defined(__linux__)
+    // uinput: the loop compiled against it, each key an inlined write
+    if (auto *uinput = backend::bound<backend::UinputBackend>(*backend)) {
+      play(*uinput, macro, started);
+      return;
+    }
+#endif
+    play(*backend, macro, started);
+  }
+
+  template <typename Backend>
+  void play(Backend &output, const Macro &macro, uint64_t started) {
+    Clock::time_point deadline = Clock::now();
+    const uint8_t *pc = macro.code.data();
+    const uint8_t *end = pc + macro.code.size();
+    while (pc < end) {
+      switch (static_cast<MacroOp>(*pc)) {
+      case MacroOp::Down:
+        output.keyDown(static_cast<backend::Key>(pc[1]));
+        held.set(pc[1]);
+        pc += 2;
+        break;
+      case MacroOp::Up:
+        output.keyUp(static_cast<backend::Key>(pc[1]));
+        held.reset(pc[1]);
+        pc += 2;
+        break;
+      case MacroOp::Delay:
+        deadline += std::chrono::milliseconds(readU16(pc + 1));
+        pc += 3;
+        if (!sleepUntil(deadline, started)) {
+          releaseHeld(output);
+          return;
+        }
+        break;
+      case MacroOp::Text:
+        output.typeText(macro.texts[readU16(pc + 1)]);
+        pc += 3;
+        break;
+      default:
+        pc = end;
+        break;
+      }
+    }
+    output.flush();
+  }
+
+  // Returns false if playback was cancelled in the meantime
+  bool sleepUntil(Clock::time_point deadline, uint64_t started) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return !wake.wait_until(lock, deadline,
+                            [&]() { return generation != started; });
+  }
+
+  template <typename Backend> void releaseHeld(Backend &output) {
+    for (std::size_t key = 0; key < held.size(); ++key) {
+      if (held[key]) {
+        output.keyUp(static_cast<backend::Key>(key));
+      }
+    }
+    held.reset();
+    output.flush();
+  }
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable idle;
+  std::array<std::shared_ptr<const Macro>, kQueueSize> queue;
+  std::size_t head{0};
+  std::size_t count{0};
+  bool busy{false};
+  bool stopping{false};
+  bool opened{false};
+  backend::Capabilities openedCapabilities;
+  // Bumped by cancel() and on destruction; a macro stops once it changed
+  uint64_t generation{0};
+
+  // Playback thread only
+  std::unique_ptr<backend::InputBackend> backend;
+  std::bitset<256> held;
+
+  std::thread worker;
+};
+
+MacroPlayer::MacroPlayer() : m_impl(std::make_unique<Impl>()) {}
+
+MacroPlayer::~MacroPlayer() = default;
+
+bool MacroPlayer::play(std::shared_ptr<const Macro> macro) {
+  return m_impl->play(std::move(macro));
+}
+
+void MacroPlayer::cancel() { m_impl->cancel(); }
+
+void MacroPlayer::waitUntilIdle() { m_impl->waitUntilIdle(); }
+
+backend::Capabilities MacroPlayer::capabilities() const {
+  return m_impl->capabilities();
+}
+
+} // namespace core
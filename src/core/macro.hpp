@@ -0,0 +1,142 @@
+#pragma once
+
+#include "backend/backend.hpp"
+
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace core {
+
+/**
+ * Opcodes of compiled macros. Each is one byte followed by fixed operands:
+ *
+ *   Down   u8 key     backend::Key value
+ *   Up     u8 key
+ *   Delay  u16 ms     (longer waits are split into several)
+ *   Text   u16 index  into Macro::texts
+ */
+enum class MacroOp : uint8_t {
+  Down = 1,
+  Up = 2,
+  Delay = 3,
+  Text = 4,
+};
+
+/**
+ * @brief A macro compiled to bytecode. Everything is validated when it is
+ * compiled, so playing it is a walk over `code` without parsing, lookups or
+ * allocation.
+ */
+struct Macro {
+  std::string name;
+  std::vector<uint8_t> code;
+  std::vector<std::u32string> texts;
+
+  bool operator==(const Macro &other) const = default;
+};
+
+/**
+ * @brief Compile the steps of a macro definition.
+ *
+ * Steps are separated by whitespace:
+ *
+ *   Name       tap a key (as accepted by backend::stringToKey)
+ *   +Name      press a key and keep it down
+ *   -Name      release a key pressed with +Name
+ *   250ms      wait
+ *   "text"     type text (\" and \\ escape); only on backends that can
+ *              inject text
+ *
+ * e.g. `+CtrlLeft A -CtrlLeft 50ms "Best regards," Enter`. '#' outside of
+ * quotes starts a comment. A key held with +Name must be released before the
+ * macro ends.
+ *
+ * @return The macro, or nullopt with a message in `error`.
+ */
+std::optional<Macro> compileMacro(std::string name, std::string_view steps,
+                                  std::string &error);
+
+/**
+ * @brief Whether `macro.code` is bytecode compileMacro() could have produced:
+ * known opcodes with whole operands, known keys pressed and released in
+ * pairs, and text indices within `macro.texts`. For macros read back from
+ * storage, which MacroPlayer would otherwise trust.
+ */
+[[nodiscard]] bool isValidMacro(const Macro &macro);
+
+/**
+ * @brief Records key presses into a macro, as the same bytecode compileMacro()
+ * produces: a Down and an Up per key event and a Delay for each wait between
+ * them.
+ *
+ * Fed with what KeyboardController injects (see setOnInjected), so software
+ * repeats and callback-only keys are not recorded. The release of a key that
+ * was down before recording started is dropped, and keys still down when it
+ * finishes are released at the end, so the macro passes isValidMacro().
+ */
+class MacroRecorder {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // Start a new recording, dropping anything recorded so far
+  void start();
+  [[nodiscard]] bool isRecording() const { return recording_; }
+  // A key went down or up at `time`; ignored unless recording
+  void record(backend::Key key, bool down, Clock::time_point time);
+  // Stop recording. nullopt if no key was recorded.
+  [[nodiscard]] std::optional<Macro> finish(std::string name);
+
+private:
+  bool recording_{false};
+  std::vector<uint8_t> code_;
+  std::bitset<256> held_;
+  Clock::time_point last_{}; // of the previous event
+};
+
+/**
+ * @brief Plays compiled macros on a thread of its own.
+ *
+ * Every step is due at an absolute deadline counted from the start of its
+ * macro: the time spent injecting does not stretch the waits that follow, and
+ * a late wake-up is made up by the next step instead of being carried over.
+ *
+ * The player injects through an InputBackend it opens on its own thread.
+ * Opening may block (uinput waits for its device node), and the GUI thread's
+ * backend is not safe to share across threads. When that backend is uinput,
+ * the playback loop is compiled against UinputBackend and skips the virtual
+ * calls.
+ *
+ * Macros play one after another; play() only queues them and never blocks.
+ */
+class MacroPlayer {
+public:
+  MacroPlayer();
+  // Stops playback; keys held by a macro are released
+  ~MacroPlayer();
+
+  MacroPlayer(const MacroPlayer &) = delete;
+  MacroPlayer &operator=(const MacroPlayer &) = delete;
+  MacroPlayer(MacroPlayer &&) = delete;
+  MacroPlayer &operator=(MacroPlayer &&) = delete;
+
+  // Queue a macro. Returns false (and drops it) when the queue is full.
+  bool play(std::shared_ptr<const Macro> macro);
+  // Stop the playing macro, releasing the keys it holds, and drop the queue
+  void cancel();
+  // Block until every queued macro has played
+  void waitUntilIdle();
+  // What the player's backend can do; blocks until it is open
+  [[nodiscard]] backend::Capabilities capabilities() const;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace core
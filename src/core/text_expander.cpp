@@ -0,0 +1,299 @@
+#include "text_expander.hpp"
+
+#include "core/log.hpp"
+#include "core/trace.hpp"
+
+#include <QDebug>
+#include <QFile>
+#include <deque>
+#include <string_view>
+
+namespace core {
+
+namespace {
+
+constexpr ExpansionMatcher::State kNoState = ~ExpansionMatcher::State{0};
+
+// How long the keystrokes of an expansion may take to come back through the
+// listener before typing is watched again
+constexpr auto kEchoTimeout = std::chrono::milliseconds(500);
+
+std::u32string toUtf32(const std::string &text) {
+  return QString::fromUtf8(text.data(), static_cast<qsizetype>(text.size()))
+      .toStdU32String();
+}
+
+// An expansion as a macro: erase the abbreviation, then type the text. The
+// X11, Wayland and Windows backends type '\b' as BackSpace, so there it is
+// one text step and the expansion goes out in one injection instead of a
+// Down and an Up per backspace. Quartz text events carry characters, not
+// keys, so macOS keeps the Backspace taps.
+std::optional<Macro> compileExpansion(const TextExpander::Expansion &expansion,
+                                      std::size_t length,
+                                      std::string &error) {
+#ifdef __APPLE__
+  std::string steps;
+  for (std::size_t index = 0; index < length; ++index) {
+    steps += "Backspace ";
+  }
+  steps += '"';
+#else
+  std::string steps(1, '"');
+  steps.append(length, '\b');
+#endif
+  for (const char character : expansion.text) {
+    if (character == '"' || character == '\\') {
+      steps += '\\';
+    }
+    steps += character;
+  }
+  steps += '"';
+  return compileMacro(expansion.abbreviation, steps, error);
+}
+
+} // namespace
+
+ExpansionMatcher::ExpansionMatcher(
+    const std::vector<std::u32string> &patterns) {
+  // Alphabet: every character of every pattern, symbol 0 for the rest
+  for (const auto &pattern : patterns) {
+    for (const char32_t codepoint : pattern) {
+      if (symbolOf(codepoint) != 0) {
+        continue;
+      }
+      if (codepoint < asciiSymbols_.size()) {
+        asciiSymbols_[codepoint] = symbolCount_++;
+      } else {
+        otherSymbols_.emplace(codepoint, symbolCount_++);
+      }
+    }
+  }
+
+  const auto addState = [this]() {
+    next_.resize(next_.size() + symbolCount_, kNoState);
+    output_.push_back(-1);
+    return static_cast<State>(output_.size() - 1);
+  };
+  const auto at = [this](State state, uint32_t symbol) -> State & {
+    return next_[(static_cast<std::size_t>(state) * symbolCount_) + symbol];
+  };
+
+  // Trie
+  addState();
+  for (std::size_t index = 0; index < patterns.size(); ++index) {
+    if (patterns[index].empty()) {
+      continue;
+    }
+    State state = kRoot;
+    for (const char32_t codepoint : patterns[index]) {
+      const uint32_t symbol = symbolOf(codepoint);
+      if (at(state, symbol) == kNoState) {
+        const State child = addState();
+        at(state, symbol) = child;
+      }
+      state = at(state, symbol);
+    }
+    if (output_[state] < 0) {
+      output_[state] = static_cast<int32_t>(index);
+    }
+  }
+
+  // Breadth first, so the failure state of every state is complete before
+  // it is used. Missing transitions take the failure state's, and a state
+  // without a pattern of its own reports the longest one ending there.
+  std::vector<State> failure(output_.size(), kRoot);
+  std::deque<State> queue;
+  for (uint32_t symbol = 0; symbol < symbolCount_; ++symbol) {
+    State &child = at(kRoot, symbol);
+    if (child == kNoState) {
+      child = kRoot;
+    } else {
+      queue.push_back(child);
+    }
+  }
+  while (!queue.empty()) {
+    const State state = queue.front();
+    queue.pop_front();
+    if (output_[state] < 0) {
+      output_[state] = output_[failure[state]];
+    }
+    for (uint32_t symbol = 0; symbol < symbolCount_; ++symbol) {
+      State &child = at(state, symbol);
+      const State fallback = at(failure[state], symbol);
+      if (child == kNoState) {
+        child = fallback;
+      } else {
+        failure[child] = fallback;
+        queue.push_back(child);
+      }
+    }
+  }
+}
+
+std::optional<std::vector<TextExpander::Expansion>>
+TextExpander::loadFile(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    qWarning() << "[expander] Cannot read abbreviation file:" << path;
+    return std::nullopt;
+  }
+  const QByteArray bytes = file.readAll();
+  std::string_view text(bytes.constData(),
+                        static_cast<std::size_t>(bytes.size()));
+
+  std::vector<Expansion> expansions;
+  while (!text.empty()) {
+    const std::size_t newline = text.find('\n');
+    std::string_view line = text.substr(0, newline);
+    text = newline == std::string_view::npos ? std::string_view()
+                                             : text.substr(newline + 1);
+    if (line.ends_with('\r')) {
+      line.remove_suffix(1);
+    }
+    const std::size_t start = line.find_first_not_of(" \t");
+    if (start == std::string_view::npos || line[start] == '#') {
+      continue;
+    }
+    line.remove_prefix(start);
+
+    const std::size_t end = line.find_first_of(" \t");
+    if (end == std::string_view::npos) {
+      continue; // nothing to expand to
+    }
+    Expansion expansion{.abbreviation = std::string(line.substr(0, end)),
+                        .text = {}};
+    std::string_view rest = line.substr(end);
+    rest.remove_prefix(std::min(rest.find_first_not_of(" \t"), rest.size()));
+    for (std::size_t index = 0; index < rest.size(); ++index) {
+      char character = rest[index];
+      if (character == '\\' && index + 1 < rest.size()) {
+        const char escaped = rest[++index];
+        character = escaped == 'n' ? '\n' : escaped == 't' ? '\t' : escaped;
+      }
+      expansion.text += character;
+    }
+    if (!expansion.text.empty()) {
+      expansions.push_back(std::move(expansion));
+    }
+  }
+  return expansions;
+}
+
+TextExpander::TextExpander(const std::vector<Expansion> &expansions)
+    : matcher_([&expansions]() {
+        std::vector<std::u32string> patterns;
+        patterns.reserve(expansions.size());
+        for (const auto &expansion : expansions) {
+          patterns.push_back(toUtf32(expansion.abbreviation));
+        }
+        return ExpansionMatcher(patterns);
+      }()) {
+  TYPR_TRACE_SPAN("expander", "TextExpander::compile");
+  macros_.reserve(expansions.size());
+  echoes_.reserve(expansions.size());
+  for (const auto &expansion : expansions) {
+    const std::size_t length = toUtf32(expansion.abbreviation).size();
+    std::string error;
+    auto macro = compileExpansion(expansion, length, error);
+    if (!macro) {
+      // Unreachable for valid UTF-8; the abbreviation then never expands
+      qWarning() << "[expander]" << QString::fromStdString(error);
+      macros_.push_back(nullptr);
+      echoes_.push_back(0);
+      continue;
+    }
+    echoes_.push_back(
+        static_cast<uint32_t>(length + toUtf32(expansion.text).size()));
+    macros_.push_back(std::make_shared<const Macro>(std::move(*macro)));
+  }
+  TYPR_LOG_INFO("expander", "{} abbreviations, {} automaton states",
+                expansions.size(), matcher_.stateCount());
+}
+
+TextExpander::~TextExpander() { listener_.stopListening(); }
+
+bool TextExpander::start() {
+  const bool started = listener_.startListening(
+      [this](char32_t codepoint, backend::Key key, backend::Modifier mods,
+             bool pressed) { onKeyEvent(codepoint, key, mods, pressed); });
+  if (!started) {
+    qWarning() << "[expander] No keystroke listener, abbreviations are off";
+  }
+  return started;
+}
+
+void TextExpander::onKeyEvent(char32_t codepoint, backend::Key key,
+                              backend::Modifier mods, bool pressed) {
+  if (!pressed || disabled_) {
+    return;
+  }
+  // Our own Backspaces and text come back through the listener
+  if (pendingEchoes_ > 0) {
+    if (Clock::now() < echoDeadline_) {
+      if (key == backend::Key::Backspace || codepoint != 0) {
+        --pendingEchoes_;
+        return;
+      }
+    } else {
+      pendingEchoes_ = 0;
+    }
+  }
+
+  if (backend::isModifierKey(key)) {
+    return;
+  }
+  if (key == backend::Key::Backspace) {
+    if (depth_ > 0) {
+      --depth_;
+      top_ = (top_ + kHistory - 1) % kHistory;
+    }
+    return;
+  }
+  // Shortcuts, and keys that type nothing printable (arrows, Enter, Escape),
+  // may move the cursor: what was typed before no longer leads up to it
+  const bool shortcut =
+      backend::hasModifier(mods, backend::Modifier::Ctrl) ||
+      backend::hasModifier(mods, backend::Modifier::Super);
+  if (shortcut || codepoint < 0x20 || codepoint == 0x7f) {
+    reset();
+    return;
+  }
+
+  const ExpansionMatcher::State current =
+      depth_ > 0 ? history_[top_] : ExpansionMatcher::kRoot;
+  const ExpansionMatcher::State next = matcher_.step(current, codepoint);
+  push(next);
+  if (const int32_t index = matcher_.match(next); index >= 0) {
+    expand(index);
+  }
+}
+
+void TextExpander::push(ExpansionMatcher::State state) {
+  top_ = (top_ + 1) % kHistory;
+  history_[top_] = state;
+  depth_ = std::min(depth_ + 1, kHistory);
+}
+
+void TextExpander::reset() { depth_ = 0; }
+
+void TextExpander::expand(int32_t index) {
+  const auto &macro = macros_[static_cast<std::size_t>(index)];
+  if (macro == nullptr) {
+    return;
+  }
+  // Erasing the abbreviation without typing the text would only lose input.
+  // Waits for the player's backend the first time.
+  if (!player_.capabilities().canInjectText) {
+    TYPR_LOG_WARN("expander",
+                  "backend cannot inject text, abbreviations are off");
+    disabled_ = true;
+    return;
+  }
+  TYPR_TRACE_SPAN("expander", "TextExpander::expand");
+  player_.play(macro);
+  pendingEchoes_ = echoes_[static_cast<std::size_t>(index)];
+  echoDeadline_ = Clock::now() + kEchoTimeout;
+  reset();
+}
+
+} // namespace core
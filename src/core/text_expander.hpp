@@ -0,0 +1,130 @@
+#pragma once
+
+#include "backend/backend.hpp"
+#include "core/macro.hpp"
+
+#include <QString>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace core {
+
+/**
+ * @brief Aho-Corasick automaton over a set of abbreviations, compiled to a
+ * full transition table.
+ *
+ * Failure links are folded into the table when it is built, so feeding a
+ * character is one lookup of its symbol and one of the next state, however
+ * many abbreviations there are. Characters that occur in no abbreviation
+ * share one symbol that always leads back to the root.
+ */
+class ExpansionMatcher {
+public:
+  using State = uint32_t;
+  static constexpr State kRoot = 0;
+
+  explicit ExpansionMatcher(const std::vector<std::u32string> &patterns);
+
+  [[nodiscard]] State step(State state, char32_t codepoint) const {
+    return next_[(static_cast<std::size_t>(state) * symbolCount_) +
+                 symbolOf(codepoint)];
+  }
+
+  // Index of the longest pattern that ends in `state`, or -1
+  [[nodiscard]] int32_t match(State state) const { return output_[state]; }
+
+  [[nodiscard]] std::size_t stateCount() const { return output_.size(); }
+
+private:
+  [[nodiscard]] uint32_t symbolOf(char32_t codepoint) const {
+    if (codepoint < asciiSymbols_.size()) {
+      return asciiSymbols_[codepoint];
+    }
+    const auto found = otherSymbols_.find(codepoint);
+    return found == otherSymbols_.end() ? 0 : found->second;
+  }
+
+  std::array<uint32_t, 128> asciiSymbols_{};
+  std::unordered_map<char32_t, uint32_t> otherSymbols_;
+  uint32_t symbolCount_{1};
+  std::vector<State> next_; // stateCount() x symbolCount_
+  std::vector<int32_t> output_;
+};
+
+/**
+ * @brief Expands abbreviations as they are typed, on any keyboard.
+ *
+ * Watches the system-wide keystroke stream through an OutputListener and
+ * keeps the automaton states of the last characters in a ring, so Backspace
+ * steps back without rescanning anything. When an abbreviation has been
+ * typed, its expansion, compiled up front into a macro of Backspaces and a
+ * text step, is handed to a MacroPlayer and goes out as one batch.
+ *
+ * Everything is built in the constructor; per keystroke there is no
+ * allocation and the work does not depend on the number of abbreviations.
+ */
+class TextExpander {
+public:
+  struct Expansion {
+    std::string abbreviation; // UTF-8
+    std::string text;         // UTF-8
+  };
+
+  /**
+   * @brief Read an abbreviation file.
+   *
+   * One expansion per line: the abbreviation, whitespace, then the text up
+   * to the end of the line (\n, \t and \\ are escapes). Lines starting with
+   * '#' and blank lines are skipped, e.g. ";sig Best regards,\nJane".
+   */
+  static std::optional<std::vector<Expansion>> loadFile(const QString &path);
+
+  explicit TextExpander(const std::vector<Expansion> &expansions);
+  ~TextExpander();
+
+  TextExpander(const TextExpander &) = delete;
+  TextExpander &operator=(const TextExpander &) = delete;
+  TextExpander(TextExpander &&) = delete;
+  TextExpander &operator=(TextExpander &&) = delete;
+
+  // Start watching keystrokes. Returns false if no listener is available.
+  bool start();
+
+  // One keystroke, as reported by the OutputListener (on its thread)
+  void onKeyEvent(char32_t codepoint, backend::Key key, backend::Modifier mods,
+                  bool pressed);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  // Longest abbreviation steps that Backspace can undo
+  static constexpr std::size_t kHistory = 64;
+
+  void push(ExpansionMatcher::State state);
+  void reset();
+  void expand(int32_t index);
+
+  ExpansionMatcher matcher_;
+  std::vector<std::shared_ptr<const Macro>> macros_;
+  // Keystrokes each expansion injects and the listener will report back
+  std::vector<uint32_t> echoes_;
+
+  // Listener thread only
+  std::array<ExpansionMatcher::State, kHistory> history_{};
+  std::size_t top_{0};
+  std::size_t depth_{0};
+  uint32_t pendingEchoes_{0};
+  Clock::time_point echoDeadline_;
+  bool disabled_{false};
+
+  MacroPlayer player_;
+  backend::OutputListener listener_;
+};
+
+} // namespace core
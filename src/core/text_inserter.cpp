@@ -0,0 +1,133 @@
+#include "text_inserter.hpp"
+
+#include "core/log.hpp"
+#include "core/trace.hpp"
+
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QMimeData>
+#include <QTimer>
+
+namespace core {
+
+namespace {
+
+// Every format, so an image or rich text survives the round trip
+std::unique_ptr<QMimeData> copyMimeData(const QMimeData *source) {
+  if (source == nullptr || source->formats().isEmpty()) {
+    return nullptr;
+  }
+  auto copy = std::make_unique<QMimeData>();
+  for (const QString &format : source->formats()) {
+    copy->setData(format, source->data(format));
+  }
+  return copy;
+}
+
+} // namespace
+
+TextInserter::TextInserter(backend::InputBackend *backend,
+                           const Config &config, QObject *parent)
+    : QObject(parent), backend_(backend), config_(config),
+      restoreTimer_(new QTimer(this)) {
+  restoreTimer_->setSingleShot(true);
+  QObject::connect(restoreTimer_, &QTimer::timeout, this,
+                   [this]() { restore(); });
+  QClipboard *clipboard = QGuiApplication::clipboard();
+  QObject::connect(clipboard, &QClipboard::dataChanged, this,
+                   [this, clipboard]() {
+                     // Our own writes notify either right away or later
+                     // (Windows), when we still own the clipboard
+                     if (pending_ && !writing_ &&
+                         !clipboard->ownsClipboard()) {
+                       // Copied by someone else: theirs now, not ours to undo
+                       restoreTimer_->stop();
+                       saved_.reset();
+                       pending_ = false;
+                     }
+                   });
+}
+
+TextInserter::~TextInserter() {
+  if (pending_) {
+    restore();
+  }
+}
+
+TextInserter::Strategy
+TextInserter::choose(std::size_t length, const backend::Capabilities &caps,
+                     std::size_t pasteThreshold) {
+  if (!caps.canInjectKeys) {
+    return Strategy::Keystrokes; // nothing to press the paste combo with
+  }
+  if (!caps.canInjectText) {
+    return Strategy::Clipboard;
+  }
+  return pasteThreshold > 0 && length >= pasteThreshold ? Strategy::Clipboard
+                                                        : Strategy::Keystrokes;
+}
+
+bool TextInserter::insert(const QString &text) {
+  if (text.isEmpty()) {
+    return true;
+  }
+  const auto length = static_cast<std::size_t>(text.size());
+  if (choose(length, backend_->capabilities(), config_.pasteThreshold) ==
+      Strategy::Clipboard) {
+    return paste(text);
+  }
+  TYPR_TRACE_SPAN("insert", "TextInserter::type");
+  return backend_->typeText(text.toStdU32String());
+}
+
+bool TextInserter::paste(const QString &text) {
+  TYPR_TRACE_SPAN("insert", "TextInserter::paste");
+  QClipboard *clipboard = QGuiApplication::clipboard();
+  // A paste whose restore is still due keeps the original contents saved
+  if (!pending_) {
+    saved_ = copyMimeData(clipboard->mimeData());
+  }
+  writing_ = true;
+  clipboard->setText(text);
+  writing_ = false;
+  // A window that does not take focus may be refused the selection (e.g. on
+  // Wayland); the combo would then paste whatever was there before
+  if (clipboard->text() != text) {
+    TYPR_LOG_WARN("insert", "the clipboard did not take {} characters",
+                  text.size());
+    if (!pending_) {
+      saved_.reset();
+    }
+    if (!backend_->capabilities().canInjectText) {
+      return false;
+    }
+    return backend_->typeText(text.toStdU32String());
+  }
+  pending_ = true;
+
+  // Modifiers the user holds (e.g. a latched Shift) would change the combo
+  const backend::Modifier held = backend_->activeModifiers();
+  backend_->releaseModifier(held);
+  const bool ok = backend_->combo(config_.pasteModifiers, config_.pasteKey);
+  backend_->holdModifier(held);
+  backend_->flush();
+
+  TYPR_LOG_DEBUG("insert", "pasted {} characters", text.size());
+  restoreTimer_->start(config_.restoreDelay);
+  return ok;
+}
+
+void TextInserter::restore() {
+  restoreTimer_->stop();
+  pending_ = false;
+  QClipboard *clipboard = QGuiApplication::clipboard();
+  writing_ = true;
+  if (saved_ != nullptr) {
+    clipboard->setMimeData(saved_.release());
+  } else {
+    clipboard->clear();
+  }
+  writing_ = false;
+}
+
+} // namespace core
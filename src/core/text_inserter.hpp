@@ -0,0 +1,85 @@
+#pragma once
+
+#include "backend/backend.hpp"
+
+#include <QObject>
+#include <QString>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+class QMimeData;
+class QTimer;
+
+namespace core {
+
+#ifdef __APPLE__
+inline constexpr backend::Modifier kPlatformPasteModifiers =
+    backend::Modifier::Super;
+#else
+inline constexpr backend::Modifier kPlatformPasteModifiers =
+    backend::Modifier::Ctrl;
+#endif
+
+/**
+ * @brief Inserts text into the focused application, by keystrokes or through
+ * the clipboard.
+ *
+ * Typing costs a few events per character, which makes a multi-kilobyte text
+ * take seconds. Above a size threshold the text is put on the clipboard
+ * instead and pasted with one key combo, whatever its length. What was on
+ * the clipboard before (every format of it) is put back once the target has
+ * had time to read the paste; if something else is copied in the meantime,
+ * that is left alone.
+ *
+ * The clipboard is also the only way to insert text on backends that can
+ * inject keys but not text (uinput). If the clipboard does not take the text,
+ * it is typed instead where the backend can, and insert() fails otherwise.
+ * Lives on the GUI thread.
+ */
+class TextInserter : public QObject {
+public:
+  enum class Strategy : uint8_t { Keystrokes, Clipboard };
+
+  struct Config {
+    // Texts of at least this many characters are pasted; 0 never pastes
+    // unless the backend cannot type text at all
+    std::size_t pasteThreshold{256};
+    // Ctrl+V, Cmd+V on macOS. Terminals may want Ctrl+Shift+V.
+    backend::Modifier pasteModifiers{kPlatformPasteModifiers};
+    backend::Key pasteKey{backend::Key::V};
+    // How long the target gets to read the clipboard before it is restored
+    std::chrono::milliseconds restoreDelay{300};
+  };
+
+  TextInserter(backend::InputBackend *backend, const Config &config,
+               QObject *parent = nullptr);
+  ~TextInserter() override;
+
+  TextInserter(const TextInserter &) = delete;
+  TextInserter &operator=(const TextInserter &) = delete;
+  TextInserter(TextInserter &&) = delete;
+  TextInserter &operator=(TextInserter &&) = delete;
+
+  [[nodiscard]] static Strategy choose(std::size_t length,
+                                       const backend::Capabilities &caps,
+                                       std::size_t pasteThreshold);
+
+  // Insert `text` at the cursor of the focused application
+  bool insert(const QString &text);
+
+private:
+  bool paste(const QString &text);
+  void restore();
+
+  backend::InputBackend *backend_;
+  Config config_;
+  QTimer *restoreTimer_;
+  // What the clipboard held before the first paste that is not restored yet;
+  // null if it was empty
+  std::unique_ptr<QMimeData> saved_;
+  bool pending_{false};
+  bool writing_{false};
+};
+
+} // namespace core
@@ -0,0 +1,208 @@
+#include "trace.hpp"
+
+#include "core/log.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace core::trace {
+
+namespace detail {
+
+std::atomic<bool> g_enabled{[]() {
+  const char *env = std::getenv("TYPR_OSK_TRACE");
+  return env != nullptr && env[0] != '\0' && env[0] != '0';
+}()};
+
+} // namespace detail
+
+namespace {
+
+// Buffers are registered once per thread and never freed, so spans of
+// threads that have exited can still be exported.
+std::mutex g_registryMutex;
+std::vector<std::unique_ptr<detail::ThreadBuffer>> g_buffers;
+
+thread_local detail::ThreadBuffer *t_buffer = nullptr;
+thread_local const char *t_threadName = nullptr;
+
+int processId() {
+#ifdef _WIN32
+  return _getpid();
+#else
+  return static_cast<int>(::getpid());
+#endif
+}
+
+void writeEscaped(std::FILE *file, const char *text) {
+  for (const char *cursor = text; *cursor != '\0'; ++cursor) {
+    if (*cursor == '"' || *cursor == '\\') {
+      std::fputc('\\', file);
+    }
+    std::fputc(*cursor, file);
+  }
+}
+
+#ifndef _WIN32
+int g_exportPipe[2] = {-1, -1};
+
+void onExportSignal(int /*signal*/) {
+  const char byte = 1;
+  [[maybe_unused]] const ssize_t ignored = ::write(g_exportPipe[1], &byte, 1);
+}
+#endif
+
+std::string exportPath() {
+  const char *path = std::getenv("TYPR_OSK_TRACE_FILE");
+  if (path != nullptr && path[0] != '\0') {
+    return path;
+  }
+  const char *tmp = std::getenv("TMPDIR");
+  std::string directory = tmp != nullptr && tmp[0] != '\0' ? tmp : "/tmp";
+  return directory + "/typr-trace-" + std::to_string(processId()) + ".json";
+}
+
+} // namespace
+
+namespace detail {
+
+ThreadBuffer &threadBuffer() {
+  if (t_buffer != nullptr) {
+    return *t_buffer;
+  }
+  auto buffer = std::make_unique<ThreadBuffer>();
+  buffer->threadName = t_threadName;
+  const std::lock_guard<std::mutex> lock(g_registryMutex);
+  buffer->threadId = g_buffers.size() + 1;
+  t_buffer = buffer.get();
+  g_buffers.push_back(std::move(buffer));
+  return *t_buffer;
+}
+
+} // namespace detail
+
+void setEnabled(bool enabled) {
+  detail::g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void setThreadName(const char *name) {
+  t_threadName = name;
+  if (t_buffer != nullptr) {
+    t_buffer->threadName = name;
+  }
+}
+
+bool exportChromeTrace(const char *path) {
+  std::FILE *file = std::fopen(path, "w");
+  if (file == nullptr) {
+    TYPR_LOG_WARN("core::trace", "cannot write trace file");
+    return false;
+  }
+
+  // Snapshot the buffer list; buffers themselves are never freed
+  std::vector<detail::ThreadBuffer *> buffers;
+  {
+    const std::lock_guard<std::mutex> lock(g_registryMutex);
+    buffers.reserve(g_buffers.size());
+    for (const auto &buffer : g_buffers) {
+      buffers.push_back(buffer.get());
+    }
+  }
+
+  const int pid = processId();
+  std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+  bool first = true;
+  std::size_t exported = 0;
+  std::size_t skipped = 0;
+  for (detail::ThreadBuffer *buffer : buffers) {
+    if (buffer->threadName != nullptr) {
+      std::fprintf(file,
+                   "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,"
+                   "\"tid\":%llu,\"args\":{\"name\":\"",
+                   first ? "" : ",", pid,
+                   static_cast<unsigned long long>(buffer->threadId));
+      writeEscaped(file, buffer->threadName);
+      std::fputs("\"}}", file);
+      first = false;
+    }
+
+    const uint64_t head = buffer->head.load(std::memory_order_acquire);
+    const uint64_t begin =
+        head > detail::kBufferSize ? head - detail::kBufferSize : 0;
+    for (uint64_t index = begin; index < head; ++index) {
+      const Event event =
+          buffer->events[index & (detail::kBufferSize - 1)];
+      // The owning thread may have lapped this slot while it was copied
+      std::atomic_thread_fence(std::memory_order_acquire);
+      const uint64_t now = buffer->head.load(std::memory_order_relaxed);
+      if (index + detail::kBufferSize <= now || event.site == nullptr) {
+        ++skipped;
+        continue;
+      }
+
+      std::fprintf(file, "%s\n{\"ph\":\"X\",\"cat\":\"", first ? "" : ",");
+      writeEscaped(file, event.site->category);
+      std::fputs("\",\"name\":\"", file);
+      writeEscaped(file, event.site->name);
+      std::fprintf(file,
+                   "\",\"pid\":%d,\"tid\":%llu,\"ts\":%.3f,\"dur\":%.3f}",
+                   pid, static_cast<unsigned long long>(buffer->threadId),
+                   static_cast<double>(event.beginNs) / 1000.0,
+                   static_cast<double>(event.durationNs) / 1000.0);
+      first = false;
+      ++exported;
+    }
+  }
+  std::fputs("\n]}\n", file);
+  const bool ok = std::ferror(file) == 0;
+  std::fclose(file);
+
+  TYPR_LOG_INFO("core::trace", "exported {} spans ({} overwritten)", exported,
+                skipped);
+  return ok;
+}
+
+void installExportHandler() {
+  static std::atomic<bool> installed{false};
+  if (installed.exchange(true)) {
+    return;
+  }
+
+#ifndef _WIN32
+  // Like the log dump: the signal only pokes a pipe and a helper thread
+  // writes the file, so nothing unsafe runs inside the handler.
+  if (::pipe(g_exportPipe) != 0) {
+    return;
+  }
+  std::thread([]() {
+    setThreadName("trace export");
+    char byte = 0;
+    while (::read(g_exportPipe[0], &byte, 1) == 1) {
+      const std::string path = exportPath();
+      if (exportChromeTrace(path.c_str())) {
+        std::fprintf(stderr, "[trace] wrote %s\n", path.c_str());
+      }
+    }
+  }).detach();
+
+  struct sigaction action{};
+  action.sa_handler = onExportSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGUSR2, &action, nullptr);
+#endif
+}
+
+} // namespace core::trace
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Span tracing with Chrome trace export.
+ *
+ * TYPR_TRACE_SPAN(category, name) times the enclosing scope. Each thread
+ * appends finished spans to its own fixed-size ring, so recording takes no
+ * lock and never allocates. The spans only become JSON when the rings are
+ * exported in the Chrome trace event format (open the file in
+ * chrome://tracing or ui.perfetto.dev). An export is triggered by SIGUSR2, or
+ * by calling exportChromeTrace() directly.
+ *
+ * Tracing is off until enabled with setEnabled() or the TYPR_OSK_TRACE
+ * environment variable; a disabled span costs one relaxed load. Building with
+ * TYPR_TRACE_ENABLED=0 removes the spans entirely.
+ *
+ * Category and name must be string literals (only the pointers are stored).
+ */
+
+#ifndef TYPR_TRACE_ENABLED
+#define TYPR_TRACE_ENABLED 1
+#endif
+
+namespace core::trace {
+
+struct Site {
+  const char *category;
+  const char *name;
+};
+
+struct Event {
+  const Site *site{nullptr};
+  int64_t beginNs{0};
+  int64_t durationNs{0};
+};
+
+namespace detail {
+
+static constexpr std::size_t kBufferSize = 8192; // events, power of two
+
+// Written only by its own thread; `head` is published with release order so
+// an exporter on another thread sees complete events below it.
+struct ThreadBuffer {
+  std::atomic<uint64_t> head{0};
+  uint64_t threadId{0};
+  const char *threadName{nullptr};
+  Event events[kBufferSize];
+};
+
+extern std::atomic<bool> g_enabled;
+
+ThreadBuffer &threadBuffer();
+
+inline int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+inline void record(const Site *site, int64_t beginNs, int64_t endNs) {
+  ThreadBuffer &buffer = threadBuffer();
+  const uint64_t index = buffer.head.load(std::memory_order_relaxed);
+  Event &event = buffer.events[index & (kBufferSize - 1)];
+  event.site = site;
+  event.beginNs = beginNs;
+  event.durationNs = endNs - beginNs;
+  buffer.head.store(index + 1, std::memory_order_release);
+}
+
+} // namespace detail
+
+[[nodiscard]] inline bool isEnabled() {
+  return detail::g_enabled.load(std::memory_order_relaxed);
+}
+
+// Start or stop recording. Initialised from TYPR_OSK_TRACE.
+void setEnabled(bool enabled);
+
+// Name the calling thread in exported traces (string literal)
+void setThreadName(const char *name);
+
+// Times its own lifetime; use through TYPR_TRACE_SPAN
+class Span {
+public:
+  explicit Span(const Site *site)
+      : site_(isEnabled() ? site : nullptr),
+        beginNs_(site_ != nullptr ? detail::nowNs() : 0) {}
+
+  ~Span() {
+    if (site_ != nullptr) {
+      detail::record(site_, beginNs_, detail::nowNs());
+    }
+  }
+
+  Span(const Span &) = delete;
+  Span &operator=(const Span &) = delete;
+  Span(Span &&) = delete;
+  Span &operator=(Span &&) = delete;
+
+private:
+  const Site *site_;
+  int64_t beginNs_;
+};
+
+/**
+ * @brief Write every recorded span as Chrome trace JSON to @p path.
+ *
+ * Spans that are overwritten while the export runs are skipped. Must not be
+ * called from a signal handler.
+ *
+ * @return false if the file could not be written.
+ */
+bool exportChromeTrace(const char *path);
+
+/**
+ * @brief Install the export trigger: SIGUSR2 writes the trace to the file
+ * named by TYPR_OSK_TRACE_FILE (typr-trace-<pid>.json in the temporary
+ * directory by default). Safe to call more than once.
+ */
+void installExportHandler();
+
+} // namespace core::trace
+
+#define TYPR_TRACE_CONCAT_INNER(a, b) a##b
+#define TYPR_TRACE_CONCAT(a, b) TYPR_TRACE_CONCAT_INNER(a, b)
+
+#if TYPR_TRACE_ENABLED
+#define TYPR_TRACE_SPAN(category, name)                                        \
+  static constexpr ::core::trace::Site TYPR_TRACE_CONCAT(typrTraceSite,        \
+                                                         __LINE__){category,   \
+                                                                   name};      \
+  const ::core::trace::Span TYPR_TRACE_CONCAT(typrTraceSpan, __LINE__)(        \
+      &TYPR_TRACE_CONCAT(typrTraceSite, __LINE__))
+#else
+#define TYPR_TRACE_SPAN(category, name)                                        \
+  do {                                                                         \
+  } while (false)
+#endif
@@ -1,140 +1,243 @@
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QEvent>
 #include <QHBoxLayout>
 #include <QPushButton>
+#include <QTimer>
 #include <QVBoxLayout>
 #include <QWidget>
+#include <functional>
+#include <memory>
 #include <unordered_map>
-#include <vector>
 
 #include "backend/backend.hpp"
-#include "core/layout.hpp"
+#include "backend/backend_registry.hpp"
+#include "core/bulk_typer.hpp"
+#include "core/control_server.hpp"
+#include "core/keyboard_controller.hpp"
+#include "core/layout_file.hpp"
+#include "core/log.hpp"
+#include "core/text_expander.hpp"
+#include "core/text_inserter.hpp"
+#include "core/trace.hpp"
+#include "ui/keyboard_window.hpp"
 #include "ui/widgets.hpp"
 #include "ui/window.hpp"
 
 namespace {
-// Layout constants
-constexpr float kUnit1_5 = 1.5F;   // 60px / 40px
-constexpr float kUnit1_75 = 1.75F; // 70px / 40px
-constexpr float kUnit2_0 = 2.0F;   // 80px / 40px
-constexpr float kUnit2_25 = 2.25F; // 90px / 40px
-constexpr float kUnit2_5 = 2.5F;   // 100px / 40px
-constexpr float kUnit6_25 = 6.25F; // 250px / 40px
-
 struct AppState {
   std::unordered_map<std::string, QWidget *> windows;
 };
+
+// When the keyboard window is built
+enum class StartupMode : uint8_t {
+  Eager,    // before the event loop starts (everything up front)
+  Idle,     // right after the toggle window has painted
+  OnDemand, // the first time the toggle button shows it
+};
+
+StartupMode parseStartupMode(const QString &value) {
+  if (value == "idle") {
+    return StartupMode::Idle;
+  }
+  return value == "on-demand" ? StartupMode::OnDemand : StartupMode::Eager;
+}
+
+// Times each startup phase from the start of main() and logs it
+class StartupProfile {
+public:
+  StartupProfile() { clock_.start(); }
+
+  void mark(const char *phase) {
+    const qint64 nowUs = clock_.nsecsElapsed() / 1000;
+    TYPR_LOG_INFO("main", "startup: {} took {} us ({} us since start)", phase,
+                  nowUs - lastUs_, nowUs);
+    lastUs_ = nowUs;
+  }
+
+private:
+  QElapsedTimer clock_;
+  qint64 lastUs_{0};
+};
+
+// Runs a callback once, after the first paint of a widget has been handled
+// (i.e. its first pixels are on the way to the screen)
+class FirstPaintWatcher : public QObject {
+public:
+  FirstPaintWatcher(QWidget *widget, std::function<void()> onPainted)
+      : QObject(widget), onPainted_(std::move(onPainted)) {
+    widget->installEventFilter(this);
+  }
+
+protected:
+  bool eventFilter(QObject *watched, QEvent *event) override {
+    if (event->type() == QEvent::Paint) {
+      watched->removeEventFilter(this);
+      // Queued, so it runs once this paint has been flushed
+      QTimer::singleShot(0, watched, std::move(onPainted_));
+      deleteLater();
+    }
+    return QObject::eventFilter(watched, event);
+  }
+
+private:
+  std::function<void()> onPainted_;
+};
 } // namespace
 
 int main(int argc, char **argv) {
+  StartupProfile startup;
   QApplication app(argc, argv);
   qDebug() << "[main] Application started";
 
+  QCommandLineParser parser;
+  parser.addHelpOption();
+  const QCommandLineOption rendererOption(
+      "renderer",
+      "How keys are drawn: 'widgets' (one button per key) or 'painted' (the "
+      "whole keyboard in a single widget).",
+      "renderer", "widgets");
+  parser.addOption(rendererOption);
+  const QCommandLineOption layoutOption(
+      "layout", "Keyboard layout file to load.", "file",
+      QCoreApplication::applicationDirPath() + "/layouts/qwerty.layout");
+  parser.addOption(layoutOption);
+  const QCommandLineOption startupOption(
+      "startup",
+      "When the keyboard is built: 'eager' (before anything is shown), 'idle' "
+      "(right after the toggle window is on screen) or 'on-demand' (the first "
+      "time it is shown).",
+      "mode", "eager");
+  parser.addOption(startupOption);
+  const QCommandLineOption controlOption(
+      "control-socket",
+      "Accept commands from other programs on a local socket (protocol in "
+      "core/control_protocol.hpp); 'default' is "
+      "$XDG_RUNTIME_DIR/typr-osk.sock.",
+      "path");
+  parser.addOption(controlOption);
+  const QCommandLineOption expansionsOption(
+      "expansions",
+      "Expand abbreviations typed on any keyboard, from a file of "
+      "'abbreviation text' lines.",
+      "file");
+  parser.addOption(expansionsOption);
+  const QCommandLineOption pasteThresholdOption(
+      "paste-threshold",
+      "Insert texts of at least this many characters through the clipboard "
+      "instead of typing them; 0 types everything the backend can type.",
+      "characters", "256");
+  parser.addOption(pasteThresholdOption);
+#if defined(__linux__)
+  const QCommandLineOption backendOption(
+      "backend",
+      "Key injection backend: 'uinput', 'x11', 'wayland', or 'auto' (the one "
+      "picked for this session type last time, else the first that works).",
+      "backend", "auto");
+  parser.addOption(backendOption);
+  const QCommandLineOption probeBackendsOption(
+      "probe-backends",
+      "Try every backend for this session type again, measuring each with "
+      "Shift taps, and keep the fastest.");
+  parser.addOption(probeBackendsOption);
+#endif
+  parser.process(app);
+  const auto renderer = parser.value(rendererOption) == "painted"
+                            ? ui::KeyboardWindow::Renderer::Painted
+                            : ui::KeyboardWindow::Renderer::Widgets;
+  const StartupMode startupMode =
+      parseStartupMode(parser.value(startupOption));
+  startup.mark("application");
+
+  // Parsed up front even when the keyboard is deferred, so a broken layout
+  // still fails at startup (a valid cache makes this a memory map)
+  const auto keySpecs = layout::loadLayoutFile(parser.value(layoutOption));
+  if (!keySpecs) {
+    qCritical() << "[main] No usable keyboard layout, exiting";
+    return 1;
+  }
+  startup.mark("layout file");
+
+  // SIGUSR1 / crashes dump the in-memory log ring; SIGUSR2 exports the
+  // recorded spans (TYPR_OSK_TRACE=1) as a Chrome trace
+  core::log::installDumpHandlers();
+  core::trace::setThreadName("main");
+  core::trace::installExportHandler();
+
   ui::initializeAppleApp();
   ui::installNoActivationFilter(&app);
 
-  backend::InputBackend keyboard;
-  if (!keyboard.isReady()) {
-    keyboard.requestPermissions();
+#if defined(__linux__)
+  // Before ensureKeyboard() opens the backend
+  backend::BackendRegistry &backends = backend::BackendRegistry::instance();
+  if (const QString name = parser.value(backendOption); name != "auto") {
+    if (const auto type = backend::backendFromName(name.toStdString())) {
+      backends.pin(*type);
+    } else {
+      qWarning() << "[main] Unknown backend" << name << "- picking one";
+    }
+  } else if (parser.isSet(probeBackendsOption)) {
+    backend::BackendRegistry::Options options;
+    options.ignoreCache = true;
+    options.benchmark = true;
+    const auto selection =
+        backends.select(backend::currentSessionType(), options);
+    for (const backend::BackendProbe &probe : selection.probes) {
+      const std::string_view name = backend::backendName(probe.type);
+      qDebug() << "[main] Backend"
+               << QString::fromUtf8(name.data(), static_cast<int>(name.size()))
+               << "available" << probe.available << "ready" << probe.ready
+               << "tap latency" << probe.tapLatency.count() << "us";
+    }
   }
+#endif
 
   AppState state;
 
-  // --- Main Keyboard Window ---
-  ui::Window keyboardWindow;
-  state.windows["keyboard"] = &keyboardWindow;
-
-  layout::ElementListBuilder listBuilder(&keyboard, &keyboardWindow);
-
-  // --- Row 0: Numbers & Backspace ---
-  listBuilder.addKey(backend::Key::Escape);
-  listBuilder.addKey(backend::Key::Grave);
-  listBuilder.addKey(backend::Key::Num1);
-  listBuilder.addKey(backend::Key::Num2);
-  listBuilder.addKey(backend::Key::Num3);
-  listBuilder.addKey(backend::Key::Num4);
-  listBuilder.addKey(backend::Key::Num5);
-  listBuilder.addKey(backend::Key::Num6);
-  listBuilder.addKey(backend::Key::Num7);
-  listBuilder.addKey(backend::Key::Num8);
-  listBuilder.addKey(backend::Key::Num9);
-  listBuilder.addKey(backend::Key::Num0);
-  listBuilder.addKey(backend::Key::Minus);
-  listBuilder.addKey(backend::Key::Equal);
-  listBuilder.addKey(backend::Key::Backspace, kUnit2_0);
-
-  // --- Row 1: Tab & QWERTY ---
-  listBuilder.nextRow();
-  listBuilder.addKey(backend::Key::Tab, kUnit1_5);
-  listBuilder.addKey(backend::Key::Q);
-  listBuilder.addKey(backend::Key::W);
-  listBuilder.addKey(backend::Key::E);
-  listBuilder.addKey(backend::Key::R);
-  listBuilder.addKey(backend::Key::T);
-  listBuilder.addKey(backend::Key::Y);
-  listBuilder.addKey(backend::Key::U);
-  listBuilder.addKey(backend::Key::I);
-  listBuilder.addKey(backend::Key::O);
-  listBuilder.addKey(backend::Key::P);
-  listBuilder.addKey(backend::Key::LeftBracket);
-  listBuilder.addKey(backend::Key::RightBracket);
-  listBuilder.addKey(backend::Key::Backslash, kUnit1_5);
-
-  // --- Row 2: Caps & ASDF ---
-  listBuilder.nextRow();
-  listBuilder.addKey(backend::Key::CapsLock, kUnit1_75, 1.0F, true);
-  listBuilder.addKey(backend::Key::A);
-  listBuilder.addKey(backend::Key::S);
-  listBuilder.addKey(backend::Key::D);
-  listBuilder.addKey(backend::Key::F);
-  listBuilder.addKey(backend::Key::G);
-  listBuilder.addKey(backend::Key::H);
-  listBuilder.addKey(backend::Key::J);
-  listBuilder.addKey(backend::Key::K);
-  listBuilder.addKey(backend::Key::L);
-  listBuilder.addKey(backend::Key::Semicolon);
-  listBuilder.addKey(backend::Key::Apostrophe);
-  listBuilder.addKey(backend::Key::Enter, kUnit2_25);
-
-  // --- Row 3: Shift & ZXCV ---
-  listBuilder.nextRow();
-  listBuilder.addKey(backend::Key::ShiftLeft, kUnit2_5, 1.0F, true);
-  listBuilder.addKey(backend::Key::Z);
-  listBuilder.addKey(backend::Key::X);
-  listBuilder.addKey(backend::Key::C);
-  listBuilder.addKey(backend::Key::V);
-  listBuilder.addKey(backend::Key::B);
-  listBuilder.addKey(backend::Key::N);
-  listBuilder.addKey(backend::Key::M);
-  listBuilder.addKey(backend::Key::Comma);
-  listBuilder.addKey(backend::Key::Period);
-  listBuilder.addKey(backend::Key::Slash);
-  listBuilder.addKey(backend::Key::ShiftRight, kUnit2_5, 1.0F, true);
-
-  // --- Row 4: Modifiers & Space ---
-  listBuilder.nextRow();
-  listBuilder.addKey(backend::Key::CtrlLeft, kUnit1_5, 1.0F, true);
-  listBuilder.addKey(backend::Key::AltLeft, kUnit1_5, 1.0F, true);
-  listBuilder.addKey(backend::Key::SuperLeft, kUnit1_5, 1.0F, true);
-  listBuilder.addKey(backend::Key::Space, kUnit6_25);
-  listBuilder.addKey(backend::Key::SuperRight, kUnit1_5, 1.0F, true);
-  listBuilder.addKey(backend::Key::AltRight, kUnit1_5, 1.0F, true);
-
-  listBuilder.addKey(backend::Key::Left);
-  listBuilder.addKey(backend::Key::Up);
-  listBuilder.addKey(backend::Key::Down);
-  listBuilder.addKey(backend::Key::Right);
-
-  std::vector<layout::Element> elements = std::move(listBuilder).build();
-  auto *mainLayout = layout::toQtLayout(elements);
-
-  keyboardWindow.initialize(ui::Window::WindowFlag::StaysOnTop |
-                                ui::Window::WindowFlag::Transparent,
-                            mainLayout, "Typr OSK");
-
-  keyboardWindow.adjustSize();
-  qDebug() << "[main] Showing keyboard window";
-  keyboardWindow.show();
+  // Built together by ensureKeyboard(). The controller owns the state and
+  // timers of every key and must outlive the window's elements; the backend
+  // must outlive the controller.
+  std::unique_ptr<backend::InputBackend> keyboard;
+  std::unique_ptr<core::KeyboardController> controller;
+  std::unique_ptr<ui::KeyboardWindow> keyboardWindow;
+
+  const auto ensureKeyboard = [&]() -> ui::KeyboardWindow * {
+    if (keyboardWindow != nullptr) {
+      return keyboardWindow.get();
+    }
+
+    // Opening the backend can block (uinput waits for its device node)
+    keyboard = std::make_unique<backend::InputBackend>();
+    if (!keyboard->isReady()) {
+      keyboard->requestPermissions();
+    }
+    controller = std::make_unique<core::KeyboardController>(keyboard.get());
+    startup.mark("input backend");
+
+    keyboardWindow = std::make_unique<ui::KeyboardWindow>(
+        controller.get(), parser.value(layoutOption), *keySpecs, renderer);
+    state.windows["keyboard"] = keyboardWindow.get();
+    startup.mark("keyboard window");
+
+    new FirstPaintWatcher(keyboardWindow.get(), [&startup]() {
+      startup.mark("keyboard first paint");
+    });
+    return keyboardWindow.get();
+  };
+
+  const auto showKeyboard = [](QWidget *window) {
+    window->show();
+    // Re-apply non-activating status once the native window is mapped
+    QTimer::singleShot(0, window,
+                       [window]() { ui::makeNonActivating(window); });
+  };
+
+  if (startupMode == StartupMode::Eager) {
+    qDebug() << "[main] Showing keyboard window";
+    ensureKeyboard()->show();
+  }
 
   // --- Toggle Button Window ---
   ui::Window toggleWindow;
@@ -144,18 +247,117 @@ int main(int argc, char **argv) {
   auto *toggleButton = new QPushButton("Toggle Keyboard");
   toggleLayout->addWidget(toggleButton);
 
-  QObject::connect(toggleButton, &QPushButton::clicked, [&state]() {
+  const auto setKeyboardVisible = [&](bool visible) {
+    // A deferred keyboard is built here if the idle callback has not run yet
+    ensureKeyboard();
     auto windowIter = state.windows.find("keyboard");
-    if (windowIter != state.windows.end() && windowIter->second != nullptr) {
-      if (windowIter->second->isVisible()) {
-        windowIter->second->hide();
-      } else {
-        windowIter->second->show();
-        // Re-apply non-activating status if needed after showing
-        ui::makeNonActivating(windowIter->second);
+    if (windowIter == state.windows.end() || windowIter->second == nullptr) {
+      return;
+    }
+    if (!visible) {
+      windowIter->second->hide();
+    } else if (!windowIter->second->isVisible()) {
+      showKeyboard(windowIter->second);
+    }
+  };
+  const auto toggleKeyboard = [&]() {
+    setKeyboardVisible(!ensureKeyboard()->isVisible());
+  };
+
+  QObject::connect(toggleButton, &QPushButton::clicked, toggleKeyboard);
+
+  // --- Control Socket ---
+  // Each request runs here as one batch. Keys and text go straight to the
+  // backend, next to (not through) the on-screen keys; long text is pasted
+  // and bulk text goes out in the background.
+  std::unique_ptr<core::BulkTyper> bulkTyper;
+  std::unique_ptr<core::TextInserter> textInserter;
+  const auto runControlBatch = [&](const core::ControlBatch &batch) {
+    ui::KeyboardWindow *window = ensureKeyboard();
+    if (textInserter == nullptr) {
+      core::TextInserter::Config config;
+      config.pasteThreshold = parser.value(pasteThresholdOption).toULongLong();
+      textInserter =
+          std::make_unique<core::TextInserter>(keyboard.get(), config);
+    }
+    uint32_t succeeded = 0;
+    for (const core::ControlCommand &command : batch.commands) {
+      bool ok = true;
+      switch (command.op) {
+      case core::ControlOp::Show:
+        setKeyboardVisible(true);
+        break;
+      case core::ControlOp::Hide:
+        setKeyboardVisible(false);
+        break;
+      case core::ControlOp::Toggle:
+        toggleKeyboard();
+        break;
+      case core::ControlOp::Layer:
+        ok = window->lockLayer(command.layer);
+        break;
+      case core::ControlOp::KeyDown:
+        ok = keyboard->keyDown(command.key);
+        break;
+      case core::ControlOp::KeyUp:
+        ok = keyboard->keyUp(command.key);
+        break;
+      case core::ControlOp::Tap:
+        ok = keyboard->tap(command.key);
+        break;
+      case core::ControlOp::Combo:
+        ok = keyboard->combo(command.mods, command.key);
+        break;
+      case core::ControlOp::Text: {
+        const std::string_view text = batch.textOf(command);
+        ok = textInserter->insert(QString::fromUtf8(
+            text.data(), static_cast<qsizetype>(text.size())));
+        break;
+      }
+      case core::ControlOp::BulkText: {
+        if (bulkTyper == nullptr) {
+          bulkTyper = std::make_unique<core::BulkTyper>();
+        }
+        const std::string_view text = batch.textOf(command);
+        ok = bulkTyper->type(
+            QString::fromUtf8(text.data(), static_cast<qsizetype>(text.size()))
+                .toStdU32String());
+        break;
       }
+      case core::ControlOp::DumpLog:
+        core::log::dumpToOutput(int64_t{command.seconds} * 1000);
+        break;
+      }
+      succeeded += ok ? 1 : 0;
     }
-  });
+    keyboard->flush();
+    return succeeded;
+  };
+
+  std::unique_ptr<core::ControlServer> controlServer;
+  if (parser.isSet(controlOption)) {
+    const QString value = parser.value(controlOption);
+    const std::string path = value == "default"
+                                 ? core::ControlServer::defaultPath()
+                                 : value.toStdString();
+    controlServer = std::make_unique<core::ControlServer>(runControlBatch);
+    if (!controlServer->listen(path)) {
+      qWarning() << "[main] Control socket not available";
+      controlServer.reset();
+    }
+  }
+
+  // --- Abbreviation Expansion ---
+  std::unique_ptr<core::TextExpander> expander;
+  if (parser.isSet(expansionsOption)) {
+    if (const auto expansions =
+            core::TextExpander::loadFile(parser.value(expansionsOption))) {
+      expander = std::make_unique<core::TextExpander>(*expansions);
+      if (!expander->start()) {
+        expander.reset();
+      }
+    }
+  }
 
   toggleWindow.initialize(ui::Window::WindowFlag::StaysOnTop |
                               ui::Window::WindowFlag::Transparent |
@@ -164,15 +366,35 @@ int main(int argc, char **argv) {
 
   toggleWindow.adjustSize();
   toggleWindow.setFixedSize(toggleWindow.sizeHint());
+  startup.mark("toggle window");
+
+  new FirstPaintWatcher(&toggleWindow, [&]() {
+    startup.mark("toggle first paint");
+    if (startupMode == StartupMode::Idle) {
+      // The first pixels are out; build the keyboard when the loop is idle
+      QTimer::singleShot(0, &toggleWindow, [&]() {
+        if (keyboardWindow == nullptr) {
+          showKeyboard(ensureKeyboard());
+        }
+      });
+    }
+  });
   qDebug() << "[main] Showing toggle window";
   toggleWindow.show();
 
-  qDebug() << "[main] Processing events";
-  app.processEvents();
+  if (startupMode == StartupMode::Eager) {
+    qDebug() << "[main] Processing events";
+    app.processEvents();
 
-  qDebug() << "[main] Making keyboard non-activating";
-  ui::makeNonActivating(&keyboardWindow);
-  ui::makeNonActivating(&toggleWindow);
+    qDebug() << "[main] Making keyboard non-activating";
+    ui::makeNonActivating(keyboardWindow.get());
+    ui::makeNonActivating(&toggleWindow);
+  } else {
+    // Nothing is forced through before the loop starts; the toggle window is
+    // made non-activating once it is mapped
+    QTimer::singleShot(0, &toggleWindow,
+                       [&]() { ui::makeNonActivating(&toggleWindow); });
+  }
 
   qDebug() << "[main] Entering event loop";
   return app.exec();
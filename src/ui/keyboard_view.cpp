@@ -0,0 +1,266 @@
+#include "ui/keyboard_view.hpp"
+
+#include "core/log.hpp"
+#include "core/trace.hpp"
+#include "ui/touch_input.hpp"
+
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <algorithm>
+#include <utility>
+
+namespace ui {
+
+namespace {
+constexpr qreal kCornerRadius = 4.0;
+} // namespace
+
+KeyboardView::KeyboardView(core::KeyboardController *controller,
+                           const std::vector<layout::Element> &elements,
+                           QWidget *parent)
+    : QWidget(parent), controller_(controller) {
+  setAttribute(Qt::WA_ShowWithoutActivating, true);
+  setFocusPolicy(Qt::NoFocus);
+  setContextMenuPolicy(Qt::NoContextMenu);
+  setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+
+  setElements(elements);
+  controller_->setOnStateChanged([this](Slot slot) { onStateChanged(slot); });
+
+  // Each finger presses its own key; accepting touch here also keeps Qt from
+  // synthesizing mouse events for it.
+  new TouchKeyRouter(this, controller_, [this](const QPointF &position) {
+    return slotAt(position);
+  });
+
+  TYPR_LOG_DEBUG("ui::KeyboardView", "painting {} keys on {} layers",
+                 elements.size(), layers_.size());
+}
+
+KeyboardView::~KeyboardView() { controller_->setOnStateChanged(nullptr); }
+
+void KeyboardView::setElements(const std::vector<layout::Element> &elements) {
+  int layerCount = 1;
+  for (const auto &element : elements) {
+    layerCount = std::max(layerCount, element.layer() + 1);
+  }
+
+  layers_.clear();
+  layers_.resize(static_cast<std::size_t>(layerCount));
+  keyIndex_.assign(controller_->size(), KeyRef{});
+  minimumSize_ = QSize();
+
+  for (int layerIndex = 0; layerIndex < layerCount; ++layerIndex) {
+    Layer &layer = layers_[static_cast<std::size_t>(layerIndex)];
+    layer.geometry = layout::Geometry(elements, layerIndex);
+    layer.keys.reserve(layer.geometry.order().size());
+    for (const std::size_t index : layer.geometry.order()) {
+      const Slot slot = elements[index].input()->slot();
+      keyIndex_[slot] = KeyRef{.layer = layerIndex,
+                               .index = static_cast<int>(layer.keys.size())};
+      prepareLabel(layer.keys.emplace_back(Key{.slot = slot}));
+    }
+    // Sized for the largest layer, so a switch never resizes the window
+    minimumSize_ = minimumSize_.expandedTo(layer.geometry.minimumSize());
+  }
+
+  current_ = std::min(current_, layers_.size() - 1);
+  relayout();
+  updateGeometry();
+  update();
+}
+
+void KeyboardView::setLayer(int layer) {
+  const auto index = static_cast<std::size_t>(layer);
+  if (layer < 0 || index >= layers_.size() || index == current_) {
+    return;
+  }
+  current_ = index;
+  update();
+}
+
+KeyboardView::Slot KeyboardView::slotAt(const QPointF &position) const {
+  const Layer &layer = layers_[current_];
+  const std::size_t index = layer.geometry.hitTest(position.toPoint());
+  return index != layout::Geometry::kNoKey
+             ? layer.keys[index].slot
+             : core::KeyboardController::kInvalidSlot;
+}
+
+QSize KeyboardView::sizeHint() const { return minimumSizeHint(); }
+
+QSize KeyboardView::minimumSizeHint() const { return minimumSize_; }
+
+KeyboardView::KeyState KeyboardView::stateOf(const Key &key) const {
+  if (controller_->isDown(key.slot)) {
+    return Down;
+  }
+  return controller_->isToggled(key.slot) ? Toggled : Normal;
+}
+
+void KeyboardView::onStateChanged(Slot slot) {
+  if (slot >= keyIndex_.size() || keyIndex_[slot].layer < 0) {
+    return;
+  }
+  const KeyRef ref = keyIndex_[slot];
+  Key &key = layers_[static_cast<std::size_t>(ref.layer)]
+                 .keys[static_cast<std::size_t>(ref.index)];
+  if (key.label.text() != controller_->label(slot)) {
+    prepareLabel(key);
+  }
+  if (static_cast<std::size_t>(ref.layer) == current_) {
+    // Only the key that changed is repainted
+    update(key.rect);
+  }
+}
+
+void KeyboardView::relayout() {
+  // Hidden layers are solved too, so a layer switch is only a repaint
+  for (auto &layer : layers_) {
+    const std::vector<QRect> &rects = layer.geometry.solve(size());
+    for (std::size_t index = 0; index < layer.keys.size(); ++index) {
+      layer.keys[index].rect = rects[index];
+    }
+  }
+  atlasDirty_ = true;
+}
+
+void KeyboardView::rebuildAtlas() {
+  // One column per distinct key size, one row per state. A full keyboard has
+  // around ten distinct sizes, so the atlas stays small.
+  std::vector<std::pair<QSize, int>> columns; // size -> atlas x
+  int atlasWidth = 0;
+  atlasRowHeight_ = 0;
+  for (auto &layer : layers_) {
+    for (auto &key : layer.keys) {
+      const QSize size = key.rect.size();
+      auto found = std::ranges::find(columns, size,
+                                     &std::pair<QSize, int>::first);
+      if (found != columns.end()) {
+        key.atlasX = found->second;
+        continue;
+      }
+      key.atlasX = atlasWidth;
+      columns.emplace_back(size, atlasWidth);
+      atlasWidth += size.width() + 1;
+      atlasRowHeight_ = std::max(atlasRowHeight_, size.height() + 1);
+    }
+  }
+
+  const qreal ratio = devicePixelRatioF();
+  atlas_ = QPixmap(QSize(std::max(atlasWidth, 1),
+                         std::max(atlasRowHeight_ * StateCount, 1)) *
+                   ratio);
+  atlas_.setDevicePixelRatio(ratio);
+  atlas_.fill(Qt::transparent);
+
+  const QPalette &pal = palette();
+  const QColor fills[StateCount] = {pal.color(QPalette::Button),
+                                    pal.color(QPalette::Mid),
+                                    pal.color(QPalette::Highlight)};
+
+  QPainter painter(&atlas_);
+  painter.setRenderHint(QPainter::Antialiasing, true);
+  painter.setPen(pal.color(QPalette::Shadow));
+  for (const auto &[size, x] : columns) {
+    for (int state = 0; state < StateCount; ++state) {
+      painter.setBrush(fills[state]);
+      painter.drawRoundedRect(QRectF(x, state * atlasRowHeight_, size.width(),
+                                     size.height())
+                                  .adjusted(0.5, 0.5, -0.5, -0.5),
+                              kCornerRadius, kCornerRadius);
+    }
+  }
+
+  atlasDirty_ = false;
+}
+
+void KeyboardView::prepareLabel(Key &key) const {
+  key.label.setText(controller_->label(key.slot));
+  key.label.setTextFormat(Qt::PlainText);
+  key.label.prepare(QTransform(), font());
+}
+
+void KeyboardView::paintEvent(QPaintEvent *event) {
+  TYPR_TRACE_SPAN("ui", "KeyboardView::paintEvent");
+  if (atlasDirty_ || atlas_.devicePixelRatio() != devicePixelRatioF()) {
+    rebuildAtlas();
+  }
+
+  QPainter painter(this);
+  painter.setFont(font());
+  const QRegion &damage = event->region();
+  const qreal ratio = atlas_.devicePixelRatio();
+  const QPalette &pal = palette();
+
+  for (const auto &key : layers_[current_].keys) {
+    if (!damage.intersects(key.rect)) {
+      continue;
+    }
+    const KeyState state = stateOf(key);
+    const QRectF source(key.atlasX * ratio, state * atlasRowHeight_ * ratio,
+                        key.rect.width() * ratio, key.rect.height() * ratio);
+    painter.drawPixmap(QRectF(key.rect), atlas_, source);
+
+    painter.setPen(pal.color(state == Toggled ? QPalette::HighlightedText
+                                              : QPalette::ButtonText));
+    const QSizeF labelSize = key.label.size();
+    painter.drawStaticText(
+        QPointF(key.rect.center()) -
+            QPointF(labelSize.width() / 2.0, labelSize.height() / 2.0),
+        key.label);
+  }
+}
+
+void KeyboardView::resizeEvent(QResizeEvent *event) {
+  QWidget::resizeEvent(event);
+  relayout();
+}
+
+void KeyboardView::changeEvent(QEvent *event) {
+  switch (event->type()) {
+  case QEvent::PaletteChange:
+  case QEvent::StyleChange:
+    atlasDirty_ = true;
+    update();
+    break;
+  case QEvent::FontChange:
+    for (auto &layer : layers_) {
+      for (auto &key : layer.keys) {
+        prepareLabel(key);
+      }
+    }
+    update();
+    break;
+  default:
+    break;
+  }
+  QWidget::changeEvent(event);
+}
+
+void KeyboardView::mousePressEvent(QMouseEvent *event) {
+  TYPR_TRACE_SPAN("ui", "KeyboardView::mousePressEvent");
+  // Any button presses the key, like RightClickableToolButton does
+  event->accept();
+  if (mouseSlot_ != core::KeyboardController::kInvalidSlot) {
+    return;
+  }
+  mouseSlot_ = slotAt(event->position());
+  if (mouseSlot_ != core::KeyboardController::kInvalidSlot) {
+    controller_->press(mouseSlot_);
+  }
+}
+
+void KeyboardView::mouseReleaseEvent(QMouseEvent *event) {
+  TYPR_TRACE_SPAN("ui", "KeyboardView::mouseReleaseEvent");
+  event->accept();
+  if (event->buttons() != Qt::NoButton ||
+      mouseSlot_ == core::KeyboardController::kInvalidSlot) {
+    return;
+  }
+  controller_->release(
+      std::exchange(mouseSlot_, core::KeyboardController::kInvalidSlot));
+}
+
+} // namespace ui
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "core/geometry.hpp"
+#include "core/keyboard_controller.hpp"
+#include "core/layout.hpp"
+
+#include <QPixmap>
+#include <QStaticText>
+#include <QWidget>
+#include <cstdint>
+#include <vector>
+
+namespace ui {
+
+/**
+ * @brief Draws a whole keyboard in a single widget.
+ *
+ * Alternative to layout::toQtLayout(): instead of one RightClickableToolButton
+ * per key, the view paints every key of an Element list (built without
+ * buttons) itself, at the positions solved by layout::Geometry. Captions are
+ * cached as QStaticText, key backgrounds are pre-rendered once per size and
+ * state into a pixmap atlas, and a state change only repaints that key's
+ * rectangle. Mouse and touch hit-testing happen here
+ * as well and drive the KeyboardController directly.
+ *
+ * Every layer of the list is solved and cached up front, so switching layers
+ * only changes which one is painted and hit-tested.
+ *
+ * The elements must outlive the view (their Inputs own the controller slots).
+ */
+class KeyboardView : public QWidget {
+public:
+  using Slot = core::KeyboardController::Slot;
+
+  KeyboardView(core::KeyboardController *controller,
+               const std::vector<layout::Element> &elements,
+               QWidget *parent = nullptr);
+
+  KeyboardView(const KeyboardView &) = delete;
+  KeyboardView &operator=(const KeyboardView &) = delete;
+  KeyboardView(KeyboardView &&) = delete;
+  KeyboardView &operator=(KeyboardView &&) = delete;
+
+  ~KeyboardView() override;
+
+  // Show a new Element list (e.g. after a layout reload). Keys keep their
+  // controller slots, so pressed and toggled keys stay that way.
+  void setElements(const std::vector<layout::Element> &elements);
+
+  // Show another layer of the element list; costs one repaint
+  void setLayer(int layer);
+  [[nodiscard]] int layer() const { return static_cast<int>(current_); }
+
+  // Key under a position in widget coordinates, or kInvalidSlot
+  [[nodiscard]] Slot slotAt(const QPointF &position) const;
+
+  [[nodiscard]] QSize sizeHint() const override;
+  [[nodiscard]] QSize minimumSizeHint() const override;
+
+protected:
+  void paintEvent(QPaintEvent *event) override;
+  void resizeEvent(QResizeEvent *event) override;
+  void changeEvent(QEvent *event) override;
+  void mousePressEvent(QMouseEvent *event) override;
+  void mouseReleaseEvent(QMouseEvent *event) override;
+
+private:
+  enum KeyState : uint8_t { Normal, Down, Toggled, StateCount };
+
+  struct Key {
+    Slot slot;
+    QRect rect;
+    int atlasX{0}; // column of this key's size in the atlas
+    QStaticText label;
+  };
+
+  struct Layer {
+    layout::Geometry geometry;
+    std::vector<Key> keys; // in geometry.order()
+  };
+
+  struct KeyRef {
+    int layer{-1}; // -1 if the slot is not shown by this view
+    int index{0};
+  };
+
+  [[nodiscard]] KeyState stateOf(const Key &key) const;
+  void onStateChanged(Slot slot);
+  void relayout();
+  void rebuildAtlas();
+  void prepareLabel(Key &key) const;
+
+  core::KeyboardController *controller_;
+  std::vector<Layer> layers_;
+  std::size_t current_{0};
+  std::vector<KeyRef> keyIndex_; // per slot
+  QSize minimumSize_;
+  QPixmap atlas_;
+  int atlasRowHeight_{0};
+  bool atlasDirty_{true};
+  Slot mouseSlot_{core::KeyboardController::kInvalidSlot};
+};
+
+} // namespace ui
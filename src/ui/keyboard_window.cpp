@@ -0,0 +1,197 @@
+#include "ui/keyboard_window.hpp"
+
+#include "core/layout_reloader.hpp"
+#include "core/log.hpp"
+#include "ui/touch_input.hpp"
+
+#include <QTimer>
+#include <QVBoxLayout>
+#include <algorithm>
+
+namespace ui {
+
+KeyboardWindow::KeyboardWindow(core::KeyboardController *controller,
+                               const QString &path,
+                               const layout::LayoutSpec &spec,
+                               Renderer renderer)
+    : controller_(controller),
+      elements_(layout::buildElements(spec, controller, this,
+                                      renderer == Renderer::Widgets)),
+      layerSwitcher_([this](int layer) { showLayer(layer); }),
+      captions_(controller) {
+  auto *mainLayout = new QVBoxLayout();
+  mainLayout->setContentsMargins(0, 0, 0, 0);
+  if (renderer == Renderer::Painted) {
+    view_ = new KeyboardView(controller_, elements_, this);
+    mainLayout->addWidget(view_);
+  } else {
+    layerStack_ = new QStackedLayout();
+    mainLayout->addLayout(layerStack_);
+    layoutPages(spec);
+  }
+  layerSwitcher_.bind(spec, elements_);
+  bindMacros(spec);
+  controller_->setOnInjected(
+      [this](backend::Key key, bool down,
+             core::KeyboardController::Clock::time_point time) {
+        macroRecorder_.record(key, down, time);
+      });
+
+  initialize(WindowFlag::StaysOnTop | WindowFlag::Transparent, mainLayout,
+             "Typr OSK");
+
+  // Touchscreens: every finger drives its own key, so chords like Shift + a
+  // letter work without toggles. Mouse input still goes through the buttons.
+  // (The painted view routes its own touches.)
+  if (view_ == nullptr) {
+    new TouchKeyRouter(this, controller_,
+                       TouchKeyRouter::buttonHitTest(this, controller_));
+  }
+
+  // Edits to the layout file are applied live; only the keys that changed are
+  // touched and the rest keep their state.
+  new layout::LayoutReloader(
+      path, spec, &elements_, controller_, this, view_ == nullptr,
+      [this](const layout::LayoutSpec &changed) { onLayoutChanged(changed); });
+
+  adjustSize();
+}
+
+KeyboardWindow::~KeyboardWindow() { controller_->setOnInjected(nullptr); }
+
+void KeyboardWindow::layoutPages(const layout::LayoutSpec &spec) {
+  // Widgets renderer: one page per layer, all laid out up front, so a layer
+  // switch only changes the visible page. Pages are kept across reloads;
+  // only their layouts are rebuilt and buttons move between them.
+  const std::size_t layerCount = std::max<std::size_t>(1, spec.layers.size());
+  while (layerPages_.size() < layerCount) {
+    layerPages_.push_back(new QWidget());
+    layerStack_->addWidget(layerPages_.back());
+  }
+  for (auto *page : layerPages_) {
+    delete page->layout();
+  }
+  for (std::size_t layer = 0; layer < layerCount; ++layer) {
+    layerPages_[layer]->setLayout(
+        layout::toQtLayout(elements_, static_cast<int>(layer)));
+  }
+  // Anything still on a dropped page is a removed key
+  while (layerPages_.size() > layerCount) {
+    delete layerPages_.back();
+    layerPages_.pop_back();
+  }
+}
+
+void KeyboardWindow::showLayer(int layer) {
+  if (view_ != nullptr) {
+    view_->setLayer(layer);
+  } else if (layerStack_ != nullptr) {
+    releaseButtonPresses(layerStack_->currentIndex());
+    layerStack_->setCurrentIndex(layer);
+  }
+}
+
+void KeyboardWindow::releaseButtonPresses(int layer) {
+  // Hiding a page drops the mouse grab of a button pressed on it, so its
+  // released() never comes, and the momentary layer key that switched away
+  // would stay held. Queued, since the switch runs inside that key's press.
+  std::vector<core::KeyboardController::Slot> pressed;
+  for (const auto &element : elements_) {
+    const auto slot = element.input()->slot();
+    if (element.layer() == layer && controller_->isPressed(slot)) {
+      pressed.push_back(slot);
+    }
+  }
+  if (pressed.empty()) {
+    return;
+  }
+  QTimer::singleShot(0, this, [this, pressed = std::move(pressed)]() {
+    for (const auto slot : pressed) {
+      controller_->releaseButtonPress(slot);
+    }
+  });
+}
+
+void KeyboardWindow::onLayoutChanged(const layout::LayoutSpec &spec) {
+  // Only the layout objects are rebuilt; the buttons are reused
+  if (view_ != nullptr) {
+    view_->setElements(elements_);
+  } else {
+    layoutPages(spec);
+  }
+  layerSwitcher_.bind(spec, elements_);
+  bindMacros(spec);
+  showLayer(layerSwitcher_.current());
+  captions_.refresh();
+}
+
+void KeyboardWindow::bindMacros(const layout::LayoutSpec &spec) {
+  macros_.clear();
+  for (const auto &macro : spec.macros) {
+    const auto recorded = recordedMacros_.find(macro.name);
+    macros_.push_back(recorded != recordedMacros_.end()
+                          ? recorded->second
+                          : std::make_shared<const core::Macro>(macro));
+  }
+  if (!macros_.empty() && macroPlayer_ == nullptr) {
+    macroPlayer_ = std::make_unique<core::MacroPlayer>();
+  }
+
+  // Elements are built in spec order (see buildElements / applyDiff)
+  recordKeys_.clear();
+  const std::size_t count = std::min(elements_.size(), spec.keys.size());
+  for (std::size_t index = 0; index < count; ++index) {
+    const int macro = spec.keys[index].macro;
+    if (macro < 0) {
+      continue;
+    }
+    const auto slot = static_cast<std::size_t>(macro);
+    core::Input *input = elements_[index].input();
+    if (spec.keys[index].recordMacro) {
+      input->setOnKeyPressed(
+          [this, slot](backend::Key) { toggleRecording(slot); });
+      recordKeys_.emplace_back(input->slot(), slot);
+    } else {
+      // Looked up when pressed, so a recording replaces what it plays
+      input->setOnKeyPressed(
+          [this, slot](backend::Key) { macroPlayer_->play(macros_[slot]); });
+    }
+  }
+  labelRecordKeys();
+}
+
+void KeyboardWindow::toggleRecording(std::size_t macro) {
+  if (!macroRecorder_.isRecording()) {
+    macroRecorder_.start();
+    recordingMacro_ = macros_[macro]->name;
+  } else if (auto recorded = macroRecorder_.finish(recordingMacro_)) {
+    TYPR_LOG_INFO("macro", "recorded macro '{}' ({} bytes)", recordingMacro_,
+                  recorded->code.size());
+    auto shared = std::make_shared<const core::Macro>(std::move(*recorded));
+    recordedMacros_[recordingMacro_] = shared;
+    // The layout may have been reloaded while recording
+    const auto replaced =
+        std::ranges::find_if(macros_, [this](const auto &existing) {
+          return existing->name == recordingMacro_;
+        });
+    if (replaced != macros_.end()) {
+      *replaced = std::move(shared);
+    }
+  } else {
+    TYPR_LOG_INFO("macro", "nothing recorded, macro '{}' kept",
+                  recordingMacro_);
+  }
+  labelRecordKeys();
+}
+
+void KeyboardWindow::labelRecordKeys() {
+  for (const auto &[slot, macro] : recordKeys_) {
+    const std::string &name = macros_[macro]->name;
+    const bool recording =
+        macroRecorder_.isRecording() && name == recordingMacro_;
+    controller_->setLabel(slot, (recording ? "Stop " : "Rec ") +
+                                    QString::fromStdString(name));
+  }
+}
+
+} // namespace ui
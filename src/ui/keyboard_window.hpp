@@ -0,0 +1,79 @@
+#pragma once
+
+#include "core/key_captions.hpp"
+#include "core/keyboard_controller.hpp"
+#include "core/layer_switcher.hpp"
+#include "core/layout.hpp"
+#include "core/layout_file.hpp"
+#include "core/macro.hpp"
+#include "ui/keyboard_view.hpp"
+#include "ui/window.hpp"
+
+#include <QStackedLayout>
+#include <QString>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ui {
+
+/**
+ * @brief The keyboard window and everything behind it: the key elements of a
+ * layout, the renderer (one button per key, or a painted KeyboardView), layer
+ * switching, macro keys (and recording them), captions and live reloading
+ * of the layout file.
+ *
+ * Self-contained so main() can build it at startup or defer it until the
+ * keyboard is first needed.
+ */
+class KeyboardWindow : public Window {
+public:
+  enum class Renderer : uint8_t { Widgets, Painted };
+
+  KeyboardWindow(core::KeyboardController *controller, const QString &path,
+                 const layout::LayoutSpec &spec, Renderer renderer);
+  ~KeyboardWindow() override;
+
+  // Switch layers from outside the keyboard (see LayerSwitcher::lock)
+  bool lockLayer(int layer) { return layerSwitcher_.lock(layer); }
+
+private:
+  void layoutPages(const layout::LayoutSpec &spec);
+  void showLayer(int layer);
+  // Release the keys the mouse holds on a page about to be hidden
+  void releaseButtonPresses(int layer);
+  void onLayoutChanged(const layout::LayoutSpec &spec);
+  // Point the macro keys of `spec` at its macros (after the layer switcher,
+  // which resets the press callbacks of other keys)
+  void bindMacros(const layout::LayoutSpec &spec);
+  // A record key of macro `macro` was tapped: start recording it, or replace
+  // it with the recording
+  void toggleRecording(std::size_t macro);
+  // "Rec name", or "Stop name" while that macro is being recorded
+  void labelRecordKeys();
+
+  core::KeyboardController *controller_;
+  std::vector<layout::Element> elements_;
+  KeyboardView *view_{nullptr};
+  QStackedLayout *layerStack_{nullptr};
+  std::vector<QWidget *> layerPages_;
+  layout::LayerSwitcher layerSwitcher_;
+  core::KeyCaptions captions_;
+  // Shared with the player, so a macro that is playing survives a reload
+  std::vector<std::shared_ptr<const core::Macro>> macros_;
+  // Started with the first layout that has macros
+  std::unique_ptr<core::MacroPlayer> macroPlayer_;
+  core::MacroRecorder macroRecorder_;
+  std::string recordingMacro_; // name of the macro being recorded
+  // Slots of the record keys and the macros they record
+  std::vector<std::pair<core::KeyboardController::Slot, std::size_t>>
+      recordKeys_;
+  // Recorded macros by name. They replace the layout's definitions until the
+  // keyboard is closed, across reloads of the layout file.
+  std::unordered_map<std::string, std::shared_ptr<const core::Macro>>
+      recordedMacros_;
+};
+
+} // namespace ui
@@ -0,0 +1,88 @@
+#include "ui/touch_input.hpp"
+
+#include "core/log.hpp"
+#include "core/trace.hpp"
+
+#include <QTouchEvent>
+#include <algorithm>
+
+namespace ui {
+
+TouchKeyRouter::TouchKeyRouter(QWidget *surface,
+                               core::KeyboardController *controller,
+                               HitTest hitTest)
+    : QObject(surface), controller_(controller), hitTest_(std::move(hitTest)) {
+  surface->setAttribute(Qt::WA_AcceptTouchEvents, true);
+  surface->installEventFilter(this);
+}
+
+TouchKeyRouter::HitTest
+TouchKeyRouter::buttonHitTest(QWidget *surface,
+                              const core::KeyboardController *controller) {
+  return [surface, controller](const QPointF &position) -> Slot {
+    QWidget *child = surface->childAt(position.toPoint());
+    for (Slot slot = 0; child != nullptr && slot < controller->size();
+         ++slot) {
+      if (controller->button(slot) == child) {
+        return slot;
+      }
+    }
+    return core::KeyboardController::kInvalidSlot;
+  };
+}
+
+void TouchKeyRouter::releaseAll() {
+  for (const auto &touch : active_) {
+    controller_->release(touch.slot);
+  }
+  active_.clear();
+}
+
+bool TouchKeyRouter::eventFilter(QObject *watched, QEvent *event) {
+  TYPR_TRACE_SPAN("ui", "TouchKeyRouter::eventFilter");
+  switch (event->type()) {
+  case QEvent::TouchBegin:
+  case QEvent::TouchUpdate:
+  case QEvent::TouchEnd:
+    handleTouch(static_cast<QTouchEvent *>(event));
+    event->accept();
+    return true;
+  case QEvent::TouchCancel:
+    releaseAll();
+    event->accept();
+    return true;
+  default:
+    return QObject::eventFilter(watched, event);
+  }
+}
+
+void TouchKeyRouter::handleTouch(QTouchEvent *event) {
+  for (const auto &point : event->points()) {
+    const int id = point.id();
+
+    if (point.state() == QEventPoint::Pressed) {
+      const Slot slot = hitTest_(point.position());
+      if (slot == core::KeyboardController::kInvalidSlot ||
+          controller_->isPressed(slot)) {
+        // Off-key, or another finger already holds this key
+        continue;
+      }
+      active_.push_back(ActiveTouch{.id = id, .slot = slot});
+      TYPR_LOG_TRACE("ui::Touch", "touch {} pressed slot {}", id, slot);
+      controller_->press(slot);
+    } else if (point.state() == QEventPoint::Released) {
+      auto touch = std::ranges::find(active_, id, &ActiveTouch::id);
+      if (touch == active_.end()) {
+        continue;
+      }
+      const Slot slot = touch->slot;
+      active_.erase(touch);
+      TYPR_LOG_TRACE("ui::Touch", "touch {} released slot {}", id, slot);
+      controller_->release(slot);
+    }
+    // Moving fingers keep the key they landed on, like a physical key that
+    // stays down until lifted.
+  }
+}
+
+} // namespace ui
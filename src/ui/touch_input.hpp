@@ -0,0 +1,60 @@
+#pragma once
+
+#include "core/keyboard_controller.hpp"
+
+#include <QObject>
+#include <QPointF>
+#include <QWidget>
+#include <functional>
+#include <vector>
+
+class QTouchEvent;
+
+namespace ui {
+
+/**
+ * @brief Routes raw touch points to keyboard keys.
+ *
+ * Installed as an event filter on the keyboard surface, it accepts the
+ * QTouchEvents itself (so Qt never synthesizes a single mouse pointer from
+ * them) and tracks every touch id independently: each finger presses the key
+ * it lands on and releases it when lifted. Several keys can therefore be held
+ * at once, e.g. a real Shift + letter chord.
+ */
+class TouchKeyRouter : public QObject {
+public:
+  using Slot = core::KeyboardController::Slot;
+
+  // Maps a position (in the surface's coordinates) to a key slot, or
+  // KeyboardController::kInvalidSlot when no key is there.
+  using HitTest = std::function<Slot(const QPointF &position)>;
+
+  TouchKeyRouter(QWidget *surface, core::KeyboardController *controller,
+                 HitTest hitTest);
+
+  // Hit test for widget-based keyboards: the key whose button is under the
+  // point.
+  static HitTest buttonHitTest(QWidget *surface,
+                               const core::KeyboardController *controller);
+
+  // Release every key currently held by a touch point
+  void releaseAll();
+
+protected:
+  bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+  struct ActiveTouch {
+    int id;
+    Slot slot;
+  };
+
+  void handleTouch(QTouchEvent *event);
+
+  core::KeyboardController *controller_;
+  HitTest hitTest_;
+  // Only a handful of fingers are ever down at once; a flat vector beats a map
+  std::vector<ActiveTouch> active_;
+};
+
+} // namespace ui
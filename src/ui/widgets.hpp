@@ -1,6 +1,8 @@
 // widgets.hpp
 #pragma once
 
+#include "core/log.hpp"
+
 #include <QApplication>
 #include <QDebug>
 #include <QEvent>
@@ -32,7 +34,7 @@ public:
     setContextMenuPolicy(Qt::NoContextMenu); // Disable default context menu
     setFocusPolicy(Qt::NoFocus);             // Disable focus
     setAttribute(Qt::WA_ShowWithoutActivating, true);
-    qDebug() << "[RightClickableToolButton] Button created";
+    TYPR_LOG_TRACE("ui", "RightClickableToolButton created");
   }
 
   explicit RightClickableToolButton(QLayout *layout, QWidget *parent = nullptr)
@@ -42,7 +44,7 @@ public:
     setContextMenuPolicy(Qt::NoContextMenu); // Disable default context menu
     setFocusPolicy(Qt::NoFocus);             // Disable focus
     setAttribute(Qt::WA_ShowWithoutActivating, true);
-    qDebug() << "[RightClickableToolButton] Button created (layout ctor)";
+    TYPR_LOG_TRACE("ui", "RightClickableToolButton created (layout ctor)");
   }
 
 protected:
@@ -0,0 +1,86 @@
+#include "tests/harness.hpp"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+namespace test {
+
+namespace {
+
+struct Registered {
+  std::string name;
+  Function function;
+};
+
+std::vector<Registered> &registry() {
+  static std::vector<Registered> tests;
+  return tests;
+}
+
+// Failures of the test that is running
+std::vector<std::string> g_failures;
+
+} // namespace
+
+bool registerTest(const char *name, Function function) {
+  registry().push_back({.name = name, .function = std::move(function)});
+  return true;
+}
+
+void fail(const char *file, int line, const std::string &message) {
+  g_failures.push_back(std::string(file) + ":" + std::to_string(line) + ": " +
+                       message);
+}
+
+} // namespace test
+
+int main(int argc, char **argv) {
+  // Widgets are created but never shown; no display is needed
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  QApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.addHelpOption();
+  const QCommandLineOption filterOption(
+      "filter", "Only run tests whose name contains this text.", "text");
+  parser.addOption(filterOption);
+  parser.process(app);
+  const std::string filter = parser.value(filterOption).toStdString();
+
+  std::ranges::stable_sort(test::registry(), {}, &test::Registered::name);
+
+  int run = 0;
+  int failed = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (const test::Registered &entry : test::registry()) {
+    if (entry.name.find(filter) == std::string::npos) {
+      continue;
+    }
+    test::g_failures.clear();
+    entry.function();
+    ++run;
+    if (test::g_failures.empty()) {
+      std::printf("[ ok ] %s\n", entry.name.c_str());
+      continue;
+    }
+    ++failed;
+    std::printf("[FAIL] %s\n", entry.name.c_str());
+    for (const std::string &failure : test::g_failures) {
+      std::printf("       %s\n", failure.c_str());
+    }
+  }
+  const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  std::printf("%d of %d tests passed (%lld ms)\n", run - failed, run,
+              static_cast<long long>(elapsedMs));
+  return failed == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <sstream>
+#include <string>
+
+/**
+ * Minimal test harness.
+ *
+ *   TYPR_TEST("controller/tap") {
+ *     TYPR_CHECK(condition);
+ *     TYPR_CHECK_EQ(actual, expected);
+ *   }
+ *
+ * A failed check records its location and the test keeps going, so one run
+ * reports every mismatch of a scenario. The runner builds a QApplication on
+ * the offscreen platform first, so tests may create widgets.
+ */
+
+namespace test {
+
+using Function = std::function<void()>;
+
+// Called by TYPR_TEST at static initialisation
+bool registerTest(const char *name, Function function);
+
+// Record a failed check in the running test
+void fail(const char *file, int line, const std::string &message);
+
+template <typename Actual, typename Expected>
+void checkEqual(const Actual &actual, const Expected &expected,
+                const char *expression, const char *file, int line) {
+  if (actual == expected) {
+    return;
+  }
+  std::ostringstream message;
+  message << expression << "\n  actual:   " << actual
+          << "\n  expected: " << expected;
+  fail(file, line, message.str());
+}
+
+} // namespace test
+
+#define TYPR_CHECK(condition)                                                  \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      ::test::fail(__FILE__, __LINE__, #condition);                            \
+    }                                                                          \
+  } while (false)
+
+#define TYPR_CHECK_EQ(actual, expected)                                        \
+  ::test::checkEqual((actual), (expected), #actual " == " #expected, __FILE__, \
+                     __LINE__)
+
+#define TYPR_TEST_CONCAT_INNER(a, b) a##b
+#define TYPR_TEST_CONCAT(a, b) TYPR_TEST_CONCAT_INNER(a, b)
+
+#define TYPR_TEST(name)                                                        \
+  static void TYPR_TEST_CONCAT(typrTest, __LINE__)();                          \
+  static const bool TYPR_TEST_CONCAT(typrTestRegistered, __LINE__) =           \
+      ::test::registerTest(name, TYPR_TEST_CONCAT(typrTest, __LINE__));        \
+  static void TYPR_TEST_CONCAT(typrTest, __LINE__)()
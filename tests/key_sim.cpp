@@ -0,0 +1,82 @@
+#include "tests/key_sim.hpp"
+
+#include <chrono>
+
+namespace test {
+
+namespace {
+
+// Virtual time starts well after the clock's epoch: a default-constructed
+// time_point means "no deadline" to the controller.
+const core::KeyboardController::Clock::time_point kOrigin =
+    core::KeyboardController::Clock::time_point{} + std::chrono::hours(1);
+
+} // namespace
+
+KeySim::KeySim(bool nativeRepeat) {
+  Recording &state = recording();
+  state.nativeRepeat = nativeRepeat;
+  state.nowMs = [this]() { return nowMs_; };
+  state.injected.clear();
+
+  backend_ = std::make_unique<backend::InputBackend>();
+  controller_ = std::make_unique<core::KeyboardController>(backend_.get());
+  controller_->setClock(
+      [this]() { return kOrigin + std::chrono::milliseconds(nowMs_); });
+}
+
+KeySim::~KeySim() {
+  // Keys still held are released by the controller, at the current time
+  controller_.reset();
+  recording().nowMs = nullptr;
+}
+
+KeySim::Slot KeySim::addKey(backend::Key key) {
+  return controller_->addKey(key, nullptr);
+}
+
+void KeySim::press(Slot slot) {
+  controller_->press(slot);
+  syncTimer();
+}
+
+void KeySim::release(Slot slot) {
+  controller_->release(slot);
+  syncTimer();
+}
+
+void KeySim::advance(int64_t ms) {
+  // Keys may also have been driven directly (e.g. through button signals)
+  syncTimer();
+  const int64_t target = nowMs_ + ms;
+  while (timerRunning_ && nextTickMs_ <= target) {
+    nowMs_ = nextTickMs_;
+    nextTickMs_ += core::KeyboardController::kWheelTickMs;
+    controller_->runDueDeadlines();
+    syncTimer();
+  }
+  nowMs_ = target;
+}
+
+void KeySim::stall(int64_t ms) {
+  syncTimer();
+  nowMs_ += ms;
+  if (timerRunning_ && nextTickMs_ <= nowMs_) {
+    nextTickMs_ = nowMs_ + core::KeyboardController::kWheelTickMs;
+    controller_->runDueDeadlines();
+    syncTimer();
+  }
+}
+
+void KeySim::syncTimer() {
+  // QTimer::start() restarts the period, so a timer that was stopped and
+  // started again ticks relative to the new start
+  if (!controller_->hasPendingDeadlines()) {
+    timerRunning_ = false;
+  } else if (!timerRunning_) {
+    timerRunning_ = true;
+    nextTickMs_ = nowMs_ + core::KeyboardController::kWheelTickMs;
+  }
+}
+
+} // namespace test
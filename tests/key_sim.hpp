@@ -0,0 +1,66 @@
+#pragma once
+
+#include "backend/backend.hpp"
+#include "core/keyboard_controller.hpp"
+#include "tests/recording_backend.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace test {
+
+/**
+ * @brief A KeyboardController on a virtual clock, injecting into the
+ * recording backend.
+ *
+ * Time only moves in advance(). It replays the wheel timer the way the event
+ * loop would: the timer starts when the first deadline is armed, ticks every
+ * KeyboardController::kWheelTickMs and stops when nothing is pending. A
+ * scenario of any length therefore runs in microseconds and its injected
+ * events carry exact, repeatable times (in ms since the simulation started).
+ */
+class KeySim {
+public:
+  using Slot = core::KeyboardController::Slot;
+
+  // nativeRepeat: whether the backend claims OS key repeat (if not, the
+  // controller repeats held keys itself)
+  explicit KeySim(bool nativeRepeat = false);
+  ~KeySim();
+
+  KeySim(const KeySim &) = delete;
+  KeySim &operator=(const KeySim &) = delete;
+  KeySim(KeySim &&) = delete;
+  KeySim &operator=(KeySim &&) = delete;
+
+  // A key without a button
+  Slot addKey(backend::Key key);
+
+  void press(Slot slot);
+  void release(Slot slot);
+  // Move the clock forward, firing every timer tick on the way
+  void advance(int64_t ms);
+  // The event loop is blocked for `ms`: time passes without ticks, then the
+  // overdue tick fires once
+  void stall(int64_t ms);
+
+  [[nodiscard]] core::KeyboardController &controller() { return *controller_; }
+  [[nodiscard]] int64_t nowMs() const { return nowMs_; }
+  [[nodiscard]] const std::vector<Injected> &injected() const {
+    return recording().injected;
+  }
+  void clearInjected() { recording().injected.clear(); }
+
+private:
+  // Start or stop the simulated wheel timer after the controller ran
+  void syncTimer();
+
+  int64_t nowMs_{0};
+  bool timerRunning_{false};
+  int64_t nextTickMs_{0};
+  std::unique_ptr<backend::InputBackend> backend_;
+  std::unique_ptr<core::KeyboardController> controller_;
+};
+
+} // namespace test
@@ -0,0 +1,194 @@
+#include "tests/recording_backend.hpp"
+
+namespace test {
+
+Recording &recording() {
+  static Recording state;
+  return state;
+}
+
+std::ostream &operator<<(std::ostream &stream, const Injected &event) {
+  switch (event.kind) {
+  case Injected::Kind::Down:
+    stream << "down " << backend::keyName(event.key);
+    break;
+  case Injected::Kind::Up:
+    stream << "up " << backend::keyName(event.key);
+    break;
+  case Injected::Kind::Text:
+    stream << "text U+" << std::hex << static_cast<uint32_t>(event.codepoint)
+           << std::dec;
+    break;
+  }
+  return stream << " @" << event.atMs;
+}
+
+std::ostream &operator<<(std::ostream &stream,
+                         const std::vector<Injected> &events) {
+  stream << "[";
+  for (std::size_t index = 0; index < events.size(); ++index) {
+    stream << (index == 0 ? "" : ", ") << events[index];
+  }
+  return stream << "]";
+}
+
+} // namespace test
+
+namespace backend {
+
+namespace {
+
+void record(test::Injected event) {
+  test::Recording &state = test::recording();
+  event.atMs = state.nowMs ? state.nowMs() : 0;
+  state.injected.push_back(event);
+}
+
+} // namespace
+
+struct InputBackend::Impl {
+  bool nativeRepeat{test::recording().nativeRepeat};
+  Modifier currentMods{Modifier::None};
+
+  void track(Key key, bool down) {
+    Modifier flag = Modifier::None;
+    switch (key) {
+    case Key::ShiftLeft:
+    case Key::ShiftRight:
+      flag = Modifier::Shift;
+      break;
+    case Key::CtrlLeft:
+    case Key::CtrlRight:
+      flag = Modifier::Ctrl;
+      break;
+    case Key::AltLeft:
+    case Key::AltRight:
+      flag = Modifier::Alt;
+      break;
+    case Key::SuperLeft:
+    case Key::SuperRight:
+      flag = Modifier::Super;
+      break;
+    default:
+      return;
+    }
+    currentMods = down ? currentMods | flag
+                       : static_cast<Modifier>(
+                             static_cast<uint8_t>(currentMods) &
+                             ~static_cast<uint8_t>(flag));
+  }
+};
+
+InputBackend::InputBackend() : m_impl(std::make_unique<Impl>()) {}
+InputBackend::~InputBackend() = default;
+InputBackend::InputBackend(InputBackend &&) noexcept = default;
+InputBackend &InputBackend::operator=(InputBackend &&) noexcept = default;
+
+BackendType InputBackend::type() const { return BackendType::Unknown; }
+
+Capabilities InputBackend::capabilities() const {
+  return {
+      .canInjectKeys = true,
+      .canInjectText = true,
+      .canSimulateHID = false,
+      .supportsKeyRepeat = m_impl->nativeRepeat,
+      .needsAccessibilityPerm = false,
+      .needsInputMonitoringPerm = false,
+      .needsUinputAccess = false,
+  };
+}
+
+bool InputBackend::isReady() const { return true; }
+
+bool InputBackend::requestPermissions() { return true; }
+
+bool InputBackend::keyDown(Key key) {
+  m_impl->track(key, true);
+  record({.kind = test::Injected::Kind::Down, .key = key});
+  return true;
+}
+
+bool InputBackend::keyUp(Key key) {
+  record({.kind = test::Injected::Kind::Up, .key = key});
+  m_impl->track(key, false);
+  return true;
+}
+
+bool InputBackend::tap(Key key) { return keyDown(key) && keyUp(key); }
+
+Modifier InputBackend::activeModifiers() const { return m_impl->currentMods; }
+
+bool InputBackend::holdModifier(Modifier mod) {
+  if (hasModifier(mod, Modifier::Shift)) {
+    keyDown(Key::ShiftLeft);
+  }
+  if (hasModifier(mod, Modifier::Ctrl)) {
+    keyDown(Key::CtrlLeft);
+  }
+  if (hasModifier(mod, Modifier::Alt)) {
+    keyDown(Key::AltLeft);
+  }
+  if (hasModifier(mod, Modifier::Super)) {
+    keyDown(Key::SuperLeft);
+  }
+  return true;
+}
+
+bool InputBackend::releaseModifier(Modifier mod) {
+  if (hasModifier(mod, Modifier::Shift)) {
+    keyUp(Key::ShiftLeft);
+  }
+  if (hasModifier(mod, Modifier::Ctrl)) {
+    keyUp(Key::CtrlLeft);
+  }
+  if (hasModifier(mod, Modifier::Alt)) {
+    keyUp(Key::AltLeft);
+  }
+  if (hasModifier(mod, Modifier::Super)) {
+    keyUp(Key::SuperLeft);
+  }
+  return true;
+}
+
+bool InputBackend::releaseAllModifiers() {
+  return releaseModifier(Modifier::Shift | Modifier::Ctrl | Modifier::Alt |
+                         Modifier::Super);
+}
+
+bool InputBackend::combo(Modifier mods, Key key) {
+  holdModifier(mods);
+  const bool ok = tap(key);
+  releaseModifier(mods);
+  return ok;
+}
+
+bool InputBackend::typeText(const std::u32string &text) {
+  for (const char32_t codepoint : text) {
+    typeCharacter(codepoint);
+  }
+  return true;
+}
+
+bool InputBackend::typeText(const std::string &utf8Text) {
+  // Tests only type ASCII
+  for (const char character : utf8Text) {
+    typeCharacter(static_cast<unsigned char>(character));
+  }
+  return true;
+}
+
+bool InputBackend::typeCharacter(char32_t codepoint) {
+  record({.kind = test::Injected::Kind::Text, .codepoint = codepoint});
+  return true;
+}
+
+void InputBackend::flush() {}
+
+void InputBackend::setKeyDelay(uint32_t /*delayUs*/) {}
+
+#if defined(__linux__)
+// No driver, so MacroPlayer keeps recording through the calls above
+Driver *InputBackend::driver() { return nullptr; }
+#endif
+
+} // namespace backend
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "backend/backend.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+namespace test {
+
+// One event the recording backend was asked to inject
+struct Injected {
+  enum class Kind : uint8_t { Down, Up, Text };
+
+  Kind kind{Kind::Down};
+  backend::Key key{backend::Key::Unknown};
+  int64_t atMs{0};
+  char32_t codepoint{0}; // Text only
+
+  bool operator==(const Injected &other) const = default;
+};
+
+std::ostream &operator<<(std::ostream &stream, const Injected &event);
+std::ostream &operator<<(std::ostream &stream,
+                         const std::vector<Injected> &events);
+
+inline Injected down(backend::Key key, int64_t atMs) {
+  return {.kind = Injected::Kind::Down, .key = key, .atMs = atMs};
+}
+inline Injected up(backend::Key key, int64_t atMs) {
+  return {.kind = Injected::Kind::Up, .key = key, .atMs = atMs};
+}
+
+/**
+ * @brief Configuration and output of the InputBackend the tests link instead
+ * of a platform backend. Nothing reaches the system; every call is appended
+ * to `injected`, stamped with `nowMs()`.
+ *
+ * Read once per InputBackend: `nativeRepeat` is what capabilities() reports
+ * (and so whether KeyboardController repeats keys itself).
+ */
+struct Recording {
+  bool nativeRepeat{false};
+  std::function<int64_t()> nowMs; // 0 when empty
+  std::vector<Injected> injected;
+};
+
+Recording &recording();
+
+} // namespace test
@@ -0,0 +1,277 @@
+#include "tests/harness.hpp"
+
+#include "backend/backend_registry.hpp"
+#include "backend/driver.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+using backend::BackendRegistry;
+using backend::BackendType;
+using backend::SessionType;
+
+// Ready or not, injects nothing
+class FakeDriver final : public backend::Driver {
+public:
+  FakeDriver(BackendType type, bool ready) : type_(type), ready_(ready) {}
+
+  [[nodiscard]] BackendType type() const override { return type_; }
+  [[nodiscard]] backend::Capabilities capabilities() const override {
+    return {};
+  }
+  [[nodiscard]] bool isReady() const override { return ready_; }
+  bool requestPermissions() override { return ready_; }
+  bool keyDown(backend::Key) override { return ready_; }
+  bool keyUp(backend::Key) override { return ready_; }
+  bool tap(backend::Key) override { return ready_; }
+  [[nodiscard]] backend::Modifier activeModifiers() const override {
+    return backend::Modifier::None;
+  }
+  bool holdModifier(backend::Modifier) override { return ready_; }
+  bool releaseModifier(backend::Modifier) override { return ready_; }
+  bool releaseAllModifiers() override { return ready_; }
+  bool combo(backend::Modifier, backend::Key) override { return ready_; }
+  bool typeText(const std::u32string &) override { return ready_; }
+  void flush() override {}
+  void setKeyDelay(uint32_t) override {}
+
+private:
+  BackendType type_;
+  bool ready_;
+};
+
+// What each fake backend does when probed, and how often it was opened
+struct Machine {
+  struct Backend {
+    bool available{true};
+    bool ready{true};
+    std::chrono::microseconds latency{0};
+    int opened{0};
+  };
+  std::map<BackendType, Backend> backends;
+
+  [[nodiscard]] std::vector<BackendRegistry::Entry> entries() {
+    std::vector<BackendRegistry::Entry> entries;
+    for (auto &[type, backend] : backends) {
+      BackendRegistry::Entry entry;
+      entry.type = type;
+      entry.available = [&backend]() { return backend.available; };
+      entry.create = [type, &backend]() -> std::unique_ptr<backend::Driver> {
+        ++backend.opened;
+        return std::make_unique<FakeDriver>(type, backend.ready);
+      };
+      entries.push_back(std::move(entry));
+    }
+    return entries;
+  }
+
+  [[nodiscard]] BackendRegistry::Measure measure() {
+    return [this](backend::Driver &driver, std::size_t) {
+      return backends[driver.type()].latency;
+    };
+  }
+};
+
+// A cache file of its own, removed again
+class CacheFile {
+public:
+  CacheFile()
+      : path_(std::filesystem::temp_directory_path() /
+              ("typr-registry-test-" + std::to_string(getpid()) + "-" +
+               std::to_string(++count_)) /
+              "backend") {}
+  ~CacheFile() {
+    std::error_code error;
+    std::filesystem::remove_all(path_.parent_path(), error);
+  }
+
+  CacheFile(const CacheFile &) = delete;
+  CacheFile &operator=(const CacheFile &) = delete;
+
+  [[nodiscard]] std::string path() const { return path_.string(); }
+
+  [[nodiscard]] std::string contents() const {
+    std::ifstream in(path_);
+    return {std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>()};
+  }
+
+private:
+  static inline int count_ = 0;
+  std::filesystem::path path_;
+};
+
+} // namespace
+
+TYPR_TEST("registry/names") {
+  for (const BackendType type :
+       {BackendType::LinuxUInput, BackendType::LinuxX11,
+        BackendType::LinuxWayland}) {
+    TYPR_CHECK(backend::backendFromName(backend::backendName(type)) == type);
+  }
+  TYPR_CHECK(!backend::backendFromName("xtest").has_value());
+  TYPR_CHECK_EQ(backend::sessionName(SessionType::Wayland),
+                std::string_view("wayland"));
+}
+
+TYPR_TEST("registry/candidates follow the session") {
+  Machine machine;
+  machine.backends[BackendType::LinuxUInput] = {};
+  machine.backends[BackendType::LinuxX11] = {};
+  BackendRegistry registry(machine.entries(), "");
+
+  TYPR_CHECK(registry.candidates(SessionType::X11) ==
+             (std::vector{BackendType::LinuxX11, BackendType::LinuxUInput}));
+  // XTest would only reach Xwayland clients; no Wayland backend built in
+  TYPR_CHECK(registry.candidates(SessionType::Wayland) ==
+             std::vector{BackendType::LinuxUInput});
+  TYPR_CHECK(registry.candidates(SessionType::Console) ==
+             std::vector{BackendType::LinuxUInput});
+}
+
+TYPR_TEST("registry/first ready backend wins") {
+  Machine machine;
+  machine.backends[BackendType::LinuxUInput] = {};
+  machine.backends[BackendType::LinuxWayland] = {.ready = false};
+  BackendRegistry registry(machine.entries(), "");
+
+  const auto selection =
+      registry.select(SessionType::Wayland, BackendRegistry::Options{});
+  TYPR_CHECK(selection.type == BackendType::LinuxUInput);
+  TYPR_CHECK(!selection.cached);
+  TYPR_CHECK_EQ(selection.probes.size(), std::size_t{2});
+  TYPR_CHECK(selection.probes[0].available && !selection.probes[0].ready);
+
+  // The driver opened while probing is the one handed out
+  auto driver = registry.open();
+  TYPR_CHECK(driver != nullptr && driver->isReady());
+  TYPR_CHECK_EQ(machine.backends[BackendType::LinuxUInput].opened, 1);
+  TYPR_CHECK(registry.open() != nullptr);
+  TYPR_CHECK_EQ(machine.backends[BackendType::LinuxUInput].opened, 2);
+}
+
+TYPR_TEST("registry/unavailable backends are not opened") {
+  Machine machine;
+  machine.backends[BackendType::LinuxUInput] = {};
+  machine.backends[BackendType::LinuxX11] = {.available = false};
+  BackendRegistry registry(machine.entries(), "");
+
+  const auto selection =
+      registry.select(SessionType::X11, BackendRegistry::Options{});
+  TYPR_CHECK(selection.type == BackendType::LinuxUInput);
+  TYPR_CHECK_EQ(machine.backends[BackendType::LinuxX11].opened, 0);
+}
+
+TYPR_TEST("registry/without a benchmark the rest stay closed") {
+  Machine machine;
+  machine.backends[BackendType::LinuxUInput] = {};
+  machine.backends[BackendType::LinuxX11] = {};
+  BackendRegistry registry(machine.entries(), "");
+
+  const auto selection =
+      registry.select(SessionType::X11, BackendRegistry::Options{});
+  TYPR_CHECK(selection.type == BackendType::LinuxX11);
+  TYPR_CHECK_EQ(machine.backends[BackendType::LinuxUInput].opened, 0);
+}
+
+TYPR_TEST("registry/benchmark picks the lowest latency") {
+  using std::chrono::microseconds;
+  Machine machine;
+  machine.backends[BackendType::LinuxUInput] = {.latency = microseconds(300)};
+  machine.backends[BackendType::LinuxX11] = {.latency = microseconds(900)};
+  BackendRegistry registry(machine.entries(), "", machine.measure());
+
+  BackendRegistry::Options options;
+  options.benchmark = true;
+  auto selection = registry.select(SessionType::X11, options);
+  TYPR_CHECK(selection.type == BackendType::LinuxUInput);
+  TYPR_CHECK(selection.probes[1].tapLatency == microseconds(300));
+
+  // One the listener cannot see loses to any measured one, but beats none
+  machine.backends[BackendType::LinuxUInput].latency = microseconds(0);
+  selection = registry.select(SessionType::X11, options);
+  TYPR_CHECK(selection.type == BackendType::LinuxX11);
+  machine.backends[BackendType::LinuxX11].latency = microseconds(0);
+  selection = registry.select(SessionType::X11, options);
+  TYPR_CHECK(selection.type == BackendType::LinuxX11);
+}
+
+TYPR_TEST("registry/choice is cached per session") {
+  CacheFile cache;
+  Machine machine;
+  machine.backends[BackendType::LinuxUInput] = {};
+  machine.backends[BackendType::LinuxX11] = {};
+  machine.backends[BackendType::LinuxWayland] = {};
+  {
+    BackendRegistry registry(machine.entries(), cache.path());
+    registry.select(SessionType::X11, BackendRegistry::Options{});
+    registry.select(SessionType::Console, BackendRegistry::Options{});
+  }
+  TYPR_CHECK_EQ(cache.contents(), std::string("x11=x11\nconsole=uinput\n"));
+
+  // A later start opens the cached backend and probes nothing else
+  machine.backends[BackendType::LinuxX11].available = false;
+  BackendRegistry registry(machine.entries(), cache.path());
+  const auto selection =
+      registry.select(SessionType::X11, BackendRegistry::Options{});
+  TYPR_CHECK(selection.cached);
+  TYPR_CHECK(selection.type == BackendType::LinuxX11);
+  TYPR_CHECK(selection.probes.empty());
+
+  // Another session type is probed and added
+  registry.select(SessionType::Wayland, BackendRegistry::Options{});
+  TYPR_CHECK_EQ(cache.contents(),
+                std::string("x11=x11\nconsole=uinput\nwayland=wayland\n"));
+}
+
+TYPR_TEST("registry/stale cache entry is probed again") {
+  CacheFile cache;
+  Machine machine;
+  machine.backends[BackendType::LinuxUInput] = {};
+  machine.backends[BackendType::LinuxX11] = {};
+  {
+    BackendRegistry registry(machine.entries(), cache.path());
+    registry.select(SessionType::X11, BackendRegistry::Options{});
+  }
+
+  machine.backends[BackendType::LinuxX11].ready = false;
+  BackendRegistry registry(machine.entries(), cache.path());
+  const auto selection =
+      registry.select(SessionType::X11, BackendRegistry::Options{});
+  TYPR_CHECK(!selection.cached);
+  TYPR_CHECK(selection.type == BackendType::LinuxUInput);
+  TYPR_CHECK_EQ(cache.contents(), std::string("x11=uinput\n"));
+}
+
+TYPR_TEST("registry/nothing works") {
+  CacheFile cache;
+  Machine machine;
+  machine.backends[BackendType::LinuxUInput] = {.ready = false};
+  BackendRegistry registry(machine.entries(), cache.path());
+
+  // The last resort is still chosen, to report what it is missing
+  const auto selection =
+      registry.select(SessionType::Console, BackendRegistry::Options{});
+  TYPR_CHECK(selection.type == BackendType::LinuxUInput);
+  auto driver = registry.open();
+  TYPR_CHECK(driver != nullptr && !driver->isReady());
+  TYPR_CHECK(!std::filesystem::exists(cache.path()));
+}
+
+TYPR_TEST("registry/pinned backend skips probing") {
+  Machine machine;
+  machine.backends[BackendType::LinuxUInput] = {};
+  machine.backends[BackendType::LinuxX11] = {};
+  BackendRegistry registry(machine.entries(), "");
+
+  registry.pin(BackendType::LinuxUInput);
+  auto driver = registry.open();
+  TYPR_CHECK(driver != nullptr &&
+             driver->type() == BackendType::LinuxUInput);
+  TYPR_CHECK_EQ(machine.backends[BackendType::LinuxX11].opened, 0);
+}
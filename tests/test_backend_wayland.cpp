@@ -0,0 +1,69 @@
+#include "tests/harness.hpp"
+
+#include "backend/backend.hpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+// Run under a compositor with zwp_virtual_keyboard_v1, e.g. a headless sway:
+//   WLR_BACKENDS=headless sway -c /dev/null &
+//   meson test -C <builddir> backend_wayland
+//
+// Nothing here reads the keys back (that takes a client window with the
+// focus). A request the compositor rejects, such as a keymap it cannot
+// compile, ends the connection, which the next write notices.
+
+namespace {
+
+using backend::Key;
+
+// Give the compositor the time to process what was sent and react to it
+void settle() { std::this_thread::sleep_for(std::chrono::milliseconds(100)); }
+
+} // namespace
+
+TYPR_TEST("wayland/virtual keyboard is created") {
+  backend::InputBackend keyboard;
+  TYPR_CHECK(keyboard.isReady());
+  TYPR_CHECK(keyboard.type() == backend::BackendType::LinuxWayland);
+  const backend::Capabilities caps = keyboard.capabilities();
+  TYPR_CHECK(caps.canInjectKeys);
+  TYPR_CHECK(caps.canInjectText);
+  TYPR_CHECK(!caps.canSimulateHID);
+  TYPR_CHECK(!caps.needsUinputAccess);
+}
+
+TYPR_TEST("wayland/keys and modifiers") {
+  backend::InputBackend keyboard;
+  TYPR_CHECK(keyboard.tap(Key::A));
+  TYPR_CHECK(keyboard.combo(backend::Modifier::Ctrl, Key::B));
+  TYPR_CHECK(keyboard.holdModifier(backend::Modifier::Shift));
+  TYPR_CHECK(keyboard.activeModifiers() == backend::Modifier::Shift);
+  TYPR_CHECK(keyboard.tap(Key::Num1));
+  TYPR_CHECK(keyboard.releaseAllModifiers());
+  TYPR_CHECK(keyboard.activeModifiers() == backend::Modifier::None);
+  settle();
+  TYPR_CHECK(keyboard.tap(Key::Space));
+  TYPR_CHECK(keyboard.isReady());
+}
+
+TYPR_TEST("wayland/text in and outside the keymap") {
+  backend::InputBackend keyboard;
+  TYPR_CHECK(keyboard.typeText(std::u32string(U"Hi there\n")));
+  // Outside a us layout: bound to spare keycodes with keymap uploads, more of
+  // them than there are spares
+  TYPR_CHECK(keyboard.typeText(std::string("→✓€ αβγδεζηθικλμνξοπ →")));
+  settle();
+  TYPR_CHECK(keyboard.tap(Key::Space));
+  TYPR_CHECK(keyboard.isReady());
+}
+
+TYPR_TEST("wayland/long text is flushed in parts") {
+  backend::InputBackend keyboard;
+  // Far more requests than fit in one output buffer
+  TYPR_CHECK(keyboard.typeText(std::u32string(4000, U'x')));
+  settle();
+  TYPR_CHECK(keyboard.tap(Key::Space));
+  TYPR_CHECK(keyboard.isReady());
+}
@@ -0,0 +1,133 @@
+#include "tests/harness.hpp"
+
+#include "backend/backend.hpp"
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using backend::Key;
+
+/**
+ * A window of our own that has the input focus, on a separate connection.
+ * Collects the keysyms of the key presses it receives, as a client would
+ * interpret them (modifiers applied, mapping changes followed).
+ */
+class FocusedWindow {
+public:
+  FocusedWindow() : dpy_(XOpenDisplay(nullptr)) {
+    if (dpy_ == nullptr) {
+      return;
+    }
+    window_ = XCreateSimpleWindow(dpy_, DefaultRootWindow(dpy_), 0, 0, 64, 64,
+                                  0, 0, 0);
+    XSelectInput(dpy_, window_, KeyPressMask | StructureNotifyMask);
+    XMapWindow(dpy_, window_);
+    XEvent event;
+    do {
+      XNextEvent(dpy_, &event);
+    } while (event.type != MapNotify);
+    XSetInputFocus(dpy_, window_, RevertToParent, CurrentTime);
+    XSync(dpy_, False);
+  }
+
+  ~FocusedWindow() {
+    if (dpy_ != nullptr) {
+      XCloseDisplay(dpy_);
+    }
+  }
+
+  FocusedWindow(const FocusedWindow &) = delete;
+  FocusedWindow &operator=(const FocusedWindow &) = delete;
+
+  [[nodiscard]] bool isOpen() const { return dpy_ != nullptr; }
+
+  // Keysyms of the next `count` non-modifier key presses (fewer if they do
+  // not arrive within a second)
+  std::vector<KeySym> read(std::size_t count) {
+    std::vector<KeySym> syms;
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (syms.size() < count && std::chrono::steady_clock::now() < deadline) {
+      while (syms.size() < count && XPending(dpy_) > 0) {
+        XEvent event;
+        XNextEvent(dpy_, &event);
+        if (event.type == MappingNotify) {
+          XRefreshKeyboardMapping(&event.xmapping);
+          continue;
+        }
+        if (event.type != KeyPress) {
+          continue;
+        }
+        char buffer[16];
+        KeySym sym = NoSymbol;
+        XLookupString(&event.xkey, buffer, sizeof(buffer), &sym, nullptr);
+        if (!IsModifierKey(sym)) {
+          syms.push_back(sym);
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return syms;
+  }
+
+private:
+  Display *dpy_;
+  Window window_{0};
+};
+
+} // namespace
+
+// Run under an X server with XTest, e.g.
+//   xvfb-run meson test -C <builddir> backend_x11
+
+TYPR_TEST("x11/keys reach the focused window") {
+  FocusedWindow window;
+  TYPR_CHECK(window.isOpen());
+  backend::InputBackend keyboard;
+  TYPR_CHECK(keyboard.isReady());
+  TYPR_CHECK(keyboard.capabilities().canInjectText);
+  TYPR_CHECK(!keyboard.capabilities().needsUinputAccess);
+
+  TYPR_CHECK(keyboard.tap(Key::A));
+  TYPR_CHECK(keyboard.combo(backend::Modifier::Shift, Key::B));
+  TYPR_CHECK(keyboard.keyDown(Key::Num1));
+  TYPR_CHECK(keyboard.keyUp(Key::Num1));
+  TYPR_CHECK(window.read(3) ==
+             (std::vector<KeySym>{XK_a, XK_B, XK_1}));
+  TYPR_CHECK(keyboard.activeModifiers() == backend::Modifier{});
+}
+
+TYPR_TEST("x11/text in and outside the layout") {
+  FocusedWindow window;
+  TYPR_CHECK(window.isOpen());
+  backend::InputBackend keyboard;
+
+  TYPR_CHECK(keyboard.typeText(std::u32string(U"Hi é")));
+  TYPR_CHECK(window.read(4) ==
+             (std::vector<KeySym>{XK_H, XK_i, XK_space, XK_eacute}));
+  TYPR_CHECK(keyboard.typeText(std::string("€")));
+  TYPR_CHECK(window.read(1) == (std::vector<KeySym>{0x10020ac}));
+}
+
+TYPR_TEST("x11/spare keycodes are reused") {
+  FocusedWindow window;
+  TYPR_CHECK(window.isOpen());
+  backend::InputBackend keyboard;
+
+  // Three characters outside the layout, bound in one round and typed again
+  // from their bindings
+  TYPR_CHECK(keyboard.typeText(std::u32string(U"→✓→€✓")));
+  TYPR_CHECK(window.read(5) ==
+             (std::vector<KeySym>{0x1002192, 0x1002713, 0x1002192, 0x10020ac,
+                                  0x1002713}));
+  TYPR_CHECK(keyboard.typeText(std::u32string(U"€a✓")));
+  TYPR_CHECK(window.read(3) ==
+             (std::vector<KeySym>{0x10020ac, XK_a, 0x1002713}));
+}
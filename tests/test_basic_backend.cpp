@@ -0,0 +1,161 @@
+#include "tests/harness.hpp"
+
+#include "backend/basic_backend.hpp"
+
+#if defined(__linux__)
+#include "backend/evdev_keys.hpp"
+#endif
+
+#include <ostream>
+#include <vector>
+
+namespace {
+
+using backend::Key;
+using backend::Modifier;
+
+struct Event {
+  int code{0};
+  bool down{false};
+
+  bool operator==(const Event &other) const = default;
+};
+
+std::ostream &operator<<(std::ostream &stream,
+                         const std::vector<Event> &events) {
+  stream << "[";
+  for (std::size_t index = 0; index < events.size(); ++index) {
+    stream << (index == 0 ? "" : ", ") << (events[index].down ? "down " : "up ")
+           << events[index].code;
+  }
+  return stream << "]";
+}
+
+// Appends every key event; "synced" counts the flushes
+class RecordingSink {
+public:
+  RecordingSink(std::vector<Event> &events, int &synced, bool open)
+      : events_(events), synced_(synced), open_(open) {}
+
+  [[nodiscard]] bool isOpen() const { return open_; }
+  void key(int code, bool down) { events_.push_back({code, down}); }
+  void sync() { ++synced_; }
+
+private:
+  std::vector<Event> &events_;
+  int &synced_;
+  bool open_;
+};
+
+// Sends a key as its enum value, except Unknown
+struct TestKeymap {
+  static int code(Key key) {
+    return key == Key::Unknown ? -1 : static_cast<int>(key);
+  }
+};
+
+// Counts pauses instead of sleeping
+struct CountingTiming {
+  static inline int pauses = 0;
+  static inline uint32_t delayUs = 0;
+
+  void setDelay(uint32_t delay) { delayUs = delay; }
+  void pause() const { ++pauses; }
+};
+
+struct TestPolicy {
+  using Sink = RecordingSink;
+  using Keymap = TestKeymap;
+  using Timing = CountingTiming;
+
+  static constexpr backend::BackendType kType = backend::BackendType::Unknown;
+  static constexpr backend::Capabilities kCapabilities{
+      .canInjectKeys = true,
+      .canInjectText = false,
+      .canSimulateHID = true,
+      .supportsKeyRepeat = true,
+      .needsAccessibilityPerm = false,
+      .needsInputMonitoringPerm = false,
+      .needsUinputAccess = false,
+  };
+};
+
+using TestBackend = backend::BasicInputBackend<TestPolicy>;
+
+Event down(Key key) { return {static_cast<int>(key), true}; }
+Event up(Key key) { return {static_cast<int>(key), false}; }
+
+} // namespace
+
+TYPR_TEST("basic_backend/keys and modifiers") {
+  std::vector<Event> events;
+  int synced = 0;
+  TestBackend output(events, synced, true);
+
+  TYPR_CHECK(output.isReady());
+  TYPR_CHECK(output.capabilities().canInjectKeys);
+  TYPR_CHECK(output.keyDown(Key::ShiftRight));
+  TYPR_CHECK(output.keyDown(Key::A));
+  TYPR_CHECK(output.activeModifiers() == Modifier::Shift);
+  TYPR_CHECK(output.keyUp(Key::A));
+  TYPR_CHECK(output.keyUp(Key::ShiftRight));
+  TYPR_CHECK(output.activeModifiers() == Modifier::None);
+  output.flush();
+
+  TYPR_CHECK_EQ(events, (std::vector{down(Key::ShiftRight), down(Key::A),
+                                     up(Key::A), up(Key::ShiftRight)}));
+  TYPR_CHECK_EQ(synced, 1);
+}
+
+TYPR_TEST("basic_backend/unmapped key is not sent") {
+  std::vector<Event> events;
+  int synced = 0;
+  TestBackend output(events, synced, true);
+
+  TYPR_CHECK(!output.keyDown(Key::Unknown));
+  TYPR_CHECK(!output.tap(Key::Unknown));
+  TYPR_CHECK(events.empty());
+}
+
+TYPR_TEST("basic_backend/tap and combo") {
+  std::vector<Event> events;
+  int synced = 0;
+  TestBackend output(events, synced, true);
+  CountingTiming::pauses = 0;
+
+  output.setKeyDelay(250);
+  TYPR_CHECK_EQ(CountingTiming::delayUs, uint32_t{250});
+  TYPR_CHECK(output.tap(Key::E));
+  TYPR_CHECK_EQ(CountingTiming::pauses, 1);
+
+  events.clear();
+  TYPR_CHECK(output.combo(Modifier::Ctrl | Modifier::Shift, Key::S));
+  TYPR_CHECK_EQ(events,
+                (std::vector{down(Key::ShiftLeft), down(Key::CtrlLeft),
+                             down(Key::S), up(Key::S), up(Key::ShiftLeft),
+                             up(Key::CtrlLeft)}));
+  TYPR_CHECK_EQ(CountingTiming::pauses, 4);
+  TYPR_CHECK(output.activeModifiers() == Modifier::None);
+}
+
+TYPR_TEST("basic_backend/closed sink") {
+  std::vector<Event> events;
+  int synced = 0;
+  TestBackend output(events, synced, false);
+
+  TYPR_CHECK(!output.isReady());
+  TYPR_CHECK(!output.capabilities().canInjectKeys);
+  TYPR_CHECK(!output.keyDown(Key::A));
+  TYPR_CHECK(!output.combo(Modifier::Ctrl, Key::C));
+  TYPR_CHECK(!output.typeText(U"a"));
+  TYPR_CHECK(events.empty());
+}
+
+#if defined(__linux__)
+TYPR_TEST("basic_backend/evdev keymap table") {
+  for (const auto &[key, code] : backend::kEvdevKeys) {
+    TYPR_CHECK_EQ(backend::EvdevKeymap::code(key), code);
+  }
+  TYPR_CHECK_EQ(backend::EvdevKeymap::code(Key::Unknown), -1);
+}
+#endif
@@ -0,0 +1,83 @@
+#include "tests/harness.hpp"
+#include "tests/recording_backend.hpp"
+
+#include "core/bulk_typer.hpp"
+
+#include <chrono>
+#include <string>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+using test::Injected;
+
+core::InjectionRate::Config config() {
+  return {.initial = 100.0,
+          .minimum = 20.0,
+          .maximum = 200.0,
+          .increase = 10.0,
+          .decrease = 0.5,
+          .window = 4,
+          .lagLimit = 30ms};
+}
+
+} // namespace
+
+TYPR_TEST("bulk/rate grows while echoes are prompt") {
+  core::InjectionRate rate(config());
+  for (uint64_t sequence = 0; sequence < 8; ++sequence) {
+    rate.onEcho(sequence, 1ms, sequence + 1);
+  }
+  TYPR_CHECK_EQ(rate.rate(), 120.0);
+  TYPR_CHECK(rate.interval() ==
+             std::chrono::nanoseconds(1'000'000'000 / 120));
+
+  for (uint64_t sequence = 8; sequence < 100; ++sequence) {
+    rate.onEcho(sequence, 1ms, sequence + 1);
+  }
+  TYPR_CHECK_EQ(rate.rate(), 200.0);
+  TYPR_CHECK_EQ(rate.slowdowns(), 0U);
+}
+
+TYPR_TEST("bulk/one cut per episode of lag") {
+  core::InjectionRate rate(config());
+  // Characters 0-9 are in flight when 0 comes back late
+  rate.onEcho(0, 50ms, 10);
+  TYPR_CHECK_EQ(rate.rate(), 50.0);
+  // The rest of them were injected at the old rate
+  for (uint64_t sequence = 1; sequence < 10; ++sequence) {
+    rate.onEcho(sequence, 50ms, 10);
+  }
+  TYPR_CHECK_EQ(rate.rate(), 50.0);
+  // Late again after the cut
+  rate.onEcho(10, 50ms, 12);
+  TYPR_CHECK_EQ(rate.rate(), 25.0);
+  rate.onStall(12);
+  TYPR_CHECK_EQ(rate.rate(), 20.0);
+  TYPR_CHECK_EQ(rate.slowdowns(), 3U);
+}
+
+TYPR_TEST("bulk/types every character in order") {
+  test::recording().injected.clear();
+  core::BulkTypingReport report;
+  {
+    core::BulkTyper typer(config());
+    TYPR_CHECK(typer.type(U"héllo", [&report](const auto &done) {
+      report = done;
+    }));
+    // One text at a time
+    TYPR_CHECK(!typer.type(U"x"));
+    typer.waitUntilIdle();
+  }
+  TYPR_CHECK_EQ(report.typed, std::size_t{5});
+  TYPR_CHECK(!report.cancelled);
+
+  std::u32string typed;
+  for (const Injected &event : test::recording().injected) {
+    if (event.kind == Injected::Kind::Text) {
+      typed += event.codepoint;
+    }
+  }
+  TYPR_CHECK(typed == U"héllo");
+}
@@ -0,0 +1,86 @@
+#include "tests/harness.hpp"
+
+#include "core/control_protocol.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+using backend::Key;
+using backend::Modifier;
+using core::ControlBatch;
+using core::ControlOp;
+
+bool parse(const std::vector<uint8_t> &payload, ControlBatch &batch) {
+  return core::parseControlBatch(payload, batch);
+}
+
+} // namespace
+
+TYPR_TEST("protocol/mixed batch") {
+  ControlBatch batch;
+  TYPR_CHECK(parse({0x02, 0x04, 0x01, 0x13, 0x03, 0x08, 0x20, 0x02, 0x00, 'h',
+                    'i', 0x12, 0x01, 0x20, 0x00, 0x00, 0x01},
+                   batch));
+  TYPR_CHECK_EQ(batch.commands.size(), std::size_t{7});
+  TYPR_CHECK(batch.commands[0].op == ControlOp::Hide);
+  TYPR_CHECK_EQ(static_cast<int>(batch.commands[1].layer), 1);
+  TYPR_CHECK(batch.commands[2].mods == (Modifier::Shift | Modifier::Ctrl));
+  TYPR_CHECK(batch.commands[2].key == Key::H);
+  TYPR_CHECK_EQ(std::string(batch.textOf(batch.commands[3])),
+                std::string("hi"));
+  TYPR_CHECK(batch.commands[4].key == Key::A);
+  TYPR_CHECK(batch.textOf(batch.commands[5]).empty());
+  TYPR_CHECK(batch.commands[6].op == ControlOp::Show);
+}
+
+TYPR_TEST("protocol/bulk text") {
+  ControlBatch batch;
+  TYPR_CHECK(parse({0x20, 0x01, 0x00, 'a', 0x21, 0x03, 0x00, 0x00, 0x00, 'b',
+                    'c', 'd'},
+                   batch));
+  TYPR_CHECK_EQ(batch.commands.size(), std::size_t{2});
+  TYPR_CHECK(batch.commands[1].op == ControlOp::BulkText);
+  TYPR_CHECK_EQ(std::string(batch.textOf(batch.commands[1])),
+                std::string("bcd"));
+}
+
+TYPR_TEST("protocol/log dump") {
+  ControlBatch batch;
+  TYPR_CHECK(parse({0x30, 0x2c, 0x01, 0x30, 0x00, 0x00}, batch));
+  TYPR_CHECK_EQ(batch.commands.size(), std::size_t{2});
+  TYPR_CHECK(batch.commands[0].op == ControlOp::DumpLog);
+  TYPR_CHECK_EQ(batch.commands[0].seconds, uint16_t{300});
+  TYPR_CHECK_EQ(batch.commands[1].seconds, uint16_t{0});
+  TYPR_CHECK(!parse({0x30, 0x01}, batch));
+}
+
+TYPR_TEST("protocol/empty batch") {
+  ControlBatch batch;
+  TYPR_CHECK(parse({}, batch));
+  TYPR_CHECK(batch.commands.empty());
+}
+
+TYPR_TEST("protocol/malformed batches") {
+  ControlBatch batch;
+  // Unknown opcode, missing operands, unknown key, text past the end
+  TYPR_CHECK(!parse({0x01, 0x7f}, batch));
+  TYPR_CHECK(!parse({0x04}, batch));
+  TYPR_CHECK(!parse({0x13, 0x01}, batch));
+  TYPR_CHECK(!parse({0x12, 0x00}, batch));
+  TYPR_CHECK(!parse({0x10, 0xff}, batch));
+  TYPR_CHECK(!parse({0x20, 0x03, 0x00, 'a', 'b'}, batch));
+  TYPR_CHECK(!parse({0x21, 0x02, 0x00, 0x00}, batch));
+  TYPR_CHECK(!parse({0x21, 0x01, 0x00, 0x00, 0x01, 'a'}, batch));
+}
+
+TYPR_TEST("protocol/reply encoding") {
+  const auto reply =
+      core::encodeControlReply(core::ControlStatus::SomeFailed, 0x01020304);
+  const std::array<uint8_t, core::kControlReplySize> expected{
+      5, 0, 0, 0, 2, 4, 3, 2, 1};
+  TYPR_CHECK(reply == expected);
+}
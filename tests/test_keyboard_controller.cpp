@@ -0,0 +1,398 @@
+#include "tests/harness.hpp"
+#include "tests/key_sim.hpp"
+
+#include "ui/widgets.hpp"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using backend::Key;
+using core::PressMode;
+using core::RepeatConfig;
+using test::down;
+using test::Injected;
+using test::KeySim;
+using test::up;
+
+constexpr int64_t kTick = core::KeyboardController::kWheelTickMs;
+
+// Press, hold for `holdMs` and release one key
+std::vector<Injected> holdKey(KeySim &sim, KeySim::Slot slot, int64_t holdMs) {
+  sim.press(slot);
+  sim.advance(holdMs);
+  sim.release(slot);
+  return sim.injected();
+}
+
+} // namespace
+
+TYPR_TEST("controller/tap before the hold threshold") {
+  KeySim sim;
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 300);
+  TYPR_CHECK_EQ(holdKey(sim, slot, 120),
+                (std::vector{down(Key::A, 120), up(Key::A, 120)}));
+}
+
+TYPR_TEST("controller/hold past the threshold") {
+  KeySim sim(true);
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 300);
+  TYPR_CHECK_EQ(holdKey(sim, slot, 500),
+                (std::vector{down(Key::A, 300), up(Key::A, 500)}));
+}
+
+TYPR_TEST("controller/hold released on the threshold tick") {
+  KeySim sim(true);
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 300);
+  // The tick at 300 runs before the release at the same instant
+  TYPR_CHECK_EQ(holdKey(sim, slot, 300),
+                (std::vector{down(Key::A, 300), up(Key::A, 300)}));
+}
+
+TYPR_TEST("controller/threshold between two ticks") {
+  KeySim sim(true);
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 302);
+  // Deadlines fire on the first tick at or after them, never early
+  TYPR_CHECK_EQ(holdKey(sim, slot, 400),
+                (std::vector{down(Key::A, 305), up(Key::A, 400)}));
+}
+
+TYPR_TEST("controller/threshold between two ticks off the clock phase") {
+  // The timer starts with the press, so its ticks (7, 12, ... 302, 307) are
+  // not in phase with the wheel's buckets
+  KeySim sim(true);
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 301);
+  sim.advance(2);
+  sim.press(slot);
+  sim.advance(400);
+  sim.release(slot);
+  TYPR_CHECK_EQ(sim.injected(),
+                (std::vector{down(Key::A, 307), up(Key::A, 402)}));
+}
+
+TYPR_TEST("controller/zero threshold presses immediately") {
+  KeySim sim(true);
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 0);
+  TYPR_CHECK_EQ(holdKey(sim, slot, 40),
+                (std::vector{down(Key::A, 0), up(Key::A, 40)}));
+}
+
+TYPR_TEST("controller/software repeat") {
+  KeySim sim;
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 300);
+  sim.controller().setRepeatConfig(
+      slot, RepeatConfig{.initialDelayMs = 250, .intervalMs = 80});
+  TYPR_CHECK_EQ(holdKey(sim, slot, 800),
+                (std::vector{down(Key::A, 300), down(Key::A, 550),
+                             down(Key::A, 630), down(Key::A, 710),
+                             down(Key::A, 790), up(Key::A, 800)}));
+}
+
+TYPR_TEST("controller/accelerating repeat") {
+  KeySim sim;
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 300);
+  sim.controller().setRepeatConfig(slot,
+                                   RepeatConfig{.initialDelayMs = 200,
+                                                .intervalMs = 100,
+                                                .minIntervalMs = 40,
+                                                .acceleration = 0.5F});
+  TYPR_CHECK_EQ(holdKey(sim, slot, 780),
+                (std::vector{down(Key::A, 300), down(Key::A, 500),
+                             down(Key::A, 600), down(Key::A, 650),
+                             down(Key::A, 690), down(Key::A, 730),
+                             down(Key::A, 770), up(Key::A, 780)}));
+}
+
+TYPR_TEST("controller/no software repeat with native repeat") {
+  KeySim sim(true);
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 300);
+  TYPR_CHECK_EQ(holdKey(sim, slot, 2000),
+                (std::vector{down(Key::A, 300), up(Key::A, 2000)}));
+}
+
+TYPR_TEST("controller/stalled event loop skips missed repeats") {
+  KeySim sim;
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 300);
+  sim.controller().setRepeatConfig(
+      slot, RepeatConfig{.initialDelayMs = 250, .intervalMs = 80});
+  sim.press(slot);
+  sim.advance(300);
+  // Nothing runs for 700 ms; the overdue tick then fires once
+  sim.stall(700);
+  sim.advance(100);
+  sim.release(slot);
+  TYPR_CHECK_EQ(sim.injected(),
+                (std::vector{down(Key::A, 300), down(Key::A, 1000),
+                             down(Key::A, 1030), up(Key::A, 1100)}));
+}
+
+TYPR_TEST("controller/immediate tap with native repeat") {
+  KeySim sim(true);
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 300);
+  sim.controller().setPressMode(slot, PressMode::Immediate);
+  // Released right away so the OS does not start repeating early
+  TYPR_CHECK_EQ(holdKey(sim, slot, 100),
+                (std::vector{down(Key::A, 0), up(Key::A, 0)}));
+}
+
+TYPR_TEST("controller/immediate hold with native repeat") {
+  KeySim sim(true);
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 300);
+  sim.controller().setPressMode(slot, PressMode::Immediate);
+  // Pressed again once the threshold confirms the hold
+  TYPR_CHECK_EQ(holdKey(sim, slot, 400),
+                (std::vector{down(Key::A, 0), up(Key::A, 0), down(Key::A, 300),
+                             up(Key::A, 400)}));
+}
+
+TYPR_TEST("controller/immediate hold with software repeat") {
+  KeySim sim;
+  const auto slot = sim.addKey(Key::A);
+  sim.controller().setHoldThresholdMs(slot, 300);
+  sim.controller().setPressMode(slot, PressMode::Immediate);
+  sim.controller().setRepeatConfig(
+      slot, RepeatConfig{.initialDelayMs = 250, .intervalMs = 80});
+  TYPR_CHECK_EQ(holdKey(sim, slot, 700),
+                (std::vector{down(Key::A, 0), down(Key::A, 550),
+                             down(Key::A, 630), up(Key::A, 700)}));
+}
+
+TYPR_TEST("controller/toggle latches on release") {
+  KeySim sim;
+  const auto slot = sim.addKey(Key::ShiftLeft);
+  sim.controller().setToggleMode(slot, true);
+  holdKey(sim, slot, 50);
+  TYPR_CHECK(sim.controller().isToggled(slot));
+  TYPR_CHECK_EQ(sim.injected(), (std::vector{down(Key::ShiftLeft, 50)}));
+  sim.advance(1000);
+  holdKey(sim, slot, 900);
+  TYPR_CHECK(!sim.controller().isToggled(slot));
+  TYPR_CHECK_EQ(sim.injected(), (std::vector{down(Key::ShiftLeft, 50),
+                                             up(Key::ShiftLeft, 1950)}));
+}
+
+TYPR_TEST("controller/overlapping holds") {
+  KeySim sim(true);
+  const auto shift = sim.addKey(Key::ShiftLeft);
+  const auto letter = sim.addKey(Key::A);
+  sim.press(shift);
+  sim.advance(100);
+  sim.press(letter);
+  sim.advance(350);
+  sim.release(shift);
+  sim.advance(50);
+  sim.release(letter);
+  TYPR_CHECK_EQ(sim.injected(),
+                (std::vector{down(Key::ShiftLeft, 300), down(Key::A, 400),
+                             up(Key::ShiftLeft, 450), up(Key::A, 500)}));
+}
+
+TYPR_TEST("controller/removing a held key releases it") {
+  KeySim sim(true);
+  const auto slot = sim.addKey(Key::A);
+  sim.press(slot);
+  sim.advance(320);
+  sim.controller().removeKey(slot);
+  sim.advance(500);
+  TYPR_CHECK_EQ(sim.injected(),
+                (std::vector{down(Key::A, 300), up(Key::A, 320)}));
+  TYPR_CHECK(!sim.controller().hasPendingDeadlines());
+}
+
+TYPR_TEST("controller/button signals drive the key") {
+  KeySim sim(true);
+  auto button = std::make_unique<ui::Widget::RightClickableToolButton>();
+  const auto slot = sim.controller().addKey(Key::A, button.get());
+  sim.controller().setHoldThresholdMs(slot, 300);
+  Q_EMIT button->pressed();
+  sim.advance(310);
+  Q_EMIT button->released();
+  TYPR_CHECK_EQ(sim.injected(),
+                (std::vector{down(Key::A, 300), up(Key::A, 310)}));
+}
+
+TYPR_TEST("controller/button hidden while pressed") {
+  // A momentary layer key held with the mouse: its layer hides the page the
+  // button is on, so released() never comes and the window releases it
+  KeySim sim(true);
+  auto button = std::make_unique<ui::Widget::RightClickableToolButton>();
+  const auto layerKey = sim.controller().addKey(Key::Unknown, button.get());
+  const auto touched = sim.addKey(Key::A);
+  int layer = 0;
+  sim.controller().setOnKeyPressed(layerKey, [&layer](Key) { layer = 1; });
+  sim.controller().setOnKeyReleased(layerKey, [&layer](Key) { layer = 0; });
+
+  Q_EMIT button->pressed();
+  sim.press(touched);
+  sim.advance(310);
+  TYPR_CHECK_EQ(layer, 1);
+  sim.controller().releaseButtonPress(layerKey);
+  TYPR_CHECK_EQ(layer, 0);
+  TYPR_CHECK(!sim.controller().isPressed(layerKey));
+  TYPR_CHECK(!button->isDown());
+
+  // A key pressed by slot (a touch) is not the button's to release
+  sim.controller().releaseButtonPress(touched);
+  TYPR_CHECK(sim.controller().isPressed(touched));
+  sim.release(touched);
+  TYPR_CHECK_EQ(sim.injected(),
+                (std::vector{down(Key::A, 300), up(Key::A, 310)}));
+  TYPR_CHECK(!sim.controller().hasPendingDeadlines());
+}
+
+// --- Generated scenarios -------------------------------------------------
+//
+// Every combination of press mode, OS repeat, threshold, repeat settings,
+// timer phase and hold duration, checked against a direct model of the
+// documented behaviour (see core::PressMode and core::RepeatConfig).
+
+namespace {
+
+struct Scenario {
+  PressMode mode;
+  bool nativeRepeat;
+  int thresholdMs;
+  RepeatConfig repeat;
+  int64_t pressAt;
+  int64_t holdMs;
+};
+
+std::vector<Injected> model(const Scenario &scenario) {
+  const int64_t press = scenario.pressAt;
+  const int64_t release = press + scenario.holdMs;
+  const int64_t threshold = scenario.thresholdMs;
+  // The timer starts with the press; a deadline fires on its first tick at
+  // or after it
+  const auto fireAt = [press](int64_t deadline) {
+    return press + (deadline - press + kTick - 1) / kTick * kTick;
+  };
+  const bool softwareRepeat =
+      !scenario.nativeRepeat && scenario.repeat.enabled;
+
+  std::vector<Injected> events;
+  // Repeats of a key held from `from` (the deadline that made it held)
+  const auto addRepeats = [&](int64_t from) {
+    if (!softwareRepeat) {
+      return;
+    }
+    const RepeatConfig &config = scenario.repeat;
+    float period = static_cast<float>(config.intervalMs);
+    int64_t deadlineUs = (from + config.initialDelayMs) * 1000;
+    while (fireAt((deadlineUs + 999) / 1000) <= release) {
+      const int64_t firedAt = fireAt((deadlineUs + 999) / 1000);
+      events.push_back(down(Key::A, firedAt));
+      do {
+        deadlineUs += static_cast<int64_t>(period * 1000.0F);
+        period = std::max({1.0F, static_cast<float>(config.minIntervalMs),
+                           period * config.acceleration});
+      } while (deadlineUs <= firedAt * 1000);
+    }
+  };
+
+  if (scenario.mode == PressMode::Immediate) {
+    events.push_back(down(Key::A, press));
+    if (scenario.nativeRepeat && threshold > 0) {
+      events.push_back(up(Key::A, press));
+      if (fireAt(press + threshold) <= release) {
+        events.push_back(down(Key::A, fireAt(press + threshold)));
+        events.push_back(up(Key::A, release));
+      }
+      return events;
+    }
+    addRepeats(press + threshold);
+    events.push_back(up(Key::A, release));
+    return events;
+  }
+
+  if (threshold == 0) {
+    events.push_back(down(Key::A, press));
+    addRepeats(press);
+    events.push_back(up(Key::A, release));
+    return events;
+  }
+  const int64_t heldAt = fireAt(press + threshold);
+  if (heldAt > release) {
+    events.push_back(down(Key::A, release)); // tap
+    events.push_back(up(Key::A, release));
+    return events;
+  }
+  events.push_back(down(Key::A, heldAt));
+  addRepeats(press + threshold);
+  events.push_back(up(Key::A, release));
+  return events;
+}
+
+} // namespace
+
+TYPR_TEST("controller/generated scenarios") {
+  const std::array<RepeatConfig, 3> repeats = {
+      RepeatConfig{.enabled = false},
+      RepeatConfig{.initialDelayMs = 250, .intervalMs = 80},
+      RepeatConfig{.initialDelayMs = 200,
+                   .intervalMs = 60,
+                   .minIntervalMs = 16,
+                   .acceleration = 0.9F},
+  };
+  const std::array<int, 6> thresholds = {0, 1, 150, 300, 302, 333};
+  const std::array<int64_t, 3> phases = {0, 2, 4};
+  const std::array<int64_t, 14> holds = {0,   1,   4,   5,   149, 150, 151,
+                                         299, 300, 301, 305, 600, 777, 1500};
+
+  int scenarios = 0;
+  int failures = 0;
+  for (const PressMode mode : {PressMode::Deferred, PressMode::Immediate}) {
+    for (const bool nativeRepeat : {false, true}) {
+      for (const int threshold : thresholds) {
+        for (const RepeatConfig &repeat : repeats) {
+          for (const int64_t phase : phases) {
+            for (const int64_t hold : holds) {
+              const Scenario scenario{mode,   nativeRepeat, threshold,
+                                      repeat, phase,        hold};
+              KeySim sim(nativeRepeat);
+              const auto slot = sim.addKey(Key::A);
+              sim.controller().setHoldThresholdMs(slot, threshold);
+              sim.controller().setPressMode(slot, mode);
+              sim.controller().setRepeatConfig(slot, repeat);
+              sim.advance(phase);
+              holdKey(sim, slot, hold);
+
+              ++scenarios;
+              const std::vector<Injected> expected = model(scenario);
+              // Report the first few mismatches in full, then only count
+              if (sim.injected() != expected && ++failures <= 5) {
+                std::ostringstream message;
+                message << "immediate " << (mode == PressMode::Immediate)
+                        << ", native repeat " << nativeRepeat
+                        << ", threshold " << threshold << ", repeat #"
+                        << (&repeat - repeats.data()) << ", phase " << phase
+                        << ", hold " << hold
+                        << "\n  actual:   " << sim.injected()
+                        << "\n  expected: " << expected;
+                test::fail(__FILE__, __LINE__, message.str());
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  TYPR_CHECK_EQ(failures, 0);
+  TYPR_CHECK(scenarios >= 3000);
+}
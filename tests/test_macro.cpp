@@ -0,0 +1,312 @@
+#include "tests/harness.hpp"
+#include "tests/key_sim.hpp"
+#include "tests/recording_backend.hpp"
+
+#include "core/layout_file.hpp"
+#include "core/macro.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using backend::Key;
+using test::Injected;
+
+using Clock = std::chrono::steady_clock;
+
+bool compiles(std::string_view steps) {
+  std::string error;
+  return core::compileMacro("m", steps, error).has_value();
+}
+
+// Play a macro on a real player, stamping events in ms since it was queued
+std::vector<Injected> play(std::string_view steps) {
+  std::string error;
+  auto macro = core::compileMacro("m", steps, error);
+  TYPR_CHECK(macro.has_value());
+
+  const Clock::time_point start = Clock::now();
+  test::recording().injected.clear();
+  test::recording().nowMs = [start]() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               Clock::now() - start)
+        .count();
+  };
+  {
+    core::MacroPlayer player;
+    player.play(std::make_shared<const core::Macro>(std::move(*macro)));
+    player.waitUntilIdle();
+  }
+  test::recording().nowMs = nullptr;
+  return test::recording().injected;
+}
+
+std::vector<Injected::Kind> kinds(const std::vector<Injected> &events) {
+  std::vector<Injected::Kind> out;
+  for (const auto &event : events) {
+    out.push_back(event.kind);
+  }
+  return out;
+}
+
+} // namespace
+
+TYPR_TEST("macro/compile steps") {
+  std::string error;
+  const auto macro = core::compileMacro(
+      "sig", R"(+CtrlLeft A -CtrlLeft 70000ms "a \"b\" # c" # comment)",
+      error);
+  TYPR_CHECK(macro.has_value());
+  const std::vector<uint8_t> expected{
+      1, static_cast<uint8_t>(Key::CtrlLeft), // down
+      1, static_cast<uint8_t>(Key::A),        // tap
+      2, static_cast<uint8_t>(Key::A),
+      2, static_cast<uint8_t>(Key::CtrlLeft), // up
+      3, 0xff, 0xff,                          // 65535 ms
+      3, 0x71, 0x11,                          // + 4465 ms
+      4, 0, 0,                                // text 0
+  };
+  TYPR_CHECK(macro->code == expected);
+  TYPR_CHECK(macro->texts == std::vector<std::u32string>{U"a \"b\" # c"});
+}
+
+TYPR_TEST("macro/rejected steps") {
+  TYPR_CHECK(!compiles(""));
+  TYPR_CHECK(!compiles("# only a comment"));
+  TYPR_CHECK(!compiles("Nope"));
+  TYPR_CHECK(!compiles("+A"));
+  TYPR_CHECK(!compiles("-A"));
+  TYPR_CHECK(!compiles("+A +A -A"));
+  TYPR_CHECK(!compiles("+A A -A"));
+  TYPR_CHECK(!compiles("5xms"));
+  TYPR_CHECK(!compiles("\"open"));
+}
+
+TYPR_TEST("macro/layout definitions and keys") {
+  std::string error;
+  const auto layout = layout::parseLayout("*sig Q:w=2 *copy\n"
+                                          "macro sig \"Best # regards\" Enter\n"
+                                          "macro copy +CtrlLeft C -CtrlLeft\n",
+                                          error);
+  TYPR_CHECK(layout.has_value());
+  TYPR_CHECK_EQ(layout->macros.size(), std::size_t{2});
+  TYPR_CHECK_EQ(layout->keys.size(), std::size_t{3});
+  TYPR_CHECK_EQ(layout->keys[0].macro, 0);
+  TYPR_CHECK(layout->keys[0].key == Key::Unknown);
+  TYPR_CHECK_EQ(layout->keys[1].macro, -1);
+  TYPR_CHECK_EQ(layout->keys[2].macro, 1);
+  TYPR_CHECK(!layout->keys[0].recordMacro);
+
+  const auto recorder = layout::parseLayout("*sig:record\nmacro sig A", error);
+  TYPR_CHECK(recorder.has_value() && recorder->keys[0].recordMacro &&
+             recorder->keys[0].macro == 0);
+  TYPR_CHECK(layout->macros[0].texts ==
+             std::vector<std::u32string>{U"Best # regards"});
+
+  TYPR_CHECK(!layout::parseLayout("*nope", error).has_value());
+  TYPR_CHECK(!layout::parseLayout("A\nmacro m A\nmacro m B", error));
+  TYPR_CHECK(!layout::parseLayout("*m:lock\nmacro m A", error));
+  TYPR_CHECK(!layout::parseLayout("*m:record=1\nmacro m A", error));
+  TYPR_CHECK(!layout::parseLayout("A\nmacro m +A", error));
+}
+
+TYPR_TEST("macro/bytecode validation") {
+  std::string error;
+  auto macro = core::compileMacro("m", "+CtrlLeft C -CtrlLeft 5ms \"x\"",
+                                  error);
+  TYPR_CHECK(macro.has_value() && core::isValidMacro(*macro));
+
+  const auto valid = [](std::vector<uint8_t> code, std::size_t texts = 0) {
+    core::Macro macro;
+    macro.code = std::move(code);
+    macro.texts.resize(texts);
+    return core::isValidMacro(macro);
+  };
+  const auto a = static_cast<uint8_t>(Key::A);
+  TYPR_CHECK(valid({1, a, 2, a}));
+  TYPR_CHECK(valid({4, 0, 0}, 1));
+  // Empty, unknown opcode, truncated operand, unknown key, still held,
+  // released unpressed, text past the end
+  TYPR_CHECK(!valid({}));
+  TYPR_CHECK(!valid({9, a}));
+  TYPR_CHECK(!valid({1, a, 2}));
+  TYPR_CHECK(!valid({1, 0xff, 2, 0xff}));
+  TYPR_CHECK(!valid({1, a}));
+  TYPR_CHECK(!valid({2, a}));
+  TYPR_CHECK(!valid({4, 1, 0}, 1));
+}
+
+TYPR_TEST("macro/damaged layout cache falls back to the text") {
+  QStandardPaths::setTestModeEnabled(true);
+  QTemporaryDir dir;
+  const QString path = dir.filePath("cache.layout");
+  const QByteArray text = "A @fn *m\n[fn]\nB\nmacro m +CtrlLeft C -CtrlLeft\n";
+  {
+    QFile file(path);
+    TYPR_CHECK(file.open(QIODevice::WriteOnly) && file.write(text) > 0);
+  }
+  std::string error;
+  const auto parsed = layout::parseLayout(
+      std::string_view(text.constData(), static_cast<std::size_t>(text.size())),
+      error);
+  TYPR_CHECK(parsed.has_value());
+  TYPR_CHECK(layout::loadLayoutFile(path) == parsed); // writes the cache
+
+  const QDir caches(
+      QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+      "/layouts");
+  const QFileInfoList written =
+      caches.entryInfoList({"*.bin"}, QDir::Files, QDir::Time);
+  TYPR_CHECK(!written.isEmpty());
+  if (written.isEmpty()) {
+    return;
+  }
+  const QString cachePath = written.front().absoluteFilePath();
+  QByteArray good;
+  {
+    QFile file(cachePath);
+    TYPR_CHECK(file.open(QIODevice::ReadOnly));
+    good = file.readAll();
+  }
+
+  // The header takes 48 bytes, then each key 52 (key, flags, layer action,
+  // reserved, ..., layer at 40, layer target at 44, macro at 48). The file
+  // ends with m's code (its last Up at -6) and text count.
+  struct Damage {
+    qsizetype offset;
+    int32_t value;
+    bool byte; // a u8 field, else an i32 one
+  };
+  const Damage damages[] = {
+      {48 + 52 + 44, 7, false},      // @fn's target past the layers
+      {48 + 52 + 40, -1, false},     // @fn on a negative layer
+      {48 + 104 + 48, 3, false},     // *m plays a macro past the macros
+      {48, 0xfe, true},              // A is no known key
+      {48 + 2, 9, true},             // A has no known layer action
+      {good.size() - 6, 9, true},    // m has an unknown opcode
+  };
+  for (const Damage &damage : damages) {
+    QByteArray bytes = good;
+    TYPR_CHECK(damage.offset + 4 <= bytes.size());
+    if (damage.byte) {
+      bytes[damage.offset] = static_cast<char>(damage.value);
+    } else {
+      std::memcpy(bytes.data() + damage.offset, &damage.value,
+                  sizeof(damage.value));
+    }
+    {
+      QFile file(cachePath);
+      TYPR_CHECK(file.open(QIODevice::WriteOnly) && file.write(bytes) > 0);
+    }
+    TYPR_CHECK(layout::loadLayoutFile(path) == parsed);
+  }
+  QFile::remove(cachePath);
+}
+
+TYPR_TEST("macro/playback order and delays") {
+  const auto events = play(R"(+ShiftLeft A -ShiftLeft 30ms B "hi")");
+  using Kind = Injected::Kind;
+  TYPR_CHECK(kinds(events) ==
+             (std::vector{Kind::Down, Kind::Down, Kind::Up, Kind::Up,
+                          Kind::Down, Kind::Up, Kind::Text, Kind::Text}));
+  if (events.size() == 8) {
+    TYPR_CHECK(events[0].key == Key::ShiftLeft);
+    TYPR_CHECK(events[1].key == Key::A);
+    TYPR_CHECK(events[3].key == Key::ShiftLeft);
+    TYPR_CHECK(events[4].key == Key::B);
+    TYPR_CHECK(events[4].atMs - events[3].atMs >= 30);
+    TYPR_CHECK(events[6].codepoint == U'h');
+  }
+}
+
+TYPR_TEST("macro/deadlines do not drift") {
+  // Ten 10 ms waits end 100 ms after the start, however long each step took
+  const auto events = play("A 10ms A 10ms A 10ms A 10ms A 10ms A 10ms A 10ms "
+                           "A 10ms A 10ms A 10ms A");
+  TYPR_CHECK_EQ(events.size(), std::size_t{22});
+  if (events.size() == 22) {
+    TYPR_CHECK(events.back().atMs >= 100);
+    // Generous bound: sleeping past each deadline and counting the next wait
+    // from there would add the oversleep of every step
+    TYPR_CHECK(events.back().atMs < 250);
+  }
+}
+
+TYPR_TEST("macro/cancel releases held keys") {
+  std::string error;
+  auto macro = core::compileMacro("m", "+ShiftLeft 5000ms -ShiftLeft", error);
+  test::recording().injected.clear();
+  const Clock::time_point start = Clock::now();
+  {
+    core::MacroPlayer player;
+    player.play(std::make_shared<const core::Macro>(std::move(*macro)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    player.cancel();
+    player.waitUntilIdle();
+  }
+  TYPR_CHECK(Clock::now() - start < std::chrono::seconds(2));
+  // Cancelled before or after it started: either way nothing stays down
+  const auto &events = test::recording().injected;
+  TYPR_CHECK(events.empty() ||
+             events == (std::vector{test::down(Key::ShiftLeft, 0),
+                                    test::up(Key::ShiftLeft, 0)}));
+}
+
+TYPR_TEST("macro/record controller presses") {
+  test::KeySim sim(true);
+  const auto a = sim.addKey(Key::A);
+  const auto b = sim.addKey(Key::B);
+  sim.controller().setHoldThresholdMs(a, 300);
+  sim.controller().setHoldThresholdMs(b, 300);
+  core::MacroRecorder recorder;
+  sim.controller().setOnInjected(
+      [&recorder](Key key, bool down, Clock::time_point time) {
+        recorder.record(key, down, time);
+      });
+
+  // B was already down: its release is not recorded
+  sim.press(b);
+  sim.advance(300);
+  recorder.start();
+  sim.release(b);
+  sim.advance(100);
+  // A tap at 520, then B held from 900 past the end of the recording
+  sim.press(a);
+  sim.advance(120);
+  sim.release(a);
+  sim.advance(80);
+  sim.press(b);
+  sim.advance(300);
+  const auto macro = recorder.finish("rec");
+  sim.release(b);
+
+  TYPR_CHECK(macro.has_value());
+  const auto keyA = static_cast<uint8_t>(Key::A);
+  const auto keyB = static_cast<uint8_t>(Key::B);
+  const std::vector<uint8_t> expected{
+      1, keyA, 2, keyA, // tap
+      3, 0x7c, 0x01,    // 380 ms
+      1, keyB, 2, keyB, // released when the recording ends
+  };
+  TYPR_CHECK(macro->code == expected);
+  TYPR_CHECK_EQ(macro->name, std::string("rec"));
+  TYPR_CHECK(core::isValidMacro(*macro));
+
+  // Nothing recorded, nothing to replace the macro with
+  recorder.start();
+  TYPR_CHECK(!recorder.finish("rec").has_value());
+  sim.press(a);
+  sim.advance(120);
+  sim.release(a);
+  TYPR_CHECK(!recorder.isRecording());
+}
@@ -0,0 +1,122 @@
+#include "tests/harness.hpp"
+
+#include "backend/spare_keys.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using backend::SpareKeys;
+
+// Keysyms are the codepoints. The layout types the lowercase letters; every
+// other character needs a spare. Writes what it does to `log`:
+//   a          the layout's key for 'a'
+//   [200=X/W]  one batch of bindings (spare 200 to X, bound to W before)
+//   <200>      a tap of spare 200
+struct FakeSteps {
+  std::string log;
+  bool bindOk{true};
+
+  static SpareKeys::Keysym keysym(char32_t codepoint) { return codepoint; }
+  [[nodiscard]] bool hasStroke(SpareKeys::Keysym sym) const {
+    return sym >= 'a' && sym <= 'z';
+  }
+  bool typeStroke(SpareKeys::Keysym sym) {
+    if (!hasStroke(sym)) {
+      return false;
+    }
+    log += static_cast<char>(sym);
+    return true;
+  }
+  bool bind(const std::vector<SpareKeys::Binding> &binds) {
+    log += "[";
+    for (const SpareKeys::Binding &binding : binds) {
+      log += (&binding == binds.data() ? "" : " ") +
+             std::to_string(200 + binding.spare) + "=" +
+             static_cast<char>(binding.sym);
+      if (binding.previous != SpareKeys::kNoSymbol) {
+        log += "/" + std::string(1, static_cast<char>(binding.previous));
+      }
+    }
+    log += "]";
+    return bindOk;
+  }
+  void typeSpare(uint32_t keycode) {
+    log += "<" + std::to_string(keycode) + ">";
+  }
+};
+
+SpareKeys twoSpares() {
+  SpareKeys spares;
+  spares.add(200);
+  spares.add(201);
+  return spares;
+}
+
+} // namespace
+
+TYPR_TEST("spare_keys/layout characters need no spares") {
+  SpareKeys spares = twoSpares();
+  FakeSteps steps;
+  TYPR_CHECK(spares.typeText(U"ab", steps));
+  TYPR_CHECK_EQ(steps.log, std::string("ab"));
+  TYPR_CHECK(spares.isSpare(201) && !spares.isSpare(199));
+}
+
+TYPR_TEST("spare_keys/a round per batch of bindings") {
+  SpareKeys spares = twoSpares();
+  FakeSteps steps;
+  // Z needs a third spare: the round ends before it, and the least recently
+  // used binding (X) makes room
+  TYPR_CHECK(spares.typeText(U"aXbYXZ", steps));
+  TYPR_CHECK_EQ(steps.log,
+                std::string("[200=X 201=Y]a<200>b<201><200>[201=Z/Y]<201>"));
+}
+
+TYPR_TEST("spare_keys/bindings are reused") {
+  SpareKeys spares = twoSpares();
+  FakeSteps steps;
+  TYPR_CHECK(spares.typeText(U"XY", steps));
+  steps.log.clear();
+  TYPR_CHECK(spares.typeText(U"YX", steps));
+  TYPR_CHECK_EQ(steps.log, std::string("<201><200>"));
+}
+
+TYPR_TEST("spare_keys/failed bindings are dropped") {
+  SpareKeys spares = twoSpares();
+  FakeSteps steps;
+  steps.bindOk = false;
+  TYPR_CHECK(!spares.typeText(U"aX", steps));
+  TYPR_CHECK_EQ(steps.log, std::string("[200=X]a"));
+  TYPR_CHECK(spares.sym(0) == SpareKeys::kNoSymbol);
+
+  // Bound again, to the spare used least recently
+  steps.bindOk = true;
+  steps.log.clear();
+  TYPR_CHECK(spares.typeText(U"X", steps));
+  TYPR_CHECK_EQ(steps.log, std::string("[201=X]<201>"));
+}
+
+TYPR_TEST("spare_keys/no spares") {
+  SpareKeys spares;
+  FakeSteps steps;
+  TYPR_CHECK(!spares.typeText(U"aXb", steps));
+  TYPR_CHECK_EQ(steps.log, std::string("ab"));
+}
+
+TYPR_TEST("spare_keys/unbind all") {
+  SpareKeys spares = twoSpares();
+  FakeSteps steps;
+  TYPR_CHECK(spares.typeText(U"X", steps));
+  const auto binds = spares.unbindAll();
+  TYPR_CHECK_EQ(binds.size(), std::size_t{1});
+  TYPR_CHECK(binds[0].spare == 0 && binds[0].sym == SpareKeys::kNoSymbol &&
+             binds[0].previous == U'X');
+  TYPR_CHECK(spares.sym(0) == SpareKeys::kNoSymbol);
+
+  // X is bound again, to the least recently used spare
+  steps.log.clear();
+  TYPR_CHECK(spares.typeText(U"X", steps));
+  TYPR_CHECK_EQ(steps.log, std::string("[201=X]<201>"));
+}
@@ -0,0 +1,70 @@
+#include "tests/harness.hpp"
+
+#include "core/text_expander.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using core::ExpansionMatcher;
+
+// Feed `typed` and collect the pattern matched after each character (-1 for
+// none)
+std::vector<int32_t> matches(const ExpansionMatcher &matcher,
+                             std::u32string_view typed) {
+  std::vector<int32_t> out;
+  ExpansionMatcher::State state = ExpansionMatcher::kRoot;
+  for (const char32_t codepoint : typed) {
+    state = matcher.step(state, codepoint);
+    out.push_back(matcher.match(state));
+  }
+  return out;
+}
+
+} // namespace
+
+TYPR_TEST("expander/matches at the end of typed text") {
+  const ExpansionMatcher matcher({U";sig", U"btw", U"ig"});
+  // The longest abbreviation wins: ";sig" rather than "ig"
+  TYPR_CHECK(matches(matcher, U"x;sig") ==
+             (std::vector<int32_t>{-1, -1, -1, -1, 0}));
+  TYPR_CHECK(matches(matcher, U"big") == (std::vector<int32_t>{-1, -1, 2}));
+  TYPR_CHECK(matches(matcher, U"bbtw") ==
+             (std::vector<int32_t>{-1, -1, -1, 1}));
+}
+
+TYPR_TEST("expander/failure links") {
+  // "abcd" fails over to "bc" and on to "cd"
+  const ExpansionMatcher matcher({U"abce", U"bcd", U"cd"});
+  TYPR_CHECK(matches(matcher, U"abcd") ==
+             (std::vector<int32_t>{-1, -1, -1, 1}));
+  TYPR_CHECK(matches(matcher, U"abcxcd") ==
+             (std::vector<int32_t>{-1, -1, -1, -1, -1, 2}));
+}
+
+TYPR_TEST("expander/unicode and unknown characters") {
+  const ExpansionMatcher matcher({U"→é", U"zz"});
+  TYPR_CHECK(matches(matcher, U"a→é") == (std::vector<int32_t>{-1, -1, 0}));
+  TYPR_CHECK(matches(matcher, U"z→z") == (std::vector<int32_t>{-1, -1, -1}));
+  // Characters in no pattern lead back to the root
+  TYPR_CHECK(matcher.step(matcher.step(ExpansionMatcher::kRoot, U'z'), U'q') ==
+             ExpansionMatcher::kRoot);
+}
+
+TYPR_TEST("expander/large dictionary") {
+  std::vector<std::u32string> patterns;
+  for (int index = 0; index < 5000; ++index) {
+    std::u32string pattern = U";";
+    for (int value = index; value > 0 || pattern.size() == 1; value /= 26) {
+      pattern += static_cast<char32_t>(U'a' + (value % 26));
+    }
+    patterns.push_back(pattern);
+  }
+  const ExpansionMatcher matcher(patterns);
+  for (const int index : {0, 25, 26, 4999}) {
+    const auto result =
+        matches(matcher, U"text " + patterns[static_cast<std::size_t>(index)]);
+    TYPR_CHECK_EQ(result.back(), index);
+  }
+}
@@ -0,0 +1,84 @@
+#include "tests/harness.hpp"
+#include "tests/recording_backend.hpp"
+
+#include "core/text_inserter.hpp"
+
+#include <QClipboard>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QMimeData>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+using backend::Key;
+using core::TextInserter;
+using test::Injected;
+
+backend::Capabilities capabilities(bool keys, bool text) {
+  backend::Capabilities caps;
+  caps.canInjectKeys = keys;
+  caps.canInjectText = text;
+  return caps;
+}
+
+void processEventsFor(int ms) {
+  QElapsedTimer timer;
+  timer.start();
+  while (timer.elapsed() < ms) {
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 5);
+  }
+}
+
+} // namespace
+
+TYPR_TEST("inserter/strategy by size and capability") {
+  const auto both = capabilities(true, true);
+  TYPR_CHECK(TextInserter::choose(10, both, 256) ==
+             TextInserter::Strategy::Keystrokes);
+  TYPR_CHECK(TextInserter::choose(256, both, 256) ==
+             TextInserter::Strategy::Clipboard);
+  TYPR_CHECK(TextInserter::choose(100000, both, 0) ==
+             TextInserter::Strategy::Keystrokes);
+  // Keys only (uinput): the clipboard is the only way to insert text
+  TYPR_CHECK(TextInserter::choose(1, capabilities(true, false), 0) ==
+             TextInserter::Strategy::Clipboard);
+  TYPR_CHECK(TextInserter::choose(1000, capabilities(false, false), 256) ==
+             TextInserter::Strategy::Keystrokes);
+}
+
+TYPR_TEST("inserter/paste restores the clipboard") {
+  QClipboard *clipboard = QGuiApplication::clipboard();
+  auto *previous = new QMimeData();
+  previous->setText("previous");
+  previous->setData("application/x-typr-test", "extra");
+  clipboard->setMimeData(previous);
+
+  test::recording().injected.clear();
+  backend::InputBackend keyboard;
+  TextInserter::Config config;
+  config.pasteThreshold = 4;
+  config.pasteModifiers = backend::Modifier::Ctrl;
+  config.restoreDelay = std::chrono::milliseconds(20);
+  TextInserter inserter(&keyboard, config);
+
+  TYPR_CHECK(inserter.insert("long text"));
+  TYPR_CHECK(clipboard->text() == "long text");
+  TYPR_CHECK_EQ(test::recording().injected,
+                (std::vector<Injected>{test::down(Key::CtrlLeft, 0),
+                                       test::down(Key::V, 0),
+                                       test::up(Key::V, 0),
+                                       test::up(Key::CtrlLeft, 0)}));
+
+  processEventsFor(100);
+  TYPR_CHECK(clipboard->text() == "previous");
+  TYPR_CHECK(clipboard->mimeData()->data("application/x-typr-test") ==
+             "extra");
+
+  // Short texts are typed and leave the clipboard alone
+  test::recording().injected.clear();
+  TYPR_CHECK(inserter.insert("ab"));
+  TYPR_CHECK_EQ(test::recording().injected.size(), std::size_t{2});
+  TYPR_CHECK(clipboard->text() == "previous");
+}